@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pqbench.h"
+
+#define NUM_ITERATIONS 50
+
+#define POSITIONAL "<xml_file> <participants[,participants...]> <rtt_ms> <bandwidth_mbit> [non-pq|pq|hybrid|all]"
+
+typedef struct {
+    const char *kind;
+    const char *signature;
+    const char *kagree;
+    const pqb_family *family;
+} dds_suite;
+
+int main(int argc, char *argv[]) {
+    pqb_options opts;
+    int first = pqb_parse_args(argc, argv, POSITIONAL, &opts);
+    if (argc - first != 4 && argc - first != 5) {
+        pqb_usage(argv[0], POSITIONAL);
+    }
+
+    int participants[16];
+    int num_participants = 0;
+    char counts[256];
+    snprintf(counts, sizeof(counts), "%s", argv[first + 1]);
+    for (char *save = NULL, *n = strtok_r(counts, ",", &save); n; n = strtok_r(NULL, ",", &save)) {
+        if (num_participants == 16) {
+            pqb_usage(argv[0], POSITIONAL);
+        }
+        participants[num_participants] = atoi(n);
+        if (participants[num_participants] < 2 || participants[num_participants] > PQB_MESH_MAX_PARTICIPANTS) {
+            fprintf(stderr, "Participants must be between 2 and %d\n", PQB_MESH_MAX_PARTICIPANTS);
+            return EXIT_FAILURE;
+        }
+        num_participants++;
+    }
+    pqb_mesh_model model;
+    model.rtt_ms = atof(argv[first + 2]);
+    model.bandwidth_mbps = atof(argv[first + 3]);
+    const char *kind = argc - first == 5 ? argv[first + 4] : "all";
+    if (num_participants == 0 || model.rtt_ms < 0 || model.bandwidth_mbps < 0 ||
+        (strcmp(kind, "non-pq") != 0 && strcmp(kind, "pq") != 0 && strcmp(kind, "hybrid") != 0 &&
+         strcmp(kind, "all") != 0)) {
+        pqb_usage(argv[0], POSITIONAL);
+    }
+
+    // The wall clock, so CPU times are in the same unit as the round trips
+    pqb_bench bench;
+    pqb_bench_init(&bench, PQB_TIMER_WALL, NUM_ITERATIONS);
+    pqb_bench_load_provider(&bench, "default");
+    pqb_bench_load_provider(&bench, "oqsprovider");
+    pqb_bench_add_sink(&bench, pqb_text_sink_new(stdout));
+    pqb_apply_options(&bench, &opts);
+
+    // The participants' permissions document
+    size_t xml_size;
+    unsigned char *xml_data = pqb_map_file(argv[first], &xml_size);
+    pqb_bench_set_payload(&bench, xml_data, xml_size);
+
+    // The DDS-Security builtin suites, then their PQ and hybrid counterparts
+    const dds_suite suites[] = {
+        {"non-pq", "RSA-2048", "prime256v1", &pqb_dds_ecdh_handshake_family},
+        {"non-pq", "prime256v1", "prime256v1", &pqb_dds_ecdh_handshake_family},
+        {"pq", "dilithium3", "kyber768", &pqb_dds_kem_handshake_family},
+        {"pq", "falcon512", "kyber768", &pqb_dds_kem_handshake_family},
+        {"hybrid", "p256_dilithium3", "p256_kyber768", &pqb_dds_kem_handshake_family},
+        {"hybrid", "p256_falcon512", "x25519_kyber768", &pqb_dds_kem_handshake_family}
+    };
+    int num_suites = sizeof(suites) / sizeof(suites[0]);
+
+    char names[sizeof(suites) / sizeof(suites[0])][256];
+    for (int s = 0; s < num_suites; s++) {
+        const dds_suite *suite = &suites[s];
+        if (strcmp(kind, "all") != 0 && strcmp(kind, suite->kind) != 0) {
+            continue;
+        }
+        if (!pqb_key_type_available(bench.libctx, suite->signature) ||
+            !pqb_key_type_available(bench.libctx, suite->kagree)) {
+            fprintf(stderr, "%s+%s not available, skipping\n", suite->signature, suite->kagree);
+            continue;
+        }
+        snprintf(names[s], sizeof(names[s]), "%s+%s", suite->signature, suite->kagree);
+
+        // Each suite is measured once and then simulated at every size
+        pqb_dds_cost cost;
+        pqb_measure_dds_cost(&bench, suite->family, names[s], &cost);
+        for (int n = 0; n < num_participants; n++) {
+            pqb_mesh_estimate estimate;
+            pqb_simulate_mesh(&model, &cost, participants[n], &estimate);
+            pqb_report_mesh(&bench, &estimate);
+        }
+    }
+
+    int status = pqb_bench_free(&bench);
+    pqb_unmap_file(xml_data, xml_size);
+
+    return status;
+}
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pqbench.h"
+
+#define NUM_ITERATIONS 50
+
+#define POSITIONAL "<rtt_ms> <bandwidth_mbit> <chain_certs>"
+
+typedef struct {
+    const char *alg;
+    const pqb_family *family;
+} kex_suite;
+
+int main(int argc, char *argv[]) {
+    pqb_options opts;
+    int first = pqb_parse_args(argc, argv, POSITIONAL, &opts);
+    if (argc - first != 3) {
+        pqb_usage(argv[0], POSITIONAL);
+    }
+
+    pqb_cost_model model;
+    pqb_cost_model_default(&model);
+    model.rtt_ms = atof(argv[first]);
+    model.bandwidth_mbps = atof(argv[first + 1]);
+    model.chain_certs = atoi(argv[first + 2]);
+    if (model.rtt_ms < 0 || model.bandwidth_mbps <= 0 || model.chain_certs < 1) {
+        pqb_usage(argv[0], POSITIONAL);
+    }
+
+    // The wall clock, so both sides' CPU times are in the same unit as the
+    // round trips they are added to
+    pqb_bench bench;
+    pqb_bench_init(&bench, PQB_TIMER_WALL, NUM_ITERATIONS);
+    pqb_bench_load_provider(&bench, "default");
+    pqb_bench_load_provider(&bench, "oqsprovider");
+    pqb_bench_add_sink(&bench, pqb_text_sink_new(stdout));
+    pqb_apply_options(&bench, &opts);
+
+    const kex_suite kexes[] = {
+        {"prime256v1", &pqb_ecdh_handshake_family},
+        {"X25519", &pqb_ecdh_handshake_family},
+        {"kyber768", &pqb_kem_handshake_family},
+        {"x25519_kyber768", &pqb_kem_handshake_family}
+    };
+    int num_kexes = sizeof(kexes) / sizeof(kexes[0]);
+
+    const char *sigs[] = {
+        "RSA-2048",
+        "prime256v1",
+        "dilithium3",
+        "falcon512"
+    };
+    int num_sigs = sizeof(sigs) / sizeof(sigs[0]);
+
+    // Each algorithm is measured once and then combined with every other
+    pqb_kex_cost kex_costs[sizeof(kexes) / sizeof(kexes[0])];
+    int kex_available[sizeof(kexes) / sizeof(kexes[0])];
+    for (int k = 0; k < num_kexes; k++) {
+        kex_available[k] = pqb_key_type_available(bench.libctx, kexes[k].alg);
+        if (kex_available[k]) {
+            pqb_measure_kex_cost(&bench, kexes[k].family, kexes[k].alg, &kex_costs[k]);
+        } else {
+            fprintf(stderr, "%s not available, skipping\n", kexes[k].alg);
+        }
+    }
+    pqb_auth_cost auth_costs[sizeof(sigs) / sizeof(sigs[0])];
+    int sig_available[sizeof(sigs) / sizeof(sigs[0])];
+    for (int s = 0; s < num_sigs; s++) {
+        sig_available[s] = pqb_key_type_available(bench.libctx, sigs[s]);
+        if (sig_available[s]) {
+            pqb_measure_auth_cost(&bench, sigs[s], &auth_costs[s]);
+        } else {
+            fprintf(stderr, "%s not available, skipping\n", sigs[s]);
+        }
+    }
+
+    for (int k = 0; k < num_kexes; k++) {
+        for (int s = 0; s < num_sigs; s++) {
+            if (!kex_available[k] || !sig_available[s]) {
+                continue;
+            }
+            pqb_handshake_estimate estimate;
+            pqb_estimate_handshake(&model, &kex_costs[k], &auth_costs[s], &estimate);
+            pqb_report_handshake(&bench, &estimate);
+        }
+    }
+
+    int status = pqb_bench_free(&bench);
+
+    return status;
+}
@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pqbench.h"
+
+#define NUM_ITERATIONS 50
+
+int main(int argc, char *argv[]) {
+    pqb_options opts;
+    if (pqb_parse_args(argc, argv, "", &opts) != argc) {
+        pqb_usage(argv[0], "");
+    }
+
+    pqb_bench bench;
+    pqb_bench_init(&bench, PQB_TIMER_CPU_TIME, NUM_ITERATIONS);
+    pqb_bench_load_provider(&bench, "default");
+    pqb_bench_load_provider(&bench, "oqsprovider");
+    pqb_bench_add_sink(&bench, pqb_text_sink_new(stdout));
+    pqb_bench_add_sink(&bench, pqb_plot_sink_new());
+    pqb_apply_options(&bench, &opts);
+
+    // Classical exchanges the hybrids are built from
+    const char *classical[] = {
+        "X25519",
+        "prime256v1"
+    };
+    int num_classical = sizeof(classical) / sizeof(classical[0]);
+
+    pqb_run_all_with_options(&bench, &opts, &pqb_ecdh_handshake_family, classical, num_classical);
+
+    // Post-quantum and hybrid groups, all exposed as KEMs by oqsprovider
+    const char *kems[] = {
+        "kyber768",
+        "x25519_kyber768",
+        "p256_kyber768"
+    };
+    int num_kems = sizeof(kems) / sizeof(kems[0]);
+
+    pqb_run_all_with_options(&bench, &opts, &pqb_kem_handshake_family, kems, num_kems);
+
+    int status = pqb_bench_free(&bench);
+
+    return status;
+}
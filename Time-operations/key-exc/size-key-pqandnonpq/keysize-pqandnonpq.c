@@ -1,61 +1,13 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
-#include <openssl/evp.h>
-#include <openssl/ec.h>
-#include <openssl/pem.h>
 #include <oqs/oqs.h>
-#include <openssl/provider.h> // Include this header for OSSL_PROVIDER functions
 
-// Function to generate ECDH key pair for a specific curve
-EVP_PKEY* generate_ecdh_key(const char *curve_name) {
-    EVP_PKEY_CTX *ctx = NULL;
-    EVP_PKEY *pkey = NULL;
-    int curve_nid;
-
-    // Get the NID for the curve name
-    curve_nid = OBJ_sn2nid(curve_name);
-    if (curve_nid == NID_undef) {
-        fprintf(stderr, "Unknown curve name: %s\n", curve_name);
-        exit(EXIT_FAILURE);
-    }
-
-    // Create a new EVP_PKEY context for ECDH
-    ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
-    if (!ctx) {
-        fprintf(stderr, "Failed to create EVP_PKEY_CTX for ECDH\n");
-        exit(EXIT_FAILURE);
-    }
-
-    // Initialize key generation
-    if (EVP_PKEY_keygen_init(ctx) <= 0) {
-        fprintf(stderr, "Failed to initialize keygen for ECDH\n");
-        EVP_PKEY_CTX_free(ctx);
-        exit(EXIT_FAILURE);
-    }
-
-    // Set the curve name
-    if (EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, curve_nid) <= 0) {
-        fprintf(stderr, "Failed to set curve name: %s\n", curve_name);
-        EVP_PKEY_CTX_free(ctx);
-        exit(EXIT_FAILURE);
-    }
-
-    // Generate the key pair
-    if (EVP_PKEY_keygen(ctx, &pkey) <= 0) {
-        fprintf(stderr, "Failed to generate ECDH key pair for curve: %s\n", curve_name);
-        EVP_PKEY_CTX_free(ctx);
-        exit(EXIT_FAILURE);
-    }
-
-    EVP_PKEY_CTX_free(ctx);
-    return pkey;
-}
+#include "pqbench.h"
 
 // Function to display key sizes
 void display_key_sizes(EVP_PKEY *pkey, const char *alg) {
-    int priv_key_len = i2d_PrivateKey(pkey, NULL);
-    int pub_key_len = i2d_PUBKEY(pkey, NULL);
+    int priv_key_len, pub_key_len;
+    pqb_key_sizes(pkey, &priv_key_len, &pub_key_len);
 
     printf("Algorithm: %s\n", alg);
     printf("Private key size: %d bytes\n", priv_key_len);
@@ -90,7 +42,7 @@ void generate_kyber_key(const char *alg) {
     free(secret_key);
 }
 
-int main() {
+int main(void) {
     // Initialize OpenSSL
     OPENSSL_init_crypto(0, NULL);
     OSSL_PROVIDER *oqsprov = OSSL_PROVIDER_load(NULL, "oqsprovider");
@@ -105,7 +57,7 @@ int main() {
 
     // Generate and display ECDH key sizes
     for (int i = 0; i < num_ecdh_curves; i++) {
-        EVP_PKEY *pkey = generate_ecdh_key(ecdh_curves[i]);
+        EVP_PKEY *pkey = pqb_generate_key(NULL, ecdh_curves[i]);
         display_key_sizes(pkey, ecdh_curves[i]);
         EVP_PKEY_free(pkey);
     }
@@ -124,4 +76,4 @@ int main() {
     OPENSSL_cleanup();
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,89 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
-#include <openssl/evp.h>
-#include <openssl/pem.h>
-#include <openssl/ec.h>
-#include <openssl/rsa.h>
 #include <openssl/err.h>
-#include <oqs/oqs.h>
-#include <openssl/provider.h> // Include this header for OSSL_PROVIDER functions
-
-EVP_PKEY* generate_key(const char *alg) {
-    EVP_PKEY_CTX *ctx = NULL;
-    EVP_PKEY *pkey = NULL;
-
-    if (strncmp(alg, "RSA", 3) == 0) {
-        ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL);
-        if (!ctx) {
-            fprintf(stderr, "Failed to create EVP_PKEY_CTX for %s\n", alg);
-            exit(EXIT_FAILURE);
-        }
-
-        if (EVP_PKEY_keygen_init(ctx) <= 0) {
-            fprintf(stderr, "Failed to initialize keygen for %s\n", alg);
-            exit(EXIT_FAILURE);
-        }
-
-        int bits = 2048;
-        if (strcmp(alg, "RSA-3072") == 0) {
-            bits = 3072;
-        } else if (strcmp(alg, "RSA-4096") == 0) {
-            bits = 4096;
-        }
-
-        if (EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, bits) <= 0) {
-            fprintf(stderr, "Failed to set RSA key size\n");
-            exit(EXIT_FAILURE);
-        }
-    } else if (strncmp(alg, "prime", 5) == 0 || strncmp(alg, "secp", 4) == 0) {
-        ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
-        if (!ctx) {
-            fprintf(stderr, "Failed to create EVP_PKEY_CTX for %s\n", alg);
-            exit(EXIT_FAILURE);
-        }
-
-        if (EVP_PKEY_keygen_init(ctx) <= 0) {
-            fprintf(stderr, "Failed to initialize keygen for %s\n", alg);
-            exit(EXIT_FAILURE);
-        }
-
-        int curve_nid = NID_X9_62_prime256v1;
-        if (strcmp(alg, "secp384r1") == 0) {
-            curve_nid = NID_secp384r1;
-        } else if (strcmp(alg, "secp521r1") == 0) {
-            curve_nid = NID_secp521r1;
-        }
-
-        if (EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, curve_nid) <= 0) {
-            fprintf(stderr, "Failed to set EC curve\n");
-            exit(EXIT_FAILURE);
-        }
-    } else {
-        ctx = EVP_PKEY_CTX_new_from_name(NULL, alg, NULL);
-        if (!ctx) {
-            fprintf(stderr, "Failed to create EVP_PKEY_CTX for %s\n", alg);
-            exit(EXIT_FAILURE);
-        }
-
-        if (EVP_PKEY_keygen_init(ctx) <= 0) {
-            fprintf(stderr, "Failed to initialize keygen for %s\n", alg);
-            exit(EXIT_FAILURE);
-        }
-    }
-
-    if (EVP_PKEY_keygen(ctx, &pkey) <= 0) {
-        fprintf(stderr, "Failed to generate key pair for %s\n", alg);
-        exit(EXIT_FAILURE);
-    }
 
-    EVP_PKEY_CTX_free(ctx);
-    return pkey;
-}
+#include "pqbench.h"
 
 void display_key_sizes(EVP_PKEY *pkey, const char *alg) {
-    int priv_key_len = i2d_PrivateKey(pkey, NULL);
-    int pub_key_len = i2d_PUBKEY(pkey, NULL);
+    int priv_key_len, pub_key_len;
+    pqb_key_sizes(pkey, &priv_key_len, &pub_key_len);
 
     printf("Algorithm: %s\n", alg);
     printf("Private key size: %d bytes\n", priv_key_len);
@@ -116,24 +39,16 @@ int main(int argc, char *argv[]) {
     // Initialize OpenSSL
     OpenSSL_add_all_algorithms();
     ERR_load_crypto_strings();
+    OSSL_PROVIDER *defprov = OSSL_PROVIDER_load(NULL, "default");
     OSSL_PROVIDER *oqsprov = OSSL_PROVIDER_load(NULL, "oqsprovider");
-    if (!oqsprov) {
+    if (!defprov || !oqsprov) {
         fprintf(stderr, "Failed to load OQS provider\n");
         exit(EXIT_FAILURE);
     }
 
-    // Read file to sign
-    FILE *fp = fopen(file_to_sign, "rb");
-    if (!fp) {
-        fprintf(stderr, "Failed to open file %s\n", file_to_sign);
-        exit(EXIT_FAILURE);
-    }
-    fseek(fp, 0, SEEK_END);
-    long file_size = ftell(fp);
-    rewind(fp);
-    unsigned char *file_data = (unsigned char *)malloc(file_size);
-    fread(file_data, 1, file_size, fp);
-    fclose(fp);
+    // Map file to sign
+    size_t file_size;
+    unsigned char *file_data = pqb_map_file(file_to_sign, &file_size);
 
     // Algorithms to test
     const char *algorithms[] = {
@@ -157,7 +72,7 @@ int main(int argc, char *argv[]) {
 
     // Generate keys and display sizes
     for (int i = 0; i < num_algorithms; i++) {
-        EVP_PKEY *pkey = generate_key(algorithms[i]);
+        EVP_PKEY *pkey = pqb_generate_key(NULL, algorithms[i]);
         display_key_sizes(pkey, algorithms[i]);
 
         // Sign the file and display signature size
@@ -172,10 +87,11 @@ int main(int argc, char *argv[]) {
 
     // Clean up
     OSSL_PROVIDER_unload(oqsprov);
+    OSSL_PROVIDER_unload(defprov);
     EVP_cleanup();
     CRYPTO_cleanup_all_ex_data();
     ERR_free_strings();
-    free(file_data);
+    pqb_unmap_file(file_data, file_size);
 
     return 0;
-}
\ No newline at end of file
+}
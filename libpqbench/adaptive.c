@@ -0,0 +1,140 @@
+#include "bench.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "measure.h"
+#include "stats.h"
+
+// Passes added in one step, as a fraction of those already measured, so the
+// number of steps grows with the logarithm of the final sample count
+#define STEP_FRACTION 0.25
+
+typedef struct {
+    const char *alg;
+    const pqb_family *family;
+    void *state;
+    pqb_collected c;
+    double seconds; // wall time spent in measured passes
+    int done;
+} pair;
+
+// Widest relative half-width of any op's mean, from the normal approximation
+static double relative_half_width(const pqb_family *family, const pqb_collected *c, double z) {
+    double worst = 0.0;
+    int n = c->runs;
+    for (int o = 0; o < family->num_ops; o++) {
+        double sum = 0.0, sum_sq = 0.0;
+        for (int i = 0; i < n; i++) {
+            double x = (double)c->samples[o][i];
+            sum += x;
+            sum_sq += x * x;
+        }
+        double mean = sum / n;
+        double var = n > 1 ? (sum_sq - n * mean * mean) / (n - 1) : 0.0;
+        double h = mean > 0 ? z * sqrt(var > 0 ? var : 0) / sqrt((double)n) / mean : 0.0;
+        if (h > worst) {
+            worst = h;
+        }
+    }
+    return worst;
+}
+
+static void measure_passes(const pqb_bench *bench, pair *p, int passes) {
+    pqb_collected_reserve(&p->c, p->family, p->c.runs + passes);
+    uint64_t start = pqb_cycles_read_monotonic();
+    for (int i = 0; i < passes; i++) {
+        pqb_measure_pass(bench, p->family, p->state, &p->c);
+    }
+    p->seconds += (pqb_cycles_read_monotonic() - start) * 1e-9;
+}
+
+void pqb_bench_run_adaptive(pqb_bench *bench, const pqb_family *const families[], const char *const algs[],
+                            int num_algs) {
+    double z = pqb_normal_quantile(0.5 + bench->stats_options.confidence / 2);
+    uint64_t started = pqb_cycles_read_monotonic();
+    int min_runs = PQB_ADAPTIVE_MIN_RUNS;
+    pair *pairs = calloc(num_algs, sizeof(pair));
+    if (!pairs) {
+        fprintf(stderr, "Failed to allocate memory for %d algorithms\n", num_algs);
+        exit(EXIT_FAILURE);
+    }
+
+    // Every algorithm keeps its state, and so its keys and contexts, until
+    // the end, so later passes measure the same thing as the first ones
+    for (int a = 0; a < num_algs; a++) {
+        pair *p = &pairs[a];
+        p->alg = algs[a];
+        p->family = families[a];
+        p->state = p->family->create(bench, p->alg);
+        pqb_collected_init(&p->c, p->family, min_runs);
+        p->c.warmup_runs = pqb_bench_warm_up(bench, p->family, p->state, &bench->timer);
+        measure_passes(bench, p, min_runs);
+    }
+
+    for (;;) {
+        double elapsed = (pqb_cycles_read_monotonic() - started) * 1e-9;
+        double remaining = bench->time_budget - elapsed;
+        if (remaining <= 0) {
+            break;
+        }
+
+        // Pick the step that takes the most off an interval above target per
+        // second, assuming the half-width shrinks as 1 / sqrt(runs)
+        pair *best = NULL;
+        int best_step = 0;
+        double best_rate = 0.0;
+        for (int a = 0; a < num_algs; a++) {
+            pair *p = &pairs[a];
+            if (p->done) {
+                continue;
+            }
+            int n = p->c.runs;
+            double h = relative_half_width(p->family, &p->c, z);
+            if (h <= bench->target_ci || n >= bench->max_runs) {
+                p->done = 1;
+                continue;
+            }
+            double per_pass = p->seconds / n;
+            int step = (int)ceil(n * STEP_FRACTION);
+            if (step > bench->max_runs - n) {
+                step = bench->max_runs - n;
+            }
+            if (per_pass > 0 && step * per_pass > remaining) {
+                step = (int)(remaining / per_pass);
+                if (step < 1) {
+                    step = 1;
+                }
+            }
+            double next = h * sqrt((double)n / (n + step));
+            double gain = h - (next > bench->target_ci ? next : bench->target_ci);
+            double cost = step * per_pass;
+            double rate = cost > 0 ? gain / cost : INFINITY;
+            if (!best || rate > best_rate) {
+                best = p;
+                best_step = step;
+                best_rate = rate;
+            }
+        }
+        if (!best) {
+            break;
+        }
+        measure_passes(bench, best, best_step);
+    }
+
+    for (int a = 0; a < num_algs; a++) {
+        pair *p = &pairs[a];
+        double h = relative_half_width(p->family, &p->c, z);
+        if (h > bench->target_ci) {
+            fprintf(stderr, "%s: stopped at %d runs with a %.2f%% confidence interval, target %.2f%%\n", p->alg,
+                    p->c.runs, h * 100, bench->target_ci * 100);
+        }
+        pqb_collect_memory(bench, p->family, p->state, &p->c);
+        p->c.wire_bytes = p->family->wire_bytes ? p->family->wire_bytes(p->state) : 0;
+        p->family->destroy(p->state);
+        pqb_report_collected(bench, p->family, p->alg, &p->c);
+        pqb_collected_free(&p->c, p->family);
+    }
+    free(pairs);
+}
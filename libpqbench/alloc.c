@@ -0,0 +1,267 @@
+#include "alloc.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <openssl/crypto.h>
+
+#define MIN_CLASS_SHIFT 4  // 16 bytes
+#define MAX_CLASS_SHIFT 16 // 64 KiB
+#define NUM_CLASSES (MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1)
+#define LARGE_CLASS 0xff
+#define BLOCK_MAGIC 0x70716261u
+// Each thread carves its blocks out of a slab of the arena of its own
+#define SLAB_SIZE (256 * 1024)
+
+// Precedes every block handed out; 16 bytes so payloads stay 16-byte aligned
+typedef struct {
+    uint32_t magic;
+    uint32_t size_class; // LARGE_CLASS for blocks from malloc
+    size_t size;         // bytes requested
+} block_header;
+
+typedef struct free_block {
+    struct free_block *next;
+} free_block;
+
+static int active;
+static unsigned char *arena;
+static size_t arena_size;
+static _Atomic size_t arena_used;
+// Blocks of threads that have exited, for the others to take over
+static free_block *free_lists[NUM_CLASSES];
+static atomic_int spilled;
+static pthread_mutex_t spill_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t exit_key;
+static pthread_once_t exit_once = PTHREAD_ONCE_INIT;
+// Allocations and frees touch only the calling thread's lists and slab, so
+// threads never wait for each other inside a timed op
+static _Thread_local free_block *local_lists[NUM_CLASSES];
+static _Thread_local unsigned char *slab;
+static _Thread_local size_t slab_left;
+static _Thread_local pqb_alloc_count thread_count;
+// Bytes this thread has allocated less those it has freed, the most that has
+// been at any point since the last reset, and the level at that reset
+static _Thread_local int64_t thread_live;
+static _Thread_local int64_t thread_peak;
+static _Thread_local int64_t thread_peak_base;
+
+static void live_add(int64_t bytes) {
+    thread_live += bytes;
+    if (thread_live > thread_peak) {
+        thread_peak = thread_live;
+    }
+}
+
+static int size_class(size_t size) {
+    int c = 0;
+    while (((size_t)1 << (c + MIN_CLASS_SHIFT)) < size) {
+        c++;
+    }
+    return c;
+}
+
+static size_t class_chunk(int c) {
+    return sizeof(block_header) + ((size_t)1 << (c + MIN_CLASS_SHIFT));
+}
+
+static void push(free_block **list, void *p) {
+    free_block *fb = p;
+    fb->next = *list;
+    *list = fb;
+}
+
+// On thread exit: hand the thread's free blocks, and what is left of its
+// slab cut into blocks, to the threads that are still running
+static void spill(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&spill_lock);
+    for (int c = NUM_CLASSES - 1; c >= 0; c--) {
+        while (slab_left >= class_chunk(c)) {
+            push(&free_lists[c], slab);
+            slab += class_chunk(c);
+            slab_left -= class_chunk(c);
+        }
+        while (local_lists[c]) {
+            free_block *fb = local_lists[c];
+            local_lists[c] = fb->next;
+            push(&free_lists[c], fb);
+        }
+    }
+    atomic_store(&spilled, 1);
+    pthread_mutex_unlock(&spill_lock);
+}
+
+static void create_exit_key(void) {
+    pthread_key_create(&exit_key, spill);
+}
+
+static void *arena_take(int c) {
+    size_t chunk = class_chunk(c);
+    void *p = NULL;
+
+    if (!local_lists[c] && atomic_load_explicit(&spilled, memory_order_relaxed)) {
+        pthread_mutex_lock(&spill_lock);
+        local_lists[c] = free_lists[c];
+        free_lists[c] = NULL;
+        pthread_mutex_unlock(&spill_lock);
+    }
+    if (local_lists[c]) {
+        p = local_lists[c];
+        local_lists[c] = local_lists[c]->next;
+        return p;
+    }
+    if (slab_left < chunk) {
+        // A thread's first slab also arranges for its blocks to be spilled
+        if (!slab) {
+            pthread_once(&exit_once, create_exit_key);
+            pthread_setspecific(exit_key, arena);
+        }
+        size_t at = atomic_fetch_add_explicit(&arena_used, SLAB_SIZE, memory_order_relaxed);
+        if (at + SLAB_SIZE > arena_size) {
+            return NULL;
+        }
+        slab = arena + at;
+        slab_left = SLAB_SIZE;
+    }
+    p = slab;
+    slab += chunk;
+    slab_left -= chunk;
+    return p;
+}
+
+static void *block_alloc(size_t size) {
+    block_header *h = NULL;
+    uint32_t c = LARGE_CLASS;
+
+    if (arena && size <= ((size_t)1 << MAX_CLASS_SHIFT)) {
+        int sc = size_class(size);
+        h = arena_take(sc);
+        if (h) {
+            c = sc;
+        }
+    }
+    if (!h) {
+        h = malloc(sizeof(block_header) + size);
+        if (!h) {
+            return NULL;
+        }
+    }
+    h->magic = BLOCK_MAGIC;
+    h->size_class = c;
+    h->size = size;
+
+    thread_count.allocs++;
+    thread_count.bytes += size;
+    live_add((int64_t)size);
+    return h + 1;
+}
+
+static void block_free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    block_header *h = (block_header *)ptr - 1;
+    if (h->magic != BLOCK_MAGIC) {
+        fprintf(stderr, "Freeing memory not allocated by the libpqbench allocator\n");
+        abort();
+    }
+    live_add(-(int64_t)h->size);
+    if (h->size_class == LARGE_CLASS) {
+        h->magic = 0;
+        free(h);
+        return;
+    }
+
+    // The free list link overwrites the header, which is rewritten on reuse.
+    // A block another thread allocated joins this thread's list.
+    push(&local_lists[h->size_class], h);
+}
+
+static void *counted_malloc(size_t size, const char *file, int line) {
+    (void)file;
+    (void)line;
+    return block_alloc(size);
+}
+
+static void *counted_realloc(void *ptr, size_t size, const char *file, int line) {
+    (void)file;
+    (void)line;
+    if (!ptr) {
+        return block_alloc(size);
+    }
+    if (size == 0) {
+        block_free(ptr);
+        return NULL;
+    }
+
+    block_header *h = (block_header *)ptr - 1;
+    if (h->size_class != LARGE_CLASS && size <= ((size_t)1 << (h->size_class + MIN_CLASS_SHIFT))) {
+        live_add((int64_t)size - (int64_t)h->size);
+        h->size = size; // still fits in its size class
+        return ptr;
+    }
+    void *p = block_alloc(size);
+    if (p) {
+        memcpy(p, ptr, h->size < size ? h->size : size);
+        block_free(ptr);
+    }
+    return p;
+}
+
+static void counted_free(void *ptr, const char *file, int line) {
+    (void)file;
+    (void)line;
+    block_free(ptr);
+}
+
+int pqb_alloc_install(size_t arena_mib) {
+    const char *env = getenv("PQB_ARENA");
+    if (env && *env) {
+        arena_mib = strtoul(env, NULL, 10);
+    }
+
+    if (arena_mib > 0) {
+        arena_size = arena_mib << 20;
+        // MAP_POPULATE pre-faults every page of the arena up front
+        void *p = mmap(NULL, arena_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (p == MAP_FAILED) {
+            fprintf(stderr, "Failed to map a %zu MiB allocation arena, using malloc\n", arena_mib);
+            arena_size = 0;
+        } else {
+            arena = p;
+        }
+    }
+
+    if (!CRYPTO_set_mem_functions(counted_malloc, counted_realloc, counted_free)) {
+        fprintf(stderr, "OpenSSL has already allocated memory, allocations will not be counted\n");
+        if (arena) {
+            munmap(arena, arena_size);
+            arena = NULL;
+            arena_size = 0;
+        }
+        return 0;
+    }
+    active = 1;
+    return 1;
+}
+
+int pqb_alloc_active(void) {
+    return active;
+}
+
+void pqb_alloc_snapshot(pqb_alloc_count *count) {
+    *count = thread_count;
+}
+
+void pqb_alloc_peak_reset(void) {
+    thread_peak = thread_live;
+    thread_peak_base = thread_live;
+}
+
+uint64_t pqb_alloc_peak(void) {
+    return (uint64_t)(thread_peak - thread_peak_base);
+}
@@ -0,0 +1,41 @@
+#ifndef PQB_ALLOC_H
+#define PQB_ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define PQB_ARENA_DEFAULT_MIB 64
+
+// Allocations made by the calling thread through OpenSSL's allocator,
+// including the ones OpenSSL and the providers make internally
+typedef struct {
+    uint64_t allocs; // malloc and growing realloc calls
+    uint64_t bytes;  // bytes requested by them
+} pqb_alloc_count;
+
+// Route OpenSSL's allocations through libpqbench with CRYPTO_set_mem_functions.
+// They are counted per thread and, for a non-zero arena size, served from
+// one arena that is allocated and pre-faulted here, so no page fault or
+// glibc arena lock lands in a timed region. Every thread has size-class free
+// lists and a slab of the arena of its own, so threads take no lock to
+// allocate or free either; a thread's blocks go to the others when it
+// exits. Requests larger than the biggest size class, or made once the
+// arena is used up, fall through to malloc. The PQB_ARENA environment
+// variable overrides arena_mib, 0 keeps the system allocator and only counts.
+// Must run before OpenSSL allocates anything; returns 0 and leaves the
+// allocator alone if it is too late.
+int pqb_alloc_install(size_t arena_mib);
+
+// Whether allocations are being counted
+int pqb_alloc_active(void);
+
+void pqb_alloc_snapshot(pqb_alloc_count *count);
+
+// Peak heap of the calling thread: how far the bytes it has allocated and
+// not yet freed rose above their level at the last pqb_alloc_peak_reset.
+// Blocks freed by another thread than the one that allocated them skew both
+// threads' levels, so measure on a thread that does all its own freeing.
+void pqb_alloc_peak_reset(void);
+uint64_t pqb_alloc_peak(void);
+
+#endif
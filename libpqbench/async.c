@@ -0,0 +1,377 @@
+#include "bench.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/async.h>
+#include <openssl/opensslv.h>
+
+#include "measure.h"
+
+// One job slot: a family state of its own, going through the ops of one
+// pass after another, each op inside a job
+typedef struct {
+    void *state;
+    ASYNC_WAIT_CTX *wait;
+    ASYNC_JOB *job; // the paused job, NULL between ops
+    int op;         // op in flight or next to start
+    int pass;       // pass it belongs to, -1 once the slot has no more
+    uint64_t start; // when the job of the op in flight was started
+} slot;
+
+typedef struct {
+    const pqb_family *family;
+    slot *s;
+} job_args;
+
+static int job_main(void *arg) {
+    const job_args *a = arg;
+    a->family->ops[a->s->op].run(a->s->state);
+    return 1;
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30200000L
+// OpenSSL allocates job stacks of the size it passes in here, or of the
+// size set on the way out
+static void *stack_alloc(size_t *num) {
+    if (*num < PQB_ASYNC_STACK_BYTES) {
+        *num = PQB_ASYNC_STACK_BYTES;
+    }
+    return malloc(*num);
+}
+
+static void stack_free(void *addr) {
+    free(addr);
+}
+#endif
+
+// Before any job exists; post-quantum signing can need more stack than
+// OpenSSL's default. Before 3.2 the stacks are 32 KiB whatever we ask, which
+// only the built-in key types are known to fit in; returns whether alg can
+// run in a job.
+static int set_up_stacks(const char *alg) {
+#if OPENSSL_VERSION_NUMBER >= 0x30200000L
+    static int done = 0;
+    (void)alg;
+    if (!done && !ASYNC_set_mem_functions(stack_alloc, stack_free)) {
+        fprintf(stderr, "Failed to set the async job stacks, keeping OpenSSL's\n");
+    }
+    done = 1;
+    return 1;
+#else
+    if (!pqb_key_type_builtin(alg)) {
+        fprintf(stderr, "Skipping %s: OpenSSL before 3.2 runs async jobs on 32 KiB stacks, which only RSA, EC and "
+                        "X25519/X448/Ed25519/Ed448 are known to fit in\n",
+                alg);
+        return 0;
+    }
+    return 1;
+#endif
+}
+
+typedef struct {
+    uint64_t **samples; // [op][pass]
+    uint64_t *pauses;   // [op]
+    double wall_seconds;
+} point;
+
+// Depth 0: the ops called directly, as every other mode does
+static void run_sync(const pqb_bench *bench, const pqb_family *family, void *state, const pqb_timer *timer,
+                     point *p) {
+    uint64_t started = pqb_cycles_read_monotonic();
+    for (int i = 0; i < bench->runs; i++) {
+        for (int o = 0; o < family->num_ops; o++) {
+            const pqb_op *op = &family->ops[o];
+            if (op->prepare) {
+                op->prepare(state);
+            }
+            uint64_t start = pqb_timer_start(timer);
+            op->run(state);
+            uint64_t stop = pqb_timer_stop(timer);
+            p->samples[o][i] = pqb_timer_elapsed(timer, start, stop);
+            if (op->finish) {
+                op->finish(state);
+            }
+        }
+    }
+    p->wall_seconds = (pqb_cycles_read_monotonic() - started) * 1e-9;
+}
+
+// Start the slot's job, or resume it once paused; returns ASYNC_FINISH,
+// ASYNC_PAUSE or ASYNC_NO_JOBS, which leaves it to start next round
+static int step(const pqb_family *family, slot *s, const char *alg, const pqb_timer *timer) {
+    job_args args = {family, s};
+    int ret = 0;
+    if (!s->job) {
+        s->start = pqb_timer_start(timer);
+    }
+    int status = ASYNC_start_job(&s->job, s->wait, &ret, job_main, &args, sizeof(args));
+    if (status == ASYNC_ERR) {
+        fprintf(stderr, "Failed to run %s %s in an async job\n", alg, family->ops[s->op].name);
+        exit(EXIT_FAILURE);
+    }
+    if (status == ASYNC_FINISH) {
+        s->job = NULL;
+    }
+    return status;
+}
+
+static void prepare_op(const pqb_family *family, slot *s) {
+    const pqb_op *op = &family->ops[s->op];
+    if (op->prepare) {
+        op->prepare(s->state);
+    }
+}
+
+// Wait for a wait fd of any paused slot, or not at all if one of them has
+// none to wait on or is still to start its job; marks the slots worth
+// stepping in ready. got is scratch for max_fds fds.
+static void wait_for_paused(slot *slots, int depth, struct pollfd *fds, int *fd_slot, OSSL_ASYNC_FD *got, int max_fds,
+                            int *ready) {
+    int num_fds = 0;
+    int any_without = 0;
+    for (int d = 0; d < depth; d++) {
+        ready[d] = 0;
+        if (slots[d].pass < 0) {
+            continue;
+        }
+        if (!slots[d].job) {
+            ready[d] = 1;
+            any_without = 1;
+            continue;
+        }
+        size_t n = 0;
+        ASYNC_WAIT_CTX_get_all_fds(slots[d].wait, NULL, &n);
+        if (n == 0 || num_fds + (int)n > max_fds) {
+            ready[d] = 1;
+            any_without = 1;
+            continue;
+        }
+        ASYNC_WAIT_CTX_get_all_fds(slots[d].wait, got, &n);
+        for (size_t f = 0; f < n; f++) {
+            fds[num_fds].fd = got[f];
+            fds[num_fds].events = POLLIN;
+            fds[num_fds].revents = 0;
+            fd_slot[num_fds++] = d;
+        }
+    }
+    if (num_fds == 0) {
+        return;
+    }
+    int n = poll(fds, num_fds, any_without ? 0 : PQB_ASYNC_POLL_MS);
+    if (n < 0 && errno != EINTR) {
+        fprintf(stderr, "Failed to poll the async wait fds: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    // A provider that never signals still gets its jobs resumed
+    for (int f = 0; f < num_fds; f++) {
+        if (n <= 0 || fds[f].revents) {
+            ready[fd_slot[f]] = 1;
+        }
+    }
+}
+
+static void run_async(const pqb_bench *bench, const pqb_family *family, const char *alg, slot *slots, int depth,
+                      const pqb_timer *timer, point *p) {
+    int runs = bench->runs;
+    int next_pass = 0;
+    int max_fds = depth * 4;
+    struct pollfd *fds = pqb_xcalloc(max_fds, sizeof(struct pollfd), "async mode");
+    int *fd_slot = pqb_xcalloc(max_fds, sizeof(int), "async mode");
+    OSSL_ASYNC_FD *got = pqb_xcalloc(max_fds, sizeof(OSSL_ASYNC_FD), "async mode");
+    int *ready = pqb_xcalloc(depth, sizeof(int), "async mode");
+
+    uint64_t started = pqb_cycles_read_monotonic();
+    int active = 0;
+    for (int d = 0; d < depth; d++) {
+        slots[d].job = NULL;
+        slots[d].op = 0;
+        slots[d].pass = next_pass < runs ? next_pass++ : -1;
+        if (slots[d].pass >= 0) {
+            prepare_op(family, &slots[d]);
+            active++;
+        }
+        ready[d] = 1;
+    }
+    while (active > 0) {
+        int paused = 0;
+        for (int d = 0; d < depth; d++) {
+            slot *s = &slots[d];
+            if (s->pass < 0) {
+                continue;
+            }
+            if (!ready[d]) {
+                paused++;
+                continue;
+            }
+            int status = step(family, s, alg, timer);
+            if (status == ASYNC_PAUSE) {
+                p->pauses[s->op]++;
+                paused++;
+                continue;
+            }
+            if (status == ASYNC_NO_JOBS) {
+                continue;
+            }
+            uint64_t stop = pqb_timer_stop(timer);
+            const pqb_op *op = &family->ops[s->op];
+            p->samples[s->op][s->pass] = pqb_timer_elapsed(timer, s->start, stop);
+            if (op->finish) {
+                op->finish(s->state);
+            }
+            if (++s->op == family->num_ops) {
+                s->op = 0;
+                s->pass = next_pass < runs ? next_pass++ : -1;
+            }
+            if (s->pass < 0) {
+                active--;
+            } else {
+                prepare_op(family, s);
+            }
+        }
+        if (paused > 0) {
+            wait_for_paused(slots, depth, fds, fd_slot, got, max_fds, ready);
+        } else {
+            for (int d = 0; d < depth; d++) {
+                ready[d] = 1;
+            }
+        }
+    }
+    p->wall_seconds = (pqb_cycles_read_monotonic() - started) * 1e-9;
+
+    free(ready);
+    free(fd_slot);
+    free(got);
+    free(fds);
+}
+
+// The passes of a point overlap, so an op's throughput is taken over its
+// share of the wall time, in proportion to the summed latency of each op
+static void report(const pqb_bench *bench, const pqb_family *family, const char *alg, int depth, const point *p,
+                   double *base_ops_per_sec, const pqb_timer *timer) {
+    double total_latency = 0.0;
+    double *latency = pqb_xcalloc(family->num_ops, sizeof(double), "async mode");
+    for (int o = 0; o < family->num_ops; o++) {
+        for (int i = 0; i < bench->runs; i++) {
+            latency[o] += p->samples[o][i];
+        }
+        total_latency += latency[o];
+    }
+    for (int o = 0; o < family->num_ops; o++) {
+        pqb_async_result result;
+        result.algorithm = alg;
+        result.op = &family->ops[o];
+        result.depth = depth;
+        result.wall_seconds = p->wall_seconds;
+        result.ops_per_sample = result.op->batched ? bench->batch_size : 1;
+        double share = total_latency > 0 ? p->wall_seconds * latency[o] / total_latency : 0.0;
+        result.ops_per_sec = share > 0 ? (double)bench->runs * result.ops_per_sample / share : 0.0;
+        if (depth == 0) {
+            base_ops_per_sec[o] = result.ops_per_sec;
+        }
+        result.speedup = base_ops_per_sec[o] > 0 ? result.ops_per_sec / base_ops_per_sec[o] : 0.0;
+        result.pauses = p->pauses[o];
+        result.timer = timer;
+        pqb_compute_statistics(p->samples[o], bench->runs, &bench->stats_options, &result.stats);
+        for (int s = 0; s < bench->num_sinks; s++) {
+            if (bench->sinks[s]->async) {
+                bench->sinks[s]->async(bench->sinks[s], &result);
+            }
+        }
+    }
+    free(latency);
+}
+
+void pqb_bench_run_async(pqb_bench *bench, const pqb_family *family, const char *alg, const pqb_async_options *options) {
+    if (!ASYNC_is_capable()) {
+        fprintf(stderr, "This OpenSSL build cannot run async jobs\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!set_up_stacks(alg)) {
+        return;
+    }
+
+    int num_ops = family->num_ops;
+    int max_depth = 1;
+    for (int i = 0; i < options->num_depths; i++) {
+        if (options->depths[i] > max_depth) {
+            max_depth = options->depths[i];
+        }
+    }
+    pqb_timer timer;
+    pqb_timer_init(&timer, PQB_TIMER_WALL);
+    point p;
+    p.samples = pqb_xcalloc(num_ops, sizeof(uint64_t *), "async mode");
+    for (int o = 0; o < num_ops; o++) {
+        p.samples[o] = pqb_xcalloc(bench->runs, sizeof(uint64_t), "async mode");
+    }
+    p.pauses = pqb_xcalloc(num_ops, sizeof(uint64_t), "async mode");
+    double *base_ops_per_sec = pqb_xcalloc(num_ops, sizeof(double), "async mode");
+
+    // Every slot has its own keys and contexts, as a thread would, created
+    // and warmed up before any point is timed; none come from the bench's
+    // shared keys
+    pqb_bench local = *bench;
+    local.keys = NULL;
+    slot *slots = pqb_xcalloc(max_depth, sizeof(slot), "async mode");
+    for (int d = 0; d < max_depth; d++) {
+        slots[d].state = family->create(&local, alg);
+        slots[d].wait = ASYNC_WAIT_CTX_new();
+        if (!slots[d].wait) {
+            fprintf(stderr, "Failed to create an async wait context\n");
+            exit(EXIT_FAILURE);
+        }
+        pqb_bench_warm_up(bench, family, slots[d].state, &timer);
+        // Whatever the warmup, one pass each so that the synchronous point,
+        // measured first, is not the only one to pay for first use
+        for (int o = 0; o < num_ops; o++) {
+            const pqb_op *op = &family->ops[o];
+            if (op->prepare) {
+                op->prepare(slots[d].state);
+            }
+            op->run(slots[d].state);
+            if (op->finish) {
+                op->finish(slots[d].state);
+            }
+        }
+    }
+
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->begin) {
+            bench->sinks[s]->begin(bench->sinks[s], alg);
+        }
+    }
+    run_sync(bench, family, slots[0].state, &timer, &p);
+    report(bench, family, alg, 0, &p, base_ops_per_sec, &timer);
+    for (int i = 0; i < options->num_depths; i++) {
+        int depth = options->depths[i];
+        if (!ASYNC_init_thread(depth, depth)) {
+            fprintf(stderr, "Failed to set up %d async jobs\n", depth);
+            exit(EXIT_FAILURE);
+        }
+        memset(p.pauses, 0, num_ops * sizeof(uint64_t));
+        run_async(bench, family, alg, slots, depth, &timer, &p);
+        ASYNC_cleanup_thread();
+        report(bench, family, alg, depth, &p, base_ops_per_sec, &timer);
+    }
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->end) {
+            bench->sinks[s]->end(bench->sinks[s], alg);
+        }
+    }
+
+    for (int d = 0; d < max_depth; d++) {
+        ASYNC_WAIT_CTX_free(slots[d].wait);
+        family->destroy(slots[d].state);
+    }
+    free(slots);
+    free(base_ops_per_sec);
+    free(p.pauses);
+    for (int o = 0; o < num_ops; o++) {
+        free(p.samples[o]);
+    }
+    free(p.samples);
+    pqb_timer_close(&timer);
+}
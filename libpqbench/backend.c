@@ -0,0 +1,163 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "keys.h"
+#include "oqs.h"
+
+// Providers of one backend live in a library context of their own, so two
+// builds of the same provider, or the FIPS and default providers, never see
+// each other's algorithms or properties
+
+void pqb_bench_add_backend(pqb_bench *bench, const char *spec) {
+    if (bench->num_backends == PQB_MAX_BACKENDS) {
+        fprintf(stderr, "Too many backends, cannot add %s\n", spec);
+        exit(EXIT_FAILURE);
+    }
+    pqb_backend *backend = &bench->backends[bench->num_backends];
+    memset(backend, 0, sizeof(*backend));
+
+    if (strcmp(spec, "liboqs") == 0) {
+#if PQB_HAVE_LIBOQS
+        snprintf(backend->name, sizeof(backend->name), "liboqs");
+        backend->liboqs = 1;
+        bench->num_backends++;
+        return;
+#else
+        fprintf(stderr, "Built without liboqs, cannot add the liboqs backend\n");
+        exit(EXIT_FAILURE);
+#endif
+    }
+
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    char *colon = strchr(buf, ':');
+    if (!colon || colon == buf || (size_t)(colon - buf) >= sizeof(backend->name)) {
+        fprintf(stderr, "Invalid backend %s, expected liboqs or NAME:PROVIDER[+PROVIDER...][,config=FILE][,modules=DIR]\n",
+                spec);
+        exit(EXIT_FAILURE);
+    }
+    *colon = '\0';
+    memcpy(backend->name, buf, colon - buf);
+
+    char *save = NULL;
+    char *providers = strtok_r(colon + 1, ",", &save);
+    const char *config = NULL, *modules = NULL;
+    for (char *opt = strtok_r(NULL, ",", &save); opt; opt = strtok_r(NULL, ",", &save)) {
+        if (strncmp(opt, "config=", 7) == 0) {
+            config = opt + 7;
+        } else if (strncmp(opt, "modules=", 8) == 0) {
+            modules = opt + 8;
+        } else {
+            fprintf(stderr, "Unknown option %s of backend %s\n", opt, backend->name);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (!providers) {
+        fprintf(stderr, "Backend %s names no providers\n", backend->name);
+        exit(EXIT_FAILURE);
+    }
+
+    backend->libctx = OSSL_LIB_CTX_new();
+    if (!backend->libctx) {
+        fprintf(stderr, "Failed to create the library context of backend %s\n", backend->name);
+        exit(EXIT_FAILURE);
+    }
+    // The config comes first, as a FIPS provider needs its module config
+    // before it can be loaded
+    if (config && !OSSL_LIB_CTX_load_config(backend->libctx, config)) {
+        fprintf(stderr, "Failed to load %s into backend %s\n", config, backend->name);
+        exit(EXIT_FAILURE);
+    }
+    if (modules && !OSSL_PROVIDER_set_default_search_path(backend->libctx, modules)) {
+        fprintf(stderr, "Failed to set the provider search path of backend %s\n", backend->name);
+        exit(EXIT_FAILURE);
+    }
+    char *save_prov = NULL;
+    for (char *p = strtok_r(providers, "+", &save_prov); p; p = strtok_r(NULL, "+", &save_prov)) {
+        if (backend->num_providers == PQB_MAX_PROVIDERS) {
+            fprintf(stderr, "Too many providers in backend %s\n", backend->name);
+            exit(EXIT_FAILURE);
+        }
+        OSSL_PROVIDER *prov = OSSL_PROVIDER_load(backend->libctx, p);
+        if (!prov) {
+            fprintf(stderr, "Failed to load %s provider into backend %s\n", p, backend->name);
+            exit(EXIT_FAILURE);
+        }
+        backend->providers[backend->num_providers++] = prov;
+    }
+    bench->num_backends++;
+}
+
+// The family to run against the backend, or NULL if it cannot run alg
+static const pqb_family *backend_family(const pqb_backend *backend, const pqb_family *family, const char *alg) {
+    if (!backend->liboqs) {
+        return pqb_key_type_available(backend->libctx, alg) ? family : NULL;
+    }
+#if PQB_HAVE_LIBOQS
+    if (family->liboqs && family->algorithms == PQB_ALGS_SIGNATURE && pqb_oqs_sig_name(alg)) {
+        return family->liboqs;
+    }
+    if (family->liboqs && family->algorithms == PQB_ALGS_KEM && pqb_oqs_kem_name(alg)) {
+        return family->liboqs;
+    }
+#endif
+    return NULL;
+}
+
+void pqb_bench_run_backends(pqb_bench *bench, const pqb_family *family, const char *alg) {
+    int num_ops = family->num_ops;
+    int measured[PQB_MAX_BACKENDS];
+    pqb_stats *stats = calloc((size_t)bench->num_backends * num_ops, sizeof(pqb_stats));
+    if (!stats) {
+        fprintf(stderr, "Failed to allocate memory for %d backends\n", bench->num_backends);
+        exit(EXIT_FAILURE);
+    }
+
+    // The families read the library context from the bench when they create
+    // their state, so swapping it is all it takes to change backend
+    OSSL_LIB_CTX *libctx = bench->libctx;
+    int num_measured = 0;
+    for (int b = 0; b < bench->num_backends; b++) {
+        const pqb_backend *backend = &bench->backends[b];
+        const pqb_family *f = backend_family(backend, family, alg);
+        measured[b] = f != NULL;
+        if (!f) {
+            fprintf(stderr, "Backend %s cannot run %s for the %s family, skipping it\n", backend->name, alg,
+                    family->name);
+            continue;
+        }
+        bench->libctx = backend->libctx;
+        pqb_bench_measure(bench, f, alg, &stats[b * num_ops]);
+        num_measured++;
+    }
+    bench->libctx = libctx;
+    if (num_measured == 0) {
+        free(stats);
+        return;
+    }
+
+    pqb_comparison_result result;
+    result.algorithm = alg;
+    result.family = family;
+    result.num_backends = bench->num_backends;
+    result.backends = bench->backends;
+    result.measured = measured;
+    result.stats = stats;
+    result.timer = &bench->timer;
+    for (int s = 0; s < bench->num_sinks; s++) {
+        pqb_sink *sink = bench->sinks[s];
+        if (sink->begin) {
+            sink->begin(sink, alg);
+        }
+        if (sink->comparison) {
+            sink->comparison(sink, &result);
+        }
+        if (sink->end) {
+            sink->end(sink, alg);
+        }
+    }
+    free(stats);
+}
@@ -0,0 +1,402 @@
+#include "baseline.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/params.h>
+
+#include "config.h"
+#include "cpufeatures.h"
+#include "oqs.h"
+#include "stats.h"
+#include "writer.h"
+
+// 64-bit FNV-1a of s, as 16 hex digits
+static void hash_hex(const char *s, char out[17]) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 0x100000001b3ULL;
+    }
+    snprintf(out, 17, "%016llx", (unsigned long long)h);
+}
+
+static void append(char *buf, size_t size, const char *fmt, const char *a, const char *b) {
+    size_t len = strlen(buf);
+    if (len < size) {
+        snprintf(buf + len, size - len, fmt, a, b);
+    }
+}
+
+static void cpu_model(char *out, size_t size) {
+    char line[256];
+    snprintf(out, size, "unknown cpu");
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (!f) {
+        return;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        char *colon = strchr(line, ':');
+        if (colon && strncmp(line, "model name", 10) == 0) {
+            char *v = colon + 1;
+            v += strspn(v, " \t");
+            v[strcspn(v, "\n")] = '\0';
+            snprintf(out, size, "%s", v);
+            break;
+        }
+    }
+    fclose(f);
+}
+
+void pqb_fingerprint_get(const pqb_bench *bench, pqb_fingerprint *fp) {
+    char model[256], hostname[128] = "unknown";
+    struct utsname un;
+    cpu_model(model, sizeof(model));
+    gethostname(hostname, sizeof(hostname) - 1);
+    hostname[sizeof(hostname) - 1] = '\0';
+    if (uname(&un) != 0) {
+        snprintf(un.machine, sizeof(un.machine), "unknown");
+    }
+    // A run with features masked is a different host as far as its results go
+    pqb_cpu_features features;
+    pqb_cpu_features_get(&features);
+    snprintf(fp->host, sizeof(fp->host), "%s, %ld cpus, %s, %s", model, sysconf(_SC_NPROCESSORS_CONF), un.machine,
+             hostname);
+    append(fp->host, sizeof(fp->host), ", features %s, masks %s", features.detected, features.masks);
+    hash_hex(fp->host, fp->host_id);
+
+    snprintf(fp->versions, sizeof(fp->versions), "%s", OpenSSL_version(OPENSSL_VERSION));
+    for (int i = 0; i < bench->num_providers; i++) {
+        char *version = "unknown";
+        OSSL_PARAM params[2];
+        params[0] = OSSL_PARAM_construct_utf8_ptr(OSSL_PROV_PARAM_VERSION, &version, 0);
+        params[1] = OSSL_PARAM_construct_end();
+        OSSL_PROVIDER_get_params(bench->providers[i], params);
+        append(fp->versions, sizeof(fp->versions), ", %s %s", OSSL_PROVIDER_get0_name(bench->providers[i]), version);
+    }
+#if PQB_HAVE_LIBOQS
+    append(fp->versions, sizeof(fp->versions), ", %s %s", "liboqs", OQS_version());
+#endif
+    hash_hex(fp->versions, fp->versions_id);
+}
+
+// mkdir -p
+static void make_dirs(const char *path) {
+    char buf[4096];
+    snprintf(buf, sizeof(buf), "%s", path);
+    for (char *p = buf + 1; ; p++) {
+        if (*p == '/' || *p == '\0') {
+            char c = *p;
+            *p = '\0';
+            if (mkdir(buf, 0777) != 0 && errno != EEXIST) {
+                fprintf(stderr, "Failed to create baseline directory %s: %s\n", buf, strerror(errno));
+                exit(EXIT_FAILURE);
+            }
+            *p = c;
+            if (c == '\0') {
+                break;
+            }
+        }
+    }
+}
+
+// Saving
+
+typedef struct {
+    pqb_sink base;
+    pqb_writer *w;
+} baseline_sink;
+
+static void baseline_result(pqb_sink *sink, const pqb_result *r) {
+    baseline_sink *bs = (baseline_sink *)sink;
+    pqb_writer_write(bs->w, "{\"algorithm\":", 13);
+    pqb_writer_json_string(bs->w, r->algorithm);
+    pqb_writer_printf(bs->w, ",\"op\":\"%s\",\"unit\":\"%s\",\"ops_per_sample\":%d,\"samples\":[", r->op->name,
+                      pqb_timer_raw_unit(r->timer), r->ops_per_sample);
+    for (int i = 0; i < r->num_samples; i++) {
+        pqb_writer_printf(bs->w, "%s%llu", i ? "," : "", (unsigned long long)r->samples[i]);
+    }
+    pqb_writer_write(bs->w, "]}\n", 3);
+}
+
+static void baseline_close(pqb_sink *sink) {
+    baseline_sink *bs = (baseline_sink *)sink;
+    pqb_writer_close(bs->w);
+    free(bs);
+}
+
+pqb_sink *pqb_baseline_sink_new(const char *dir, const char *program, const pqb_fingerprint *fp) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s/%s", dir, fp->host_id, fp->versions_id);
+    make_dirs(path);
+    snprintf(path, sizeof(path), "%s/%s/%s/%s.ndjson", dir, fp->host_id, fp->versions_id, program);
+
+    baseline_sink *bs = calloc(1, sizeof(*bs));
+    if (!bs) {
+        fprintf(stderr, "Failed to allocate baseline sink for %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    bs->base.result = baseline_result;
+    bs->base.close = baseline_close;
+    bs->w = pqb_writer_open(path);
+    pqb_writer_write(bs->w, "{\"host\":", 8);
+    pqb_writer_json_string(bs->w, fp->host);
+    pqb_writer_printf(bs->w, ",\"host_id\":\"%s\",\"versions\":", fp->host_id);
+    pqb_writer_json_string(bs->w, fp->versions);
+    pqb_writer_printf(bs->w, ",\"versions_id\":\"%s\"}\n", fp->versions_id);
+    return &bs->base;
+}
+
+// Loading
+
+typedef struct {
+    char algorithm[256];
+    char op[64];
+    char unit[16];
+    int ops_per_sample;
+    uint64_t *samples;
+    size_t num_samples;
+} baseline_entry;
+
+// The string value of key in one line of a baseline, unescaped into out;
+// returns 0 if the line has no such key
+static int string_field(const char *line, const char *key, char *out, size_t size) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":\"", key);
+    const char *p = strstr(line, pattern);
+    if (!p) {
+        return 0;
+    }
+    size_t n = 0;
+    for (p += strlen(pattern); *p && *p != '"' && n + 1 < size; p++) {
+        if (*p == '\\' && p[1] == 'u') {
+            char hex[5] = {0};
+            memcpy(hex, p + 2, strnlen(p + 2, 4));
+            out[n++] = (char)strtol(hex, NULL, 16);
+            p += 1 + strlen(hex);
+        } else if (*p == '\\' && p[1]) {
+            out[n++] = *++p;
+        } else {
+            out[n++] = *p;
+        }
+    }
+    out[n] = '\0';
+    return 1;
+}
+
+// On failure e->samples is NULL or allocated, for the caller to free
+static int parse_entry(const char *line, baseline_entry *e) {
+    memset(e, 0, sizeof(*e));
+    const char *ops = strstr(line, "\"ops_per_sample\":");
+    const char *samples = strstr(line, "\"samples\":[");
+    if (!string_field(line, "algorithm", e->algorithm, sizeof(e->algorithm)) ||
+        !string_field(line, "op", e->op, sizeof(e->op)) || !string_field(line, "unit", e->unit, sizeof(e->unit)) ||
+        !ops || !samples) {
+        return 0;
+    }
+    e->ops_per_sample = atoi(ops + 17);
+
+    size_t capacity = 64;
+    e->samples = malloc(capacity * sizeof(uint64_t));
+    const char *p = samples + 11;
+    while (e->samples && *p && *p != ']') {
+        char *end;
+        unsigned long long v = strtoull(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        if (e->num_samples == capacity) {
+            capacity *= 2;
+            e->samples = realloc(e->samples, capacity * sizeof(uint64_t));
+            if (!e->samples) {
+                break;
+            }
+        }
+        e->samples[e->num_samples++] = v;
+        p = end + (*end == ',');
+    }
+    if (!e->samples) {
+        fprintf(stderr, "Failed to allocate memory for the baseline\n");
+        exit(EXIT_FAILURE);
+    }
+    return e->num_samples > 0;
+}
+
+// The baseline of program for this host whose file changed last, or 0 if
+// there is none
+static int newest_baseline(const char *dir, const char *program, const pqb_fingerprint *fp, char *path,
+                           size_t size) {
+    char host_dir[2048], candidate[4096];
+    snprintf(host_dir, sizeof(host_dir), "%s/%s", dir, fp->host_id);
+    DIR *d = opendir(host_dir);
+    if (!d) {
+        return 0;
+    }
+    struct timespec newest = {0, 0};
+    int found = 0;
+    struct dirent *de;
+    while ((de = readdir(d))) {
+        if (de->d_name[0] == '.') {
+            continue;
+        }
+        struct stat st;
+        snprintf(candidate, sizeof(candidate), "%s/%s/%s.ndjson", host_dir, de->d_name, program);
+        if (stat(candidate, &st) != 0) {
+            continue;
+        }
+        if (!found || st.st_mtim.tv_sec > newest.tv_sec ||
+            (st.st_mtim.tv_sec == newest.tv_sec && st.st_mtim.tv_nsec > newest.tv_nsec)) {
+            newest = st.st_mtim;
+            snprintf(path, size, "%s", candidate);
+            found = 1;
+        }
+    }
+    closedir(d);
+    return found;
+}
+
+// Comparing
+
+typedef struct {
+    pqb_sink base;
+    FILE *out;
+    char path[4096];
+    baseline_entry *entries;
+    int num_entries;
+    double threshold;
+    int *status;
+    int compared;
+    int regressions;
+    int improvements;
+} regression_sink;
+
+static void load_baseline(regression_sink *rs, const pqb_fingerprint *fp) {
+    FILE *f = fopen(rs->path, "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open baseline %s: %s\n", rs->path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    char *line = NULL;
+    size_t line_size = 0;
+    int capacity = 0;
+    char versions[sizeof(fp->versions)] = "unknown";
+    for (int n = 0; getline(&line, &line_size, f) > 0; n++) {
+        if (n == 0) {
+            string_field(line, "versions", versions, sizeof(versions));
+            continue;
+        }
+        if (rs->num_entries == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            rs->entries = realloc(rs->entries, capacity * sizeof(baseline_entry));
+            if (!rs->entries) {
+                fprintf(stderr, "Failed to allocate memory for the baseline\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        if (parse_entry(line, &rs->entries[rs->num_entries])) {
+            rs->num_entries++;
+        } else {
+            free(rs->entries[rs->num_entries].samples);
+        }
+    }
+    free(line);
+    fclose(f);
+    fprintf(rs->out, "Baseline: %s, %d ops, versions %s\n", rs->path, rs->num_entries, versions);
+    if (strcmp(versions, fp->versions) != 0) {
+        fprintf(rs->out, "Baseline: now running %s\n", fp->versions);
+    }
+}
+
+static const baseline_entry *find_entry(const regression_sink *rs, const char *algorithm, const char *op) {
+    for (int i = 0; i < rs->num_entries; i++) {
+        if (strcmp(rs->entries[i].algorithm, algorithm) == 0 && strcmp(rs->entries[i].op, op) == 0) {
+            return &rs->entries[i];
+        }
+    }
+    return NULL;
+}
+
+static void regression_result(pqb_sink *sink, const pqb_result *r) {
+    regression_sink *rs = (regression_sink *)sink;
+    if (!rs->entries) {
+        return;
+    }
+    const baseline_entry *e = find_entry(rs, r->algorithm, r->op->name);
+    if (!e) {
+        fprintf(rs->out, "    %s - Baseline: none\n", r->op->label);
+        return;
+    }
+    if (strcmp(e->unit, pqb_timer_raw_unit(r->timer)) != 0 || e->ops_per_sample != r->ops_per_sample) {
+        fprintf(rs->out, "    %s - Baseline: not comparable, %d ops per sample in %s\n", r->op->label,
+                e->ops_per_sample, e->unit);
+        return;
+    }
+
+    // The baseline summarised as the current run is, so the medians compare
+    pqb_stats_options opts;
+    pqb_stats_default_options(&opts);
+    opts.bootstrap_resamples = 0;
+    pqb_stats base;
+    pqb_compute_statistics(e->samples, e->num_samples, &opts, &base);
+    pqb_mann_whitney mw;
+    pqb_mann_whitney_test(e->samples, e->num_samples, r->samples, r->num_samples, &mw);
+
+    double change = base.median > 0 ? r->stats.median / base.median - 1 : 0.0;
+    double p = change >= 0 ? mw.p_greater : mw.p_less;
+    const char *verdict = p < PQB_BASELINE_ALPHA ? "within threshold" : "no significant change";
+    if (change > rs->threshold && mw.p_greater < PQB_BASELINE_ALPHA) {
+        verdict = "REGRESSION";
+        rs->regressions++;
+    } else if (change < -rs->threshold && mw.p_less < PQB_BASELINE_ALPHA) {
+        verdict = "improvement";
+        rs->improvements++;
+    }
+    rs->compared++;
+    double scale = pqb_timer_scale(r->timer);
+    fprintf(rs->out, "    %s - Baseline median: %f -> %f %s (%+.2f%%), P(slower): %.3f, p: %.2g, %s\n",
+            r->op->label, base.median * scale, r->stats.median * scale, pqb_timer_unit(r->timer), change * 100,
+            mw.effect, p, verdict);
+}
+
+static void regression_close(pqb_sink *sink) {
+    regression_sink *rs = (regression_sink *)sink;
+    if (rs->entries) {
+        fprintf(rs->out, "Baseline comparison: %d ops compared, %d regressions, %d improvements (threshold %.1f%%)\n",
+                rs->compared, rs->regressions, rs->improvements, rs->threshold * 100);
+    }
+    fflush(rs->out);
+    if (rs->regressions > 0) {
+        *rs->status = PQB_EXIT_REGRESSION;
+    }
+    for (int i = 0; i < rs->num_entries; i++) {
+        free(rs->entries[i].samples);
+    }
+    free(rs->entries);
+    free(rs);
+}
+
+pqb_sink *pqb_regression_sink_new(const char *dir, const char *program, const pqb_fingerprint *fp, double threshold,
+                                  FILE *out, int *status) {
+    regression_sink *rs = calloc(1, sizeof(*rs));
+    if (!rs) {
+        fprintf(stderr, "Failed to allocate regression sink\n");
+        exit(EXIT_FAILURE);
+    }
+    rs->base.result = regression_result;
+    rs->base.close = regression_close;
+    rs->out = out;
+    rs->threshold = threshold;
+    rs->status = status;
+    if (newest_baseline(dir, program, fp, rs->path, sizeof(rs->path))) {
+        load_baseline(rs, fp);
+    } else {
+        fprintf(out, "Baseline: none for %s on this host under %s, nothing to compare\n", program, dir);
+    }
+    return &rs->base;
+}
@@ -0,0 +1,39 @@
+#ifndef PQB_BASELINE_H
+#define PQB_BASELINE_H
+
+#include <stdio.h>
+
+#include "bench.h"
+
+// A regression is a slowdown of the median by more than the threshold that
+// a one-sided Mann-Whitney U test finds significant at PQB_BASELINE_ALPHA
+#define PQB_BASELINE_ALPHA 0.01
+#define PQB_BASELINE_THRESHOLD 0.05
+
+// What a run measured on: the machine, and the versions of OpenSSL, of every
+// provider loaded into the bench's library context and of liboqs
+typedef struct {
+    char host[1024];      // CPU model, logical cpus, architecture, host name, vector features and their masks
+    char host_id[17];     // hash of host, in hex
+    char versions[512];
+    char versions_id[17];
+} pqb_fingerprint;
+
+void pqb_fingerprint_get(const pqb_bench *bench, pqb_fingerprint *fp);
+
+// Baseline store: the raw samples of every latency result of one driver, in
+// dir/<host_id>/<versions_id>/<program>.ndjson. The first line holds the
+// fingerprint, every other line one algorithm and op. An existing baseline
+// with the same key is replaced.
+pqb_sink *pqb_baseline_sink_new(const char *dir, const char *program, const pqb_fingerprint *fp);
+
+// Compare every latency result with the same algorithm and op in the newest
+// baseline of program for this host under dir, whatever its versions, and
+// print a verdict per op to out. The baseline is loaded here, so a baseline
+// sink saving to the same key may be created afterwards. When it closes, the
+// sink sets *status to PQB_EXIT_REGRESSION if any op regressed by more than
+// threshold, a fraction of the baseline median.
+pqb_sink *pqb_regression_sink_new(const char *dir, const char *program, const pqb_fingerprint *fp, double threshold,
+                                  FILE *out, int *status);
+
+#endif
@@ -0,0 +1,404 @@
+#define _GNU_SOURCE
+#include "bench.h"
+
+#include <math.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/crypto.h>
+
+#include "alloc.h"
+#include "measure.h"
+#include "stats.h"
+
+void pqb_bench_init(pqb_bench *bench, pqb_timer_kind timer_kind, int runs) {
+    memset(bench, 0, sizeof(*bench));
+    // Before anything makes OpenSSL allocate
+    pqb_alloc_install(PQB_ARENA_DEFAULT_MIB);
+    bench->runs = runs;
+    bench->batch_size = 1;
+    bench->chain_depth = PQB_CHAIN_DEPTH;
+    bench->max_runs = PQB_ADAPTIVE_MAX_RUNS;
+    bench->time_budget = PQB_ADAPTIVE_TIME_BUDGET;
+    pqb_stats_default_options(&bench->stats_options);
+    pqb_timer_init(&bench->timer, timer_kind);
+    pqb_counters_init(&bench->counters);
+}
+
+int pqb_bench_free(pqb_bench *bench) {
+    for (int i = 0; i < bench->num_sinks; i++) {
+        bench->sinks[i]->close(bench->sinks[i]);
+    }
+    // Before the providers whose keys they are
+    pqb_key_cache_free(bench->keys);
+    for (int i = bench->num_providers - 1; i >= 0; i--) {
+        OSSL_PROVIDER_unload(bench->providers[i]);
+    }
+    for (int b = 0; b < bench->num_backends; b++) {
+        pqb_backend *backend = &bench->backends[b];
+        for (int i = backend->num_providers - 1; i >= 0; i--) {
+            OSSL_PROVIDER_unload(backend->providers[i]);
+        }
+        OSSL_LIB_CTX_free(backend->libctx);
+    }
+    pqb_timer_close(&bench->timer);
+    pqb_counters_close(&bench->counters);
+    int status = bench->status;
+    memset(bench, 0, sizeof(*bench));
+    return status;
+}
+
+void pqb_bench_share_keys(pqb_bench *bench) {
+    if (!bench->keys) {
+        bench->keys = pqb_key_cache_new();
+    }
+}
+
+void pqb_bench_load_provider(pqb_bench *bench, const char *name) {
+    if (bench->num_providers == PQB_MAX_PROVIDERS) {
+        fprintf(stderr, "Too many providers, cannot load %s\n", name);
+        exit(EXIT_FAILURE);
+    }
+    OSSL_PROVIDER *prov = OSSL_PROVIDER_load(bench->libctx, name);
+    if (!prov) {
+        fprintf(stderr, "Failed to load %s provider\n", name);
+        exit(EXIT_FAILURE);
+    }
+    bench->providers[bench->num_providers++] = prov;
+}
+
+void pqb_bench_set_payload(pqb_bench *bench, const unsigned char *data, size_t len) {
+    bench->payload = data;
+    bench->payload_len = len;
+}
+
+void pqb_bench_add_sink(pqb_bench *bench, pqb_sink *sink) {
+    if (bench->num_sinks == PQB_MAX_SINKS) {
+        fprintf(stderr, "Too many output sinks\n");
+        exit(EXIT_FAILURE);
+    }
+    bench->sinks[bench->num_sinks++] = sink;
+}
+
+// One pass over every op; stores each op's time in times if it is not NULL
+static void warm_up_pass(const pqb_family *family, void *state, const pqb_timer *timer, uint64_t *times) {
+    for (int o = 0; o < family->num_ops; o++) {
+        const pqb_op *op = &family->ops[o];
+        if (op->prepare) {
+            op->prepare(state);
+        }
+        uint64_t start = pqb_timer_start(timer);
+        op->run(state);
+        uint64_t stop = pqb_timer_stop(timer);
+        if (times) {
+            times[o] = pqb_timer_elapsed(timer, start, stop);
+        }
+        if (op->finish) {
+            op->finish(state);
+        }
+    }
+}
+
+// Largest coefficient of variation of any op over one window
+static double window_cv(const uint64_t *window, int num_ops) {
+    double worst = 0.0;
+    for (int o = 0; o < num_ops; o++) {
+        double sum = 0.0, sum_sq = 0.0;
+        for (int w = 0; w < PQB_WARMUP_WINDOW; w++) {
+            double x = (double)window[w * num_ops + o];
+            sum += x;
+            sum_sq += x * x;
+        }
+        double mean = sum / PQB_WARMUP_WINDOW;
+        double var = sum_sq / PQB_WARMUP_WINDOW - mean * mean;
+        double cv = mean > 0 ? sqrt(var > 0 ? var : 0) / mean : 0.0;
+        if (cv > worst) {
+            worst = cv;
+        }
+    }
+    return worst;
+}
+
+int pqb_bench_warm_up(const pqb_bench *bench, const pqb_family *family, void *state, const pqb_timer *timer) {
+    if (bench->warmup != PQB_WARMUP_AUTO) {
+        for (int i = 0; i < bench->warmup; i++) {
+            warm_up_pass(family, state, timer, NULL);
+        }
+        return bench->warmup;
+    }
+
+    int num_ops = family->num_ops;
+    uint64_t *window = pqb_xcalloc((size_t)PQB_WARMUP_WINDOW * num_ops, sizeof(uint64_t), "the warm-up window");
+    uint64_t deadline = pqb_cycles_read_monotonic() + PQB_WARMUP_MAX_SECONDS * 1000000000ULL;
+    double previous = -1.0;
+    int passes = 0;
+    while (passes < PQB_WARMUP_MAX_PASSES && pqb_cycles_read_monotonic() < deadline) {
+        for (int w = 0; w < PQB_WARMUP_WINDOW; w++) {
+            warm_up_pass(family, state, timer, &window[w * num_ops]);
+        }
+        passes += PQB_WARMUP_WINDOW;
+        double cv = window_cv(window, num_ops);
+        if (previous >= 0 && fabs(cv - previous) <= PQB_WARMUP_CV_TOLERANCE * previous) {
+            break;
+        }
+        previous = cv;
+    }
+    free(window);
+    return passes;
+}
+
+void *pqb_xcalloc(size_t count, size_t size, const char *what) {
+    void *p = calloc(count, size);
+    if (!p) {
+        fprintf(stderr, "Failed to allocate memory for %s\n", what);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+void pqb_collected_init(pqb_collected *c, const pqb_family *family, int capacity) {
+    memset(c, 0, sizeof(*c));
+    c->samples = pqb_xcalloc(family->num_ops, sizeof(uint64_t *), "the measurements");
+    c->cpus = pqb_xcalloc(family->num_ops, sizeof(int *), "the measurements");
+    c->allocs = pqb_xcalloc(family->num_ops, sizeof(pqb_alloc_count), "the measurements");
+    c->counters = pqb_xcalloc(family->num_ops, sizeof(pqb_counter_totals), "the measurements");
+    c->memory = pqb_xcalloc(family->num_ops, sizeof(pqb_memory_usage), "the measurements");
+    pqb_collected_reserve(c, family, capacity);
+}
+
+void pqb_collected_reserve(pqb_collected *c, const pqb_family *family, int capacity) {
+    if (capacity <= c->capacity) {
+        return;
+    }
+    for (int o = 0; o < family->num_ops; o++) {
+        c->samples[o] = realloc(c->samples[o], capacity * sizeof(uint64_t));
+        c->cpus[o] = realloc(c->cpus[o], capacity * sizeof(int));
+        if (!c->samples[o] || !c->cpus[o]) {
+            fprintf(stderr, "Failed to allocate memory for %d samples\n", capacity);
+            exit(EXIT_FAILURE);
+        }
+    }
+    c->capacity = capacity;
+}
+
+void pqb_collected_free(pqb_collected *c, const pqb_family *family) {
+    for (int o = 0; o < family->num_ops; o++) {
+        free(c->samples[o]);
+        free(c->cpus[o]);
+    }
+    free(c->samples);
+    free(c->cpus);
+    free(c->allocs);
+    free(c->counters);
+    free(c->memory);
+    memset(c, 0, sizeof(*c));
+}
+
+// The measured loop shared by every driver
+void pqb_measure_pass(const pqb_bench *bench, const pqb_family *family, void *state, pqb_collected *c) {
+    const pqb_timer *timer = &bench->timer;
+    const pqb_counters *counters = &bench->counters;
+    int counting = pqb_counters_enabled(counters);
+    pqb_alloc_count before, after;
+    pqb_counter_values counters_before, counters_after;
+    int i = c->runs;
+
+    if (i == c->capacity) {
+        pqb_collected_reserve(c, family, c->capacity ? c->capacity * 2 : 64);
+    }
+    for (int o = 0; o < family->num_ops; o++) {
+        const pqb_op *op = &family->ops[o];
+        if (op->prepare) {
+            op->prepare(state);
+        }
+        pqb_alloc_snapshot(&before);
+        // The counter reads sit outside the timer reads so they add nothing
+        // to the sample, at the cost of counting the timer reads themselves
+        int counted = counting && pqb_counters_read(counters, &counters_before);
+        uint64_t start = pqb_timer_start(timer);
+        op->run(state);
+        uint64_t stop = pqb_timer_stop(timer);
+        counted = counted && pqb_counters_read(counters, &counters_after);
+        pqb_alloc_snapshot(&after);
+        c->samples[o][i] = pqb_timer_elapsed(timer, start, stop);
+        uint64_t delta[PQB_NUM_COUNTERS];
+        if (counted && pqb_counters_delta(counters, &counters_before, &counters_after, delta)) {
+            for (int e = 0; e < PQB_NUM_COUNTERS; e++) {
+                c->counters[o].sum[e] += delta[e];
+            }
+            c->counters[o].runs++;
+        }
+        c->cpus[o][i] = sched_getcpu();
+        c->allocs[o].allocs += after.allocs - before.allocs;
+        c->allocs[o].bytes += after.bytes - before.bytes;
+        if (op->finish) {
+            op->finish(state);
+        }
+    }
+    c->runs++;
+}
+
+void pqb_collect_memory(const pqb_bench *bench, const pqb_family *family, void *state, pqb_collected *c) {
+    if (bench->memory) {
+        pqb_memory_profile(family, state, c->memory);
+        c->memory_profiled = 1;
+    }
+}
+
+const pqb_op pqb_handshake_op = {"handshake", "Handshake", NULL, NULL, NULL, 0};
+
+// Run the family bench->runs times for alg, then profile its memory if
+// profile is set and the bench asks for it
+static void collect(const pqb_bench *bench, const pqb_family *family, const char *alg, pqb_collected *c,
+                    int profile) {
+    pqb_collected_init(c, family, bench->runs);
+    void *state = family->create((pqb_bench *)bench, alg);
+    c->warmup_runs = pqb_bench_warm_up(bench, family, state, &bench->timer);
+    for (int i = 0; i < bench->runs; i++) {
+        pqb_measure_pass(bench, family, state, c);
+    }
+    if (profile) {
+        pqb_collect_memory(bench, family, state, c);
+    }
+    c->wire_bytes = family->wire_bytes ? family->wire_bytes(state) : 0;
+    family->destroy(state);
+}
+
+void pqb_bench_measure(pqb_bench *bench, const pqb_family *family, const char *alg, pqb_stats stats[]) {
+    pqb_collected c;
+    collect(bench, family, alg, &c, 0);
+    for (int o = 0; o < family->num_ops; o++) {
+        pqb_compute_statistics(c.samples[o], c.runs, &bench->stats_options, &stats[o]);
+    }
+    pqb_collected_free(&c, family);
+}
+
+// Mean counts per operation from the mean counts per run, if any run was
+// counted
+static void set_counters(const pqb_bench *bench, const double per_run[PQB_NUM_COUNTERS], int counted,
+                         int ops_per_sample, pqb_result *result) {
+    const pqb_counters *counters = &bench->counters;
+    result->counters_counted = pqb_counters_enabled(counters) && counted;
+    for (int e = 0; e < PQB_NUM_COUNTERS; e++) {
+        result->counters_per_op[e] =
+            result->counters_counted && pqb_counter_counted(counters, e) ? per_run[e] / ops_per_sample : -1.0;
+    }
+}
+
+static void report(const pqb_bench *bench, pqb_result *result) {
+    for (int s = 0; s < bench->num_sinks; s++) {
+        bench->sinks[s]->result(bench->sinks[s], result);
+    }
+}
+
+void pqb_report_collected(const pqb_bench *bench, const pqb_family *family, const char *alg,
+                          const pqb_collected *c) {
+    int runs = c->runs;
+    pqb_alloc_count total_allocs = {0, 0};
+    // The handshake's counts are the sum of every op's mean, as the ops of
+    // one run need not all have been counted
+    double total_counters[PQB_NUM_COUNTERS] = {0};
+    int all_counted = 1;
+    // and its footprint the largest of any op, as the ops run one at a time
+    pqb_memory_usage total_memory = {-1, -1, -1};
+
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->begin) {
+            bench->sinks[s]->begin(bench->sinks[s], alg);
+        }
+    }
+    for (int o = 0; o < family->num_ops; o++) {
+        pqb_result result;
+        result.algorithm = alg;
+        result.op = &family->ops[o];
+        result.samples = c->samples[o];
+        result.cpus = c->cpus[o];
+        result.num_samples = runs;
+        result.ops_per_sample = family->ops[o].batched ? bench->batch_size : 1;
+        double ops = (double)runs * result.ops_per_sample;
+        result.allocs_counted = pqb_alloc_active();
+        result.allocs_per_op = c->allocs[o].allocs / ops;
+        result.alloc_bytes_per_op = c->allocs[o].bytes / ops;
+        result.wire_bytes = family->handshake ? 0 : c->wire_bytes;
+        result.warmup_runs = c->warmup_runs;
+        const pqb_counter_totals *counted = &c->counters[o];
+        double per_run[PQB_NUM_COUNTERS];
+        for (int e = 0; e < PQB_NUM_COUNTERS; e++) {
+            per_run[e] = counted->runs ? (double)counted->sum[e] / counted->runs : 0.0;
+            total_counters[e] += per_run[e];
+        }
+        all_counted = all_counted && counted->runs > 0;
+        set_counters(bench, per_run, counted->runs > 0, result.ops_per_sample, &result);
+        result.memory_measured = c->memory_profiled;
+        result.memory = c->memory[o];
+        result.timer = &bench->timer;
+        pqb_compute_statistics(c->samples[o], runs, &bench->stats_options, &result.stats);
+        report(bench, &result);
+
+        total_allocs.allocs += c->allocs[o].allocs;
+        total_allocs.bytes += c->allocs[o].bytes;
+        if (c->memory_profiled) {
+            const pqb_memory_usage *u = &c->memory[o];
+            total_memory.peak_heap = u->peak_heap > total_memory.peak_heap ? u->peak_heap : total_memory.peak_heap;
+            total_memory.peak_rss = u->peak_rss > total_memory.peak_rss ? u->peak_rss : total_memory.peak_rss;
+            total_memory.stack = u->stack > total_memory.stack ? u->stack : total_memory.stack;
+        }
+    }
+
+    if (family->handshake) {
+        uint64_t *total = pqb_xcalloc(runs, sizeof(uint64_t), "the measurements");
+        for (int o = 0; o < family->num_ops; o++) {
+            for (int i = 0; i < runs; i++) {
+                total[i] += c->samples[o][i];
+            }
+        }
+
+        pqb_result result;
+        result.algorithm = alg;
+        result.op = &pqb_handshake_op;
+        result.samples = total;
+        result.cpus = c->cpus[0];
+        result.num_samples = runs;
+        result.ops_per_sample = 1;
+        result.allocs_counted = pqb_alloc_active();
+        result.allocs_per_op = (double)total_allocs.allocs / runs;
+        result.alloc_bytes_per_op = (double)total_allocs.bytes / runs;
+        result.wire_bytes = c->wire_bytes;
+        result.warmup_runs = c->warmup_runs;
+        set_counters(bench, total_counters, all_counted, 1, &result);
+        result.memory_measured = c->memory_profiled;
+        result.memory = total_memory;
+        result.timer = &bench->timer;
+        pqb_compute_statistics(total, runs, &bench->stats_options, &result.stats);
+        report(bench, &result);
+        free(total);
+    }
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->end) {
+            bench->sinks[s]->end(bench->sinks[s], alg);
+        }
+    }
+}
+
+const pqb_family *pqb_family_for(const pqb_family *family, const char *alg) {
+    const pqb_family *resolved = family->resolve ? family->resolve(alg) : family;
+    // The ops left out, named once here rather than by every hook
+    for (int o = 0; o < family->num_ops; o++) {
+        int kept = 0;
+        for (int r = 0; r < resolved->num_ops && !kept; r++) {
+            kept = strcmp(family->ops[o].name, resolved->ops[r].name) == 0;
+        }
+        if (!kept) {
+            fprintf(stderr, "%s cannot run the %s op, skipping it\n", alg, family->ops[o].name);
+        }
+    }
+    return resolved;
+}
+
+void pqb_bench_run(pqb_bench *bench, const pqb_family *family, const char *alg) {
+    pqb_collected c;
+    collect(bench, family, alg, &c, 1);
+    pqb_report_collected(bench, family, alg, &c);
+    pqb_collected_free(&c, family);
+}
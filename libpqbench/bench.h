@@ -0,0 +1,577 @@
+#ifndef PQB_BENCH_H
+#define PQB_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <openssl/provider.h>
+
+#include "counters.h"
+#include "histogram.h"
+#include "keys.h"
+#include "memory.h"
+#include "samples.h"
+#include "stats.h"
+#include "timer.h"
+
+#define PQB_MAX_PROVIDERS 8
+#define PQB_MAX_SINKS 8
+#define PQB_MAX_BACKENDS 8
+
+// Exit status of a run in which a baseline comparison found a regression
+#define PQB_EXIT_REGRESSION 3
+#define PQB_SWEEP_MIN 64
+#define PQB_SWEEP_MAX (16 << 20)
+
+// Warmup until the per-op coefficient of variation over consecutive windows
+// of PQB_WARMUP_WINDOW passes changes by less than PQB_WARMUP_CV_TOLERANCE
+// (relative), giving up after PQB_WARMUP_MAX_PASSES passes or
+// PQB_WARMUP_MAX_SECONDS seconds
+#define PQB_WARMUP_AUTO -1
+#define PQB_WARMUP_WINDOW 10
+#define PQB_WARMUP_CV_TOLERANCE 0.1
+#define PQB_WARMUP_MAX_PASSES 1000
+#define PQB_WARMUP_MAX_SECONDS 10
+
+// Adaptive mode: pilot passes per algorithm, and the defaults of the
+// per-algorithm pass cap and the per-call time budget
+#define PQB_ADAPTIVE_MIN_RUNS 10
+#define PQB_ADAPTIVE_MAX_RUNS 100000
+#define PQB_ADAPTIVE_TIME_BUDGET 60.0
+
+// Leakage mode, after dudect: the first PQB_LEAKAGE_PILOT measurements set
+// the cropping thresholds and are not tested, and a |t| above
+// PQB_LEAKAGE_T_THRESHOLD is reported as a likely leak
+#define PQB_LEAKAGE_PILOT 10000
+#define PQB_LEAKAGE_CROPS 10
+#define PQB_LEAKAGE_T_THRESHOLD 4.5
+// Inputs made at a time, all before the first of their measurements
+#define PQB_LEAKAGE_BLOCK 64
+
+// Load mode: rates one run may sweep, the default seconds of arrivals per
+// rate, how many times that the run may take before the requests still
+// queued are abandoned, and the share of the offered rate below which the
+// achieved rate counts as saturated
+#define PQB_MAX_LOAD_RATES 32
+#define PQB_LOAD_DURATION 5.0
+#define PQB_LOAD_DEADLINE 3
+#define PQB_LOAD_SATURATED 0.95
+
+// Key pool mode: the default number of keys the ring holds, and how long a
+// producer that finds it full sleeps before trying again
+#define PQB_POOL_CAPACITY 64
+#define PQB_POOL_FULL_SLEEP_NS 100000
+
+// Async mode: depths one run may sweep and the largest one, how long to wait
+// on the wait fds of paused jobs before resuming them anyway, and the stack
+// each job gets where OpenSSL lets it be set (3.2 on; before, it is 32 KiB)
+#define PQB_MAX_ASYNC_DEPTHS 16
+#define PQB_ASYNC_MAX_DEPTH 1024
+#define PQB_ASYNC_POLL_MS 10
+#define PQB_ASYNC_STACK_BYTES (256 * 1024)
+
+// CPU feature matrix: the levels one run may compare, the environment
+// variables one level may set, the variable that tells a driver it runs as
+// a level of a matrix, naming the CSV file its results go to, and the one
+// naming the level
+#define PQB_MAX_CPU_LEVELS 8
+#define PQB_CPU_LEVEL_MAX_ENV 4
+#define PQB_CPU_MATRIX_ENV "PQB_CPU_MATRIX_CSV"
+#define PQB_CPU_LEVEL_ENV "PQB_CPU_LEVEL"
+
+// Soak mode: the largest raw timer value a histogram of samples tells
+// apart, about 18 minutes of ns or 6 of cycles at 3 GHz
+#define PQB_SOAK_HIGHEST (1ULL << 40)
+
+// Certificate chains: the deepest one, and the depth of chains of a single
+// algorithm unless set, root and leaf included
+#define PQB_CHAIN_MAX_DEPTH 8
+#define PQB_CHAIN_DEPTH 3
+
+typedef struct pqb_bench pqb_bench;
+
+// One timed operation of an algorithm family. prepare and finish run outside
+// the timed region before and after every run and may be NULL.
+typedef struct {
+    const char *name;  // short name used in file names, e.g. "encapsulation"
+    const char *label; // human readable name used in reports, e.g. "Encapsulation"
+    void (*prepare)(void *state);
+    void (*run)(void *state);
+    void (*finish)(void *state);
+    int batched; // each run performs bench->batch_size operations rather than one
+} pqb_op;
+
+// What a family's algorithms are, so they can be discovered from providers
+typedef enum {
+    PQB_ALGS_NONE,      // not discoverable, e.g. EC curve names
+    PQB_ALGS_SIGNATURE, // EVP_SIGNATURE algorithms
+    PQB_ALGS_KEM        // EVP_KEM algorithms
+} pqb_alg_kind;
+
+// A set of operations measured together for one algorithm: every run executes
+// each op once, in order, so that later ops can consume what earlier ones made
+typedef struct pqb_family pqb_family;
+struct pqb_family {
+    const char *name;
+    const pqb_op *ops;
+    int num_ops;
+    void *(*create)(pqb_bench *bench, const char *alg);
+    void (*destroy)(void *state);
+    // The same operations with algorithm fetches and context setup done
+    // once or in prepare, so only the primitive is timed; NULL if none
+    const pqb_family *hot;
+    // Ops that each perform a batch of bench->batch_size operations; NULL if none
+    const pqb_family *batch;
+    // Every API path to the same primitive, measured side by side; NULL if none
+    const pqb_family *paths;
+    // The family to measure alg with in place of this one, for a variant
+    // some of whose ops cannot run every algorithm; NULL to always use this one
+    const pqb_family *(*resolve)(const char *alg);
+    // Also report the sum of every op of a run as one "Handshake" result
+    int handshake;
+    // Bytes both parties put on the wire in one run, or NULL. Reported on the
+    // handshake total, or on every op of a family that is not a handshake.
+    size_t (*wire_bytes)(void *state);
+    // Of those, the ones the responder sends, or NULL. Handshake families
+    // name their ops *_initiator and *_responder after the side that runs them.
+    size_t (*responder_bytes)(void *state);
+    // Kind of algorithm --discover looks for, and which liboqs API the liboqs
+    // backend runs through for this family or variant
+    pqb_alg_kind algorithms;
+    // The same ops, in the same order, through the raw liboqs API, for the
+    // liboqs backend of a comparison; NULL if none
+    const pqb_family *liboqs;
+    // Ops to test for timing leakage, each measured on inputs of two classes;
+    // NULL if none
+    const pqb_family *leakage;
+    // Leakage families only: write an input of class 0 (fixed) or 1 (random)
+    // into slot slot of PQB_LEAKAGE_BLOCK, ahead of the block's measurements
+    void (*make_input)(void *state, int slot, int input_class);
+    // and point the ops at the input in slot, before prepare, the same
+    // switch whichever class it holds
+    void (*use_input)(void *state, int slot);
+    const char *input_classes[2]; // what each class is, e.g. "valid ciphertext"
+    // Requests the load generator issues: ops that each stand alone and may
+    // repeat on one state, as a server handles them; NULL if none
+    const pqb_family *load;
+    // Certificate chains of the algorithm, bench->chain_depth levels deep or
+    // mixed as "ROOT/.../LEAF": encoding, parsing and verifying them; NULL if none
+    const pqb_family *chain;
+};
+
+// Measurements of one op of one algorithm, handed to every sink
+typedef struct {
+    const char *algorithm;
+    const pqb_op *op;
+    const uint64_t *samples;
+    const int *cpus; // cpu each sample was taken on, -1 if unknown
+    int num_samples;
+    int ops_per_sample; // operations each sample covers, 1 unless the op is batched
+    int allocs_counted; // whether the two fields below were measured
+    double allocs_per_op;      // OpenSSL allocations inside the timed region
+    double alloc_bytes_per_op; // bytes they requested
+    size_t wire_bytes;         // bytes exchanged per handshake or per op, 0 on the ops of a handshake
+    int warmup_runs;           // untimed passes before the first sample
+    int counters_counted;      // whether counters_per_op was measured
+    double counters_per_op[PQB_NUM_COUNTERS]; // mean hardware counts per operation, -1 for events not counted
+    int memory_measured;       // whether memory was profiled
+    pqb_memory_usage memory;   // per operation, or per sample for batched ops
+    pqb_stats stats;    // in raw timer units, per sample
+    const pqb_timer *timer;
+} pqb_result;
+
+// One point of a throughput scaling curve or topology sweep for one op: the
+// same op measured on several pinned threads at once
+typedef struct {
+    const char *algorithm;
+    const pqb_op *op;
+    int threads;
+    const char *topology;          // configuration of a topology sweep, e.g. "smt-pair"; NULL on a scaling curve
+    const int *cpus;               // cpu each thread was pinned to
+    double wall_seconds;           // from the start barrier until the last thread finished
+    double iterations_per_sec;     // passes over every op of the family, threads * runs / wall_seconds
+    double ops_per_sec;            // operations of every thread / summed wall time of this op's phases
+    int ops_per_sample;            // operations each latency sample covers
+    double speedup;                // ops_per_sec relative to the one thread point, or to "core"
+    const pqb_stats *thread_stats; // latency of each thread, in raw timer units
+    const uint64_t *const *thread_samples; // [thread][run] latency samples
+    int num_samples;               // runs per thread
+    pqb_stats stats;               // latency over the samples of every thread
+    const pqb_timer *timer;
+} pqb_throughput_result;
+
+// Cost of one op against payload size, from a sweep over sizes
+typedef struct {
+    const char *algorithm;
+    const pqb_op *op;
+    int num_points;
+    const size_t *sizes;    // payload bytes of each point
+    const pqb_stats *stats; // latency at each point, in raw timer units
+    double fixed;           // intercept of a weighted least squares fit of the mean, raw timer units
+    double per_byte;        // slope of that fit, raw timer units per payload byte
+    double r_squared;
+    const pqb_timer *timer;
+} pqb_sweep_result;
+
+// A provider set loaded into a library context of its own, or the raw
+// liboqs API, that the same family can be measured against
+typedef struct {
+    char name[64];
+    OSSL_LIB_CTX *libctx; // NULL for liboqs
+    OSSL_PROVIDER *providers[PQB_MAX_PROVIDERS];
+    int num_providers;
+    int liboqs; // runs the family's liboqs variant instead of the EVP one
+} pqb_backend;
+
+// Every op of one algorithm measured against each backend; backends that
+// lack the algorithm are left out and have measured set to 0
+typedef struct {
+    const char *algorithm;
+    const pqb_family *family; // ops are those of family, whatever the backend
+    int num_backends;
+    const pqb_backend *backends;
+    const int *measured;    // [backend]
+    const pqb_stats *stats; // [backend * family->num_ops + op], in raw timer units
+    const pqb_timer *timer;
+} pqb_comparison_result;
+
+// Welch's t-test between the two input classes of one op, over every
+// sample and over PQB_LEAKAGE_CROPS sets of the samples below increasing
+// thresholds, dudect's cropping
+typedef struct {
+    const char *algorithm;
+    const pqb_op *op;
+    const char *const *input_classes; // [2]
+    uint64_t measurements;     // tested ones, pilot excluded
+    uint64_t counts[2];        // per class
+    double means[2];           // per class, raw timer units
+    double t;                  // over every tested sample
+    double max_t;              // largest |t| of any of the tests
+    uint64_t max_t_samples;    // samples of the test max_t came from
+    double max_t_threshold;    // crop threshold of that test in raw timer units, 0 if uncropped
+    double max_tau;            // max_t / sqrt(max_t_samples), comparable across sample counts
+    int leaky;                 // max_t above PQB_LEAKAGE_T_THRESHOLD
+    const pqb_timer *timer;
+} pqb_leakage_result;
+
+// Estimated cost of one full handshake with a key exchange and a signature
+// algorithm, from measured CPU times and sizes under a network model
+typedef struct {
+    const char *kex;
+    const char *signature;
+    double rtt_ms;            // model inputs
+    double bandwidth_mbps;
+    int chain_certs;
+    size_t client_bytes;      // key share
+    size_t server_bytes;      // key share, certificates and CertificateVerify
+    int round_trips;          // including those TCP slow start adds to either flight
+    double client_cpu_ms;     // key exchange ops of the initiator and every verification
+    double server_cpu_ms;     // key exchange ops of the responder and one signature
+    double transfer_ms;       // serialisation of both flights at the model bandwidth
+    double latency_ms;        // round trips, CPU and transfer
+} pqb_handshake_estimate;
+
+// Estimated discovery storm of a DDS-Security domain that a number of
+// participants join at once, each authenticating with every other over one
+// handshake per pair, from measured CPU times and message sizes
+typedef struct {
+    const char *algorithm;    // "<signature>+<key agreement>"
+    int participants;
+    double rtt_ms;            // model inputs
+    double bandwidth_mbps;
+    uint64_t handshakes;      // one per pair
+    size_t request_bytes;     // HandshakeRequest, HandshakeReply and HandshakeFinal tokens
+    size_t reply_bytes;
+    size_t final_bytes;
+    double handshake_ms;      // one handshake on idle participants: CPU of every step and three one-way trips
+    double full_mesh_ms;      // from joining until the last pair has authenticated
+    double cpu_ms_min;        // handshake CPU per participant over the storm
+    double cpu_ms_mean;
+    double cpu_ms_max;
+    double sent_bytes_mean;   // per participant
+} pqb_mesh_estimate;
+
+typedef enum {
+    PQB_ARRIVAL_FIXED,  // evenly spaced requests
+    PQB_ARRIVAL_POISSON // exponentially distributed gaps, as independent clients make
+} pqb_arrival;
+
+typedef struct {
+    double rates[PQB_MAX_LOAD_RATES]; // offered requests per second, one point of the curve each
+    int num_rates;
+    int workers;      // threads serving the requests, each pinned with its own state
+    pqb_arrival arrival;
+    double duration;  // seconds over which requests arrive, per rate
+} pqb_load_options;
+
+// One point of a latency under load curve for one op: requests issued open
+// loop at a fixed offered rate, whether or not earlier ones have finished.
+// Latency runs from when a request was meant to start, so time spent queued
+// behind a slow request counts and the tail is not hidden by the schedule
+// slipping (coordinated omission); service time runs from when it started.
+typedef struct {
+    const char *algorithm;
+    const pqb_op *op;
+    int workers;
+    const int *cpus;          // cpu each worker was pinned to
+    pqb_arrival arrival;
+    double offered_rate;      // requests per second
+    double achieved_rate;     // completed ones over the duration, or until the last finished if later
+    uint64_t requests;        // scheduled during the duration
+    uint64_t completed;
+    uint64_t abandoned;       // not started by PQB_LOAD_DEADLINE durations
+    double duration;
+    int saturated;            // achieved_rate below PQB_LOAD_SATURATED of the offered rate, or requests abandoned
+    const pqb_histogram *latency; // of the completed requests, in raw timer units
+    const pqb_histogram *service;
+    const pqb_timer *timer;       // wall clock
+} pqb_load_result;
+
+typedef struct {
+    double rate;      // handshakes per second, each taking one key from the pool
+    int capacity;     // keys the ring holds
+    int producers;    // background threads that refill it, 0 for as many as the rate needs and the cpus allow
+    pqb_arrival arrival;
+    double duration;  // seconds over which handshakes arrive
+} pqb_pool_options;
+
+// Whether pregenerating key pairs pays off for one algorithm: the latency of
+// generating a key when a handshake needs it against that of taking one from
+// a full pool that background threads refill, at a target handshake rate. A
+// handshake that finds the pool empty generates its key itself, as a service
+// would, and counts as a miss.
+typedef struct {
+    const char *algorithm;
+    int capacity;
+    int producers;
+    pqb_arrival arrival;
+    double target_rate;       // handshakes per second, so keys per second the refill has to sustain
+    double keygen_rate;       // keys per second one thread generates, from the on demand mean
+    double cores_needed;      // target_rate over keygen_rate: cores the refill keeps busy
+    int producers_needed;     // cores_needed rounded up
+    double refill_rate;       // keys per second the producers generated over the run
+    uint64_t requests;        // handshakes scheduled during the duration
+    uint64_t misses;          // of those, the ones that found the pool empty
+    uint64_t abandoned;       // not started by PQB_LOAD_DEADLINE durations
+    uint64_t lowest_fill;     // fewest keys left in the pool after a hand-out
+    double duration;
+    int sustained;            // no misses and the producers kept up with the target rate
+    const pqb_histogram *on_demand; // key generation when needed, in raw timer units
+    const pqb_histogram *handout;   // from each handshake's intended start until it has its key
+    const pqb_timer *timer;         // wall clock
+} pqb_pool_result;
+
+typedef struct {
+    int depths[PQB_MAX_ASYNC_DEPTHS]; // jobs in flight at each point, in the order given
+    int num_depths;
+} pqb_async_options;
+
+// One op run inside OpenSSL ASYNC jobs, depth of them in flight on one
+// thread, each job over a family state of its own doing the ops of one pass
+// in order. Depth 0 is the synchronous baseline: the same ops called
+// directly on one state. The ops of a pass overlap with those of the other
+// jobs, so ops_per_sec is taken over the op's share of wall_seconds, split
+// between the ops in proportion to their summed latency.
+typedef struct {
+    const char *algorithm;
+    const pqb_op *op;
+    int depth;
+    double wall_seconds;  // from the first job started to the last one finished
+    double ops_per_sec;
+    double speedup;       // ops_per_sec over that of the synchronous baseline
+    uint64_t pauses;      // times a job of this op paused to wait for the provider
+    int ops_per_sample;
+    pqb_stats stats;      // from each job's start to its completion, in raw timer units
+    const pqb_timer *timer; // wall clock
+} pqb_async_result;
+
+// A set of CPU features to run a driver with: environment variables set
+// before the process starts, so before OpenSSL reads its capability masks,
+// e.g. OPENSSL_ia32cap to hide AVX-512, or LD_LIBRARY_PATH and
+// OPENSSL_MODULES to load a build of liboqs and oqsprovider without vector
+// code. liboqs has no mask of its own.
+typedef struct {
+    char name[64];
+    char env[PQB_CPU_LEVEL_MAX_ENV][256]; // VAR=VALUE
+    int num_env;
+} pqb_cpu_level;
+
+// The median of one latency result at each level
+typedef struct {
+    char algorithm[256];
+    char op[64];
+    char unit[16];
+    double median[PQB_MAX_CPU_LEVELS]; // in unit, NAN where the level has no such result
+} pqb_cpu_matrix_row;
+
+// Every latency result of a driver, run once per level; speedups are those
+// of the first level, the reference, over each other one
+typedef struct {
+    int num_levels;
+    const pqb_cpu_level *levels;
+    const int *completed; // [level], 0 where its run failed
+    int num_rows;
+    const pqb_cpu_matrix_row *rows;
+} pqb_cpu_matrix_result;
+
+typedef struct pqb_sink pqb_sink;
+
+// Output sink; begin and end bracket the results of one algorithm and may be
+// NULL, as may throughput, sweep, comparison, leakage, handshake, mesh, load, pool, async
+// and cpu_matrix for sinks that only understand latency results
+struct pqb_sink {
+    void (*begin)(pqb_sink *sink, const char *algorithm);
+    void (*result)(pqb_sink *sink, const pqb_result *result);
+    void (*throughput)(pqb_sink *sink, const pqb_throughput_result *result);
+    void (*sweep)(pqb_sink *sink, const pqb_sweep_result *result);
+    void (*comparison)(pqb_sink *sink, const pqb_comparison_result *result);
+    void (*leakage)(pqb_sink *sink, const pqb_leakage_result *result);
+    void (*handshake)(pqb_sink *sink, const pqb_handshake_estimate *estimate);
+    void (*mesh)(pqb_sink *sink, const pqb_mesh_estimate *estimate);
+    void (*load)(pqb_sink *sink, const pqb_load_result *result);
+    void (*pool)(pqb_sink *sink, const pqb_pool_result *result);
+    void (*async)(pqb_sink *sink, const pqb_async_result *result);
+    void (*cpu_matrix)(pqb_sink *sink, const pqb_cpu_matrix_result *result);
+    void (*end)(pqb_sink *sink, const char *algorithm);
+    void (*close)(pqb_sink *sink);
+};
+
+struct pqb_bench {
+    OSSL_LIB_CTX *libctx;
+    OSSL_PROVIDER *providers[PQB_MAX_PROVIDERS];
+    int num_providers;
+    pqb_timer timer;
+    pqb_key_cache *keys; // fixture key pairs shared by the runs once pqb_bench_share_keys is called; NULL generates each
+    pqb_counters counters; // read around every timed op once opened; off by default
+    int memory;            // profile every op's heap, resident set and stack after the measured runs
+    pqb_stats_options stats_options;
+    int runs;
+    int warmup;     // passes over the family before the measured runs, or PQB_WARMUP_AUTO
+    int batch_size; // operations per run of batched ops
+    int chain_depth; // certificates in a chain of one algorithm, root and leaf included
+    double target_ci;   // adaptive mode: relative CI half-width of the mean to reach, e.g. 0.01
+    int max_runs;       // adaptive mode: passes per algorithm at most
+    double time_budget; // adaptive mode: seconds one pqb_bench_run_adaptive call may take
+    const unsigned char *payload;
+    size_t payload_len;
+    pqb_sink *sinks[PQB_MAX_SINKS];
+    int num_sinks;
+    pqb_backend backends[PQB_MAX_BACKENDS];
+    int num_backends;
+    int status; // exit status the sinks ask for once closed, 0 unless a baseline comparison found a regression
+};
+
+void pqb_bench_init(pqb_bench *bench, pqb_timer_kind timer_kind, int runs);
+// Close the sinks and free the bench; returns bench->status as the sinks
+// left it, for drivers to exit with
+int pqb_bench_free(pqb_bench *bench);
+
+// Load a provider into the bench's library context, exiting on failure
+void pqb_bench_load_provider(pqb_bench *bench, const char *name);
+
+// From now on, hot runs that need a key pair rather than time its
+// generation, such as the hot, batch, leakage and load variants of the
+// signature family, share one per algorithm and library context instead of
+// generating their own. Cold states, throughput workers and async slots
+// still generate keys of their own.
+void pqb_bench_share_keys(pqb_bench *bench);
+
+// Message that signature families sign and verify; not copied
+void pqb_bench_set_payload(pqb_bench *bench, const unsigned char *data, size_t len);
+
+// Register a sink; the bench closes it in pqb_bench_free
+void pqb_bench_add_sink(pqb_bench *bench, pqb_sink *sink);
+
+// The family to run for alg: family, or what its resolve hook picks, with a
+// note on stderr for every op of family it leaves out
+const pqb_family *pqb_family_for(const pqb_family *family, const char *alg);
+
+// Measure every op of the family for one algorithm and report to all sinks
+void pqb_bench_run(pqb_bench *bench, const pqb_family *family, const char *alg);
+
+// Measure every op of the family for one algorithm without reporting;
+// stats must hold family->num_ops entries
+void pqb_bench_measure(pqb_bench *bench, const pqb_family *family, const char *alg, pqb_stats stats[]);
+
+// Adaptive mode: measure the family for every algorithm in algs, starting
+// with PQB_ADAPTIVE_MIN_RUNS passes each rather than bench->runs, until every op's mean has a confidence
+// interval (normal approximation, at stats_options.confidence) no wider than
+// bench->target_ci of the mean on either side. Further passes go to the
+// algorithm whose widest interval shrinks most per second of measuring, until
+// all have converged, reached bench->max_runs or used up bench->time_budget.
+// families holds the family for each algorithm, as pqb_family_for resolves
+// it. Results are reported in the order of algs.
+void pqb_bench_run_adaptive(pqb_bench *bench, const pqb_family *const families[], const char *const algs[],
+                            int num_algs);
+
+// Run the family's ops over state, untimed as far as the results go, as
+// bench->warmup asks; returns the number of passes made
+int pqb_bench_warm_up(const pqb_bench *bench, const pqb_family *family, void *state, const pqb_timer *timer);
+
+// Sweep the payload from PQB_SWEEP_MIN to PQB_SWEEP_MAX bytes, quadrupling
+// each time, and fit each op's mean cost as fixed + per_byte * size. Points
+// are sliced from the bench payload while it is long enough and synthetic
+// beyond that.
+void pqb_bench_run_sweep(pqb_bench *bench, const pqb_family *family, const char *alg);
+
+// Add a backend to compare from a spec: "liboqs" for the raw liboqs API, or
+// NAME:PROVIDER[+PROVIDER...] with optional ",config=FILE" to load an
+// OpenSSL config file into the backend's library context first and
+// ",modules=DIR" to look for the providers in DIR, e.g.
+//   fips:fips+base,config=/usr/local/ssl/fipsmodule.cnf
+// Exits on failure.
+void pqb_bench_add_backend(pqb_bench *bench, const char *spec);
+
+// Measure every op of the family for one algorithm against each backend in
+// turn, in this one process, and report the comparison to all sinks
+void pqb_bench_run_backends(pqb_bench *bench, const pqb_family *family, const char *alg);
+
+// Leakage mode: for every op of family->leakage, take measurements samples,
+// each on an input of a class drawn at random, after PQB_LEAKAGE_PILOT
+// more, and report Welch's t-test between the classes to all sinks. Memory
+// use does not grow with measurements.
+void pqb_bench_run_leakage(pqb_bench *bench, const pqb_family *family, const char *alg, uint64_t measurements);
+
+// Load mode: for every op of family->load and every rate in options, issue
+// requests open loop at that rate to a pool of options->workers threads for
+// options->duration seconds and report the latency and service time
+// histograms to the sinks. Latency comes from the monotonic clock, as in
+// throughput mode.
+void pqb_bench_run_load(pqb_bench *bench, const pqb_family *family, const char *alg, const pqb_load_options *options);
+
+// Key pool mode: time bench->runs on demand key generations for alg, then
+// hand out keys from a pool of pregenerated ones at options->rate for
+// options->duration seconds and report both latency distributions and the
+// refill throughput to the sinks. Keys come from pqb_keygen_ctx_new, so any
+// algorithm pqb_generate_key accepts works. Wall clock, as in load mode.
+void pqb_bench_run_pool(pqb_bench *bench, const char *alg, const pqb_pool_options *options);
+
+// Async mode: run the family's ops directly, then inside ASYNC jobs at every
+// depth in options, bench->runs passes at each point, and report the
+// throughput and latency of each op at each point to the sinks. A job that
+// pauses is resumed once a wait fd its provider set becomes readable, after
+// PQB_ASYNC_POLL_MS without one, or at once if it set none. All on the
+// calling thread; wall clock, as in throughput mode.
+void pqb_bench_run_async(pqb_bench *bench, const pqb_family *family, const char *alg, const pqb_async_options *options);
+
+// Soak mode: run the family over and over for seconds of wall time and
+// report every op to the sinks as latency results, keeping each op's samples
+// in mode. Histogram mode holds memory constant however long the run and
+// reports no raw samples, so sinks that need them get none.
+void pqb_bench_run_soak(pqb_bench *bench, const pqb_family *family, const char *alg, double seconds,
+                        pqb_samples_mode mode);
+
+// Throughput mode: run the family on 1, 2, 4, ... up to max_threads threads,
+// each pinned to its own cpu with its own family state, and report every
+// point of the scaling curve to the sinks. Each op of each pass is a phase
+// the threads start together at a barrier, and throughput is the ops of
+// all threads over the wall time of the op's phases. Latency is taken from the
+// monotonic clock whatever the bench timer is, since process CPU time and
+// per-thread cycle counters cannot be read across threads.
+void pqb_bench_run_throughput(pqb_bench *bench, const pqb_family *family, const char *alg, int max_threads);
+
+// Topology sweep: the same as throughput mode, but on each configuration of
+// cpus pqb_topology_configs finds on this machine in turn instead of on
+// growing thread counts, from one core through SMT siblings to every socket
+void pqb_bench_run_topology(pqb_bench *bench, const pqb_family *family, const char *alg);
+
+#endif
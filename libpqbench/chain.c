@@ -0,0 +1,205 @@
+#include "families.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/x509.h>
+#include <openssl/x509_vfy.h>
+
+#include "keys.h"
+#include "x509.h"
+
+// A chain from a self-signed root through intermediates to a leaf, in that
+// order, and what a verifier keeps between chains: a store that trusts the
+// root and one verification context. The peer sends everything but the root.
+typedef struct {
+    OSSL_LIB_CTX *libctx;
+    const char *alg;
+    int depth;
+    char algs[PQB_CHAIN_MAX_DEPTH][128];
+    EVP_PKEY *keys[PQB_CHAIN_MAX_DEPTH];
+    X509 *certs[PQB_CHAIN_MAX_DEPTH];
+    unsigned char *der[PQB_CHAIN_MAX_DEPTH];
+    size_t der_len[PQB_CHAIN_MAX_DEPTH];
+    X509 *parsed[PQB_CHAIN_MAX_DEPTH]; // of one run; parsed[0] is unused, the root comes from the store
+    X509_STORE *store;
+    X509_STORE_CTX *ctx;
+    STACK_OF(X509) *untrusted;
+    size_t wire_bytes;
+} chain_state;
+
+// "ROOT/.../LEAF" names every level; a single algorithm is used for all
+// bench->chain_depth of them
+static void parse_levels(const pqb_bench *bench, const char *alg, chain_state *st) {
+    if (!strchr(alg, '/')) {
+        st->depth = bench->chain_depth;
+        for (int i = 0; i < st->depth; i++) {
+            snprintf(st->algs[i], sizeof(st->algs[i]), "%s", alg);
+        }
+        return;
+    }
+    const char *start = alg;
+    for (;;) {
+        const char *slash = strchr(start, '/');
+        size_t len = slash ? (size_t)(slash - start) : strlen(start);
+        if (len == 0 || len >= sizeof(st->algs[0]) || st->depth == PQB_CHAIN_MAX_DEPTH) {
+            fprintf(stderr, "%s is not a chain of 2 to %d algorithms\n", alg, PQB_CHAIN_MAX_DEPTH);
+            exit(EXIT_FAILURE);
+        }
+        memcpy(st->algs[st->depth], start, len);
+        st->algs[st->depth++][len] = '\0';
+        if (!slash) {
+            break;
+        }
+        start = slash + 1;
+    }
+    if (st->depth < 2) {
+        fprintf(stderr, "%s is not a chain of 2 to %d algorithms\n", alg, PQB_CHAIN_MAX_DEPTH);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void *chain_create(pqb_bench *bench, const char *alg) {
+    chain_state *st = calloc(1, sizeof(*st));
+    if (!st) {
+        fprintf(stderr, "Failed to allocate chain state for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    st->libctx = bench->libctx;
+    st->alg = alg;
+    parse_levels(bench, alg, st);
+
+    char names[PQB_CHAIN_MAX_DEPTH][64];
+    for (int i = 0; i < st->depth; i++) {
+        if (i == 0) {
+            snprintf(names[i], sizeof(names[i]), "pqbench root CA");
+        } else if (i == st->depth - 1) {
+            snprintf(names[i], sizeof(names[i]), "pqbench leaf");
+        } else {
+            snprintf(names[i], sizeof(names[i]), "pqbench intermediate CA %d", i);
+        }
+        st->keys[i] = pqb_generate_key(st->libctx, st->algs[i]);
+        st->certs[i] = pqb_x509_issue(st->libctx, st->keys[i], names[i], st->keys[i > 0 ? i - 1 : 0],
+                                      names[i > 0 ? i - 1 : 0], i < st->depth - 1);
+        st->der_len[i] = i2d_X509(st->certs[i], NULL);
+        st->der[i] = OPENSSL_malloc(st->der_len[i]);
+        if (st->der_len[i] == 0 || !st->der[i]) {
+            fprintf(stderr, "Failed to allocate memory for the certificates of %s\n", alg);
+            exit(EXIT_FAILURE);
+        }
+        if (i > 0) {
+            st->wire_bytes += st->der_len[i];
+        }
+    }
+
+    st->store = X509_STORE_new();
+    st->ctx = X509_STORE_CTX_new_ex(st->libctx, NULL);
+    st->untrusted = sk_X509_new_null();
+    if (!st->store || !st->ctx || !st->untrusted || !X509_STORE_add_cert(st->store, st->certs[0])) {
+        fprintf(stderr, "Failed to set up the certificate store for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    return st;
+}
+
+static void chain_release(chain_state *st) {
+    sk_X509_zero(st->untrusted);
+    for (int i = 1; i < st->depth; i++) {
+        X509_free(st->parsed[i]);
+        st->parsed[i] = NULL;
+    }
+}
+
+static void chain_destroy(void *state) {
+    chain_state *st = state;
+    chain_release(st);
+    sk_X509_free(st->untrusted);
+    X509_STORE_CTX_free(st->ctx);
+    X509_STORE_free(st->store);
+    for (int i = 0; i < st->depth; i++) {
+        OPENSSL_free(st->der[i]);
+        X509_free(st->certs[i]);
+        EVP_PKEY_free(st->keys[i]);
+    }
+    free(st);
+}
+
+static size_t chain_wire_bytes(void *state) {
+    chain_state *st = state;
+    return st->wire_bytes;
+}
+
+// DER encoding of what the peer sends. Certificates OpenSSL has signed keep
+// no cached encoding, so each is encoded in full every time.
+static void chain_encode(void *state) {
+    chain_state *st = state;
+    for (int i = 1; i < st->depth; i++) {
+        unsigned char *p = st->der[i];
+        if (i2d_X509(st->certs[i], &p) != (int)st->der_len[i]) {
+            fprintf(stderr, "Failed to encode the certificates of %s\n", st->alg);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// Decoding into certificates of the bench's library context, so that the
+// provider that implements each key decodes it
+static void chain_parse(void *state) {
+    chain_state *st = state;
+    for (int i = 1; i < st->depth; i++) {
+        const unsigned char *p = st->der[i];
+        st->parsed[i] = X509_new_ex(st->libctx, NULL);
+        if (!st->parsed[i] || !d2i_X509(&st->parsed[i], &p, (long)st->der_len[i])) {
+            fprintf(stderr, "Failed to parse the certificates of %s\n", st->alg);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// Each certificate's signature checked with its issuer's key and nothing
+// else: the part of path validation that is the signature algorithm's
+static void chain_verify_signatures(void *state) {
+    chain_state *st = state;
+    for (int i = 1; i < st->depth; i++) {
+        X509 *issuer = i == 1 ? st->certs[0] : st->parsed[i - 1];
+        if (X509_verify(st->parsed[i], X509_get0_pubkey(issuer)) != 1) {
+            fprintf(stderr, "Failed to verify the certificate signatures of %s\n", st->alg);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// Full path validation of the parsed chain against the store
+static void chain_verify(void *state) {
+    chain_state *st = state;
+    for (int i = 1; i < st->depth - 1; i++) {
+        sk_X509_push(st->untrusted, st->parsed[i]);
+    }
+    if (!X509_STORE_CTX_init(st->ctx, st->store, st->parsed[st->depth - 1], st->untrusted) ||
+        X509_verify_cert(st->ctx) != 1) {
+        fprintf(stderr, "Failed to verify the chain of %s: %s\n", st->alg,
+                X509_verify_cert_error_string(X509_STORE_CTX_get_error(st->ctx)));
+        exit(EXIT_FAILURE);
+    }
+    X509_STORE_CTX_cleanup(st->ctx);
+}
+
+static void chain_finish_iteration(void *state) {
+    chain_release(state);
+}
+
+static const pqb_op chain_ops[] = {
+    {"chain_encode", "Chain DER encoding", NULL, chain_encode, NULL, 0},
+    {"chain_parse", "Chain DER parsing", NULL, chain_parse, NULL, 0},
+    {"chain_signatures", "Chain signatures", NULL, chain_verify_signatures, NULL, 0},
+    {"chain_verify", "Chain X509_verify_cert", NULL, chain_verify, chain_finish_iteration, 0},
+};
+
+const pqb_family pqb_chain_family = {
+    .name = "x509_chain",
+    .ops = chain_ops,
+    .num_ops = sizeof(chain_ops) / sizeof(chain_ops[0]),
+    .create = chain_create,
+    .destroy = chain_destroy,
+    .wire_bytes = chain_wire_bytes,
+};
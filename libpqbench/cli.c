@@ -0,0 +1,742 @@
+#include "cli.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "baseline.h"
+#include "cpufeatures.h"
+#include "discover.h"
+#include "measure.h"
+#include "sink.h"
+#include "topology.h"
+
+void pqb_usage(const char *prog, const char *positional) {
+    fprintf(stderr, "Usage: %s [--threads N] [--topology] [--contexts cold|hot|both] [--batch K] [--sweep] [--paths] [--chain DEPTH]\n"
+            "       [--ndjson FILE] [--json FILE] [--csv FILE] [--warmup N|auto] [--filter legacy|none]\n"
+            "       [--cpu N] [--fifo] [--mlock] [--counters] [--memory] [--leakage N]\n"
+            "       [--load RATE[,RATE...]] [--arrival fixed|poisson] [--load-duration SECONDS]\n"
+            "       [--pool RATE] [--pool-size N] [--soak SECONDS] [--soak-samples histogram|raw]\n"
+            "       [--async DEPTH[,DEPTH...]]\n"
+            "       [--target-ci PERCENT] [--max-runs N] [--time-budget SECONDS]\n"
+            "       [--list] [--discover PROVIDER] [--algorithms A,B,...] [--include GLOBS] [--exclude GLOBS]\n"
+            "       [--backend liboqs|NAME:PROVIDER[+PROVIDER...][,config=FILE][,modules=DIR]]...\n"
+            "       [--save-baseline DIR] [--compare-baseline DIR] [--regression-threshold PERCENT]\n"
+            "       [--cpu-matrix] [--cpu-level NAME:VAR=VALUE[,VAR=VALUE...]]... %s\n",
+            prog, positional);
+    exit(EXIT_FAILURE);
+}
+
+static int parse_at_least(const char *prog, const char *name, const char *value, long min) {
+    char *end;
+    long v = strtol(value, &end, 10);
+    if (*value == '\0' || *end != '\0' || v < min || v > 1 << 20) {
+        fprintf(stderr, "%s: invalid value for --%s: %s\n", prog, name, value);
+        exit(EXIT_FAILURE);
+    }
+    return (int)v;
+}
+
+// A positive count that may run to billions, e.g. of leakage measurements
+static uint64_t parse_count(const char *prog, const char *name, const char *value) {
+    char *end;
+    errno = 0;
+    unsigned long long v = strtoull(value, &end, 10);
+    if (*value == '\0' || *value == '-' || *end != '\0' || errno == ERANGE || v == 0) {
+        fprintf(stderr, "%s: invalid value for --%s: %s\n", prog, name, value);
+        exit(EXIT_FAILURE);
+    }
+    return v;
+}
+
+// A positive decimal number
+static double parse_positive_double(const char *prog, const char *name, const char *value) {
+    char *end;
+    double v = strtod(value, &end);
+    if (*value == '\0' || *end != '\0' || !(v > 0)) {
+        fprintf(stderr, "%s: invalid value for --%s: %s\n", prog, name, value);
+        exit(EXIT_FAILURE);
+    }
+    return v;
+}
+
+// Comma separated positive rates, in the order given
+static void parse_rates(const char *prog, const char *value, pqb_load_options *load) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", value);
+    char *save = NULL;
+    load->num_rates = 0;
+    for (char *r = strtok_r(buf, ",", &save); r; r = strtok_r(NULL, ",", &save)) {
+        if (load->num_rates == PQB_MAX_LOAD_RATES) {
+            fprintf(stderr, "%s: at most %d rates for --load\n", prog, PQB_MAX_LOAD_RATES);
+            exit(EXIT_FAILURE);
+        }
+        load->rates[load->num_rates++] = parse_positive_double(prog, "load", r);
+    }
+    if (load->num_rates == 0) {
+        fprintf(stderr, "%s: invalid value for --load: %s\n", prog, value);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Comma separated async depths, in the order given
+static void parse_depths(const char *prog, const char *value, pqb_async_options *async) {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", value);
+    char *save = NULL;
+    async->num_depths = 0;
+    for (char *d = strtok_r(buf, ",", &save); d; d = strtok_r(NULL, ",", &save)) {
+        if (async->num_depths == PQB_MAX_ASYNC_DEPTHS) {
+            fprintf(stderr, "%s: at most %d depths for --async\n", prog, PQB_MAX_ASYNC_DEPTHS);
+            exit(EXIT_FAILURE);
+        }
+        int depth = parse_at_least(prog, "async", d, 1);
+        if (depth > PQB_ASYNC_MAX_DEPTH) {
+            fprintf(stderr, "%s: --async depths are at most %d\n", prog, PQB_ASYNC_MAX_DEPTH);
+            exit(EXIT_FAILURE);
+        }
+        async->depths[async->num_depths++] = depth;
+    }
+    if (async->num_depths == 0) {
+        fprintf(stderr, "%s: invalid value for --async: %s\n", prog, value);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// The options that pick a mode or change what a run reports, as bits
+enum {
+    OPT_THREADS,
+    OPT_TOPOLOGY,
+    OPT_SWEEP,
+    OPT_TARGET_CI,
+    OPT_BACKEND,
+    OPT_BATCH,
+    OPT_PATHS,
+    OPT_CHAIN,
+    OPT_LEAKAGE,
+    OPT_LOAD,
+    OPT_POOL,
+    OPT_SOAK,
+    OPT_ASYNC,
+    OPT_COUNTERS,
+    OPT_MEMORY,
+    OPT_SAVE_BASELINE,
+    OPT_COMPARE_BASELINE,
+    OPT_CPU_MATRIX,
+    OPT_CPU_LEVEL,
+    OPT_NDJSON,
+    OPT_CSV,
+    NUM_OPTS
+};
+
+static const char *const option_names[NUM_OPTS] = {
+    "threads", "topology", "sweep", "target-ci", "backend", "batch", "paths", "chain", "leakage", "load", "pool",
+    "soak", "async", "counters", "memory", "save-baseline", "compare-baseline", "cpu-matrix", "cpu-level", "ndjson",
+    "csv",
+};
+
+#define OPT(o) (1u << (o))
+#define OPT_BASELINES (OPT(OPT_SAVE_BASELINE) | OPT(OPT_COMPARE_BASELINE))
+
+// Options that cannot be given together: any of modes with any of excludes.
+// Every pair a run would otherwise settle by dropping one of them is here.
+typedef struct {
+    unsigned modes;
+    unsigned excludes;
+} conflict;
+
+static const conflict conflicts[] = {
+    // Throughput, sweep and adaptive runs each time passes their own way
+    {OPT(OPT_THREADS), OPT(OPT_SWEEP) | OPT(OPT_TARGET_CI)},
+    {OPT(OPT_SWEEP), OPT(OPT_TARGET_CI)},
+    // A family measures one variant: the chain, the paths or the batches
+    {OPT(OPT_PATHS), OPT(OPT_BATCH)},
+    // A comparison is a latency table, one fixed-count run per backend
+    {OPT(OPT_BACKEND), OPT(OPT_THREADS) | OPT(OPT_SWEEP) | OPT(OPT_TARGET_CI)},
+    {OPT(OPT_LEAKAGE),
+     OPT(OPT_THREADS) | OPT(OPT_SWEEP) | OPT(OPT_TARGET_CI) | OPT(OPT_BACKEND) | OPT(OPT_BATCH) | OPT(OPT_PATHS)},
+    // Baselines hold latency samples only
+    {OPT_BASELINES, OPT(OPT_THREADS) | OPT(OPT_SWEEP) | OPT(OPT_BACKEND) | OPT(OPT_LEAKAGE)},
+    // Only latency results carry a profile or counter readings
+    {OPT(OPT_MEMORY) | OPT(OPT_COUNTERS), OPT(OPT_THREADS) | OPT(OPT_SWEEP) | OPT(OPT_BACKEND) | OPT(OPT_LEAKAGE)},
+    // Load mode has a family of its own and reports histograms only; its
+    // workers are the threads
+    {OPT(OPT_LOAD), OPT(OPT_SWEEP) | OPT(OPT_TARGET_CI) | OPT(OPT_BACKEND) | OPT(OPT_BATCH) | OPT(OPT_PATHS) |
+                        OPT(OPT_LEAKAGE) | OPT(OPT_COUNTERS) | OPT(OPT_MEMORY) | OPT_BASELINES},
+    // Key pool mode reports histograms too; its producers are the threads
+    {OPT(OPT_POOL), OPT(OPT_SWEEP) | OPT(OPT_TARGET_CI) | OPT(OPT_BACKEND) | OPT(OPT_BATCH) | OPT(OPT_PATHS) |
+                        OPT(OPT_LEAKAGE) | OPT(OPT_LOAD) | OPT(OPT_COUNTERS) | OPT(OPT_MEMORY) | OPT_BASELINES},
+    // The topology sweep is throughput mode on cpus it picks itself
+    {OPT(OPT_TOPOLOGY), OPT(OPT_THREADS) | OPT(OPT_SWEEP) | OPT(OPT_TARGET_CI) | OPT(OPT_BACKEND) |
+                            OPT(OPT_LEAKAGE) | OPT(OPT_LOAD) | OPT(OPT_POOL) | OPT(OPT_COUNTERS) | OPT(OPT_MEMORY) |
+                            OPT_BASELINES},
+    // A soak run is one long latency run on one thread
+    {OPT(OPT_SOAK), OPT(OPT_THREADS) | OPT(OPT_TOPOLOGY) | OPT(OPT_SWEEP) | OPT(OPT_TARGET_CI) | OPT(OPT_BACKEND) |
+                        OPT(OPT_LEAKAGE) | OPT(OPT_LOAD) | OPT(OPT_POOL) | OPT(OPT_COUNTERS) | OPT(OPT_MEMORY) |
+                        OPT_BASELINES},
+    // Async mode sweeps depths on the one measuring thread, against a
+    // synchronous point of its own
+    {OPT(OPT_ASYNC), OPT(OPT_THREADS) | OPT(OPT_TOPOLOGY) | OPT(OPT_SWEEP) | OPT(OPT_TARGET_CI) | OPT(OPT_BACKEND) |
+                         OPT(OPT_LEAKAGE) | OPT(OPT_LOAD) | OPT(OPT_POOL) | OPT(OPT_SOAK) | OPT(OPT_COUNTERS) |
+                         OPT(OPT_MEMORY) | OPT_BASELINES},
+    // Chains are a family of their own, measured like the primitive
+    {OPT(OPT_CHAIN), OPT(OPT_SWEEP) | OPT(OPT_BACKEND) | OPT(OPT_BATCH) | OPT(OPT_PATHS) | OPT(OPT_LEAKAGE) |
+                         OPT(OPT_LOAD) | OPT(OPT_POOL)},
+    // CSV rows are the latency, throughput and sweep summaries, and NDJSON
+    // lines the raw samples of latency and throughput runs; the other modes'
+    // results only have JSON records
+    {OPT(OPT_CSV), OPT(OPT_BACKEND) | OPT(OPT_LEAKAGE) | OPT(OPT_LOAD) | OPT(OPT_POOL) | OPT(OPT_ASYNC)},
+    {OPT(OPT_NDJSON),
+     OPT(OPT_SWEEP) | OPT(OPT_BACKEND) | OPT(OPT_LEAKAGE) | OPT(OPT_LOAD) | OPT(OPT_POOL) | OPT(OPT_ASYNC)},
+    // A matrix is built from the latency rows of each level's CSV file, and
+    // the levels' own runs must not overwrite the files the options name
+    {OPT(OPT_CPU_MATRIX) | OPT(OPT_CPU_LEVEL),
+     OPT(OPT_THREADS) | OPT(OPT_TOPOLOGY) | OPT(OPT_SWEEP) | OPT(OPT_BACKEND) | OPT(OPT_LEAKAGE) | OPT(OPT_LOAD) |
+         OPT(OPT_POOL) | OPT(OPT_ASYNC) | OPT_BASELINES | OPT(OPT_NDJSON) | OPT(OPT_CSV)},
+};
+
+// Exits naming the first pair of options given together that conflict
+static void check_conflicts(const char *prog, unsigned given) {
+    for (size_t r = 0; r < sizeof(conflicts) / sizeof(conflicts[0]); r++) {
+        unsigned modes = given & conflicts[r].modes;
+        unsigned excluded = given & conflicts[r].excludes;
+        if (!modes || !excluded) {
+            continue;
+        }
+        fprintf(stderr, "%s: --%s cannot be combined with --%s\n", prog, option_names[__builtin_ctz(modes)],
+                option_names[__builtin_ctz(excluded)]);
+        exit(EXIT_FAILURE);
+    }
+}
+
+int pqb_parse_args(int argc, char *argv[], const char *positional, pqb_options *opts) {
+    static const struct option long_options[] = {
+        {"threads", required_argument, NULL, 't'},
+        {"topology", no_argument, NULL, 'Y'},
+        {"contexts", required_argument, NULL, 'c'},
+        {"batch", required_argument, NULL, 'b'},
+        {"sweep", no_argument, NULL, 's'},
+        {"paths", no_argument, NULL, 'p'},
+        {"chain", required_argument, NULL, 'X'},
+        {"ndjson", required_argument, NULL, 'n'},
+        {"json", required_argument, NULL, 'j'},
+        {"csv", required_argument, NULL, 'v'},
+        {"warmup", required_argument, NULL, 'w'},
+        {"filter", required_argument, NULL, 'F'},
+        {"cpu", required_argument, NULL, 'u'},
+        {"fifo", no_argument, NULL, 'f'},
+        {"mlock", no_argument, NULL, 'm'},
+        {"counters", no_argument, NULL, 'C'},
+        {"memory", no_argument, NULL, 'H'},
+        {"leakage", required_argument, NULL, 'L'},
+        {"load", required_argument, NULL, 'O'},
+        {"arrival", required_argument, NULL, 'A'},
+        {"load-duration", required_argument, NULL, 'd'},
+        {"pool", required_argument, NULL, 'P'},
+        {"soak", required_argument, NULL, 'K'},
+        {"soak-samples", required_argument, NULL, 'E'},
+        {"pool-size", required_argument, NULL, 'Z'},
+        {"async", required_argument, NULL, 'J'},
+        {"target-ci", required_argument, NULL, 'T'},
+        {"max-runs", required_argument, NULL, 'M'},
+        {"time-budget", required_argument, NULL, 'B'},
+        {"list", no_argument, NULL, 'l'},
+        {"discover", required_argument, NULL, 'D'},
+        {"algorithms", required_argument, NULL, 'a'},
+        {"include", required_argument, NULL, 'i'},
+        {"exclude", required_argument, NULL, 'x'},
+        {"backend", required_argument, NULL, 'k'},
+        {"save-baseline", required_argument, NULL, 'S'},
+        {"compare-baseline", required_argument, NULL, 'R'},
+        {"regression-threshold", required_argument, NULL, 'r'},
+        {"cpu-matrix", no_argument, NULL, 'G'},
+        {"cpu-level", required_argument, NULL, 'V'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    opts->threads = 0;
+    opts->topology = 0;
+    opts->contexts = PQB_CONTEXTS_COLD;
+    opts->batch = 0;
+    opts->sweep = 0;
+    opts->paths = 0;
+    opts->chain = 0;
+    opts->ndjson = NULL;
+    opts->json = NULL;
+    opts->csv = NULL;
+    opts->warmup = 0;
+    opts->filter = PQB_FILTER_LEGACY;
+    pqb_isolation_default(&opts->isolation);
+    opts->counters = 0;
+    opts->memory = 0;
+    opts->leakage = 0;
+    opts->load.num_rates = 0;
+    opts->load.workers = 1;
+    opts->load.arrival = PQB_ARRIVAL_FIXED;
+    opts->load.duration = PQB_LOAD_DURATION;
+    opts->soak = 0.0;
+    opts->soak_samples = PQB_SAMPLES_HISTOGRAM;
+    opts->pool.rate = 0.0;
+    opts->pool.capacity = PQB_POOL_CAPACITY;
+    opts->pool.producers = 0;
+    opts->async.num_depths = 0;
+    opts->target_ci = 0.0;
+    opts->max_runs = PQB_ADAPTIVE_MAX_RUNS;
+    opts->time_budget = PQB_ADAPTIVE_TIME_BUDGET;
+    opts->list = 0;
+    opts->discover = NULL;
+    opts->algorithms = NULL;
+    opts->include = NULL;
+    opts->exclude = NULL;
+    opts->num_backends = 0;
+    opts->save_baseline = NULL;
+    opts->compare_baseline = NULL;
+    opts->regression_threshold = PQB_BASELINE_THRESHOLD;
+    opts->cpu_matrix = 0;
+    opts->num_cpu_levels = 0;
+    opts->argv = argv;
+    const char *cpu_levels[PQB_MAX_CPU_LEVELS];
+    int num_cpu_levels = 0;
+    const char *slash = strrchr(argv[0], '/');
+    opts->program = slash ? slash + 1 : argv[0];
+
+    // From the start, for drivers that parse several argument lists
+    optind = 0;
+    int c;
+    while ((c = getopt_long(argc, argv, "t:Yc:b:spX:n:j:v:w:F:u:fmCHL:O:A:d:P:Z:J:K:E:T:M:B:lD:a:i:x:k:S:R:r:GV:h", long_options, NULL)) != -1) {
+        switch (c) {
+        case 't':
+            opts->threads = parse_at_least(argv[0], "threads", optarg, 1);
+            break;
+        case 'b':
+            opts->batch = parse_at_least(argv[0], "batch", optarg, 1);
+            break;
+        case 's':
+            opts->sweep = 1;
+            break;
+        case 'p':
+            opts->paths = 1;
+            break;
+        case 'n':
+            opts->ndjson = optarg;
+            break;
+        case 'j':
+            opts->json = optarg;
+            break;
+        case 'v':
+            opts->csv = optarg;
+            break;
+        case 'w':
+            opts->warmup = strcmp(optarg, "auto") == 0 ? PQB_WARMUP_AUTO : parse_at_least(argv[0], "warmup", optarg, 0);
+            break;
+        case 'F':
+            if (strcmp(optarg, "legacy") == 0) {
+                opts->filter = PQB_FILTER_LEGACY;
+            } else if (strcmp(optarg, "none") == 0) {
+                opts->filter = PQB_FILTER_NONE;
+            } else {
+                fprintf(stderr, "%s: --filter must be legacy or none\n", argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'u':
+            opts->isolation.cpu = parse_at_least(argv[0], "cpu", optarg, 0);
+            break;
+        case 'f':
+            opts->isolation.fifo = 1;
+            break;
+        case 'm':
+            opts->isolation.lock_memory = 1;
+            break;
+        case 'C':
+            opts->counters = 1;
+            break;
+        case 'H':
+            opts->memory = 1;
+            break;
+        case 'L':
+            opts->leakage = parse_count(argv[0], "leakage", optarg);
+            break;
+        case 'O':
+            parse_rates(argv[0], optarg, &opts->load);
+            break;
+        case 'A':
+            if (strcmp(optarg, "fixed") == 0) {
+                opts->load.arrival = PQB_ARRIVAL_FIXED;
+            } else if (strcmp(optarg, "poisson") == 0) {
+                opts->load.arrival = PQB_ARRIVAL_POISSON;
+            } else {
+                fprintf(stderr, "%s: --arrival must be fixed or poisson\n", argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'K':
+            opts->soak = parse_positive_double(argv[0], "soak", optarg);
+            break;
+        case 'E':
+            if (strcmp(optarg, "histogram") == 0) {
+                opts->soak_samples = PQB_SAMPLES_HISTOGRAM;
+            } else if (strcmp(optarg, "raw") == 0) {
+                opts->soak_samples = PQB_SAMPLES_RAW;
+            } else {
+                fprintf(stderr, "%s: --soak-samples must be histogram or raw\n", argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'Y':
+            opts->topology = 1;
+            break;
+        case 'P':
+            opts->pool.rate = parse_positive_double(argv[0], "pool", optarg);
+            break;
+        case 'Z':
+            opts->pool.capacity = parse_at_least(argv[0], "pool-size", optarg, 1);
+            break;
+        case 'J':
+            parse_depths(argv[0], optarg, &opts->async);
+            break;
+        case 'X':
+            opts->chain = parse_at_least(argv[0], "chain", optarg, 2);
+            if (opts->chain > PQB_CHAIN_MAX_DEPTH) {
+                fprintf(stderr, "%s: --chain is at most %d\n", argv[0], PQB_CHAIN_MAX_DEPTH);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'd':
+            opts->load.duration = parse_positive_double(argv[0], "load-duration", optarg);
+            break;
+        case 'S':
+            opts->save_baseline = optarg;
+            break;
+        case 'R':
+            opts->compare_baseline = optarg;
+            break;
+        case 'r':
+            opts->regression_threshold = parse_positive_double(argv[0], "regression-threshold", optarg) / 100;
+            break;
+        case 'G':
+            opts->cpu_matrix = 1;
+            break;
+        case 'V':
+            if (num_cpu_levels == PQB_MAX_CPU_LEVELS - 1) {
+                fprintf(stderr, "%s: at most %d --cpu-level options\n", argv[0], PQB_MAX_CPU_LEVELS - 1);
+                exit(EXIT_FAILURE);
+            }
+            cpu_levels[num_cpu_levels++] = optarg;
+            break;
+        case 'T':
+            opts->target_ci = parse_positive_double(argv[0], "target-ci", optarg) / 100;
+            break;
+        case 'M':
+            opts->max_runs = parse_at_least(argv[0], "max-runs", optarg, 2);
+            break;
+        case 'B':
+            opts->time_budget = parse_positive_double(argv[0], "time-budget", optarg);
+            break;
+        case 'l':
+            opts->list = 1;
+            break;
+        case 'D':
+            opts->discover = optarg;
+            break;
+        case 'a':
+            opts->algorithms = optarg;
+            break;
+        case 'i':
+            opts->include = optarg;
+            break;
+        case 'x':
+            opts->exclude = optarg;
+            break;
+        case 'k':
+            if (opts->num_backends == PQB_MAX_BACKENDS) {
+                fprintf(stderr, "%s: at most %d --backend options\n", argv[0], PQB_MAX_BACKENDS);
+                exit(EXIT_FAILURE);
+            }
+            opts->backends[opts->num_backends++] = optarg;
+            break;
+        case 'c':
+            if (strcmp(optarg, "cold") == 0) {
+                opts->contexts = PQB_CONTEXTS_COLD;
+            } else if (strcmp(optarg, "hot") == 0) {
+                opts->contexts = PQB_CONTEXTS_HOT;
+            } else if (strcmp(optarg, "both") == 0) {
+                opts->contexts = PQB_CONTEXTS_BOTH;
+            } else {
+                fprintf(stderr, "%s: --contexts must be cold, hot or both\n", argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        default:
+            pqb_usage(argv[0], positional);
+        }
+    }
+    unsigned given = (opts->threads > 0 ? OPT(OPT_THREADS) : 0) | (opts->topology ? OPT(OPT_TOPOLOGY) : 0) |
+                     (opts->sweep ? OPT(OPT_SWEEP) : 0) | (opts->target_ci > 0 ? OPT(OPT_TARGET_CI) : 0) |
+                     (opts->num_backends > 0 ? OPT(OPT_BACKEND) : 0) | (opts->batch > 0 ? OPT(OPT_BATCH) : 0) |
+                     (opts->paths ? OPT(OPT_PATHS) : 0) | (opts->chain > 0 ? OPT(OPT_CHAIN) : 0) |
+                     (opts->leakage > 0 ? OPT(OPT_LEAKAGE) : 0) | (opts->load.num_rates > 0 ? OPT(OPT_LOAD) : 0) |
+                     (opts->pool.rate > 0 ? OPT(OPT_POOL) : 0) | (opts->soak > 0 ? OPT(OPT_SOAK) : 0) |
+                     (opts->async.num_depths > 0 ? OPT(OPT_ASYNC) : 0) | (opts->counters ? OPT(OPT_COUNTERS) : 0) |
+                     (opts->memory ? OPT(OPT_MEMORY) : 0) | (opts->save_baseline ? OPT(OPT_SAVE_BASELINE) : 0) |
+                     (opts->compare_baseline ? OPT(OPT_COMPARE_BASELINE) : 0) |
+                     (opts->cpu_matrix ? OPT(OPT_CPU_MATRIX) : 0) | (num_cpu_levels > 0 ? OPT(OPT_CPU_LEVEL) : 0) |
+                     (opts->ndjson ? OPT(OPT_NDJSON) : 0) | (opts->csv ? OPT(OPT_CSV) : 0);
+    check_conflicts(argv[0], given);
+
+    if (opts->load.num_rates > 0 && opts->threads > 0) {
+        opts->load.workers = opts->threads;
+    }
+    if (opts->pool.rate > 0) {
+        opts->pool.producers = opts->threads;
+        opts->pool.arrival = opts->load.arrival;
+        opts->pool.duration = opts->load.duration;
+    }
+    if (opts->cpu_matrix || num_cpu_levels > 0) {
+        // The reference is every feature, whatever else is compared
+        if (opts->cpu_matrix) {
+            opts->num_cpu_levels = pqb_cpu_levels_default(opts->cpu_levels, PQB_MAX_CPU_LEVELS - num_cpu_levels);
+        } else {
+            opts->num_cpu_levels = pqb_cpu_levels_default(opts->cpu_levels, 1);
+        }
+        for (int l = 0; l < num_cpu_levels; l++) {
+            pqb_cpu_level_parse(cpu_levels[l], &opts->cpu_levels[opts->num_cpu_levels++]);
+        }
+        if (opts->num_cpu_levels < 2) {
+            fprintf(stderr, "%s: no built-in CPU levels on this architecture, name some with --cpu-level\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    return optind;
+}
+
+void pqb_apply_options(pqb_bench *bench, const pqb_options *opts) {
+    if (opts->list) {
+        pqb_list_algorithms(bench, stdout);
+        pqb_bench_free(bench);
+        exit(EXIT_SUCCESS);
+    }
+    // The levels of a matrix isolate themselves; this run only collects them
+    const char *matrix_csv = getenv(PQB_CPU_MATRIX_ENV);
+    if (opts->num_cpu_levels > 0 && !matrix_csv) {
+        pqb_report_cpu_features(stdout);
+        if (opts->json) {
+            pqb_bench_add_sink(bench, pqb_json_sink_new(opts->json));
+        }
+        int failed = pqb_bench_run_cpu_matrix(bench, opts->argv, opts->cpu_levels, opts->num_cpu_levels);
+        pqb_bench_free(bench);
+        exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+    // Isolate first so the writer threads of the sinks below can keep off
+    // the pinned cpu
+    pqb_isolate(&opts->isolation);
+    pqb_report_host(stdout);
+    pqb_report_cpu_features(stdout);
+    if (opts->topology) {
+        pqb_topology topo;
+        pqb_topology_discover(&topo);
+        pqb_topology_report(&topo, stdout);
+    }
+
+    pqb_apply_run_options(bench, opts);
+    if (matrix_csv) {
+        pqb_bench_add_sink(bench, pqb_csv_sink_new(matrix_csv));
+    } else {
+        if (opts->ndjson) {
+            pqb_bench_add_sink(bench, pqb_ndjson_sink_new(opts->ndjson));
+        }
+        if (opts->json) {
+            pqb_bench_add_sink(bench, pqb_json_sink_new(opts->json));
+        }
+        if (opts->csv) {
+            pqb_bench_add_sink(bench, pqb_csv_sink_new(opts->csv));
+        }
+    }
+    for (int b = 0; b < opts->num_backends; b++) {
+        pqb_bench_add_backend(bench, opts->backends[b]);
+    }
+    if (opts->save_baseline || opts->compare_baseline) {
+        pqb_fingerprint fp;
+        pqb_fingerprint_get(bench, &fp);
+        // Compare first: it loads the old baseline before a save to the same
+        // key replaces it
+        if (opts->compare_baseline) {
+            pqb_bench_add_sink(bench, pqb_regression_sink_new(opts->compare_baseline, opts->program, &fp,
+                                                              opts->regression_threshold, stdout, &bench->status));
+        }
+        if (opts->save_baseline) {
+            pqb_bench_add_sink(bench, pqb_baseline_sink_new(opts->save_baseline, opts->program, &fp));
+        }
+    }
+    // Calibrated after isolation, on the cpu the runs will use
+    if (opts->counters) {
+        pqb_counters_open(&bench->counters);
+    }
+}
+
+void pqb_apply_run_options(pqb_bench *bench, const pqb_options *opts) {
+    bench->warmup = opts->warmup;
+    bench->memory = opts->memory;
+    bench->stats_options.filter = opts->filter;
+}
+
+// The families the options select: the chain, paths, batch, cold and/or hot variant
+static int select_variants(pqb_bench *bench, const pqb_options *opts, const pqb_family *family,
+                           const pqb_family *variants[2]) {
+    // A verifier keeps its store and context, so --contexts does not apply
+    if (opts->chain > 0) {
+        if (!family->chain) {
+            fprintf(stderr, "The %s family has no certificate chains\n", family->name);
+            exit(EXIT_FAILURE);
+        }
+        bench->chain_depth = opts->chain;
+        variants[0] = family->chain;
+        return 1;
+    }
+    // Each path sets up its contexts the way its API does, so --contexts does not apply
+    if (opts->paths) {
+        if (!family->paths) {
+            fprintf(stderr, "The %s family has no alternative paths\n", family->name);
+            exit(EXIT_FAILURE);
+        }
+        variants[0] = family->paths;
+        return 1;
+    }
+    // Batches always reuse contexts, so --contexts does not apply
+    if (opts->batch > 0) {
+        if (!family->batch) {
+            fprintf(stderr, "The %s family has no batch variant\n", family->name);
+            exit(EXIT_FAILURE);
+        }
+        bench->batch_size = opts->batch;
+        variants[0] = family->batch;
+        return 1;
+    }
+    int n = 0;
+    if (opts->contexts != PQB_CONTEXTS_HOT) {
+        variants[n++] = family;
+    }
+    if (opts->contexts != PQB_CONTEXTS_COLD) {
+        if (!family->hot) {
+            fprintf(stderr, "The %s family has no hot variant\n", family->name);
+            exit(EXIT_FAILURE);
+        }
+        variants[n++] = family->hot;
+    }
+    return n;
+}
+
+static void run_family(pqb_bench *bench, const pqb_options *opts, const pqb_family *family, const char *alg) {
+    if (bench->num_backends > 0) {
+        pqb_bench_run_backends(bench, family, alg);
+    } else if (opts->threads > 0) {
+        pqb_bench_run_throughput(bench, family, alg, opts->threads);
+    } else if (opts->topology) {
+        pqb_bench_run_topology(bench, family, alg);
+    } else if (opts->async.num_depths > 0) {
+        pqb_bench_run_async(bench, family, alg, &opts->async);
+    } else if (opts->soak > 0) {
+        pqb_bench_run_soak(bench, family, alg, opts->soak, opts->soak_samples);
+    } else if (opts->sweep) {
+        pqb_bench_run_sweep(bench, family, alg);
+    } else {
+        pqb_bench_run(bench, family, alg);
+    }
+}
+
+// The algorithms to run the family for: the driver's, or the ones the
+// options name or discover, filtered
+static void select_algorithms(const pqb_bench *bench, const pqb_options *opts, const pqb_family *family,
+                              const char *const algs[], int num_algs, pqb_alg_list *list) {
+    if (opts->algorithms) {
+        char buf[1024];
+        snprintf(buf, sizeof(buf), "%s", opts->algorithms);
+        char *save = NULL;
+        for (char *a = strtok_r(buf, ",", &save); a; a = strtok_r(NULL, ",", &save)) {
+            pqb_alg_list_add(list, a);
+        }
+    } else if (opts->discover) {
+        if (family->algorithms == PQB_ALGS_NONE) {
+            fprintf(stderr, "The %s family cannot discover its algorithms, skipping it\n", family->name);
+            return;
+        }
+        pqb_discover(bench, family->algorithms, opts->discover, list);
+    } else {
+        for (int a = 0; a < num_algs; a++) {
+            pqb_alg_list_add(list, algs[a]);
+        }
+    }
+    pqb_filter_algorithms(list, opts->include, opts->exclude);
+    if (list->count == 0) {
+        fprintf(stderr, "No algorithms selected for the %s family\n", family->name);
+    }
+}
+
+void pqb_run_all_with_options(pqb_bench *bench, const pqb_options *opts, const pqb_family *family,
+                              const char *const algs[], int num_algs) {
+    pqb_alg_list list = {0};
+    select_algorithms(bench, opts, family, algs, num_algs, &list);
+    if (list.count == 0) {
+        pqb_alg_list_free(&list);
+        return;
+    }
+    // The leakage test has a family of its own, with one set of contexts
+    if (opts->leakage > 0) {
+        for (int a = 0; a < list.count; a++) {
+            pqb_bench_run_leakage(bench, family, list.names[a], opts->leakage);
+        }
+        pqb_alg_list_free(&list);
+        return;
+    }
+    // So has load mode, whose ops are requests
+    if (opts->load.num_rates > 0) {
+        for (int a = 0; a < list.count; a++) {
+            pqb_bench_run_load(bench, family, list.names[a], &opts->load);
+        }
+        pqb_alg_list_free(&list);
+        return;
+    }
+    // Key pool mode only generates keys of the algorithms, whatever the family
+    if (opts->pool.rate > 0) {
+        for (int a = 0; a < list.count; a++) {
+            pqb_bench_run_pool(bench, list.names[a], &opts->pool);
+        }
+        pqb_alg_list_free(&list);
+        return;
+    }
+    const pqb_family *variants[2];
+    int num_variants = select_variants(bench, opts, family, variants);
+    // Each variant resolved once per algorithm, for both runners
+    const pqb_family **resolved = pqb_xcalloc((size_t)num_variants * list.count, sizeof(pqb_family *), "the families");
+    for (int v = 0; v < num_variants; v++) {
+        for (int a = 0; a < list.count; a++) {
+            resolved[v * list.count + a] = pqb_family_for(variants[v], list.names[a]);
+        }
+    }
+
+    // The adaptive runner shares time out across algorithms, so it needs
+    // all of them at once
+    if (opts->target_ci > 0 && opts->threads == 0 && !opts->sweep) {
+        bench->target_ci = opts->target_ci;
+        bench->max_runs = opts->max_runs;
+        bench->time_budget = opts->time_budget;
+        for (int v = 0; v < num_variants; v++) {
+            pqb_bench_run_adaptive(bench, &resolved[v * list.count], list.names, list.count);
+        }
+    } else {
+        for (int a = 0; a < list.count; a++) {
+            for (int v = 0; v < num_variants; v++) {
+                run_family(bench, opts, resolved[v * list.count + a], list.names[a]);
+            }
+        }
+    }
+    free(resolved);
+    pqb_alg_list_free(&list);
+}
+
+void pqb_run_with_options(pqb_bench *bench, const pqb_options *opts, const pqb_family *family, const char *alg) {
+    pqb_run_all_with_options(bench, opts, family, &alg, 1);
+}
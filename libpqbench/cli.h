@@ -0,0 +1,87 @@
+#ifndef PQB_CLI_H
+#define PQB_CLI_H
+
+#include "bench.h"
+#include "isolate.h"
+#include "stats.h"
+
+// Which variant of a family is measured
+typedef enum {
+    PQB_CONTEXTS_COLD, // fetch the algorithm and build its contexts on every call, as a one-off caller does
+    PQB_CONTEXTS_HOT,  // pre-fetched algorithms and reused contexts, the primitive cost alone
+    PQB_CONTEXTS_BOTH  // cold then hot; the difference is the setup overhead
+} pqb_contexts;
+
+// Options shared by the drivers
+typedef struct {
+    int threads; // --threads N: throughput mode on up to N pinned threads, 0 measures latency on one thread
+    int topology; // --topology: throughput on one core, SMT siblings, a socket and every socket instead
+    pqb_contexts contexts; // --contexts cold|hot|both
+    int batch;             // --batch K: time batches of K operations, 0 times them one by one
+    int sweep;             // --sweep: cost against payload size instead of the fixed payload
+    double soak;           // --soak SECONDS: run for this long instead of a fixed count, 0 for no soak
+    pqb_samples_mode soak_samples; // --soak-samples histogram|raw
+    int paths;             // --paths: every API path to the primitive side by side
+    int chain;             // --chain DEPTH: certificate chains DEPTH deep instead of the primitive, 0 for none
+    const char *ndjson;    // --ndjson FILE: raw samples, NULL if not requested
+    const char *json;      // --json FILE: summary records
+    const char *csv;       // --csv FILE: summary rows
+    int warmup;            // --warmup N|auto: untimed passes before measuring, PQB_WARMUP_AUTO until stable
+    pqb_filter filter;     // --filter legacy|none: samples the mean is computed over
+    pqb_isolation isolation; // --cpu N, --fifo, --mlock
+    int counters;          // --counters: hardware counters around every timed op
+    int memory;            // --memory: peak heap, resident set and stack of every op
+    uint64_t leakage;      // --leakage N: timing leakage test with N measurements per op, 0 for none
+    pqb_load_options load; // --load RATE[,RATE...] --arrival fixed|poisson --load-duration SECONDS, --threads workers
+    pqb_pool_options pool; // --pool RATE --pool-size N, --threads producers, arrivals and duration as for --load
+    pqb_async_options async; // --async DEPTH[,DEPTH...]: ASYNC jobs in flight at each point, after a synchronous one
+    double target_ci;      // --target-ci PERCENT: adaptive mode, as a fraction; 0 runs the fixed count
+    int max_runs;          // --max-runs N: adaptive passes per algorithm at most
+    double time_budget;    // --time-budget SECONDS: adaptive time per family and variant
+    int list;              // --list: print the algorithms of the loaded providers and exit
+    const char *discover;  // --discover PROVIDER: every algorithm of PROVIDER instead of the driver's list
+    const char *algorithms; // --algorithms A,B,...: this list instead of the driver's
+    const char *include;   // --include GLOBS: keep only matching algorithms
+    const char *exclude;   // --exclude GLOBS: drop matching algorithms
+    const char *backends[PQB_MAX_BACKENDS]; // --backend SPEC, repeatable: compare these instead of the driver's providers
+    int num_backends;
+    const char *save_baseline;    // --save-baseline DIR: store this run's samples as the baseline
+    const char *compare_baseline; // --compare-baseline DIR: test this run against the newest stored baseline
+    double regression_threshold;  // --regression-threshold PERCENT: slowdown that fails the run, as a fraction
+    const char *program;          // driver name the baselines are stored under, from argv[0]
+    int cpu_matrix;               // --cpu-matrix: run again with the built-in CPU feature levels and compare them
+    pqb_cpu_level cpu_levels[PQB_MAX_CPU_LEVELS]; // --cpu-level NAME:VAR=VALUE[,...], repeatable, after the built-in ones
+    int num_cpu_levels;           // 0 unless a matrix is asked for; the first level is the reference
+    char **argv;                  // the driver's arguments, for the runs of a matrix
+} pqb_options;
+
+// Parse the shared options and return the index of the first positional
+// argument; prints usage and exits on bad input. positional describes the
+// driver's own arguments for the usage line and may be "".
+int pqb_parse_args(int argc, char *argv[], const char *positional, pqb_options *opts);
+
+void pqb_usage(const char *prog, const char *positional);
+
+// Apply the options that configure the bench itself rather than a single
+// run: the machine readable sinks, warmup, the mean's filter, the backends,
+// hardware counters and process isolation, then report the host state. Call once, after the bench is set up.
+// With a CPU matrix asked for, this runs the whole matrix and exits instead;
+// in each level's own run, the results go to the matrix's CSV file, not the
+// files the options name.
+void pqb_apply_options(pqb_bench *bench, const pqb_options *opts);
+
+// Only the part of pqb_apply_options that differs from one run to the next,
+// the warmup, the memory profile and the mean's filter, for drivers that run
+// several option sets over one bench
+void pqb_apply_run_options(pqb_bench *bench, const pqb_options *opts);
+
+// Measure the family for every algorithm in algs, or in the list that
+// --algorithms or --discover gives instead, narrowed by --include and
+// --exclude, in the way the options ask for
+void pqb_run_all_with_options(pqb_bench *bench, const pqb_options *opts, const pqb_family *family,
+                              const char *const algs[], int num_algs);
+
+// The same for a single algorithm
+void pqb_run_with_options(pqb_bench *bench, const pqb_options *opts, const pqb_family *family, const char *alg);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef PQB_CONFIG_H
+#define PQB_CONFIG_H
+
+// Optional dependencies; build with -DPQB_HAVE_LIBOQS=0 when liboqs is not
+// installed to drop the paths that call it directly
+#ifndef PQB_HAVE_LIBOQS
+#define PQB_HAVE_LIBOQS 1
+#endif
+
+// -DPQB_HAVE_PLPLOT=0 builds without libplplot; the plot sink then does nothing
+// and plots can still be drawn later from --ndjson output
+#ifndef PQB_HAVE_PLPLOT
+#define PQB_HAVE_PLPLOT 1
+#endif
+
+#endif
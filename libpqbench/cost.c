@@ -0,0 +1,152 @@
+#include "cost.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+
+#include "families.h"
+#include "keys.h"
+
+void pqb_cost_model_default(pqb_cost_model *m) {
+    m->rtt_ms = 0.0;
+    m->bandwidth_mbps = 0.0;
+    m->chain_certs = 2;
+    m->cert_overhead = 0;
+    m->initcwnd = 10;
+    m->mss = 1460;
+}
+
+static int ends_with(const char *s, const char *suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+void pqb_measure_kex_cost(pqb_bench *bench, const pqb_family *family, const char *alg, pqb_kex_cost *out) {
+    if (!family->wire_bytes || !family->responder_bytes) {
+        fprintf(stderr, "The %s family does not report what each side sends\n", family->name);
+        exit(EXIT_FAILURE);
+    }
+
+    // Sizes from one untimed pass; they do not change from run to run
+    void *state = family->create(bench, alg);
+    for (int o = 0; o < family->num_ops; o++) {
+        const pqb_op *op = &family->ops[o];
+        if (op->prepare) {
+            op->prepare(state);
+        }
+        op->run(state);
+        if (op->finish) {
+            op->finish(state);
+        }
+    }
+    size_t wire = family->wire_bytes(state);
+    out->algorithm = alg;
+    out->responder_bytes = family->responder_bytes(state);
+    out->initiator_bytes = wire - out->responder_bytes;
+    family->destroy(state);
+
+    pqb_stats *stats = calloc(family->num_ops, sizeof(pqb_stats));
+    if (!stats) {
+        fprintf(stderr, "Failed to allocate memory for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    pqb_bench_measure(bench, family, alg, stats);
+    out->initiator_ns = 0.0;
+    out->responder_ns = 0.0;
+    for (int o = 0; o < family->num_ops; o++) {
+        double ns = pqb_timer_ns(&bench->timer, stats[o].median);
+        if (ends_with(family->ops[o].name, "_responder")) {
+            out->responder_ns += ns;
+        } else {
+            out->initiator_ns += ns;
+        }
+    }
+    free(stats);
+}
+
+void pqb_measure_auth_cost(pqb_bench *bench, const char *alg, pqb_auth_cost *out) {
+    EVP_PKEY *pkey = pqb_generate_key(bench->libctx, alg);
+    int priv_len, pub_len;
+    pqb_key_sizes(pkey, &priv_len, &pub_len);
+
+    // Signed as the signature family signs, so the size matches what it times
+    EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+    EVP_MD *md = EVP_MD_fetch(bench->libctx, "SHA256", NULL);
+    unsigned char *sig = OPENSSL_malloc(EVP_PKEY_get_size(pkey));
+    unsigned int sig_len = 0;
+    if (!md_ctx || !md || !sig || !EVP_SignInit_ex(md_ctx, md, NULL) ||
+        !EVP_SignUpdate(md_ctx, bench->payload, bench->payload_len) ||
+        !EVP_SignFinal_ex(md_ctx, sig, &sig_len, pkey, bench->libctx, NULL)) {
+        fprintf(stderr, "Failed to sign the payload with %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    OPENSSL_free(sig);
+    EVP_MD_free(md);
+    EVP_MD_CTX_free(md_ctx);
+    EVP_PKEY_free(pkey);
+
+    pqb_stats stats[2];
+    pqb_bench_measure(bench, &pqb_sig_family, alg, stats);
+    out->algorithm = alg;
+    out->public_key_bytes = pub_len;
+    out->signature_bytes = sig_len;
+    out->sign_ns = pqb_timer_ns(&bench->timer, stats[0].median);
+    out->verify_ns = pqb_timer_ns(&bench->timer, stats[1].median);
+}
+
+// Round trips a flight of bytes takes under slow start: the window starts at
+// initcwnd segments and doubles every round trip
+static int flight_round_trips(const pqb_cost_model *m, size_t bytes) {
+    size_t segments = (bytes + m->mss - 1) / m->mss;
+    size_t window = m->initcwnd, sent = 0;
+    int rounds = 0;
+    while (sent < segments) {
+        sent += window;
+        window *= 2;
+        rounds++;
+    }
+    return rounds > 0 ? rounds : 1;
+}
+
+void pqb_estimate_handshake(const pqb_cost_model *m, const pqb_kex_cost *kex, const pqb_auth_cost *auth,
+                            pqb_handshake_estimate *out) {
+    size_t per_cert = auth->public_key_bytes + auth->signature_bytes + m->cert_overhead;
+
+    out->kex = kex->algorithm;
+    out->signature = auth->algorithm;
+    out->rtt_ms = m->rtt_ms;
+    out->bandwidth_mbps = m->bandwidth_mbps;
+    out->chain_certs = m->chain_certs;
+    out->client_bytes = kex->initiator_bytes;
+    out->server_bytes = kex->responder_bytes + m->chain_certs * per_cert + auth->signature_bytes;
+
+    // One round trip for the handshake itself, plus what slow start adds to
+    // each flight beyond its first window
+    out->round_trips = 1 + (flight_round_trips(m, out->client_bytes) - 1) + (flight_round_trips(m, out->server_bytes) - 1);
+
+    // The client verifies every certificate and the CertificateVerify
+    out->client_cpu_ms = (kex->initiator_ns + (m->chain_certs + 1) * auth->verify_ns) * 1e-6;
+    out->server_cpu_ms = (kex->responder_ns + auth->sign_ns) * 1e-6;
+    out->transfer_ms = m->bandwidth_mbps > 0
+                           ? (double)(out->client_bytes + out->server_bytes) * 8 / (m->bandwidth_mbps * 1e3)
+                           : 0.0;
+    out->latency_ms = out->round_trips * m->rtt_ms + out->client_cpu_ms + out->server_cpu_ms + out->transfer_ms;
+}
+
+void pqb_report_handshake(pqb_bench *bench, const pqb_handshake_estimate *estimate) {
+    char name[256];
+    snprintf(name, sizeof(name), "%s + %s", estimate->kex, estimate->signature);
+    for (int s = 0; s < bench->num_sinks; s++) {
+        pqb_sink *sink = bench->sinks[s];
+        if (sink->begin) {
+            sink->begin(sink, name);
+        }
+        if (sink->handshake) {
+            sink->handshake(sink, estimate);
+        }
+        if (sink->end) {
+            sink->end(sink, name);
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef PQB_COST_H
+#define PQB_COST_H
+
+#include <stddef.h>
+
+#include "bench.h"
+
+// Network side of the handshake cost model: a TLS 1.3 style full handshake
+// of one round trip, in which the client sends its key share and the server
+// answers with its key share, its certificate chain and a CertificateVerify
+// signature. Every certificate carries a public key and its issuer's
+// signature, all of the same algorithm.
+typedef struct {
+    double rtt_ms;
+    double bandwidth_mbps;
+    int chain_certs;      // certificates the server sends, leaf first
+    size_t cert_overhead; // bytes per certificate beyond key and signature: names, validity, extensions
+    int initcwnd;         // TCP initial congestion window, in segments
+    size_t mss;           // TCP segment payload
+} pqb_cost_model;
+
+// 2 certificates without overhead, an initial window of 10 segments of 1460
+// bytes; rtt_ms and bandwidth_mbps are left for the caller
+void pqb_cost_model_default(pqb_cost_model *m);
+
+// A key exchange, as measured with a handshake family
+typedef struct {
+    const char *algorithm;
+    size_t initiator_bytes;
+    size_t responder_bytes;
+    double initiator_ns; // median time of the ops the initiator runs
+    double responder_ns;
+} pqb_kex_cost;
+
+// A signature algorithm, as used for the certificate chain
+typedef struct {
+    const char *algorithm;
+    size_t public_key_bytes; // DER SubjectPublicKeyInfo
+    size_t signature_bytes;  // of one signature over the bench payload
+    double sign_ns;          // median
+    double verify_ns;
+} pqb_auth_cost;
+
+// Measure the family, which must have responder_bytes, for alg
+void pqb_measure_kex_cost(pqb_bench *bench, const pqb_family *family, const char *alg, pqb_kex_cost *out);
+
+// Measure pqb_sig_family for alg and take one key and signature's sizes
+void pqb_measure_auth_cost(pqb_bench *bench, const char *alg, pqb_auth_cost *out);
+
+void pqb_estimate_handshake(const pqb_cost_model *m, const pqb_kex_cost *kex, const pqb_auth_cost *auth,
+                            pqb_handshake_estimate *out);
+
+// Hand an estimate to every sink, between begin and end with "KEX + SIG" as
+// the algorithm
+void pqb_report_handshake(pqb_bench *bench, const pqb_handshake_estimate *estimate);
+
+#endif
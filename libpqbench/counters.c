@@ -0,0 +1,198 @@
+#define _GNU_SOURCE
+#include "counters.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#define CALIBRATION_PAIRS 1000
+
+typedef struct {
+    const char *name;
+    const char *label;
+    uint32_t type;
+    uint64_t config;
+} event;
+
+#define CACHE_READ_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+// In pqb_counter order; the first event that opens leads the group
+static const event events[PQB_NUM_COUNTERS] = {
+    {"instructions", "Instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cycles", "Cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"l1d_misses", "L1d misses", PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D)},
+    {"llc_misses", "LLC misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch_misses", "Branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"dtlb_misses", "dTLB misses", PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB)},
+};
+
+static int open_event(const event *e, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = e->type;
+    attr.size = sizeof(attr);
+    attr.config = e->config;
+    attr.disabled = group_fd < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // Count this thread on whatever CPU it runs on
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+void pqb_counters_init(pqb_counters *pc) {
+    memset(pc, 0, sizeof(*pc));
+    pc->leader_fd = -1;
+    for (int c = 0; c < PQB_NUM_COUNTERS; c++) {
+        pc->fds[c] = -1;
+        pc->slot[c] = -1;
+    }
+}
+
+void pqb_counters_close(pqb_counters *pc) {
+    for (int c = 0; c < PQB_NUM_COUNTERS; c++) {
+        if (pc->fds[c] >= 0) {
+            close(pc->fds[c]);
+        }
+    }
+    pqb_counters_init(pc);
+}
+
+// Open the events in wanted as one group; returns the number that opened
+static int open_group(pqb_counters *pc, const int wanted[PQB_NUM_COUNTERS]) {
+    pqb_counters_init(pc);
+    for (int c = 0; c < PQB_NUM_COUNTERS; c++) {
+        if (!wanted[c]) {
+            continue;
+        }
+        int fd = open_event(&events[c], pc->leader_fd);
+        if (fd < 0) {
+            continue;
+        }
+        if (pc->leader_fd < 0) {
+            pc->leader_fd = fd;
+        }
+        pc->fds[c] = fd;
+        pc->slot[c] = pc->num_open++;
+    }
+    if (pc->leader_fd >= 0) {
+        ioctl(pc->leader_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(pc->leader_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    return pc->num_open;
+}
+
+int pqb_counters_read(const pqb_counters *pc, pqb_counter_values *out) {
+    uint64_t buf[3 + PQB_NUM_COUNTERS];
+    ssize_t want = (ssize_t)((3 + pc->num_open) * sizeof(uint64_t));
+    if (read(pc->leader_fd, buf, want) != want) {
+        return 0;
+    }
+    out->time_enabled = buf[1];
+    out->time_running = buf[2];
+    for (int c = 0; c < PQB_NUM_COUNTERS; c++) {
+        out->values[c] = pc->slot[c] >= 0 ? buf[3 + pc->slot[c]] : 0;
+    }
+    return 1;
+}
+
+int pqb_counters_delta(const pqb_counters *pc, const pqb_counter_values *before, const pqb_counter_values *after,
+                       uint64_t delta[PQB_NUM_COUNTERS]) {
+    uint64_t enabled = after->time_enabled - before->time_enabled;
+    uint64_t running = after->time_running - before->time_running;
+    if (running == 0 || running != enabled) {
+        return 0;
+    }
+    for (int c = 0; c < PQB_NUM_COUNTERS; c++) {
+        uint64_t d = after->values[c] - before->values[c];
+        delta[c] = d > pc->overhead[c] ? d - pc->overhead[c] : 0;
+    }
+    return 1;
+}
+
+// Whether the group gets onto the PMU at all; a group with more events than
+// the PMU has counters for never does
+static int group_counts(const pqb_counters *pc) {
+    pqb_counter_values before, after;
+    if (!pqb_counters_read(pc, &before)) {
+        return 0;
+    }
+    volatile uint64_t sink = 0;
+    for (int i = 0; i < 100000; i++) {
+        sink += i;
+    }
+    if (!pqb_counters_read(pc, &after) || after.time_running == before.time_running) {
+        return 0;
+    }
+    uint64_t total = 0;
+    for (int c = 0; c < PQB_NUM_COUNTERS; c++) {
+        total += after.values[c] - before.values[c];
+    }
+    return total > 0;
+}
+
+// A pair with a failed read is dropped; if every pair is, no overhead is taken off
+static void calibrate(pqb_counters *pc) {
+    for (int c = 0; c < PQB_NUM_COUNTERS; c++) {
+        pc->overhead[c] = UINT64_MAX;
+    }
+    for (int i = 0; i < CALIBRATION_PAIRS; i++) {
+        pqb_counter_values before, after;
+        if (!pqb_counters_read(pc, &before) || !pqb_counters_read(pc, &after)) {
+            continue;
+        }
+        for (int c = 0; c < PQB_NUM_COUNTERS; c++) {
+            uint64_t d = after.values[c] - before.values[c];
+            if (d < pc->overhead[c]) {
+                pc->overhead[c] = d;
+            }
+        }
+    }
+    for (int c = 0; c < PQB_NUM_COUNTERS; c++) {
+        if (pc->overhead[c] == UINT64_MAX) {
+            pc->overhead[c] = 0;
+        }
+    }
+}
+
+int pqb_counters_open(pqb_counters *pc) {
+    int wanted[PQB_NUM_COUNTERS];
+    for (int c = 0; c < PQB_NUM_COUNTERS; c++) {
+        wanted[c] = 1;
+    }
+
+    // Drop events from the end until the rest fit on the PMU together
+    while (open_group(pc, wanted) > 0 && !group_counts(pc)) {
+        int last = PQB_NUM_COUNTERS - 1;
+        while (last >= 0 && pc->slot[last] < 0) {
+            last--;
+        }
+        pqb_counters_close(pc);
+        wanted[last] = 0;
+    }
+    if (pc->num_open == 0) {
+        pqb_counters_close(pc);
+        fprintf(stderr, "Hardware counters unavailable, reporting without them\n");
+        return 0;
+    }
+    for (int c = 0; c < PQB_NUM_COUNTERS; c++) {
+        if (pc->slot[c] < 0) {
+            fprintf(stderr, "Hardware counter %s unavailable, reporting without it\n", events[c].name);
+        }
+    }
+    calibrate(pc);
+    return 1;
+}
+
+const char *pqb_counter_name(pqb_counter c) {
+    return events[c].name;
+}
+
+const char *pqb_counter_label(pqb_counter c) {
+    return events[c].label;
+}
@@ -0,0 +1,66 @@
+#ifndef PQB_COUNTERS_H
+#define PQB_COUNTERS_H
+
+#include <stdint.h>
+
+// Hardware events counted around every timed op when counters are enabled
+typedef enum {
+    PQB_COUNTER_INSTRUCTIONS,
+    PQB_COUNTER_CYCLES,
+    PQB_COUNTER_L1D_MISSES,    // L1 data cache read misses
+    PQB_COUNTER_LLC_MISSES,    // last level cache misses
+    PQB_COUNTER_BRANCH_MISSES, // mispredicted branches
+    PQB_COUNTER_DTLB_MISSES,   // data TLB read misses
+    PQB_NUM_COUNTERS
+} pqb_counter;
+
+// One perf_event group on the calling thread, counting user space only, so
+// every event covers exactly the same instructions
+typedef struct {
+    int leader_fd;                       // -1 when counters are off
+    int fds[PQB_NUM_COUNTERS];           // -1 for events the PMU does not have
+    int slot[PQB_NUM_COUNTERS];          // position of each event in a group read, -1 if not counted
+    int num_open;
+    uint64_t overhead[PQB_NUM_COUNTERS]; // minimum counts of an empty read pair, subtracted from every delta
+} pqb_counters;
+
+// A group read
+typedef struct {
+    uint64_t time_enabled;
+    uint64_t time_running;
+    uint64_t values[PQB_NUM_COUNTERS]; // 0 for events not counted
+} pqb_counter_values;
+
+// Leaves the group closed, so pqb_counters_enabled is false
+void pqb_counters_init(pqb_counters *pc);
+
+// Open and calibrate the group. Events the PMU lacks, or that do not fit on
+// it alongside the others, are left out with a warning; returns 0 and
+// leaves counters off if nothing can be counted, e.g. in most VMs or with
+// kernel.perf_event_paranoid above 2.
+int pqb_counters_open(pqb_counters *pc);
+void pqb_counters_close(pqb_counters *pc);
+
+static inline int pqb_counters_enabled(const pqb_counters *pc) {
+    return pc->leader_fd >= 0;
+}
+
+static inline int pqb_counter_counted(const pqb_counters *pc, pqb_counter c) {
+    return pc->slot[c] >= 0;
+}
+
+// Returns 0 if the read failed
+int pqb_counters_read(const pqb_counters *pc, pqb_counter_values *out);
+
+// Counts between two reads with the calibrated overhead removed; returns 0,
+// and the sample should be dropped, if the group was not on the PMU the
+// whole time in between
+int pqb_counters_delta(const pqb_counters *pc, const pqb_counter_values *before, const pqb_counter_values *after,
+                       uint64_t delta[PQB_NUM_COUNTERS]);
+
+// Short name used in machine readable output, e.g. "l1d_misses", and the
+// human readable one, e.g. "L1d misses"
+const char *pqb_counter_name(pqb_counter c);
+const char *pqb_counter_label(pqb_counter c);
+
+#endif
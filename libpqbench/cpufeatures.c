@@ -0,0 +1,345 @@
+#define _GNU_SOURCE
+#include "cpufeatures.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#if defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "oqs.h"
+
+static void append(char *buf, size_t size, const char *word) {
+    size_t len = strlen(buf);
+    if (len < size) {
+        snprintf(buf + len, size - len, "%s%s", len ? " " : "", word);
+    }
+}
+
+// The extensions vector code is chosen by, not every flag the CPU has
+static void detect(char *out, size_t size) {
+    out[0] = '\0';
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx")) {
+        append(out, size, "avx");
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        append(out, size, "avx2");
+    }
+    if (__builtin_cpu_supports("bmi2")) {
+        append(out, size, "bmi2");
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        append(out, size, "avx512f");
+    }
+    if (__builtin_cpu_supports("avx512bw")) {
+        append(out, size, "avx512bw");
+    }
+    if (__builtin_cpu_supports("avx512vl")) {
+        append(out, size, "avx512vl");
+    }
+    if (__builtin_cpu_supports("aes")) {
+        append(out, size, "aes");
+    }
+    if (__builtin_cpu_supports("pclmul")) {
+        append(out, size, "pclmul");
+    }
+    if (__builtin_cpu_supports("vaes")) {
+        append(out, size, "vaes");
+    }
+    if (__builtin_cpu_supports("vpclmulqdq")) {
+        append(out, size, "vpclmulqdq");
+    }
+#elif defined(__aarch64__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    if (hwcap & HWCAP_ASIMD) {
+        append(out, size, "neon");
+    }
+    if (hwcap & HWCAP_AES) {
+        append(out, size, "aes");
+    }
+    if (hwcap & HWCAP_PMULL) {
+        append(out, size, "pmull");
+    }
+    if (hwcap & HWCAP_SHA2) {
+        append(out, size, "sha2");
+    }
+#ifdef HWCAP_SHA3
+    if (hwcap & HWCAP_SHA3) {
+        append(out, size, "sha3");
+    }
+#endif
+#ifdef HWCAP_SVE
+    if (hwcap & HWCAP_SVE) {
+        append(out, size, "sve");
+    }
+#endif
+#endif
+    if (!out[0]) {
+        snprintf(out, size, "none");
+    }
+}
+
+void pqb_cpu_features_get(pqb_cpu_features *f) {
+    detect(f->detected, sizeof(f->detected));
+
+    static const char *const masks[] = {"OPENSSL_ia32cap", "OPENSSL_armcap"};
+    f->masks[0] = '\0';
+    for (size_t m = 0; m < sizeof(masks) / sizeof(masks[0]); m++) {
+        const char *value = getenv(masks[m]);
+        if (value) {
+            size_t len = strlen(f->masks);
+            snprintf(f->masks + len, sizeof(f->masks) - len, "%s%s=%s", len ? " " : "", masks[m], value);
+        }
+    }
+    if (!f->masks[0]) {
+        snprintf(f->masks, sizeof(f->masks), "none");
+    }
+
+    f->liboqs[0] = '\0';
+#if PQB_HAVE_LIBOQS
+    static const struct {
+        OQS_CPU_EXT ext;
+        const char *name;
+    } exts[] = {
+        {OQS_CPU_EXT_AVX, "avx"}, {OQS_CPU_EXT_AVX2, "avx2"}, {OQS_CPU_EXT_BMI2, "bmi2"},
+        {OQS_CPU_EXT_AVX512, "avx512"}, {OQS_CPU_EXT_AES, "aes"}, {OQS_CPU_EXT_PCLMULQDQ, "pclmul"},
+        {OQS_CPU_EXT_VPCLMULQDQ, "vpclmulqdq"}, {OQS_CPU_EXT_ARM_NEON, "neon"}, {OQS_CPU_EXT_ARM_AES, "aes"},
+        {OQS_CPU_EXT_ARM_SHA2, "sha2"}, {OQS_CPU_EXT_ARM_SHA3, "sha3"},
+    };
+    for (size_t e = 0; e < sizeof(exts) / sizeof(exts[0]); e++) {
+        if (OQS_CPU_has_extension(exts[e].ext)) {
+            append(f->liboqs, sizeof(f->liboqs), exts[e].name);
+        }
+    }
+    if (!f->liboqs[0]) {
+        snprintf(f->liboqs, sizeof(f->liboqs), "none");
+    }
+#endif
+}
+
+void pqb_report_cpu_features(FILE *out) {
+    pqb_cpu_features f;
+    pqb_cpu_features_get(&f);
+    fprintf(out, "CPU features: %s, masks %s", f.detected, f.masks);
+    if (f.liboqs[0]) {
+        fprintf(out, ", liboqs %s", f.liboqs);
+    }
+    fprintf(out, "\n");
+}
+
+// Levels
+
+static void add_level(pqb_cpu_level levels[], int *n, int max, const char *name, const char *env) {
+    if (*n == max) {
+        return;
+    }
+    pqb_cpu_level *level = &levels[(*n)++];
+    memset(level, 0, sizeof(*level));
+    snprintf(level->name, sizeof(level->name), "%s", name);
+    if (env) {
+        snprintf(level->env[level->num_env++], sizeof(level->env[0]), "%s", env);
+    }
+}
+
+int pqb_cpu_levels_default(pqb_cpu_level levels[], int max) {
+    int n = 0;
+    add_level(levels, &n, max, "native", NULL);
+#if defined(__x86_64__) || defined(__i386__)
+    // OPENSSL_ia32cap clears bits of CPUID leaf 1 (ECX in the high half of
+    // the first word) and leaf 7 (EBX in the low half of the second):
+    // AVX-512 F, DQ, IFMA, PF, ER, CD, BW and VL first, then AVX2, BMI1,
+    // BMI2 and ADX too, then AVX as well
+    add_level(levels, &n, max, "no-avx512", "OPENSSL_ia32cap=:~0xdc230000");
+    add_level(levels, &n, max, "no-avx2", "OPENSSL_ia32cap=:~0xdc2b0128");
+    add_level(levels, &n, max, "no-avx", "OPENSSL_ia32cap=~0x1000000000000000:~0xdc2b0128");
+#elif defined(__aarch64__)
+    // No NEON, so no AES, PMULL or SHA instructions either
+    add_level(levels, &n, max, "no-neon", "OPENSSL_armcap=0");
+#endif
+    return n;
+}
+
+void pqb_cpu_level_parse(const char *spec, pqb_cpu_level *level) {
+    memset(level, 0, sizeof(*level));
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    char *colon = strchr(buf, ':');
+    if (!colon || colon == buf || (size_t)(colon - buf) >= sizeof(level->name)) {
+        fprintf(stderr, "Invalid CPU level %s, expected NAME:VAR=VALUE[,VAR=VALUE...]\n", spec);
+        exit(EXIT_FAILURE);
+    }
+    *colon = '\0';
+    memcpy(level->name, buf, colon - buf);
+    char *save = NULL;
+    for (char *var = strtok_r(colon + 1, ",", &save); var; var = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(var, '=');
+        if (!eq || eq == var || strlen(var) >= sizeof(level->env[0])) {
+            fprintf(stderr, "Invalid variable %s of CPU level %s, expected VAR=VALUE\n", var, level->name);
+            exit(EXIT_FAILURE);
+        }
+        if (level->num_env == PQB_CPU_LEVEL_MAX_ENV) {
+            fprintf(stderr, "Too many variables in CPU level %s\n", level->name);
+            exit(EXIT_FAILURE);
+        }
+        snprintf(level->env[level->num_env++], sizeof(level->env[0]), "%s", var);
+    }
+    if (level->num_env == 0) {
+        fprintf(stderr, "CPU level %s sets no variables\n", level->name);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Running
+
+typedef struct {
+    pqb_cpu_matrix_row *rows;
+    int count;
+    int capacity;
+} matrix_rows;
+
+// The row for the next result of alg and op at level: the first one with
+// the same names that level has not filled yet, so repeated ops such as
+// those of the cold and hot variants pair up in order
+static pqb_cpu_matrix_row *find_row(matrix_rows *m, const char *alg, const char *op, const char *unit, int level) {
+    for (int r = 0; r < m->count; r++) {
+        pqb_cpu_matrix_row *row = &m->rows[r];
+        if (isnan(row->median[level]) && strcmp(row->algorithm, alg) == 0 && strcmp(row->op, op) == 0 &&
+            strcmp(row->unit, unit) == 0) {
+            return row;
+        }
+    }
+    if (m->count == m->capacity) {
+        m->capacity = m->capacity ? m->capacity * 2 : 64;
+        m->rows = realloc(m->rows, m->capacity * sizeof(pqb_cpu_matrix_row));
+        if (!m->rows) {
+            fprintf(stderr, "Failed to allocate memory for the CPU matrix\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    pqb_cpu_matrix_row *row = &m->rows[m->count++];
+    memset(row, 0, sizeof(*row));
+    snprintf(row->algorithm, sizeof(row->algorithm), "%s", alg);
+    snprintf(row->op, sizeof(row->op), "%s", op);
+    snprintf(row->unit, sizeof(row->unit), "%s", unit);
+    for (int l = 0; l < PQB_MAX_CPU_LEVELS; l++) {
+        row->median[l] = NAN;
+    }
+    return row;
+}
+
+// The latency rows of one level's CSV file: type, algorithm, op, threads,
+// payload, unit, samples, samples_in_mean, mean, std_dev, median, ...
+static void read_level(const char *path, matrix_rows *m, int level) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return;
+    }
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        char *fields[11];
+        int n = 0;
+        for (char *p = line; n < 11; n++) {
+            fields[n] = p;
+            char *comma = strchr(p, ',');
+            if (!comma) {
+                n++;
+                break;
+            }
+            *comma = '\0';
+            p = comma + 1;
+        }
+        if (n < 11 || strcmp(fields[0], "latency") != 0) {
+            continue;
+        }
+        pqb_cpu_matrix_row *row = find_row(m, fields[1], fields[2], fields[5], level);
+        row->median[level] = strtod(fields[10], NULL);
+    }
+    fclose(f);
+}
+
+// Run argv with the level's environment; returns its exit status, or -1
+static int run_level(char *const argv[], const pqb_cpu_level *level, const char *csv) {
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "Failed to fork for CPU level %s: %s\n", level->name, strerror(errno));
+        return -1;
+    }
+    if (pid == 0) {
+        for (int e = 0; e < level->num_env; e++) {
+            char var[256];
+            snprintf(var, sizeof(var), "%s", level->env[e]);
+            char *eq = strchr(var, '=');
+            *eq = '\0';
+            setenv(var, eq + 1, 1);
+        }
+        setenv(PQB_CPU_MATRIX_ENV, csv, 1);
+        setenv(PQB_CPU_LEVEL_ENV, level->name, 1);
+        execv("/proc/self/exe", argv);
+        fprintf(stderr, "Failed to run %s for CPU level %s: %s\n", argv[0], level->name, strerror(errno));
+        _exit(127);
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            fprintf(stderr, "Failed to wait for CPU level %s: %s\n", level->name, strerror(errno));
+            return -1;
+        }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+int pqb_bench_run_cpu_matrix(pqb_bench *bench, char *const argv[], const pqb_cpu_level levels[], int num_levels) {
+    matrix_rows m = {0};
+    int completed[PQB_MAX_CPU_LEVELS];
+    int failed = 0;
+    for (int l = 0; l < num_levels; l++) {
+        const pqb_cpu_level *level = &levels[l];
+        printf("CPU level: %s", level->name);
+        for (int e = 0; e < level->num_env; e++) {
+            printf("%s%s", e ? ", " : " (", level->env[e]);
+        }
+        printf("%s\n", level->num_env ? ")" : "");
+
+        char csv[] = "/tmp/pqbench-cpu-matrix-XXXXXX";
+        int fd = mkstemp(csv);
+        if (fd < 0) {
+            fprintf(stderr, "Failed to create a file for CPU level %s: %s\n", level->name, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        close(fd);
+        // A regression found in a level still fills its column
+        int status = run_level(argv, level, csv);
+        completed[l] = status == 0 || status == PQB_EXIT_REGRESSION;
+        if (completed[l]) {
+            read_level(csv, &m, l);
+        } else {
+            fprintf(stderr, "CPU level %s failed, leaving it out of the matrix\n", level->name);
+            failed++;
+        }
+        unlink(csv);
+    }
+
+    pqb_cpu_matrix_result result;
+    result.num_levels = num_levels;
+    result.levels = levels;
+    result.completed = completed;
+    result.num_rows = m.count;
+    result.rows = m.rows;
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->cpu_matrix) {
+            bench->sinks[s]->cpu_matrix(bench->sinks[s], &result);
+        }
+    }
+    free(m.rows);
+    return failed;
+}
@@ -0,0 +1,36 @@
+#ifndef PQB_CPUFEATURES_H
+#define PQB_CPUFEATURES_H
+
+#include <stdio.h>
+
+#include "bench.h"
+
+// The vector extensions of this CPU that the crypto libraries choose their
+// code paths by, and the masks that hide some of them from OpenSSL
+typedef struct {
+    char detected[256]; // what the CPU reports, e.g. "avx2 bmi2 avx512f aes", or "none"
+    char masks[512];    // OPENSSL_ia32cap and OPENSSL_armcap as set, or "none"
+    char liboqs[256];   // the extensions liboqs dispatches on, "" when built without it
+} pqb_cpu_features;
+
+void pqb_cpu_features_get(pqb_cpu_features *f);
+
+// One line with the features, after pqb_report_host's
+void pqb_report_cpu_features(FILE *out);
+
+// The built-in levels of this architecture: every feature first, as the
+// reference, then fewer and fewer. Returns how many were stored, at most max.
+int pqb_cpu_levels_default(pqb_cpu_level levels[], int max);
+
+// Parse NAME:VAR=VALUE[,VAR=VALUE...] into level, exiting on bad input
+void pqb_cpu_level_parse(const char *spec, pqb_cpu_level *level);
+
+// Run this driver again, with the same argv, once per level, each in a
+// process of its own with the level's environment and PQB_CPU_MATRIX_ENV
+// naming a CSV file for its results. The medians of their latency results
+// are reported to the sinks as one matrix, levels[0] being the reference.
+// Each run writes its own text output to stdout as it goes. Returns the
+// number of levels whose run failed.
+int pqb_bench_run_cpu_matrix(pqb_bench *bench, char *const argv[], const pqb_cpu_level levels[], int num_levels);
+
+#endif
@@ -0,0 +1,191 @@
+#define _GNU_SOURCE
+#include "cycles.h"
+
+#include <setjmp.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+#define CALIBRATION_PAIRS 2000
+#define CALIBRATION_WINDOW_NS 20000000ULL // 20 ms
+
+static const char *source_names[] = {"perf", "tsc", "cntvct", "pmccntr", "monotonic"};
+
+static int open_perf_cycles(void) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    // Count this thread on whatever CPU it runs on
+    int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    return fd;
+}
+
+#if defined(__aarch64__)
+static sigjmp_buf probe_env;
+
+static void probe_sigill(int sig) {
+    (void)sig;
+    siglongjmp(probe_env, 1);
+}
+
+// PMCCNTR_EL0 traps unless the kernel enabled user access, so probe it once
+// under a SIGILL handler instead of crashing in the middle of a run
+static int pmccntr_accessible(void) {
+    struct sigaction sa, old;
+    volatile int ok = 0;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = probe_sigill;
+    sigaction(SIGILL, &sa, &old);
+    if (sigsetjmp(probe_env, 1) == 0) {
+        uint64_t t;
+        __asm__ __volatile__("mrs %0, pmccntr_el0" : "=r"(t));
+        ok = t != 0;
+    }
+    sigaction(SIGILL, &old, NULL);
+    return ok;
+}
+#endif
+
+static int try_source(pqb_cycle_counter *cc, pqb_cycle_source source) {
+    cc->source = source;
+    cc->perf_fd = -1;
+    switch (source) {
+    case PQB_CYCLES_PERF:
+        cc->perf_fd = open_perf_cycles();
+        return cc->perf_fd >= 0;
+#if defined(__x86_64__) || defined(__i386__)
+    case PQB_CYCLES_TSC:
+        return 1;
+#endif
+#if defined(__aarch64__)
+    case PQB_CYCLES_CNTVCT:
+        return 1;
+    case PQB_CYCLES_PMCCNTR:
+        return pmccntr_accessible();
+#endif
+    case PQB_CYCLES_MONOTONIC:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static pqb_cycle_source fallback_source(pqb_cycle_source source) {
+    switch (source) {
+    case PQB_CYCLES_PERF:
+#if defined(__x86_64__) || defined(__i386__)
+        return PQB_CYCLES_TSC;
+#elif defined(__aarch64__)
+        return PQB_CYCLES_CNTVCT;
+#else
+        return PQB_CYCLES_MONOTONIC;
+#endif
+    case PQB_CYCLES_PMCCNTR:
+        return PQB_CYCLES_CNTVCT;
+    default:
+        return PQB_CYCLES_MONOTONIC;
+    }
+}
+
+static void calibrate(pqb_cycle_counter *cc) {
+    // Timer overhead: the cheapest empty start/stop pair this source can produce
+    cc->overhead = 0;
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < CALIBRATION_PAIRS; i++) {
+        uint64_t start = pqb_cycles_start(cc);
+        uint64_t stop = pqb_cycles_stop(cc);
+        if (stop - start < best) {
+            best = stop - start;
+        }
+    }
+    cc->overhead = best;
+
+    // Counting rate against the monotonic clock, reported so that fixed-rate
+    // counters can be related to the core frequency
+    uint64_t ns_start = pqb_cycles_read_monotonic();
+    uint64_t ticks_start = pqb_cycles_start(cc);
+    uint64_t ns_now;
+    do {
+        ns_now = pqb_cycles_read_monotonic();
+    } while (ns_now - ns_start < CALIBRATION_WINDOW_NS);
+    uint64_t ticks_stop = pqb_cycles_stop(cc);
+    cc->ticks_per_ns = (double)(ticks_stop - ticks_start) / (double)(ns_now - ns_start);
+}
+
+void pqb_cycles_init(pqb_cycle_counter *cc) {
+    pqb_cycle_source source = PQB_CYCLES_PERF;
+    const char *requested = getenv("PQB_CYCLES");
+
+    if (requested && *requested) {
+        int found = 0;
+        for (int i = 0; i < (int)(sizeof(source_names) / sizeof(source_names[0])); i++) {
+            if (strcmp(requested, source_names[i]) == 0) {
+                source = (pqb_cycle_source)i;
+                found = 1;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "Unknown cycle source %s, using %s\n", requested, source_names[source]);
+        }
+    }
+
+    while (!try_source(cc, source)) {
+        pqb_cycle_source next = fallback_source(source);
+        fprintf(stderr, "Cycle source %s unavailable, falling back to %s\n", source_names[source], source_names[next]);
+        source = next;
+    }
+
+    calibrate(cc);
+
+    // Virtualised hosts often accept the perf event but never count it
+    if (cc->source == PQB_CYCLES_PERF && cc->ticks_per_ns == 0.0) {
+        fprintf(stderr, "Cycle source perf is not counting, falling back to %s\n", source_names[fallback_source(PQB_CYCLES_PERF)]);
+        pqb_cycles_close(cc);
+        try_source(cc, fallback_source(PQB_CYCLES_PERF));
+        calibrate(cc);
+    }
+}
+
+void pqb_cycles_close(pqb_cycle_counter *cc) {
+    if (cc->perf_fd >= 0) {
+        close(cc->perf_fd);
+        cc->perf_fd = -1;
+    }
+}
+
+const char *pqb_cycles_source_name(const pqb_cycle_counter *cc) {
+    return source_names[cc->source];
+}
+
+const char *pqb_cycles_unit(const pqb_cycle_counter *cc) {
+    switch (cc->source) {
+    case PQB_CYCLES_PERF:
+    case PQB_CYCLES_PMCCNTR:
+        return "cycles";
+    case PQB_CYCLES_TSC:
+    case PQB_CYCLES_CNTVCT:
+        return "ticks";
+    default:
+        return "ns";
+    }
+}
+
+void pqb_cycles_describe(const pqb_cycle_counter *cc, FILE *out) {
+    fprintf(out, "Cycle source: %s, %.3f %s/ns, timer overhead %llu %s subtracted\n",
+            pqb_cycles_source_name(cc), cc->ticks_per_ns, pqb_cycles_unit(cc),
+            (unsigned long long)cc->overhead, pqb_cycles_unit(cc));
+}
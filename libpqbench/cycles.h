@@ -0,0 +1,119 @@
+#ifndef PQB_CYCLES_H
+#define PQB_CYCLES_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Cycle sources, in the order they are tried when none is requested explicitly
+typedef enum {
+    PQB_CYCLES_PERF,      // perf_event_open PERF_COUNT_HW_CPU_CYCLES, user space only
+    PQB_CYCLES_TSC,       // lfence-serialized RDTSC / RDTSCP (x86)
+    PQB_CYCLES_CNTVCT,    // CNTVCT_EL0 virtual counter (AArch64)
+    PQB_CYCLES_PMCCNTR,   // PMCCNTR_EL0 core cycle counter, needs PMUSERENR_EL0.EN (AArch64)
+    PQB_CYCLES_MONOTONIC  // CLOCK_MONOTONIC nanoseconds, last resort
+} pqb_cycle_source;
+
+typedef struct {
+    pqb_cycle_source source;
+    int perf_fd;
+    uint64_t overhead;    // minimum cost of an empty start/stop pair, subtracted from every sample
+    double ticks_per_ns;  // counting rate measured against CLOCK_MONOTONIC at startup
+} pqb_cycle_counter;
+
+// Open and calibrate a cycle source. The PQB_CYCLES environment variable
+// (perf, tsc, cntvct, pmccntr, monotonic) overrides the default; a source that
+// is unavailable on this host falls back to the next one with a warning.
+void pqb_cycles_init(pqb_cycle_counter *cc);
+void pqb_cycles_close(pqb_cycle_counter *cc);
+
+const char *pqb_cycles_source_name(const pqb_cycle_counter *cc);
+
+// Unit the samples are expressed in: "cycles" for core cycle counters, "ticks"
+// for fixed-rate counters (TSC, CNTVCT) and "ns" for the monotonic fallback
+const char *pqb_cycles_unit(const pqb_cycle_counter *cc);
+
+// One-line summary of the selected source and its calibration
+void pqb_cycles_describe(const pqb_cycle_counter *cc, FILE *out);
+
+static inline uint64_t pqb_cycles_read_monotonic(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t pqb_cycles_read_perf(const pqb_cycle_counter *cc) {
+    uint64_t value = 0;
+    if (read(cc->perf_fd, &value, sizeof(value)) != sizeof(value)) {
+        return 0;
+    }
+    return value;
+}
+
+// Read the counter at the start of a timed region: nothing issued before this
+// point may still be in flight, and nothing after it may start early
+static inline uint64_t pqb_cycles_start(const pqb_cycle_counter *cc) {
+    switch (cc->source) {
+#if defined(__x86_64__) || defined(__i386__)
+    case PQB_CYCLES_TSC: {
+        _mm_lfence();
+        uint64_t t = __rdtsc();
+        _mm_lfence();
+        return t;
+    }
+#endif
+#if defined(__aarch64__)
+    case PQB_CYCLES_CNTVCT: {
+        uint64_t t;
+        __asm__ __volatile__("isb\n\tmrs %0, cntvct_el0" : "=r"(t) : : "memory");
+        return t;
+    }
+    case PQB_CYCLES_PMCCNTR: {
+        uint64_t t;
+        __asm__ __volatile__("isb\n\tmrs %0, pmccntr_el0" : "=r"(t) : : "memory");
+        return t;
+    }
+#endif
+    case PQB_CYCLES_PERF:
+        return pqb_cycles_read_perf(cc);
+    default:
+        return pqb_cycles_read_monotonic();
+    }
+}
+
+// Read the counter at the end of a timed region: RDTSCP waits for the measured
+// code to retire, the trailing lfence keeps later code out of the window
+static inline uint64_t pqb_cycles_stop(const pqb_cycle_counter *cc) {
+    switch (cc->source) {
+#if defined(__x86_64__) || defined(__i386__)
+    case PQB_CYCLES_TSC: {
+        unsigned int aux;
+        uint64_t t = __rdtscp(&aux);
+        _mm_lfence();
+        return t;
+    }
+#endif
+#if defined(__aarch64__)
+    case PQB_CYCLES_CNTVCT:
+    case PQB_CYCLES_PMCCNTR:
+        return pqb_cycles_start(cc);
+#endif
+    case PQB_CYCLES_PERF:
+        return pqb_cycles_read_perf(cc);
+    default:
+        return pqb_cycles_read_monotonic();
+    }
+}
+
+// Elapsed count between two reads with the calibrated timer overhead removed
+static inline uint64_t pqb_cycles_elapsed(const pqb_cycle_counter *cc, uint64_t start, uint64_t stop) {
+    uint64_t delta = stop - start;
+    return delta > cc->overhead ? delta - cc->overhead : 0;
+}
+
+#endif
@@ -0,0 +1,688 @@
+#include "dds.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/x509.h>
+
+#include "families.h"
+#include "keys.h"
+#include "x509.h"
+
+#define MAX_SECRET_LEN 256
+#define CHALLENGE_LEN 32 // 256 bit nonces, as the PKI-DH plugin uses
+#define HASH_LEN 32      // SHA-256
+
+// What a participant brings to every handshake: its identity key, the
+// identity certificate the CA issued for it and its permissions document
+// signed by the permissions CA. One CA plays both roles.
+typedef struct {
+    EVP_PKEY *key;
+    unsigned char *cert; // DER
+    size_t cert_len;
+    unsigned char *permissions_sig;
+    size_t permissions_sig_len;
+} participant;
+
+// One DDS-Security authentication between an initiator and a replier, after
+// the PKI-DH plugin of the DDS-Security specification:
+//   HandshakeRequest:  c.id, c.perm, c.dsign_algo, c.kagree_algo, hash_c1, dh1, challenge1
+//   HandshakeReply:    the same of the replier with hash_c2, dh2, challenge2, the
+//                      initiator's hash_c1, dh1 and challenge1, and a signature over them
+//   HandshakeFinal:    both hashes, key shares and challenges, and a signature
+// Each side validates the other's certificate and permissions before it
+// answers. dh2 is the replier's public key for ECDH and the ciphertext for a
+// KEM, which the initiator decapsulates. Key shares are used as the EVP keys
+// they were generated as, as in the key exchange families; certificates are
+// parsed from DER.
+typedef struct {
+    OSSL_LIB_CTX *libctx;
+    const char *alg;
+    char signature[128];
+    char kagree[128];
+    int kem;
+    EVP_MD *md;
+    EVP_MD_CTX *md_ctx;
+    EVP_PKEY *ca;
+    const unsigned char *permissions; // the bench payload
+    size_t permissions_len;
+    participant parts[2];            // initiator, replier
+    // One handshake
+    EVP_PKEY *remote[2];             // key each side took from the other's certificate
+    EVP_PKEY *dh1;
+    EVP_PKEY *dh2;                   // ECDH only
+    unsigned char *dh1_data;         // key shares as sent
+    size_t dh1_len;
+    unsigned char *dh2_data;
+    size_t dh2_len;
+    unsigned char challenge1[CHALLENGE_LEN];
+    unsigned char challenge2[CHALLENGE_LEN];
+    unsigned char hash_c1[HASH_LEN];
+    unsigned char hash_c2[HASH_LEN];
+    unsigned char *reply_sig;
+    unsigned int reply_sig_len;
+    unsigned char *final_sig;
+    unsigned int final_sig_len;
+    unsigned char secret[2][MAX_SECRET_LEN];
+    size_t secret_len;
+    unsigned char shared[2][HASH_LEN]; // SharedSecret of each side
+    size_t request_bytes;
+    size_t reply_bytes;
+    size_t final_bytes;
+} dds_state;
+
+static void sign(dds_state *st, EVP_PKEY *key, const unsigned char *const data[], const size_t lens[], int n,
+                 unsigned char **sig, unsigned int *sig_len) {
+    *sig = OPENSSL_malloc(EVP_PKEY_get_size(key));
+    if (!*sig || !EVP_SignInit_ex(st->md_ctx, st->md, NULL)) {
+        fprintf(stderr, "Failed to start signing with %s\n", st->signature);
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < n; i++) {
+        if (!EVP_SignUpdate(st->md_ctx, data[i], lens[i])) {
+            fprintf(stderr, "Failed to sign with %s\n", st->signature);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (!EVP_SignFinal_ex(st->md_ctx, *sig, sig_len, key, st->libctx, NULL)) {
+        fprintf(stderr, "Failed to sign with %s\n", st->signature);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void verify(dds_state *st, EVP_PKEY *key, const unsigned char *const data[], const size_t lens[], int n,
+                   const unsigned char *sig, unsigned int sig_len, const char *what) {
+    int ok = EVP_VerifyInit_ex(st->md_ctx, st->md, NULL);
+    for (int i = 0; ok && i < n; i++) {
+        ok = EVP_VerifyUpdate(st->md_ctx, data[i], lens[i]);
+    }
+    if (!ok || EVP_VerifyFinal_ex(st->md_ctx, sig, sig_len, key, st->libctx, NULL) != 1) {
+        fprintf(stderr, "Failed to verify the %s of %s\n", what, st->alg);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void hash(dds_state *st, const unsigned char *const data[], const size_t lens[], int n, unsigned char *out) {
+    int ok = EVP_DigestInit_ex2(st->md_ctx, st->md, NULL);
+    for (int i = 0; ok && i < n; i++) {
+        ok = EVP_DigestUpdate(st->md_ctx, data[i], lens[i]);
+    }
+    if (!ok || !EVP_DigestFinal_ex(st->md_ctx, out, NULL)) {
+        fprintf(stderr, "Failed to hash handshake data for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// hash_c of one side: SHA-256 over the properties it sends in clear
+static void hash_properties(dds_state *st, const participant *p, unsigned char *out) {
+    const unsigned char *data[] = {p->cert, st->permissions, p->permissions_sig, (const unsigned char *)st->signature,
+                                   (const unsigned char *)st->kagree};
+    const size_t lens[] = {p->cert_len, st->permissions_len, p->permissions_sig_len, strlen(st->signature),
+                           strlen(st->kagree)};
+    hash(st, data, lens, 5, out);
+}
+
+static size_t properties_bytes(const dds_state *st, const participant *p) {
+    return p->cert_len + st->permissions_len + p->permissions_sig_len + strlen(st->signature) + strlen(st->kagree) +
+           HASH_LEN;
+}
+
+static void *dds_create(pqb_bench *bench, const char *alg, int kem) {
+    dds_state *st = calloc(1, sizeof(*st));
+    if (!st) {
+        fprintf(stderr, "Failed to allocate handshake state for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    const char *plus = strchr(alg, '+');
+    if (!plus || plus == alg || !plus[1] || (size_t)(plus - alg) >= sizeof(st->signature) ||
+        strlen(plus + 1) >= sizeof(st->kagree)) {
+        fprintf(stderr, "%s is not <signature>+<key agreement>\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(st->signature, alg, plus - alg);
+    strcpy(st->kagree, plus + 1);
+    st->libctx = bench->libctx;
+    st->alg = alg;
+    st->kem = kem;
+    st->permissions = bench->payload;
+    st->permissions_len = bench->payload_len;
+    st->md = EVP_MD_fetch(st->libctx, "SHA256", NULL);
+    st->md_ctx = EVP_MD_CTX_new();
+    if (!st->md || !st->md_ctx) {
+        fprintf(stderr, "Failed to set up hashing for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+
+    // Enrolment, done once per domain rather than per handshake
+    st->ca = pqb_generate_key(st->libctx, st->signature);
+    for (int p = 0; p < 2; p++) {
+        participant *part = &st->parts[p];
+        part->key = pqb_generate_key(st->libctx, st->signature);
+        X509 *cert = pqb_x509_issue(st->libctx, part->key, p == 0 ? "participant 1" : "participant 2", st->ca,
+                                    "pqbench identity CA", 0);
+        unsigned char *der = NULL;
+        int der_len = i2d_X509(cert, &der);
+        if (der_len <= 0) {
+            fprintf(stderr, "Failed to encode the identity certificate of %s\n", alg);
+            exit(EXIT_FAILURE);
+        }
+        part->cert = der;
+        part->cert_len = der_len;
+        X509_free(cert);
+
+        unsigned char *sig;
+        unsigned int sig_len;
+        const unsigned char *data[] = {st->permissions};
+        const size_t lens[] = {st->permissions_len};
+        sign(st, st->ca, data, lens, 1, &sig, &sig_len);
+        part->permissions_sig = sig;
+        part->permissions_sig_len = sig_len;
+    }
+    return st;
+}
+
+static void *dds_ecdh_create(pqb_bench *bench, const char *alg) {
+    return dds_create(bench, alg, 0);
+}
+
+static void *dds_kem_create(pqb_bench *bench, const char *alg) {
+    return dds_create(bench, alg, 1);
+}
+
+static void dds_release(dds_state *st) {
+    for (int p = 0; p < 2; p++) {
+        EVP_PKEY_free(st->remote[p]);
+        st->remote[p] = NULL;
+    }
+    EVP_PKEY_free(st->dh1);
+    EVP_PKEY_free(st->dh2);
+    OPENSSL_free(st->dh1_data);
+    OPENSSL_free(st->dh2_data);
+    OPENSSL_free(st->reply_sig);
+    OPENSSL_free(st->final_sig);
+    st->dh1 = NULL;
+    st->dh2 = NULL;
+    st->dh1_data = NULL;
+    st->dh2_data = NULL;
+    st->reply_sig = NULL;
+    st->final_sig = NULL;
+}
+
+static void dds_destroy(void *state) {
+    dds_state *st = state;
+    dds_release(st);
+    for (int p = 0; p < 2; p++) {
+        EVP_PKEY_free(st->parts[p].key);
+        OPENSSL_free(st->parts[p].cert);
+        OPENSSL_free(st->parts[p].permissions_sig);
+    }
+    EVP_PKEY_free(st->ca);
+    EVP_MD_CTX_free(st->md_ctx);
+    EVP_MD_free(st->md);
+    free(st);
+}
+
+static size_t dds_wire_bytes(void *state) {
+    dds_state *st = state;
+    return st->request_bytes + st->reply_bytes + st->final_bytes;
+}
+
+static size_t dds_responder_bytes(void *state) {
+    dds_state *st = state;
+    return st->reply_bytes;
+}
+
+// Validate the remote participant side `local` talks to: parse its identity
+// certificate, check the CA signed it and its permissions document, and
+// check its hash_c. Keeps the certificate's key for the signatures to come.
+static void validate_remote(dds_state *st, int local, const unsigned char *remote_hash) {
+    const participant *remote = &st->parts[1 - local];
+    const unsigned char *p = remote->cert;
+    // Parsed into the bench's library context, whose providers decode the key
+    X509 *cert = X509_new_ex(st->libctx, NULL);
+    if (!cert || !d2i_X509(&cert, &p, (long)remote->cert_len) || X509_verify(cert, st->ca) != 1) {
+        fprintf(stderr, "Failed to validate the identity certificate of %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    st->remote[local] = X509_get_pubkey(cert);
+    X509_free(cert);
+    if (!st->remote[local]) {
+        fprintf(stderr, "Failed to get the identity key of %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+
+    const unsigned char *data[] = {st->permissions};
+    const size_t lens[] = {st->permissions_len};
+    verify(st, st->ca, data, lens, 1, remote->permissions_sig, remote->permissions_sig_len, "permissions");
+
+    unsigned char expected[HASH_LEN];
+    hash_properties(st, remote, expected);
+    if (memcmp(expected, remote_hash, HASH_LEN) != 0) {
+        fprintf(stderr, "hash_c of %s does not match\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static size_t derive(dds_state *st, EVP_PKEY *own, EVP_PKEY *peer, unsigned char *secret) {
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_from_pkey(st->libctx, own, NULL);
+    if (!ctx || EVP_PKEY_derive_init(ctx) <= 0 || EVP_PKEY_derive_set_peer(ctx, peer) <= 0) {
+        fprintf(stderr, "Failed to initialize key derivation for %s\n", st->kagree);
+        exit(EXIT_FAILURE);
+    }
+    size_t len = MAX_SECRET_LEN;
+    if (EVP_PKEY_derive(ctx, secret, &len) <= 0) {
+        fprintf(stderr, "Failed to derive the shared secret for %s\n", st->kagree);
+        exit(EXIT_FAILURE);
+    }
+    EVP_PKEY_CTX_free(ctx);
+    return len;
+}
+
+// SharedSecret: SHA-256 over challenge1, the agreed secret and challenge2
+static void shared_secret(dds_state *st, int side) {
+    const unsigned char *data[] = {st->challenge1, st->secret[side], st->challenge2};
+    const size_t lens[] = {CHALLENGE_LEN, st->secret_len, CHALLENGE_LEN};
+    hash(st, data, lens, 3, st->shared[side]);
+}
+
+static void challenge(dds_state *st, unsigned char *out) {
+    if (RAND_bytes(out, CHALLENGE_LEN) != 1) {
+        fprintf(stderr, "Failed to generate a challenge for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// What the reply signs: hash_c2, challenge2, dh2, challenge1, dh1, hash_c1;
+// the final signs the same with the initiator's fields first
+static void signed_fields(const dds_state *st, int reply, const unsigned char *data[6], size_t lens[6]) {
+    const unsigned char *own[3] = {st->hash_c1, st->challenge1, st->dh1_data};
+    const unsigned char *other[3] = {st->hash_c2, st->challenge2, st->dh2_data};
+    const size_t own_lens[3] = {HASH_LEN, CHALLENGE_LEN, st->dh1_len};
+    const size_t other_lens[3] = {HASH_LEN, CHALLENGE_LEN, st->dh2_len};
+    for (int i = 0; i < 3; i++) {
+        data[i] = reply ? other[i] : own[i];
+        lens[i] = reply ? other_lens[i] : own_lens[i];
+        data[5 - i] = reply ? own[i] : other[i];
+        lens[5 - i] = reply ? own_lens[i] : other_lens[i];
+    }
+}
+
+static unsigned char *encode_share(const dds_state *st, EVP_PKEY *pkey, size_t *len) {
+    unsigned char *encoded = NULL;
+    *len = EVP_PKEY_get1_encoded_public_key(pkey, &encoded);
+    if (*len == 0) {
+        fprintf(stderr, "Failed to encode the key share of %s\n", st->kagree);
+        exit(EXIT_FAILURE);
+    }
+    return encoded;
+}
+
+// begin_handshake_request: a fresh key share, a challenge and hash_c1
+static void dds_request(void *state) {
+    dds_state *st = state;
+    st->dh1 = pqb_generate_key(st->libctx, st->kagree);
+    st->dh1_data = encode_share(st, st->dh1, &st->dh1_len);
+    challenge(st, st->challenge1);
+    hash_properties(st, &st->parts[0], st->hash_c1);
+}
+
+// begin_handshake_reply: validate the initiator, answer its key share and
+// sign the handshake so far
+static void dds_reply(void *state) {
+    dds_state *st = state;
+    validate_remote(st, 1, st->hash_c1);
+    if (st->kem) {
+        EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_from_pkey(st->libctx, st->dh1, NULL);
+        if (!ctx || EVP_PKEY_encapsulate_init(ctx, NULL) <= 0 ||
+            EVP_PKEY_encapsulate(ctx, NULL, &st->dh2_len, NULL, &st->secret_len) <= 0 ||
+            st->secret_len > MAX_SECRET_LEN) {
+            fprintf(stderr, "Failed to initialize encapsulation for %s\n", st->kagree);
+            exit(EXIT_FAILURE);
+        }
+        st->dh2_data = OPENSSL_malloc(st->dh2_len);
+        if (!st->dh2_data ||
+            EVP_PKEY_encapsulate(ctx, st->dh2_data, &st->dh2_len, st->secret[1], &st->secret_len) <= 0) {
+            fprintf(stderr, "Failed to encapsulate key for %s\n", st->kagree);
+            exit(EXIT_FAILURE);
+        }
+        EVP_PKEY_CTX_free(ctx);
+    } else {
+        st->dh2 = pqb_generate_key(st->libctx, st->kagree);
+        st->dh2_data = encode_share(st, st->dh2, &st->dh2_len);
+    }
+    challenge(st, st->challenge2);
+    hash_properties(st, &st->parts[1], st->hash_c2);
+
+    const unsigned char *data[6];
+    size_t lens[6];
+    signed_fields(st, 1, data, lens);
+    sign(st, st->parts[1].key, data, lens, 6, &st->reply_sig, &st->reply_sig_len);
+}
+
+// process_handshake on the reply: validate the replier and its signature,
+// agree on the secret and sign the final
+static void dds_final(void *state) {
+    dds_state *st = state;
+    validate_remote(st, 0, st->hash_c2);
+    const unsigned char *data[6];
+    size_t lens[6];
+    signed_fields(st, 1, data, lens);
+    verify(st, st->remote[0], data, lens, 6, st->reply_sig, st->reply_sig_len, "handshake reply");
+
+    if (st->kem) {
+        size_t secret_len = st->secret_len;
+        EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_from_pkey(st->libctx, st->dh1, NULL);
+        if (!ctx || EVP_PKEY_decapsulate_init(ctx, NULL) <= 0 ||
+            EVP_PKEY_decapsulate(ctx, st->secret[0], &secret_len, st->dh2_data, st->dh2_len) <= 0) {
+            fprintf(stderr, "Failed to decapsulate key for %s\n", st->kagree);
+            exit(EXIT_FAILURE);
+        }
+        EVP_PKEY_CTX_free(ctx);
+    } else {
+        st->secret_len = derive(st, st->dh1, st->dh2, st->secret[0]);
+    }
+    shared_secret(st, 0);
+
+    signed_fields(st, 0, data, lens);
+    sign(st, st->parts[0].key, data, lens, 6, &st->final_sig, &st->final_sig_len);
+}
+
+// process_handshake on the final: check the initiator's signature; the
+// replier of an ECDH handshake derives its secret only now
+static void dds_finish(void *state) {
+    dds_state *st = state;
+    const unsigned char *data[6];
+    size_t lens[6];
+    signed_fields(st, 0, data, lens);
+    verify(st, st->remote[1], data, lens, 6, st->final_sig, st->final_sig_len, "handshake final");
+    if (!st->kem) {
+        derive(st, st->dh2, st->dh1, st->secret[1]);
+    }
+    shared_secret(st, 1);
+}
+
+// Both SharedSecrets must agree; checked outside the timed region
+static void dds_finish_iteration(void *state) {
+    dds_state *st = state;
+    if (memcmp(st->shared[0], st->shared[1], HASH_LEN) != 0) {
+        fprintf(stderr, "Shared secrets of %s do not match\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    st->request_bytes = properties_bytes(st, &st->parts[0]) + st->dh1_len + CHALLENGE_LEN;
+    st->reply_bytes = properties_bytes(st, &st->parts[1]) + st->dh2_len + 2 * CHALLENGE_LEN + HASH_LEN +
+                      st->dh1_len + st->reply_sig_len;
+    st->final_bytes = 2 * (HASH_LEN + CHALLENGE_LEN) + st->dh1_len + st->dh2_len + st->final_sig_len;
+    dds_release(st);
+}
+
+static const pqb_op dds_ops[] = {
+    {"request_initiator", "Handshake request (initiator)", NULL, dds_request, NULL, 0},
+    {"reply_responder", "Handshake reply (responder)", NULL, dds_reply, NULL, 0},
+    {"final_initiator", "Handshake final (initiator)", NULL, dds_final, NULL, 0},
+    {"finish_responder", "Handshake finish (responder)", NULL, dds_finish, dds_finish_iteration, 0},
+};
+
+const pqb_family pqb_dds_ecdh_handshake_family = {
+    .name = "dds_ecdh_handshake",
+    .ops = dds_ops,
+    .num_ops = sizeof(dds_ops) / sizeof(dds_ops[0]),
+    .create = dds_ecdh_create,
+    .destroy = dds_destroy,
+    .handshake = 1,
+    .wire_bytes = dds_wire_bytes,
+    .responder_bytes = dds_responder_bytes,
+};
+
+const pqb_family pqb_dds_kem_handshake_family = {
+    .name = "dds_kem_handshake",
+    .ops = dds_ops,
+    .num_ops = sizeof(dds_ops) / sizeof(dds_ops[0]),
+    .create = dds_kem_create,
+    .destroy = dds_destroy,
+    .handshake = 1,
+    .wire_bytes = dds_wire_bytes,
+    .responder_bytes = dds_responder_bytes,
+};
+
+void pqb_measure_dds_cost(pqb_bench *bench, const pqb_family *family, const char *alg, pqb_dds_cost *out) {
+    if (family != &pqb_dds_ecdh_handshake_family && family != &pqb_dds_kem_handshake_family) {
+        fprintf(stderr, "The %s family is not a DDS handshake\n", family->name);
+        exit(EXIT_FAILURE);
+    }
+
+    // Sizes from one untimed handshake; they do not change from run to run
+    dds_state *st = family->create(bench, alg);
+    for (int o = 0; o < family->num_ops; o++) {
+        family->ops[o].run(st);
+        if (family->ops[o].finish) {
+            family->ops[o].finish(st);
+        }
+    }
+    out->algorithm = alg;
+    out->request_bytes = st->request_bytes;
+    out->reply_bytes = st->reply_bytes;
+    out->final_bytes = st->final_bytes;
+    family->destroy(st);
+
+    pqb_stats stats[sizeof(dds_ops) / sizeof(dds_ops[0])];
+    pqb_bench_measure(bench, family, alg, stats);
+    out->request_ns = pqb_timer_ns(&bench->timer, stats[0].median);
+    out->reply_ns = pqb_timer_ns(&bench->timer, stats[1].median);
+    out->final_ns = pqb_timer_ns(&bench->timer, stats[2].median);
+    out->finish_ns = pqb_timer_ns(&bench->timer, stats[3].median);
+}
+
+// Discrete event simulation of the storm. Steps 0 to 3 of a handshake are
+// the request, reply, final and finish; even steps run on the initiator.
+// A step becomes a task on its participant once the message that triggers
+// it has arrived, and waits its turn behind earlier arrivals.
+
+typedef struct {
+    double time;
+    uint64_t seq; // ties go in the order events were scheduled
+    int task;     // pair * 4 + step
+    int done;     // 1 when the step finishes, 0 when its message arrives
+} event;
+
+typedef struct {
+    event *events;
+    size_t count;
+    size_t capacity;
+    uint64_t seq;
+} event_queue;
+
+static int event_before(const event *a, const event *b) {
+    return a->time < b->time || (a->time == b->time && a->seq < b->seq);
+}
+
+static void push_event(event_queue *q, double time, int task, int done) {
+    if (q->count == q->capacity) {
+        q->capacity = q->capacity ? 2 * q->capacity : 1024;
+        q->events = realloc(q->events, q->capacity * sizeof(event));
+        if (!q->events) {
+            fprintf(stderr, "Failed to allocate memory for the mesh simulation\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    size_t i = q->count++;
+    event e = {time, q->seq++, task, done};
+    while (i > 0 && event_before(&e, &q->events[(i - 1) / 2])) {
+        q->events[i] = q->events[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    q->events[i] = e;
+}
+
+static event pop_event(event_queue *q) {
+    event top = q->events[0];
+    event last = q->events[--q->count];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= q->count) {
+            break;
+        }
+        if (child + 1 < q->count && event_before(&q->events[child + 1], &q->events[child])) {
+            child++;
+        }
+        if (!event_before(&q->events[child], &last)) {
+            break;
+        }
+        q->events[i] = q->events[child];
+        i = child;
+    }
+    if (q->count > 0) {
+        q->events[i] = last;
+    }
+    return top;
+}
+
+// A participant: what it is running, and the tasks waiting behind it in a
+// list threaded through next
+typedef struct {
+    int busy;
+    int head;
+    int tail;
+    double link_free; // when its link has sent everything handed to it
+    double cpu_ms;
+    double sent_bytes;
+} node;
+
+static void *sim_calloc(size_t count, size_t size) {
+    void *p = calloc(count, size);
+    if (!p) {
+        fprintf(stderr, "Failed to allocate memory for the mesh simulation\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+void pqb_simulate_mesh(const pqb_mesh_model *m, const pqb_dds_cost *cost, int participants, pqb_mesh_estimate *out) {
+    if (participants < 2 || participants > PQB_MESH_MAX_PARTICIPANTS) {
+        fprintf(stderr, "A mesh needs 2 to %d participants, not %d\n", PQB_MESH_MAX_PARTICIPANTS, participants);
+        exit(EXIT_FAILURE);
+    }
+    const double step_ms[4] = {cost->request_ns * 1e-6, cost->reply_ns * 1e-6, cost->final_ns * 1e-6,
+                               cost->finish_ns * 1e-6};
+    const size_t step_bytes[3] = {cost->request_bytes, cost->reply_bytes, cost->final_bytes};
+    double one_way_ms = m->rtt_ms / 2;
+
+    int num_pairs = participants * (participants - 1) / 2;
+    int *initiator = sim_calloc(num_pairs, sizeof(int));
+    int *replier = sim_calloc(num_pairs, sizeof(int));
+    int *next = sim_calloc((size_t)num_pairs * 4, sizeof(int));
+    node *nodes = sim_calloc(participants, sizeof(node));
+    for (int p = 0; p < participants; p++) {
+        nodes[p].head = nodes[p].tail = -1;
+    }
+    event_queue q = {NULL, 0, 0, 0};
+
+    // Everyone discovers everyone at time 0; each initiator has its
+    // requests queued in the order of its peers
+    int pair = 0;
+    for (int a = 0; a < participants; a++) {
+        for (int b = a + 1; b < participants; b++) {
+            initiator[pair] = a;
+            replier[pair] = b;
+            push_event(&q, 0.0, pair * 4, 0);
+            pair++;
+        }
+    }
+
+    double finished = 0.0;
+    while (q.count > 0) {
+        event e = pop_event(&q);
+        int p = e.task / 4, step = e.task % 4;
+        node *n = &nodes[step % 2 == 0 ? initiator[p] : replier[p]];
+        if (!e.done) {
+            if (n->busy) {
+                next[e.task] = -1;
+                if (n->tail >= 0) {
+                    next[n->tail] = e.task;
+                } else {
+                    n->head = e.task;
+                }
+                n->tail = e.task;
+            } else {
+                n->busy = 1;
+                n->cpu_ms += step_ms[step];
+                push_event(&q, e.time + step_ms[step], e.task, 1);
+            }
+            continue;
+        }
+
+        if (step < 3) {
+            // The message leaves once the link has sent what came before it
+            double transfer_ms = m->bandwidth_mbps > 0 ? step_bytes[step] * 8 / (m->bandwidth_mbps * 1e3) : 0.0;
+            double depart = e.time > n->link_free ? e.time : n->link_free;
+            n->link_free = depart + transfer_ms;
+            n->sent_bytes += step_bytes[step];
+            push_event(&q, n->link_free + one_way_ms, e.task + 1, 0);
+        } else if (e.time > finished) {
+            finished = e.time;
+        }
+        if (n->head >= 0) {
+            int task = n->head;
+            n->head = next[task];
+            if (n->head < 0) {
+                n->tail = -1;
+            }
+            n->cpu_ms += step_ms[task % 4];
+            push_event(&q, e.time + step_ms[task % 4], task, 1);
+        } else {
+            n->busy = 0;
+        }
+    }
+
+    out->algorithm = cost->algorithm;
+    out->participants = participants;
+    out->rtt_ms = m->rtt_ms;
+    out->bandwidth_mbps = m->bandwidth_mbps;
+    out->handshakes = num_pairs;
+    out->request_bytes = cost->request_bytes;
+    out->reply_bytes = cost->reply_bytes;
+    out->final_bytes = cost->final_bytes;
+    out->handshake_ms = step_ms[0] + step_ms[1] + step_ms[2] + step_ms[3] + 3 * one_way_ms;
+    if (m->bandwidth_mbps > 0) {
+        out->handshake_ms += (double)(step_bytes[0] + step_bytes[1] + step_bytes[2]) * 8 / (m->bandwidth_mbps * 1e3);
+    }
+    out->full_mesh_ms = finished;
+    out->cpu_ms_min = nodes[0].cpu_ms;
+    out->cpu_ms_max = nodes[0].cpu_ms;
+    double cpu_sum = 0.0, sent_sum = 0.0;
+    for (int i = 0; i < participants; i++) {
+        if (nodes[i].cpu_ms < out->cpu_ms_min) {
+            out->cpu_ms_min = nodes[i].cpu_ms;
+        }
+        if (nodes[i].cpu_ms > out->cpu_ms_max) {
+            out->cpu_ms_max = nodes[i].cpu_ms;
+        }
+        cpu_sum += nodes[i].cpu_ms;
+        sent_sum += nodes[i].sent_bytes;
+    }
+    out->cpu_ms_mean = cpu_sum / participants;
+    out->sent_bytes_mean = sent_sum / participants;
+
+    free(q.events);
+    free(nodes);
+    free(next);
+    free(replier);
+    free(initiator);
+}
+
+void pqb_report_mesh(pqb_bench *bench, const pqb_mesh_estimate *estimate) {
+    for (int s = 0; s < bench->num_sinks; s++) {
+        pqb_sink *sink = bench->sinks[s];
+        if (sink->begin) {
+            sink->begin(sink, estimate->algorithm);
+        }
+        if (sink->mesh) {
+            sink->mesh(sink, estimate);
+        }
+        if (sink->end) {
+            sink->end(sink, estimate->algorithm);
+        }
+    }
+}
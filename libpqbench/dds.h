@@ -0,0 +1,43 @@
+#ifndef PQB_DDS_H
+#define PQB_DDS_H
+
+#include <stddef.h>
+
+#include "bench.h"
+
+// Participants a discovery storm is simulated for at most
+#define PQB_MESH_MAX_PARTICIPANTS 2048
+
+// Network side of the discovery storm: every participant sits on a link of
+// its own, which sends one message at a time
+typedef struct {
+    double rtt_ms;
+    double bandwidth_mbps; // 0 for unlimited
+} pqb_mesh_model;
+
+// One DDS-Security handshake, as measured with a DDS handshake family
+typedef struct {
+    const char *algorithm;
+    size_t request_bytes;
+    size_t reply_bytes;
+    size_t final_bytes;
+    double request_ns; // median time of each step
+    double reply_ns;
+    double final_ns;
+    double finish_ns;
+} pqb_dds_cost;
+
+// Measure pqb_dds_ecdh_handshake_family or pqb_dds_kem_handshake_family for
+// alg, "<signature>+<key agreement>"
+void pqb_measure_dds_cost(pqb_bench *bench, const pqb_family *family, const char *alg, pqb_dds_cost *out);
+
+// Simulate participants joining a domain at the same moment. Every pair
+// runs one handshake, initiated by the lower numbered participant as DDS
+// picks one side by GUID. Each participant handles one step at a time, in
+// the order the messages reach it.
+void pqb_simulate_mesh(const pqb_mesh_model *m, const pqb_dds_cost *cost, int participants, pqb_mesh_estimate *out);
+
+// Hand an estimate to every sink, between begin and end with its algorithm
+void pqb_report_mesh(pqb_bench *bench, const pqb_mesh_estimate *estimate);
+
+#endif
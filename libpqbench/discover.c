@@ -0,0 +1,149 @@
+#define _GNU_SOURCE
+#include "discover.h"
+
+#include <fnmatch.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+
+#include "oqs.h"
+
+void pqb_alg_list_add(pqb_alg_list *list, const char *name) {
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->names[i], name) == 0) {
+            return;
+        }
+    }
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 32;
+        list->names = realloc(list->names, list->capacity * sizeof(char *));
+        if (!list->names) {
+            fprintf(stderr, "Failed to allocate memory for %d algorithm names\n", list->capacity);
+            exit(EXIT_FAILURE);
+        }
+    }
+    char *copy = strdup(name);
+    if (!copy) {
+        fprintf(stderr, "Failed to allocate memory for algorithm %s\n", name);
+        exit(EXIT_FAILURE);
+    }
+    list->names[list->count++] = copy;
+}
+
+void pqb_alg_list_free(pqb_alg_list *list) {
+    for (int i = 0; i < list->count; i++) {
+        free((char *)list->names[i]);
+    }
+    free(list->names);
+    memset(list, 0, sizeof(*list));
+}
+
+typedef struct {
+    const char *provider; // NULL for every provider
+    pqb_alg_list *list;
+    FILE *out;            // set when listing rather than collecting
+    const char *kind;
+} discovery;
+
+static void found(discovery *d, const char *name, const OSSL_PROVIDER *prov) {
+    const char *prov_name = OSSL_PROVIDER_get0_name(prov);
+    if (d->provider && strcmp(prov_name, d->provider) != 0) {
+        return;
+    }
+    if (!d->out) {
+        pqb_alg_list_add(d->list, name);
+        return;
+    }
+
+    const char *oqs = NULL;
+#if PQB_HAVE_LIBOQS
+    oqs = strcmp(d->kind, "kem") == 0 ? pqb_oqs_kem_name(name) : pqb_oqs_sig_name(name);
+#endif
+    fprintf(d->out, "%-10s %-32s %-16s %s\n", d->kind, name, prov_name, oqs ? oqs : "-");
+}
+
+static void found_signature(EVP_SIGNATURE *sig, void *arg) {
+    found(arg, EVP_SIGNATURE_get0_name(sig), EVP_SIGNATURE_get0_provider(sig));
+}
+
+static void found_kem(EVP_KEM *kem, void *arg) {
+    found(arg, EVP_KEM_get0_name(kem), EVP_KEM_get0_provider(kem));
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+void pqb_discover(const pqb_bench *bench, pqb_alg_kind kind, const char *provider, pqb_alg_list *list) {
+    discovery d = {provider, list, NULL, NULL};
+    int first = list->count;
+    if (kind == PQB_ALGS_SIGNATURE) {
+        EVP_SIGNATURE_do_all_provided(bench->libctx, found_signature, &d);
+    } else if (kind == PQB_ALGS_KEM) {
+        EVP_KEM_do_all_provided(bench->libctx, found_kem, &d);
+    }
+    qsort(list->names + first, list->count - first, sizeof(char *), compare_names);
+}
+
+static int matches_any(const char *name, const char *patterns) {
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s", patterns);
+    char *save = NULL;
+    for (char *p = strtok_r(buf, ",", &save); p; p = strtok_r(NULL, ",", &save)) {
+        if (fnmatch(p, name, FNM_CASEFOLD) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void pqb_filter_algorithms(pqb_alg_list *list, const char *include, const char *exclude) {
+    int kept = 0;
+    for (int i = 0; i < list->count; i++) {
+        const char *name = list->names[i];
+        if ((!include || matches_any(name, include)) && !(exclude && matches_any(name, exclude))) {
+            list->names[kept++] = name;
+        } else {
+            free((char *)name);
+        }
+    }
+    list->count = kept;
+}
+
+void pqb_list_algorithms(const pqb_bench *bench, FILE *out) {
+    discovery d = {NULL, NULL, out, "signature"};
+    fprintf(out, "%-10s %-32s %-16s %s\n", "Kind", "Algorithm", "Provider", "liboqs");
+    EVP_SIGNATURE_do_all_provided(bench->libctx, found_signature, &d);
+    d.kind = "kem";
+    EVP_KEM_do_all_provided(bench->libctx, found_kem, &d);
+
+#if PQB_HAVE_LIBOQS
+    pqb_alg_list sigs = {0}, kems = {0};
+    pqb_discover(bench, PQB_ALGS_SIGNATURE, NULL, &sigs);
+    pqb_discover(bench, PQB_ALGS_KEM, NULL, &kems);
+    for (int i = 0; i < OQS_SIG_alg_count(); i++) {
+        const char *id = OQS_SIG_alg_identifier(i);
+        int exposed = 0;
+        for (int j = 0; j < sigs.count && !exposed; j++) {
+            const char *mapped = pqb_oqs_sig_name(sigs.names[j]);
+            exposed = mapped && strcmp(mapped, id) == 0;
+        }
+        if (OQS_SIG_alg_is_enabled(id) && !exposed) {
+            fprintf(out, "%-10s %-32s %-16s %s\n", "signature", "-", "liboqs only", id);
+        }
+    }
+    for (int i = 0; i < OQS_KEM_alg_count(); i++) {
+        const char *id = OQS_KEM_alg_identifier(i);
+        int exposed = 0;
+        for (int j = 0; j < kems.count && !exposed; j++) {
+            const char *mapped = pqb_oqs_kem_name(kems.names[j]);
+            exposed = mapped && strcmp(mapped, id) == 0;
+        }
+        if (OQS_KEM_alg_is_enabled(id) && !exposed) {
+            fprintf(out, "%-10s %-32s %-16s %s\n", "kem", "-", "liboqs only", id);
+        }
+    }
+    pqb_alg_list_free(&sigs);
+    pqb_alg_list_free(&kems);
+#endif
+}
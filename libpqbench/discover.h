@@ -0,0 +1,33 @@
+#ifndef PQB_DISCOVER_H
+#define PQB_DISCOVER_H
+
+#include <stdio.h>
+
+#include "bench.h"
+
+// A list of algorithm names that owns its strings
+typedef struct {
+    const char **names;
+    int count;
+    int capacity;
+} pqb_alg_list;
+
+void pqb_alg_list_add(pqb_alg_list *list, const char *name);
+void pqb_alg_list_free(pqb_alg_list *list);
+
+// Add every signature or KEM algorithm that the named provider, loaded into
+// the bench's library context, implements, by its canonical name, sorted and
+// without duplicates. Hybrids such as p256_dilithium2 are included.
+void pqb_discover(const pqb_bench *bench, pqb_alg_kind kind, const char *provider, pqb_alg_list *list);
+
+// Keep the names that match one of the include globs, or any name if include
+// is NULL, and none of the exclude globs. Both are comma separated fnmatch
+// patterns, e.g. "dilithium*,falcon*".
+void pqb_filter_algorithms(pqb_alg_list *list, const char *include, const char *exclude);
+
+// Print every signature and KEM algorithm of the loaded providers with the
+// provider implementing it and, with liboqs, the liboqs algorithm behind it,
+// followed by the enabled liboqs algorithms no provider exposes
+void pqb_list_algorithms(const pqb_bench *bench, FILE *out);
+
+#endif
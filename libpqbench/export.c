@@ -0,0 +1,453 @@
+#include "sink.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "writer.h"
+
+// Machine readable sinks. Records are formatted into a pqb_writer, whose
+// thread does the file I/O, so nothing is written from the timed loop's
+// thread. Summaries are in the unit the text sink reports (microseconds or
+// cycles); raw samples keep their raw timer unit.
+
+typedef struct {
+    pqb_sink base;
+    pqb_writer *w;
+    int records; // summary records written so far, for JSON separators
+} export_sink;
+
+static export_sink *export_sink_new(const char *path) {
+    export_sink *es = calloc(1, sizeof(*es));
+    if (!es) {
+        fprintf(stderr, "Failed to allocate output sink for %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    es->w = pqb_writer_open(path);
+    return es;
+}
+
+static void export_close(pqb_sink *sink) {
+    export_sink *es = (export_sink *)sink;
+    pqb_writer_close(es->w);
+    free(es);
+}
+
+// NDJSON, one line per raw sample
+
+static void ndjson_sample(pqb_writer *w, const char *algorithm, const pqb_op *op, int threads, int iteration,
+                          uint64_t value, const char *unit, int thread, int cpu, int ops_per_sample) {
+    pqb_writer_write(w, "{\"algorithm\":", 13);
+    pqb_writer_json_string(w, algorithm);
+    pqb_writer_printf(w,
+                      ",\"op\":\"%s\",\"threads\":%d,\"iteration\":%d,\"value\":%llu,\"unit\":\"%s\","
+                      "\"thread\":%d,\"cpu\":%d,\"ops_per_sample\":%d}\n",
+                      op->name, threads, iteration, (unsigned long long)value, unit, thread, cpu, ops_per_sample);
+}
+
+static void ndjson_result(pqb_sink *sink, const pqb_result *r) {
+    export_sink *es = (export_sink *)sink;
+    const char *unit = pqb_timer_raw_unit(r->timer);
+    for (int i = 0; i < r->num_samples; i++) {
+        ndjson_sample(es->w, r->algorithm, r->op, 1, i, r->samples[i], unit, 0, r->cpus ? r->cpus[i] : -1,
+                      r->ops_per_sample);
+    }
+}
+
+static void ndjson_throughput(pqb_sink *sink, const pqb_throughput_result *r) {
+    export_sink *es = (export_sink *)sink;
+    const char *unit = pqb_timer_raw_unit(r->timer);
+    for (int t = 0; t < r->threads; t++) {
+        for (int i = 0; i < r->num_samples; i++) {
+            ndjson_sample(es->w, r->algorithm, r->op, r->threads, i, r->thread_samples[t][i], unit, t, r->cpus[t],
+                          r->ops_per_sample);
+        }
+    }
+}
+
+pqb_sink *pqb_ndjson_sink_new(const char *path) {
+    export_sink *es = export_sink_new(path);
+    es->base.result = ndjson_result;
+    es->base.throughput = ndjson_throughput;
+    es->base.close = export_close;
+    return &es->base;
+}
+
+// JSON, one array of summary records
+
+static void json_stats(pqb_writer *w, const pqb_stats *st, double scale) {
+    pqb_writer_printf(w,
+                      "\"samples\":%zu,\"samples_in_mean\":%zu,\"mean\":%.6f,\"std_dev\":%.6f,\"median\":%.6f,"
+                      "\"p90\":%.6f,\"p99\":%.6f,\"p999\":%.6f,\"min\":%.6f,\"max\":%.6f,\"mad\":%.6f,"
+                      "\"confidence\":%.3f,\"mean_ci\":[%.6f,%.6f],\"median_ci\":[%.6f,%.6f]",
+                      st->num_samples, st->num_filtered, st->mean * scale, st->std_dev * scale, st->median * scale,
+                      st->p90 * scale, st->p99 * scale, st->p999 * scale, st->min * scale, st->max * scale,
+                      st->mad * scale, st->confidence, st->mean_ci_low * scale, st->mean_ci_high * scale,
+                      st->median_ci_low * scale, st->median_ci_high * scale);
+}
+
+static void json_record_start(export_sink *es, const char *type, const char *algorithm, const pqb_op *op,
+                              const pqb_timer *timer) {
+    pqb_writer_printf(es->w, "%s\n  {\"type\":\"%s\",\"algorithm\":", es->records++ ? "," : "", type);
+    pqb_writer_json_string(es->w, algorithm);
+    pqb_writer_printf(es->w, ",\"op\":\"%s\",\"unit\":\"%s\",", op->name, pqb_timer_unit(timer));
+}
+
+static void json_result(pqb_sink *sink, const pqb_result *r) {
+    export_sink *es = (export_sink *)sink;
+    json_record_start(es, "latency", r->algorithm, r->op, r->timer);
+    json_stats(es->w, &r->stats, pqb_timer_scale(r->timer));
+    pqb_writer_printf(es->w, ",\"ops_per_sample\":%d,\"warmup\":%d,\"wire_bytes\":%zu", r->ops_per_sample,
+                      r->warmup_runs, r->wire_bytes);
+    if (r->allocs_counted) {
+        pqb_writer_printf(es->w, ",\"allocs_per_op\":%.3f,\"alloc_bytes_per_op\":%.3f", r->allocs_per_op,
+                          r->alloc_bytes_per_op);
+    }
+    if (r->counters_counted) {
+        const double *n = r->counters_per_op;
+        pqb_writer_write(es->w, ",\"counters\":{", 13);
+        int first = 1;
+        for (int c = 0; c < PQB_NUM_COUNTERS; c++) {
+            if (n[c] >= 0) {
+                pqb_writer_printf(es->w, "%s\"%s\":%.3f", first ? "" : ",", pqb_counter_name(c), n[c]);
+                first = 0;
+            }
+        }
+        if (n[PQB_COUNTER_INSTRUCTIONS] >= 0 && n[PQB_COUNTER_CYCLES] > 0) {
+            pqb_writer_printf(es->w, "%s\"ipc\":%.6f", first ? "" : ",",
+                              n[PQB_COUNTER_INSTRUCTIONS] / n[PQB_COUNTER_CYCLES]);
+        }
+        pqb_writer_write(es->w, "}", 1);
+    }
+    if (r->memory_measured) {
+        const int64_t fields[3] = {r->memory.peak_heap, r->memory.peak_rss, r->memory.stack};
+        const char *names[3] = {"peak_heap_bytes", "peak_rss_bytes", "stack_bytes"};
+        pqb_writer_write(es->w, ",\"memory\":{", 11);
+        for (int f = 0; f < 3; f++) {
+            if (fields[f] >= 0) {
+                pqb_writer_printf(es->w, "%s\"%s\":%lld", f ? "," : "", names[f], (long long)fields[f]);
+            } else {
+                pqb_writer_printf(es->w, "%s\"%s\":null", f ? "," : "", names[f]);
+            }
+        }
+        pqb_writer_write(es->w, "}", 1);
+    }
+    pqb_writer_write(es->w, "}", 1);
+}
+
+static void json_throughput(pqb_sink *sink, const pqb_throughput_result *r) {
+    export_sink *es = (export_sink *)sink;
+    json_record_start(es, "throughput", r->algorithm, r->op, r->timer);
+    json_stats(es->w, &r->stats, pqb_timer_scale(r->timer));
+    if (r->topology) {
+        pqb_writer_printf(es->w, ",\"topology\":\"%s\"", r->topology);
+    }
+    pqb_writer_printf(es->w,
+                      ",\"ops_per_sample\":%d,\"threads\":%d,\"ops_per_sec\":%.3f,\"speedup\":%.3f,"
+                      "\"iterations_per_sec\":%.3f,\"wall_seconds\":%.6f,\"cpus\":[",
+                      r->ops_per_sample, r->threads, r->ops_per_sec, r->speedup, r->iterations_per_sec,
+                      r->wall_seconds);
+    for (int t = 0; t < r->threads; t++) {
+        pqb_writer_printf(es->w, "%s%d", t ? "," : "", r->cpus[t]);
+    }
+    pqb_writer_write(es->w, "]}", 2);
+}
+
+static void json_sweep(pqb_sink *sink, const pqb_sweep_result *r) {
+    export_sink *es = (export_sink *)sink;
+    double scale = pqb_timer_scale(r->timer);
+    json_record_start(es, "sweep", r->algorithm, r->op, r->timer);
+    pqb_writer_printf(es->w, "\"fixed\":%.6f,\"per_kib\":%.6f,\"r_squared\":%.6f,\"points\":[", r->fixed * scale,
+                      r->per_byte * 1024 * scale, r->r_squared);
+    for (int p = 0; p < r->num_points; p++) {
+        pqb_writer_printf(es->w, "%s{\"payload\":%zu,", p ? "," : "", r->sizes[p]);
+        json_stats(es->w, &r->stats[p], scale);
+        pqb_writer_write(es->w, "}", 1);
+    }
+    pqb_writer_write(es->w, "]}", 2);
+}
+
+// One record per op, with an entry per measured backend and its median
+// relative to the first measured one
+static void json_comparison(pqb_sink *sink, const pqb_comparison_result *r) {
+    export_sink *es = (export_sink *)sink;
+    double scale = pqb_timer_scale(r->timer);
+    int num_ops = r->family->num_ops;
+    for (int o = 0; o < num_ops; o++) {
+        json_record_start(es, "comparison", r->algorithm, &r->family->ops[o], r->timer);
+        pqb_writer_printf(es->w, "\"backends\":[");
+        double reference = 0.0;
+        int n = 0;
+        for (int b = 0; b < r->num_backends; b++) {
+            if (!r->measured[b]) {
+                continue;
+            }
+            const pqb_stats *st = &r->stats[b * num_ops + o];
+            if (n == 0) {
+                reference = st->median;
+            }
+            pqb_writer_printf(es->w, "%s{\"backend\":", n++ ? "," : "");
+            pqb_writer_json_string(es->w, r->backends[b].name);
+            pqb_writer_write(es->w, ",", 1);
+            json_stats(es->w, st, scale);
+            pqb_writer_printf(es->w, ",\"relative\":%.6f}", reference > 0 ? st->median / reference : 0.0);
+        }
+        pqb_writer_write(es->w, "]}", 2);
+    }
+}
+
+static void json_leakage(pqb_sink *sink, const pqb_leakage_result *r) {
+    export_sink *es = (export_sink *)sink;
+    double scale = pqb_timer_scale(r->timer);
+    json_record_start(es, "leakage", r->algorithm, r->op, r->timer);
+    pqb_writer_write(es->w, "\"classes\":[", 11);
+    pqb_writer_json_string(es->w, r->input_classes[0]);
+    pqb_writer_write(es->w, ",", 1);
+    pqb_writer_json_string(es->w, r->input_classes[1]);
+    pqb_writer_printf(es->w,
+                      "],\"measurements\":%llu,\"counts\":[%llu,%llu],\"means\":[%.6f,%.6f],\"t\":%.6f,"
+                      "\"max_t\":%.6f,\"max_t_samples\":%llu,\"max_t_threshold\":%.6f,\"max_tau\":%.6f,"
+                      "\"leaky\":%s}",
+                      (unsigned long long)r->measurements, (unsigned long long)r->counts[0],
+                      (unsigned long long)r->counts[1], r->means[0] * scale, r->means[1] * scale, r->t, r->max_t,
+                      (unsigned long long)r->max_t_samples, r->max_t_threshold * scale, r->max_tau,
+                      r->leaky ? "true" : "false");
+}
+
+// Estimates are not about one op, so the record has none
+static void json_handshake(pqb_sink *sink, const pqb_handshake_estimate *e) {
+    export_sink *es = (export_sink *)sink;
+    pqb_writer_printf(es->w, "%s\n  {\"type\":\"handshake\",\"kex\":", es->records++ ? "," : "");
+    pqb_writer_json_string(es->w, e->kex);
+    pqb_writer_write(es->w, ",\"signature\":", 13);
+    pqb_writer_json_string(es->w, e->signature);
+    pqb_writer_printf(es->w,
+                      ",\"rtt_ms\":%.3f,\"bandwidth_mbps\":%.3f,\"chain_certs\":%d,\"client_bytes\":%zu,"
+                      "\"server_bytes\":%zu,\"round_trips\":%d,\"client_cpu_ms\":%.6f,\"server_cpu_ms\":%.6f,"
+                      "\"transfer_ms\":%.6f,\"latency_ms\":%.6f}",
+                      e->rtt_ms, e->bandwidth_mbps, e->chain_certs, e->client_bytes, e->server_bytes,
+                      e->round_trips, e->client_cpu_ms, e->server_cpu_ms, e->transfer_ms, e->latency_ms);
+}
+
+static void json_mesh(pqb_sink *sink, const pqb_mesh_estimate *e) {
+    export_sink *es = (export_sink *)sink;
+    pqb_writer_printf(es->w, "%s\n  {\"type\":\"mesh\",\"algorithm\":", es->records++ ? "," : "");
+    pqb_writer_json_string(es->w, e->algorithm);
+    pqb_writer_printf(es->w,
+                      ",\"participants\":%d,\"rtt_ms\":%.3f,\"bandwidth_mbps\":%.3f,\"handshakes\":%llu,"
+                      "\"request_bytes\":%zu,\"reply_bytes\":%zu,\"final_bytes\":%zu,\"handshake_ms\":%.6f,"
+                      "\"full_mesh_ms\":%.6f,\"cpu_ms_min\":%.6f,\"cpu_ms_mean\":%.6f,\"cpu_ms_max\":%.6f,"
+                      "\"sent_bytes_mean\":%.1f}",
+                      e->participants, e->rtt_ms, e->bandwidth_mbps, (unsigned long long)e->handshakes,
+                      e->request_bytes, e->reply_bytes, e->final_bytes, e->handshake_ms, e->full_mesh_ms,
+                      e->cpu_ms_min, e->cpu_ms_mean, e->cpu_ms_max, e->sent_bytes_mean);
+}
+
+static void json_histogram(pqb_writer *w, const char *name, const pqb_histogram *h, double scale) {
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    static const char *const names[] = {"p50", "p90", "p99", "p999"};
+    pqb_writer_printf(w, "\"%s\":{\"mean\":%.6f", name, pqb_histogram_mean(h) * scale);
+    for (int q = 0; q < 4; q++) {
+        pqb_writer_printf(w, ",\"%s\":%.6f", names[q], pqb_histogram_quantile(h, quantiles[q]) * scale);
+    }
+    pqb_writer_printf(w, ",\"max\":%.6f}", pqb_histogram_quantile(h, 1.0) * scale);
+}
+
+static void json_load(pqb_sink *sink, const pqb_load_result *r) {
+    export_sink *es = (export_sink *)sink;
+    double scale = pqb_timer_scale(r->timer);
+    json_record_start(es, "load", r->algorithm, r->op, r->timer);
+    pqb_writer_printf(es->w,
+                      "\"arrival\":\"%s\",\"workers\":%d,\"offered_rate\":%.3f,\"achieved_rate\":%.3f,"
+                      "\"duration\":%.3f,\"requests\":%llu,\"completed\":%llu,\"abandoned\":%llu,"
+                      "\"saturated\":%s,",
+                      r->arrival == PQB_ARRIVAL_POISSON ? "poisson" : "fixed", r->workers, r->offered_rate,
+                      r->achieved_rate, r->duration, (unsigned long long)r->requests,
+                      (unsigned long long)r->completed, (unsigned long long)r->abandoned,
+                      r->saturated ? "true" : "false");
+    json_histogram(es->w, "latency", r->latency, scale);
+    pqb_writer_write(es->w, ",", 1);
+    json_histogram(es->w, "service", r->service, scale);
+    pqb_writer_write(es->w, "}", 1);
+}
+
+static void json_pool(pqb_sink *sink, const pqb_pool_result *r) {
+    export_sink *es = (export_sink *)sink;
+    double scale = pqb_timer_scale(r->timer);
+    pqb_writer_printf(es->w, "%s\n  {\"type\":\"pool\",\"algorithm\":", es->records++ ? "," : "");
+    pqb_writer_json_string(es->w, r->algorithm);
+    pqb_writer_printf(es->w,
+                      ",\"unit\":\"%s\",\"arrival\":\"%s\",\"capacity\":%d,\"producers\":%d,"
+                      "\"producers_needed\":%d,\"target_rate\":%.3f,\"keygen_rate\":%.3f,\"cores_needed\":%.3f,"
+                      "\"refill_rate\":%.3f,\"duration\":%.3f,\"requests\":%llu,\"misses\":%llu,"
+                      "\"abandoned\":%llu,\"lowest_fill\":%llu,\"sustained\":%s,",
+                      pqb_timer_unit(r->timer), r->arrival == PQB_ARRIVAL_POISSON ? "poisson" : "fixed", r->capacity,
+                      r->producers, r->producers_needed, r->target_rate, r->keygen_rate, r->cores_needed,
+                      r->refill_rate, r->duration, (unsigned long long)r->requests, (unsigned long long)r->misses,
+                      (unsigned long long)r->abandoned, (unsigned long long)r->lowest_fill,
+                      r->sustained ? "true" : "false");
+    json_histogram(es->w, "on_demand", r->on_demand, scale);
+    pqb_writer_write(es->w, ",", 1);
+    json_histogram(es->w, "handout", r->handout, scale);
+    pqb_writer_write(es->w, "}", 1);
+}
+
+static void json_async(pqb_sink *sink, const pqb_async_result *r) {
+    export_sink *es = (export_sink *)sink;
+    json_record_start(es, "async", r->algorithm, r->op, r->timer);
+    json_stats(es->w, &r->stats, pqb_timer_scale(r->timer));
+    pqb_writer_printf(es->w,
+                      ",\"ops_per_sample\":%d,\"depth\":%d,\"ops_per_sec\":%.3f,\"speedup\":%.3f,\"pauses\":%llu,"
+                      "\"wall_seconds\":%.6f}",
+                      r->ops_per_sample, r->depth, r->ops_per_sec, r->speedup, (unsigned long long)r->pauses,
+                      r->wall_seconds);
+}
+
+static void json_cpu_matrix(pqb_sink *sink, const pqb_cpu_matrix_result *r) {
+    export_sink *es = (export_sink *)sink;
+    for (int i = 0; i < r->num_rows; i++) {
+        const pqb_cpu_matrix_row *row = &r->rows[i];
+        pqb_writer_printf(es->w, "%s\n  {\"type\":\"cpu_matrix\",\"algorithm\":", es->records++ ? "," : "");
+        pqb_writer_json_string(es->w, row->algorithm);
+        pqb_writer_printf(es->w, ",\"op\":\"%s\",\"unit\":\"%s\",\"reference\":", row->op, row->unit);
+        pqb_writer_json_string(es->w, r->levels[0].name);
+        pqb_writer_write(es->w, ",\"levels\":[", 11);
+        int first = 1;
+        for (int l = 0; l < r->num_levels; l++) {
+            if (!r->completed[l]) {
+                continue;
+            }
+            pqb_writer_printf(es->w, "%s{\"name\":", first ? "" : ",");
+            first = 0;
+            pqb_writer_json_string(es->w, r->levels[l].name);
+            pqb_writer_write(es->w, ",\"env\":[", 8);
+            for (int e = 0; e < r->levels[l].num_env; e++) {
+                if (e) {
+                    pqb_writer_write(es->w, ",", 1);
+                }
+                pqb_writer_json_string(es->w, r->levels[l].env[e]);
+            }
+            if (isnan(row->median[l])) {
+                pqb_writer_printf(es->w, "],\"median\":null,\"speedup\":null}");
+            } else if (isnan(row->median[0]) || row->median[0] <= 0) {
+                pqb_writer_printf(es->w, "],\"median\":%.6f,\"speedup\":null}", row->median[l]);
+            } else {
+                pqb_writer_printf(es->w, "],\"median\":%.6f,\"speedup\":%.6f}", row->median[l],
+                                  row->median[l] / row->median[0]);
+            }
+        }
+        pqb_writer_write(es->w, "]}", 2);
+    }
+}
+
+static void json_close(pqb_sink *sink) {
+    export_sink *es = (export_sink *)sink;
+    pqb_writer_printf(es->w, "\n]\n");
+    export_close(sink);
+}
+
+pqb_sink *pqb_json_sink_new(const char *path) {
+    export_sink *es = export_sink_new(path);
+    es->base.result = json_result;
+    es->base.throughput = json_throughput;
+    es->base.sweep = json_sweep;
+    es->base.comparison = json_comparison;
+    es->base.leakage = json_leakage;
+    es->base.handshake = json_handshake;
+    es->base.mesh = json_mesh;
+    es->base.load = json_load;
+    es->base.pool = json_pool;
+    es->base.async = json_async;
+    es->base.cpu_matrix = json_cpu_matrix;
+    es->base.close = json_close;
+    pqb_writer_write(es->w, "[", 1);
+    return &es->base;
+}
+
+// CSV, one row per summary with the columns that do not apply left empty
+
+static void csv_row(pqb_writer *w, const char *type, const char *algorithm, const pqb_op *op, const char *threads,
+                    const char *payload, const pqb_timer *timer, const pqb_stats *st, int ops_per_sample) {
+    double scale = pqb_timer_scale(timer);
+    pqb_writer_printf(w, "%s,%s,%s,%s,%s,%s,%zu,%zu,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%d,",
+                      type, algorithm, op->name, threads, payload, pqb_timer_unit(timer), st->num_samples,
+                      st->num_filtered, st->mean * scale, st->std_dev * scale, st->median * scale, st->p90 * scale,
+                      st->p99 * scale, st->p999 * scale, st->min * scale, st->max * scale, st->mad * scale,
+                      st->mean_ci_low * scale, st->mean_ci_high * scale, ops_per_sample);
+}
+
+// The hardware counter and memory columns, then the end of the row; empty
+// for rows without them
+static void csv_counters(pqb_writer *w, const pqb_result *r) {
+    for (int c = 0; c < PQB_NUM_COUNTERS; c++) {
+        if (r && r->counters_counted && r->counters_per_op[c] >= 0) {
+            pqb_writer_printf(w, ",%.3f", r->counters_per_op[c]);
+        } else {
+            pqb_writer_write(w, ",", 1);
+        }
+    }
+    if (r && r->memory_measured) {
+        const int64_t m[3] = {r->memory.peak_heap, r->memory.peak_rss, r->memory.stack};
+        for (int f = 0; f < 3; f++) {
+            if (m[f] >= 0) {
+                pqb_writer_printf(w, ",%lld", (long long)m[f]);
+            } else {
+                pqb_writer_write(w, ",", 1);
+            }
+        }
+    } else {
+        pqb_writer_write(w, ",,,", 3);
+    }
+    pqb_writer_write(w, "\n", 1);
+}
+
+static void csv_result(pqb_sink *sink, const pqb_result *r) {
+    export_sink *es = (export_sink *)sink;
+    csv_row(es->w, "latency", r->algorithm, r->op, "1", "", r->timer, &r->stats, r->ops_per_sample);
+    if (r->allocs_counted) {
+        pqb_writer_printf(es->w, ",%.3f,%.3f,%zu", r->allocs_per_op, r->alloc_bytes_per_op, r->wire_bytes);
+    } else {
+        pqb_writer_printf(es->w, ",,,%zu", r->wire_bytes);
+    }
+    csv_counters(es->w, r);
+}
+
+static void csv_throughput(pqb_sink *sink, const pqb_throughput_result *r) {
+    export_sink *es = (export_sink *)sink;
+    char threads[64];
+    if (r->topology) {
+        snprintf(threads, sizeof(threads), "%s/%d", r->topology, r->threads);
+    } else {
+        snprintf(threads, sizeof(threads), "%d", r->threads);
+    }
+    csv_row(es->w, "throughput", r->algorithm, r->op, threads, "", r->timer, &r->stats, r->ops_per_sample);
+    pqb_writer_printf(es->w, "%.3f,,,", r->ops_per_sec);
+    csv_counters(es->w, NULL);
+}
+
+static void csv_sweep(pqb_sink *sink, const pqb_sweep_result *r) {
+    export_sink *es = (export_sink *)sink;
+    for (int p = 0; p < r->num_points; p++) {
+        char payload[32];
+        snprintf(payload, sizeof(payload), "%zu", r->sizes[p]);
+        csv_row(es->w, "sweep", r->algorithm, r->op, "1", payload, r->timer, &r->stats[p], 1);
+        pqb_writer_printf(es->w, ",,,");
+        csv_counters(es->w, NULL);
+    }
+}
+
+pqb_sink *pqb_csv_sink_new(const char *path) {
+    export_sink *es = export_sink_new(path);
+    es->base.result = csv_result;
+    es->base.throughput = csv_throughput;
+    es->base.sweep = csv_sweep;
+    es->base.close = export_close;
+    pqb_writer_printf(es->w, "type,algorithm,op,threads,payload,unit,samples,samples_in_mean,mean,std_dev,median,p90,"
+                             "p99,p999,min,max,mad,mean_ci_low,mean_ci_high,ops_per_sample,ops_per_sec,"
+                             "allocs_per_op,alloc_bytes_per_op,wire_bytes");
+    for (int c = 0; c < PQB_NUM_COUNTERS; c++) {
+        pqb_writer_printf(es->w, ",%s", pqb_counter_name(c));
+    }
+    pqb_writer_printf(es->w, ",peak_heap_bytes,peak_rss_bytes,stack_bytes");
+    pqb_writer_write(es->w, "\n", 1);
+    return &es->base;
+}
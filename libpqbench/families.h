@@ -0,0 +1,36 @@
+#ifndef PQB_FAMILIES_H
+#define PQB_FAMILIES_H
+
+#include "bench.h"
+
+// Key generation only: RSA, EC curves and signature algorithms
+extern const pqb_family pqb_keygen_family;
+
+// KEM keygen, encapsulation and decapsulation, e.g. kyber768
+extern const pqb_family pqb_kem_family;
+
+// Signing and verifying the bench payload with one key pair per algorithm
+extern const pqb_family pqb_sig_family;
+
+// X.509 chains of signature algorithms, reached as pqb_sig_family.chain: DER
+// encoding and parsing of the certificates a peer sends, their signatures
+// alone, and X509_verify_cert against a store that trusts the root
+extern const pqb_family pqb_chain_family;
+
+// One full ECDH exchange, e.g. X25519 or prime256v1: both key pairs and both
+// derivations, reported per step and summed per handshake
+extern const pqb_family pqb_ecdh_handshake_family;
+
+// One KEM exchange: initiator keygen, responder encapsulation and initiator
+// decapsulation. Covers oqsprovider's hybrid groups such as x25519_kyber768
+extern const pqb_family pqb_kem_handshake_family;
+
+// One DDS-Security authentication handshake between two participants, for
+// "<signature>+<key agreement>" such as "prime256v1+prime256v1": identity
+// certificate and permissions checks, the challenge signatures and the key
+// agreement, per step and summed. The permissions document is the bench
+// payload. ECDH and KEM key agreement, including hybrid KEMs, respectively.
+extern const pqb_family pqb_dds_ecdh_handshake_family;
+extern const pqb_family pqb_dds_kem_handshake_family;
+
+#endif
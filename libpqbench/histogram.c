@@ -0,0 +1,176 @@
+#include "histogram.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void pqb_histogram_init(pqb_histogram *h, uint64_t highest) {
+    memset(h, 0, sizeof(*h));
+    h->highest = highest;
+    h->min = UINT64_MAX;
+    h->counts_len = pqb_histogram_index(highest) + 1;
+    h->counts = calloc(h->counts_len, sizeof(uint64_t));
+    if (!h->counts) {
+        fprintf(stderr, "Failed to allocate a histogram\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void pqb_histogram_free(pqb_histogram *h) {
+    free(h->counts);
+    memset(h, 0, sizeof(*h));
+}
+
+void pqb_histogram_add(pqb_histogram *dst, const pqb_histogram *src) {
+    for (int i = 0; i < src->counts_len && i < dst->counts_len; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->total += src->total;
+    dst->sum += src->sum;
+    if (src->min < dst->min) {
+        dst->min = src->min;
+    }
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+}
+
+// The largest value that lands in index i
+static uint64_t highest_equivalent(int i) {
+    int bucket = (i >> (PQB_HISTOGRAM_SUB_BUCKET_MAGNITUDE - 1)) - 1;
+    int sub = (i & (PQB_HISTOGRAM_HALF_BUCKETS - 1)) + PQB_HISTOGRAM_HALF_BUCKETS;
+    if (bucket < 0) {
+        return (uint64_t)i;
+    }
+    return (((uint64_t)sub + 1) << bucket) - 1;
+}
+
+uint64_t pqb_histogram_quantile(const pqb_histogram *h, double q) {
+    if (h->total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(q * h->total + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < h->counts_len; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t v = highest_equivalent(i);
+            return v < h->min ? h->min : v > h->max ? h->max : v;
+        }
+    }
+    return h->max;
+}
+
+// Midpoint of the values that land in index i, within the recorded range
+static double bucket_value(const pqb_histogram *h, int i) {
+    uint64_t low = i > 0 ? highest_equivalent(i - 1) + 1 : 0;
+    double v = (low + (double)highest_equivalent(i)) / 2;
+    return v < h->min ? (double)h->min : v > h->max ? (double)h->max : v;
+}
+
+// Value of the sample at 0-based rank r of the sorted values
+static double value_at_rank(const pqb_histogram *h, uint64_t r) {
+    uint64_t seen = 0;
+    for (int i = 0; i < h->counts_len; i++) {
+        seen += h->counts[i];
+        if (seen > r) {
+            return bucket_value(h, i);
+        }
+    }
+    return (double)h->max;
+}
+
+// Smallest deviation d with at least half the values within d of median
+static double median_absolute_deviation(const pqb_histogram *h, double median) {
+    double lo = 0.0, hi = (double)(h->max - h->min);
+    uint64_t target = (h->total + 1) / 2;
+    for (int step = 0; step < 64 && hi - lo > 0.5; step++) {
+        double mid = (lo + hi) / 2;
+        uint64_t within = 0;
+        for (int i = 0; i < h->counts_len; i++) {
+            if (h->counts[i] && fabs(bucket_value(h, i) - median) <= mid) {
+                within += h->counts[i];
+            }
+        }
+        if (within >= target) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+    }
+    return hi;
+}
+
+void pqb_histogram_statistics(const pqb_histogram *h, const pqb_stats_options *opts, pqb_stats *out) {
+    memset(out, 0, sizeof(*out));
+    uint64_t n = h->total;
+    out->num_samples = n;
+    out->confidence = opts->confidence;
+    if (n == 0) {
+        return;
+    }
+
+    out->min = (double)h->min;
+    out->max = (double)h->max;
+    out->median = value_at_rank(h, (n - 1) / 2);
+    out->p90 = value_at_rank(h, (uint64_t)((n - 1) * 0.90));
+    out->p99 = value_at_rank(h, (uint64_t)((n - 1) * 0.99));
+    out->p999 = value_at_rank(h, (uint64_t)((n - 1) * 0.999));
+    out->mad = median_absolute_deviation(h, out->median);
+
+    double z = pqb_normal_quantile(1.0 - (1.0 - opts->confidence) / 2);
+    double half_width = z * sqrt((double)n) / 2;
+    double lo_rank = floor(n / 2.0 - half_width);
+    double hi_rank = ceil(n / 2.0 + half_width);
+    out->median_ci_low = value_at_rank(h, lo_rank < 0 ? 0 : (uint64_t)lo_rank);
+    out->median_ci_high = value_at_rank(h, hi_rank >= n ? n - 1 : (uint64_t)hi_rank);
+
+    // The legacy filter by rank and value, as on the sorted samples
+    uint64_t first = 0, last = n;
+    double low = -INFINITY, high = INFINITY;
+    if (opts->filter == PQB_FILTER_LEGACY) {
+        uint64_t ignore_runs = n * IGNORE_PERCENTAGE;
+        uint64_t effective_runs = n - 2 * ignore_runs;
+        if (effective_runs >= 4) {
+            double q1 = value_at_rank(h, ignore_runs + effective_runs / 4);
+            double q3 = value_at_rank(h, ignore_runs + 3 * effective_runs / 4);
+            double iqr = q3 - q1;
+            first = ignore_runs;
+            last = n - ignore_runs;
+            low = q1 - IQR_MULTIPLIER * iqr;
+            high = q3 + IQR_MULTIPLIER * iqr;
+        }
+    }
+    double sum = 0.0, sum_squares = 0.0;
+    uint64_t count = 0, seen = 0;
+    for (int i = 0; i < h->counts_len; i++) {
+        uint64_t begin = seen, end = seen + h->counts[i];
+        seen = end;
+        double v = bucket_value(h, i);
+        if (h->counts[i] == 0 || v < low || v > high) {
+            continue;
+        }
+        begin = begin > first ? begin : first;
+        end = end < last ? end : last;
+        if (end > begin) {
+            count += end - begin;
+            sum += (end - begin) * v;
+            sum_squares += (end - begin) * v * v;
+        }
+    }
+    out->num_filtered = count;
+    if (count == 0) {
+        return;
+    }
+    // Unfiltered, the exact sum gives the exact mean
+    out->mean = opts->filter == PQB_FILTER_LEGACY ? sum / count : h->sum / n;
+    double variance = sum_squares / count - (sum / count) * (sum / count);
+    out->std_dev = variance > 0 ? sqrt(variance) : 0.0;
+    double margin = count > 1 ? z * out->std_dev / sqrt((double)count) : 0.0;
+    out->mean_ci_low = out->mean - margin;
+    out->mean_ci_high = out->mean + margin;
+}
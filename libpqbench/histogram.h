@@ -0,0 +1,73 @@
+#ifndef PQB_HISTOGRAM_H
+#define PQB_HISTOGRAM_H
+
+#include <stdint.h>
+
+#include "stats.h"
+
+// HDR histogram: log-linear buckets that keep every recorded value to 3
+// significant digits from 1 up to the highest trackable value, in a fixed
+// amount of memory however many values are recorded. Values are whatever
+// unit the caller records in, e.g. nanoseconds.
+#define PQB_HISTOGRAM_SUB_BUCKET_MAGNITUDE 11 // 2048 sub-buckets, enough for 3 digits
+
+typedef struct {
+    uint64_t *counts;
+    int counts_len;
+    uint64_t highest; // larger values are recorded as this
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+} pqb_histogram;
+
+void pqb_histogram_init(pqb_histogram *h, uint64_t highest);
+void pqb_histogram_free(pqb_histogram *h);
+
+static inline void pqb_histogram_record(pqb_histogram *h, uint64_t value);
+
+// Add every count of src, which must have the same highest value, to dst
+void pqb_histogram_add(pqb_histogram *dst, const pqb_histogram *src);
+
+// Smallest recorded value that q (0..1) of all recorded values are at or
+// below, to the histogram's precision; 0 if nothing was recorded
+uint64_t pqb_histogram_quantile(const pqb_histogram *h, double q);
+
+static inline double pqb_histogram_mean(const pqb_histogram *h) {
+    return h->total ? h->sum / h->total : 0.0;
+}
+
+// The statistics pqb_compute_statistics gives for the recorded values, to the
+// histogram's precision. Values within a bucket count as its midpoint, and
+// without the values to resample the mean CI is the normal approximation.
+void pqb_histogram_statistics(const pqb_histogram *h, const pqb_stats_options *opts, pqb_stats *out);
+
+// Recording is on the hot path of the load generator, so it is inline
+
+#define PQB_HISTOGRAM_SUB_BUCKETS (1 << PQB_HISTOGRAM_SUB_BUCKET_MAGNITUDE)
+#define PQB_HISTOGRAM_HALF_BUCKETS (PQB_HISTOGRAM_SUB_BUCKETS / 2)
+
+static inline int pqb_histogram_index(uint64_t value) {
+    // Bucket 0 holds 0 .. 2047 exactly; bucket b > 0 holds the values below
+    // 2048 << b in 1024 steps of 1 << b
+    int bucket = 64 - __builtin_clzll(value | (PQB_HISTOGRAM_SUB_BUCKETS - 1)) - PQB_HISTOGRAM_SUB_BUCKET_MAGNITUDE;
+    int sub = (int)(value >> bucket);
+    return (bucket << (PQB_HISTOGRAM_SUB_BUCKET_MAGNITUDE - 1)) + sub;
+}
+
+static inline void pqb_histogram_record(pqb_histogram *h, uint64_t value) {
+    if (value > h->highest) {
+        value = h->highest;
+    }
+    h->counts[pqb_histogram_index(value)]++;
+    h->total++;
+    h->sum += (double)value;
+    if (value < h->min) {
+        h->min = value;
+    }
+    if (value > h->max) {
+        h->max = value;
+    }
+}
+
+#endif
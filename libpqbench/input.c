@@ -0,0 +1,43 @@
+#include "input.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+unsigned char *pqb_map_file(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open file %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "Failed to determine the size of %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    *size = st.st_size;
+    if (*size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    // MAP_POPULATE reads the whole file in now rather than on first touch
+    // inside a timed region
+    void *data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Failed to map file %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    return data;
+}
+
+void pqb_unmap_file(unsigned char *data, size_t size) {
+    if (data) {
+        munmap(data, size);
+    }
+}
@@ -0,0 +1,11 @@
+#ifndef PQB_INPUT_H
+#define PQB_INPUT_H
+
+#include <stddef.h>
+
+// Map a whole file read-only with every page faulted in up front, exiting if
+// it cannot be mapped. An empty file gives NULL and a size of 0.
+unsigned char *pqb_map_file(const char *path, size_t *size);
+void pqb_unmap_file(unsigned char *data, size_t size);
+
+#endif
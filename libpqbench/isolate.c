@@ -0,0 +1,117 @@
+#define _GNU_SOURCE
+#include "isolate.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+void pqb_isolation_default(pqb_isolation *iso) {
+    iso->cpu = -1;
+    iso->fifo = 0;
+    iso->lock_memory = 0;
+}
+
+void pqb_isolate(const pqb_isolation *iso) {
+    if (iso->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(iso->cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            fprintf(stderr, "Failed to pin to cpu %d: %s\n", iso->cpu, strerror(errno));
+        }
+    }
+    if (iso->fifo) {
+        struct sched_param param = {.sched_priority = sched_get_priority_min(SCHED_FIFO)};
+        if (sched_setscheduler(0, SCHED_FIFO, &param) != 0) {
+            fprintf(stderr, "Failed to switch to SCHED_FIFO: %s\n", strerror(errno));
+        }
+    }
+    if (iso->lock_memory) {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            fprintf(stderr, "Failed to lock memory: %s\n", strerror(errno));
+        }
+    }
+}
+
+void pqb_pin_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) {
+        fprintf(stderr, "Failed to pin worker to cpu %d: %s\n", cpu, strerror(err));
+        exit(EXIT_FAILURE);
+    }
+}
+
+int pqb_allowed_cpus(int *cpus, int max) {
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        perror("sched_getaffinity");
+        exit(EXIT_FAILURE);
+    }
+    int n = 0;
+    for (int c = 0; c < CPU_SETSIZE && n < max; c++) {
+        if (CPU_ISSET(c, &set)) {
+            cpus[n++] = c;
+        }
+    }
+    return n;
+}
+
+// First line of a sysfs file without its newline, or "" if it is missing
+static void read_sysfs(const char *path, char *buf, size_t size) {
+    buf[0] = '\0';
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return;
+    }
+    if (fgets(buf, size, f)) {
+        buf[strcspn(buf, "\n")] = '\0';
+    }
+    fclose(f);
+}
+
+void pqb_report_host(FILE *out) {
+    char path[128], governor[64], value[16];
+    int cpu = sched_getcpu();
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_governor", cpu < 0 ? 0 : cpu);
+    read_sysfs(path, governor, sizeof(governor));
+
+    // intel_pstate reports no_turbo, acpi-cpufreq and amd-pstate report boost
+    const char *turbo = "unknown";
+    read_sysfs("/sys/devices/system/cpu/intel_pstate/no_turbo", value, sizeof(value));
+    if (value[0]) {
+        turbo = value[0] == '1' ? "off" : "on";
+    } else {
+        read_sysfs("/sys/devices/system/cpu/cpufreq/boost", value, sizeof(value));
+        if (value[0]) {
+            turbo = value[0] == '1' ? "on" : "off";
+        }
+    }
+
+    const char *smt = "unknown";
+    read_sysfs("/sys/devices/system/cpu/smt/active", value, sizeof(value));
+    if (value[0]) {
+        smt = value[0] == '1' ? "on" : "off";
+    }
+
+    int policy = sched_getscheduler(0);
+    fprintf(out, "Host: cpu %d, governor %s, turbo %s, SMT %s, scheduler %s\n", cpu,
+            governor[0] ? governor : "unknown", turbo, smt, policy == SCHED_FIFO ? "FIFO" : "normal");
+
+    if (governor[0] && strcmp(governor, "performance") != 0) {
+        fprintf(stderr, "Warning: cpufreq governor is %s, not performance; the clock may change during the run\n",
+                governor);
+    }
+    if (strcmp(turbo, "on") == 0) {
+        fprintf(stderr, "Warning: turbo is on; results depend on temperature and load on other cores\n");
+    }
+    if (strcmp(smt, "on") == 0) {
+        fprintf(stderr, "Warning: SMT is on; a sibling thread may share the measuring core\n");
+    }
+}
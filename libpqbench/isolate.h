@@ -0,0 +1,31 @@
+#ifndef PQB_ISOLATE_H
+#define PQB_ISOLATE_H
+
+#include <stdio.h>
+
+// Process-level settings that keep the rest of the system out of the
+// measurements. Each one is opt-in; one that cannot be applied is reported
+// on stderr and the run continues without it.
+typedef struct {
+    int cpu;         // pin the measuring thread to this cpu, -1 to leave affinity alone
+    int fifo;        // run it under SCHED_FIFO, ahead of every normal task
+    int lock_memory; // mlockall current and future pages so nothing is paged out
+} pqb_isolation;
+
+void pqb_isolation_default(pqb_isolation *iso);
+
+// Apply iso to the calling thread and the process
+void pqb_isolate(const pqb_isolation *iso);
+
+// Pin the calling thread to cpu, exiting on failure
+void pqb_pin_thread(int cpu);
+
+// The cpus this process may run on, in order, at most max of them
+int pqb_allowed_cpus(int *cpus, int max);
+
+// One line with the frequency governor, turbo and SMT state of the cpu the
+// caller runs on, followed by a warning on stderr for each setting that makes
+// results noisy or host dependent
+void pqb_report_host(FILE *out);
+
+#endif
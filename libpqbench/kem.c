@@ -0,0 +1,675 @@
+#include "families.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#include "keys.h"
+#include "oqs.h"
+
+typedef struct {
+    OSSL_LIB_CTX *libctx;
+    const char *alg;
+    EVP_PKEY *pkey;
+    unsigned char *ciphertext;
+    size_t ciphertext_len;
+    unsigned char *secret_enc;
+    unsigned char *secret_dec;
+    size_t secret_len;
+    // Hot mode only
+    EVP_PKEY_CTX *keygen_ctx;
+    EVP_PKEY_CTX *op_ctx;
+    size_t ciphertext_size;
+    // Leakage mode only
+    unsigned char *inputs; // PQB_LEAKAGE_BLOCK ciphertexts of ciphertext_len bytes
+    const unsigned char *input; // the one decapsulated
+} kem_state;
+
+static void kem_release(kem_state *st) {
+    EVP_PKEY_free(st->pkey);
+    OPENSSL_free(st->ciphertext);
+    OPENSSL_free(st->secret_enc);
+    OPENSSL_free(st->secret_dec);
+    st->pkey = NULL;
+    st->ciphertext = NULL;
+    st->secret_enc = NULL;
+    st->secret_dec = NULL;
+}
+
+static void *kem_create(pqb_bench *bench, const char *alg) {
+    kem_state *st = calloc(1, sizeof(*st));
+    if (!st) {
+        fprintf(stderr, "Failed to allocate KEM state for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    st->libctx = bench->libctx;
+    st->alg = alg;
+    return st;
+}
+
+static void kem_destroy(void *state) {
+    kem_release(state);
+    free(state);
+}
+
+static void kem_keygen(void *state) {
+    kem_state *st = state;
+    st->pkey = pqb_generate_key(st->libctx, st->alg);
+}
+
+// Encapsulate a fresh secret against the public key
+static void kem_encapsulate(void *state) {
+    kem_state *st = state;
+
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_from_pkey(st->libctx, st->pkey, NULL);
+    if (!ctx) {
+        fprintf(stderr, "Failed to create EVP_PKEY_CTX for encapsulation\n");
+        exit(EXIT_FAILURE);
+    }
+    if (EVP_PKEY_encapsulate_init(ctx, NULL) <= 0) {
+        fprintf(stderr, "Failed to initialize encapsulation\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Get lengths for output and secret
+    if (EVP_PKEY_encapsulate(ctx, NULL, &st->ciphertext_len, NULL, &st->secret_len) <= 0) {
+        fprintf(stderr, "Failed to determine output lengths\n");
+        exit(EXIT_FAILURE);
+    }
+
+    st->ciphertext = OPENSSL_malloc(st->ciphertext_len);
+    st->secret_enc = OPENSSL_malloc(st->secret_len);
+    if (!st->ciphertext || !st->secret_enc) {
+        fprintf(stderr, "Failed to allocate memory for encapsulation\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (EVP_PKEY_encapsulate(ctx, st->ciphertext, &st->ciphertext_len, st->secret_enc, &st->secret_len) <= 0) {
+        fprintf(stderr, "Failed to encapsulate key\n");
+        exit(EXIT_FAILURE);
+    }
+
+    EVP_PKEY_CTX_free(ctx);
+}
+
+static void kem_prepare_decapsulate(void *state) {
+    kem_state *st = state;
+    st->secret_dec = OPENSSL_malloc(st->secret_len);
+    if (!st->secret_dec) {
+        fprintf(stderr, "Failed to allocate memory for decapsulation\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Recover the secret from the ciphertext with the private key
+static void kem_decapsulate(void *state) {
+    kem_state *st = state;
+    size_t secret_len = st->secret_len;
+
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_from_pkey(st->libctx, st->pkey, NULL);
+    if (!ctx) {
+        fprintf(stderr, "Failed to create EVP_PKEY_CTX for decapsulation\n");
+        exit(EXIT_FAILURE);
+    }
+    if (EVP_PKEY_decapsulate_init(ctx, NULL) <= 0) {
+        fprintf(stderr, "Failed to initialize decapsulation\n");
+        exit(EXIT_FAILURE);
+    }
+    if (EVP_PKEY_decapsulate(ctx, st->secret_dec, &secret_len, st->ciphertext, st->ciphertext_len) <= 0) {
+        fprintf(stderr, "Failed to decapsulate key\n");
+        exit(EXIT_FAILURE);
+    }
+
+    EVP_PKEY_CTX_free(ctx);
+}
+
+static void kem_finish_iteration(void *state) {
+    kem_release(state);
+}
+
+static const pqb_op kem_ops[] = {
+    {"keygen", "Key generation", NULL, kem_keygen, NULL, 0},
+    {"encapsulation", "Encapsulation", NULL, kem_encapsulate, NULL, 0},
+    {"decapsulation", "Decapsulation", kem_prepare_decapsulate, kem_decapsulate, kem_finish_iteration, 0},
+};
+
+#if PQB_HAVE_LIBOQS
+// The liboqs backend of a comparison: the same three ops through OQS_KEM
+// alone, into buffers allocated once
+
+typedef struct {
+    const char *alg;
+    OQS_KEM *kem;
+    uint8_t *public_key;
+    uint8_t *secret_key;
+    uint8_t *ciphertext;
+    uint8_t *secret_enc;
+    uint8_t *secret_dec;
+} kem_oqs_state;
+
+static void *kem_liboqs_create(pqb_bench *bench, const char *alg) {
+    (void)bench;
+    kem_oqs_state *st = calloc(1, sizeof(*st));
+    if (!st) {
+        fprintf(stderr, "Failed to allocate KEM state for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    st->alg = alg;
+    const char *oqs_name = pqb_oqs_kem_name(alg);
+    st->kem = oqs_name ? OQS_KEM_new(oqs_name) : NULL;
+    if (!st->kem) {
+        fprintf(stderr, "liboqs has no KEM matching %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    st->public_key = OPENSSL_malloc(st->kem->length_public_key);
+    st->secret_key = OPENSSL_malloc(st->kem->length_secret_key);
+    st->ciphertext = OPENSSL_malloc(st->kem->length_ciphertext);
+    st->secret_enc = OPENSSL_malloc(st->kem->length_shared_secret);
+    st->secret_dec = OPENSSL_malloc(st->kem->length_shared_secret);
+    if (!st->public_key || !st->secret_key || !st->ciphertext || !st->secret_enc || !st->secret_dec) {
+        fprintf(stderr, "Failed to allocate liboqs buffers for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    return st;
+}
+
+static void kem_liboqs_destroy(void *state) {
+    kem_oqs_state *st = state;
+    OPENSSL_free(st->public_key);
+    OPENSSL_clear_free(st->secret_key, st->kem->length_secret_key);
+    OPENSSL_free(st->ciphertext);
+    OPENSSL_free(st->secret_enc);
+    OPENSSL_free(st->secret_dec);
+    OQS_KEM_free(st->kem);
+    free(st);
+}
+
+static void kem_oqs_keygen(void *state) {
+    kem_oqs_state *st = state;
+    if (OQS_KEM_keypair(st->kem, st->public_key, st->secret_key) != OQS_SUCCESS) {
+        fprintf(stderr, "Failed to generate key pair for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void kem_oqs_encapsulate(void *state) {
+    kem_oqs_state *st = state;
+    if (OQS_KEM_encaps(st->kem, st->ciphertext, st->secret_enc, st->public_key) != OQS_SUCCESS) {
+        fprintf(stderr, "Failed to encapsulate key\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void kem_oqs_decapsulate(void *state) {
+    kem_oqs_state *st = state;
+    if (OQS_KEM_decaps(st->kem, st->secret_dec, st->ciphertext, st->secret_key) != OQS_SUCCESS) {
+        fprintf(stderr, "Failed to decapsulate key\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static const pqb_op kem_liboqs_ops[] = {
+    {"keygen", "Key generation (liboqs)", NULL, kem_oqs_keygen, NULL, 0},
+    {"encapsulation", "Encapsulation (liboqs)", NULL, kem_oqs_encapsulate, NULL, 0},
+    {"decapsulation", "Decapsulation (liboqs)", NULL, kem_oqs_decapsulate, NULL, 0},
+};
+
+static const pqb_family kem_liboqs_family = {
+    .name = "kem_liboqs",
+    .ops = kem_liboqs_ops,
+    .num_ops = sizeof(kem_liboqs_ops) / sizeof(kem_liboqs_ops[0]),
+    .create = kem_liboqs_create,
+    .destroy = kem_liboqs_destroy,
+};
+#endif
+
+// Hot mode: the keygen context is fetched once, the per-key
+// encapsulation and decapsulation contexts are built in prepare and the
+// output buffers are allocated once, so only the primitives are timed
+
+static void *kem_hot_create(pqb_bench *bench, const char *alg) {
+    kem_state *st = kem_create(bench, alg);
+    st->keygen_ctx = pqb_keygen_ctx_new(st->libctx, alg);
+    return st;
+}
+
+static void kem_hot_destroy(void *state) {
+    kem_state *st = state;
+    EVP_PKEY_CTX_free(st->op_ctx);
+    EVP_PKEY_CTX_free(st->keygen_ctx);
+    kem_destroy(st);
+}
+
+static void kem_hot_keygen(void *state) {
+    kem_state *st = state;
+    if (EVP_PKEY_generate(st->keygen_ctx, &st->pkey) <= 0) {
+        fprintf(stderr, "Failed to generate key pair for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void kem_hot_prepare_encapsulate(void *state) {
+    kem_state *st = state;
+
+    st->op_ctx = EVP_PKEY_CTX_new_from_pkey(st->libctx, st->pkey, NULL);
+    if (!st->op_ctx || EVP_PKEY_encapsulate_init(st->op_ctx, NULL) <= 0) {
+        fprintf(stderr, "Failed to initialize encapsulation\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (!st->ciphertext) {
+        if (EVP_PKEY_encapsulate(st->op_ctx, NULL, &st->ciphertext_size, NULL, &st->secret_len) <= 0) {
+            fprintf(stderr, "Failed to determine output lengths\n");
+            exit(EXIT_FAILURE);
+        }
+        st->ciphertext = OPENSSL_malloc(st->ciphertext_size);
+        st->secret_enc = OPENSSL_malloc(st->secret_len);
+        st->secret_dec = OPENSSL_malloc(st->secret_len);
+        if (!st->ciphertext || !st->secret_enc || !st->secret_dec) {
+            fprintf(stderr, "Failed to allocate memory for encapsulation\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    st->ciphertext_len = st->ciphertext_size;
+}
+
+static void kem_hot_encapsulate(void *state) {
+    kem_state *st = state;
+    size_t secret_len = st->secret_len;
+    if (EVP_PKEY_encapsulate(st->op_ctx, st->ciphertext, &st->ciphertext_len, st->secret_enc, &secret_len) <= 0) {
+        fprintf(stderr, "Failed to encapsulate key\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void kem_hot_prepare_decapsulate(void *state) {
+    kem_state *st = state;
+
+    // Same key, so the context just set up for encapsulation is re-initialised
+    if (EVP_PKEY_decapsulate_init(st->op_ctx, NULL) <= 0) {
+        fprintf(stderr, "Failed to initialize decapsulation\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void kem_hot_decapsulate(void *state) {
+    kem_state *st = state;
+    size_t secret_len = st->secret_len;
+    if (EVP_PKEY_decapsulate(st->op_ctx, st->secret_dec, &secret_len, st->ciphertext, st->ciphertext_len) <= 0) {
+        fprintf(stderr, "Failed to decapsulate key\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void kem_hot_finish_iteration(void *state) {
+    kem_state *st = state;
+    EVP_PKEY_CTX_free(st->op_ctx);
+    EVP_PKEY_free(st->pkey);
+    st->op_ctx = NULL;
+    st->pkey = NULL;
+}
+
+static const pqb_op kem_hot_ops[] = {
+    {"keygen_hot", "Key generation (hot)", NULL, kem_hot_keygen, NULL, 0},
+    {"encapsulation_hot", "Encapsulation (hot)", kem_hot_prepare_encapsulate, kem_hot_encapsulate, NULL, 0},
+    {"decapsulation_hot", "Decapsulation (hot)", kem_hot_prepare_decapsulate, kem_hot_decapsulate,
+     kem_hot_finish_iteration, 0},
+};
+
+static const pqb_family kem_hot_family = {
+    .name = "kem_hot",
+    .ops = kem_hot_ops,
+    .num_ops = sizeof(kem_hot_ops) / sizeof(kem_hot_ops[0]),
+    .create = kem_hot_create,
+    .destroy = kem_hot_destroy,
+    .algorithms = PQB_ALGS_KEM,
+#if PQB_HAVE_LIBOQS
+    .liboqs = &kem_liboqs_family,
+#endif
+};
+
+// Leakage mode decapsulates, with hot mode's contexts and one key, either
+// a valid ciphertext or random bytes of the same length. Only the timing is
+// of interest, so a random ciphertext that is rejected outright, as one
+// that is not a valid point of a hybrid's classical half is, still counts.
+
+static void *kem_leakage_create(pqb_bench *bench, const char *alg) {
+    kem_state *st = kem_hot_create(bench, alg);
+    kem_hot_keygen(st);
+    kem_hot_prepare_encapsulate(st);
+    kem_hot_encapsulate(st);
+    kem_hot_prepare_decapsulate(st);
+    st->inputs = OPENSSL_malloc(PQB_LEAKAGE_BLOCK * st->ciphertext_len);
+    if (!st->inputs) {
+        fprintf(stderr, "Failed to allocate memory for ciphertexts\n");
+        exit(EXIT_FAILURE);
+    }
+    return st;
+}
+
+static void kem_leakage_destroy(void *state) {
+    kem_state *st = state;
+    OPENSSL_free(st->inputs);
+    kem_hot_destroy(st);
+}
+
+// The valid class is a copy of the ciphertext encapsulated at creation
+static void kem_leakage_make_input(void *state, int slot, int input_class) {
+    kem_state *st = state;
+    unsigned char *ciphertext = st->inputs + slot * st->ciphertext_len;
+    if (input_class == 0) {
+        memcpy(ciphertext, st->ciphertext, st->ciphertext_len);
+    } else if (RAND_bytes(ciphertext, (int)st->ciphertext_len) != 1) {
+        fprintf(stderr, "Failed to generate a random ciphertext\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void kem_leakage_use_input(void *state, int slot) {
+    kem_state *st = state;
+    st->input = st->inputs + slot * st->ciphertext_len;
+}
+
+static void kem_leakage_decapsulate(void *state) {
+    kem_state *st = state;
+    size_t secret_len = st->secret_len;
+    EVP_PKEY_decapsulate(st->op_ctx, st->secret_dec, &secret_len, st->input, st->ciphertext_len);
+}
+
+static const pqb_op kem_leakage_ops[] = {
+    {"decapsulation", "Decapsulation", NULL, kem_leakage_decapsulate, NULL, 0},
+};
+
+static const pqb_family kem_leakage_family = {
+    .name = "kem_leakage",
+    .ops = kem_leakage_ops,
+    .num_ops = sizeof(kem_leakage_ops) / sizeof(kem_leakage_ops[0]),
+    .create = kem_leakage_create,
+    .destroy = kem_leakage_destroy,
+    .make_input = kem_leakage_make_input,
+    .use_input = kem_leakage_use_input,
+    .input_classes = {"valid ciphertext", "random ciphertext"},
+};
+
+// Load mode decapsulates, as a server answering key shares does, one valid
+// ciphertext with one key over and over, on leakage mode's state
+
+static const pqb_op kem_load_ops[] = {
+    {"decapsulation", "Decapsulation", NULL, kem_hot_decapsulate, NULL, 0},
+};
+
+static const pqb_family kem_load_family = {
+    .name = "kem_load",
+    .ops = kem_load_ops,
+    .num_ops = sizeof(kem_load_ops) / sizeof(kem_load_ops[0]),
+    .create = kem_leakage_create,
+    .destroy = kem_leakage_destroy,
+};
+
+// Batch mode: every run generates batch_size keys, encapsulates against each
+// of them into one contiguous ciphertext buffer and decapsulates them all, so
+// a sample is the cost of the whole batch. Contexts are handled as in hot
+// mode. With liboqs the same batches also go through the raw OQS_KEM API,
+// which shows what the provider layer costs per operation.
+
+typedef struct {
+    OSSL_LIB_CTX *libctx;
+    const char *alg;
+    int batch_size;
+    EVP_PKEY_CTX *keygen_ctx;
+    EVP_PKEY **pkeys;
+    EVP_PKEY_CTX **ctxs;
+    unsigned char *ciphertexts; // batch_size * ciphertext_len bytes
+    unsigned char *secrets_enc; // batch_size * secret_len bytes
+    unsigned char *secrets_dec;
+    size_t ciphertext_len;
+    size_t secret_len;
+#if PQB_HAVE_LIBOQS
+    OQS_KEM *oqs;
+    uint8_t *oqs_public_keys;
+    uint8_t *oqs_secret_keys;
+    uint8_t *oqs_ciphertexts;
+    uint8_t *oqs_secrets_enc;
+    uint8_t *oqs_secrets_dec;
+#endif
+} kem_batch_state;
+
+static void *batch_alloc(size_t count, size_t size) {
+    void *p = OPENSSL_zalloc(count * size);
+    if (!p) {
+        fprintf(stderr, "Failed to allocate memory for a batch of %zu\n", count);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void *kem_batch_create(pqb_bench *bench, const char *alg) {
+    kem_batch_state *st = batch_alloc(1, sizeof(*st));
+    size_t k = bench->batch_size;
+    st->libctx = bench->libctx;
+    st->alg = alg;
+    st->batch_size = bench->batch_size;
+    st->keygen_ctx = pqb_keygen_ctx_new(st->libctx, alg);
+
+    // Output lengths from one throwaway key, outside any timed region
+    EVP_PKEY *pkey = NULL;
+    EVP_PKEY_CTX *ctx = NULL;
+    if (EVP_PKEY_generate(st->keygen_ctx, &pkey) <= 0 ||
+        !(ctx = EVP_PKEY_CTX_new_from_pkey(st->libctx, pkey, NULL)) || EVP_PKEY_encapsulate_init(ctx, NULL) <= 0 ||
+        EVP_PKEY_encapsulate(ctx, NULL, &st->ciphertext_len, NULL, &st->secret_len) <= 0) {
+        fprintf(stderr, "Failed to determine output lengths for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    EVP_PKEY_CTX_free(ctx);
+    EVP_PKEY_free(pkey);
+
+    st->pkeys = batch_alloc(k, sizeof(EVP_PKEY *));
+    st->ctxs = batch_alloc(k, sizeof(EVP_PKEY_CTX *));
+    st->ciphertexts = batch_alloc(k, st->ciphertext_len);
+    st->secrets_enc = batch_alloc(k, st->secret_len);
+    st->secrets_dec = batch_alloc(k, st->secret_len);
+
+#if PQB_HAVE_LIBOQS
+    // Only the batch family's liboqs ops use these, see kem_batch_resolve
+    const char *oqs_name = pqb_oqs_kem_name(alg);
+    st->oqs = oqs_name ? OQS_KEM_new(oqs_name) : NULL;
+    if (!st->oqs) {
+        return st;
+    }
+    st->oqs_public_keys = batch_alloc(k, st->oqs->length_public_key);
+    st->oqs_secret_keys = batch_alloc(k, st->oqs->length_secret_key);
+    st->oqs_ciphertexts = batch_alloc(k, st->oqs->length_ciphertext);
+    st->oqs_secrets_enc = batch_alloc(k, st->oqs->length_shared_secret);
+    st->oqs_secrets_dec = batch_alloc(k, st->oqs->length_shared_secret);
+#endif
+    return st;
+}
+
+static void kem_batch_release(kem_batch_state *st) {
+    for (int i = 0; i < st->batch_size; i++) {
+        EVP_PKEY_CTX_free(st->ctxs[i]);
+        EVP_PKEY_free(st->pkeys[i]);
+        st->ctxs[i] = NULL;
+        st->pkeys[i] = NULL;
+    }
+}
+
+static void kem_batch_destroy(void *state) {
+    kem_batch_state *st = state;
+    kem_batch_release(st);
+    EVP_PKEY_CTX_free(st->keygen_ctx);
+    OPENSSL_free(st->pkeys);
+    OPENSSL_free(st->ctxs);
+    OPENSSL_free(st->ciphertexts);
+    OPENSSL_free(st->secrets_enc);
+    OPENSSL_free(st->secrets_dec);
+#if PQB_HAVE_LIBOQS
+    if (st->oqs) {
+        OPENSSL_clear_free(st->oqs_secret_keys, st->batch_size * st->oqs->length_secret_key);
+        OPENSSL_free(st->oqs_public_keys);
+        OPENSSL_free(st->oqs_ciphertexts);
+        OPENSSL_free(st->oqs_secrets_enc);
+        OPENSSL_free(st->oqs_secrets_dec);
+        OQS_KEM_free(st->oqs);
+    }
+#endif
+    OPENSSL_free(st);
+}
+
+static void kem_batch_keygen(void *state) {
+    kem_batch_state *st = state;
+    for (int i = 0; i < st->batch_size; i++) {
+        if (EVP_PKEY_generate(st->keygen_ctx, &st->pkeys[i]) <= 0) {
+            fprintf(stderr, "Failed to generate key pair for %s\n", st->alg);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void kem_batch_prepare_encapsulate(void *state) {
+    kem_batch_state *st = state;
+    for (int i = 0; i < st->batch_size; i++) {
+        st->ctxs[i] = EVP_PKEY_CTX_new_from_pkey(st->libctx, st->pkeys[i], NULL);
+        if (!st->ctxs[i] || EVP_PKEY_encapsulate_init(st->ctxs[i], NULL) <= 0) {
+            fprintf(stderr, "Failed to initialize encapsulation\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void kem_batch_encapsulate(void *state) {
+    kem_batch_state *st = state;
+    for (int i = 0; i < st->batch_size; i++) {
+        size_t ciphertext_len = st->ciphertext_len;
+        size_t secret_len = st->secret_len;
+        if (EVP_PKEY_encapsulate(st->ctxs[i], st->ciphertexts + i * st->ciphertext_len, &ciphertext_len,
+                                 st->secrets_enc + i * st->secret_len, &secret_len) <= 0) {
+            fprintf(stderr, "Failed to encapsulate key\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void kem_batch_prepare_decapsulate(void *state) {
+    kem_batch_state *st = state;
+    for (int i = 0; i < st->batch_size; i++) {
+        if (EVP_PKEY_decapsulate_init(st->ctxs[i], NULL) <= 0) {
+            fprintf(stderr, "Failed to initialize decapsulation\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void kem_batch_decapsulate(void *state) {
+    kem_batch_state *st = state;
+    for (int i = 0; i < st->batch_size; i++) {
+        size_t secret_len = st->secret_len;
+        if (EVP_PKEY_decapsulate(st->ctxs[i], st->secrets_dec + i * st->secret_len, &secret_len,
+                                 st->ciphertexts + i * st->ciphertext_len, st->ciphertext_len) <= 0) {
+            fprintf(stderr, "Failed to decapsulate key\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void kem_batch_finish_iteration(void *state) {
+    kem_batch_release(state);
+}
+
+#if PQB_HAVE_LIBOQS
+static void kem_oqs_batch_keygen(void *state) {
+    kem_batch_state *st = state;
+    const OQS_KEM *kem = st->oqs;
+    for (int i = 0; i < st->batch_size; i++) {
+        if (OQS_KEM_keypair(kem, st->oqs_public_keys + i * kem->length_public_key,
+                            st->oqs_secret_keys + i * kem->length_secret_key) != OQS_SUCCESS) {
+            fprintf(stderr, "Failed to generate key pair for %s\n", st->alg);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void kem_oqs_batch_encapsulate(void *state) {
+    kem_batch_state *st = state;
+    const OQS_KEM *kem = st->oqs;
+    for (int i = 0; i < st->batch_size; i++) {
+        if (OQS_KEM_encaps(kem, st->oqs_ciphertexts + i * kem->length_ciphertext,
+                           st->oqs_secrets_enc + i * kem->length_shared_secret,
+                           st->oqs_public_keys + i * kem->length_public_key) != OQS_SUCCESS) {
+            fprintf(stderr, "Failed to encapsulate key\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void kem_oqs_batch_decapsulate(void *state) {
+    kem_batch_state *st = state;
+    const OQS_KEM *kem = st->oqs;
+    for (int i = 0; i < st->batch_size; i++) {
+        if (OQS_KEM_decaps(kem, st->oqs_secrets_dec + i * kem->length_shared_secret,
+                           st->oqs_ciphertexts + i * kem->length_ciphertext,
+                           st->oqs_secret_keys + i * kem->length_secret_key) != OQS_SUCCESS) {
+            fprintf(stderr, "Failed to decapsulate key\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+#endif
+
+static const pqb_op kem_batch_ops[] = {
+    {"keygen_batch", "Key generation (batch)", NULL, kem_batch_keygen, NULL, 1},
+    {"encapsulation_batch", "Encapsulation (batch)", kem_batch_prepare_encapsulate, kem_batch_encapsulate, NULL, 1},
+    {"decapsulation_batch", "Decapsulation (batch)", kem_batch_prepare_decapsulate, kem_batch_decapsulate,
+     kem_batch_finish_iteration, 1},
+#if PQB_HAVE_LIBOQS
+    {"keygen_batch_liboqs", "Key generation (batch, liboqs)", NULL, kem_oqs_batch_keygen, NULL, 1},
+    {"encapsulation_batch_liboqs", "Encapsulation (batch, liboqs)", NULL, kem_oqs_batch_encapsulate, NULL, 1},
+    {"decapsulation_batch_liboqs", "Decapsulation (batch, liboqs)", NULL, kem_oqs_batch_decapsulate, NULL, 1},
+#endif
+};
+
+#if PQB_HAVE_LIBOQS
+// The EVP batches alone, for hybrids and any other KEM liboqs does not have
+static const pqb_family kem_evp_batch_family = {
+    .name = "kem_batch",
+    .ops = kem_batch_ops,
+    .num_ops = 3,
+    .create = kem_batch_create,
+    .destroy = kem_batch_destroy,
+};
+
+static const pqb_family kem_batch_family;
+
+static const pqb_family *kem_batch_resolve(const char *alg) {
+    return pqb_oqs_kem_name(alg) ? &kem_batch_family : &kem_evp_batch_family;
+}
+#endif
+
+static const pqb_family kem_batch_family = {
+    .name = "kem_batch",
+    .ops = kem_batch_ops,
+    .num_ops = sizeof(kem_batch_ops) / sizeof(kem_batch_ops[0]),
+    .create = kem_batch_create,
+    .destroy = kem_batch_destroy,
+#if PQB_HAVE_LIBOQS
+    .resolve = kem_batch_resolve,
+#endif
+};
+
+const pqb_family pqb_kem_family = {
+    .name = "kem",
+    .ops = kem_ops,
+    .num_ops = sizeof(kem_ops) / sizeof(kem_ops[0]),
+    .create = kem_create,
+    .destroy = kem_destroy,
+    .hot = &kem_hot_family,
+    .batch = &kem_batch_family,
+    .leakage = &kem_leakage_family,
+    .load = &kem_load_family,
+    .algorithms = PQB_ALGS_KEM,
+#if PQB_HAVE_LIBOQS
+    .liboqs = &kem_liboqs_family,
+#endif
+};
@@ -0,0 +1,205 @@
+#include "families.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+
+#include "keys.h"
+
+#define MAX_SECRET_LEN 256
+
+// Both sides of one key exchange. The initiator's key share is a public
+// key; the responder answers with its own public key (ECDH) or with a
+// ciphertext (KEM, including oqsprovider's hybrid groups such as
+// x25519_kyber768, which combine both inside one KEM).
+typedef struct {
+    OSSL_LIB_CTX *libctx;
+    const char *alg;
+    EVP_PKEY *initiator;
+    EVP_PKEY *responder;
+    unsigned char secret_initiator[MAX_SECRET_LEN];
+    unsigned char secret_responder[MAX_SECRET_LEN];
+    size_t secret_len;
+    unsigned char *ciphertext;
+    size_t ciphertext_len;
+    size_t wire_bytes;
+    size_t responder_bytes;
+} kex_state;
+
+static void *kex_create(pqb_bench *bench, const char *alg) {
+    kex_state *st = calloc(1, sizeof(*st));
+    if (!st) {
+        fprintf(stderr, "Failed to allocate key exchange state for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    st->libctx = bench->libctx;
+    st->alg = alg;
+    return st;
+}
+
+static void kex_release(kex_state *st) {
+    EVP_PKEY_free(st->initiator);
+    EVP_PKEY_free(st->responder);
+    OPENSSL_free(st->ciphertext);
+    st->initiator = NULL;
+    st->responder = NULL;
+    st->ciphertext = NULL;
+}
+
+static void kex_destroy(void *state) {
+    kex_release(state);
+    free(state);
+}
+
+static size_t kex_wire_bytes(void *state) {
+    kex_state *st = state;
+    return st->wire_bytes;
+}
+
+static size_t kex_responder_bytes(void *state) {
+    kex_state *st = state;
+    return st->responder_bytes;
+}
+
+static size_t encoded_public_key_len(EVP_PKEY *pkey) {
+    unsigned char *encoded = NULL;
+    size_t len = EVP_PKEY_get1_encoded_public_key(pkey, &encoded);
+    OPENSSL_free(encoded);
+    return len;
+}
+
+// Both secrets must agree; checked outside the timed region
+static void kex_check(kex_state *st) {
+    if (memcmp(st->secret_initiator, st->secret_responder, st->secret_len) != 0) {
+        fprintf(stderr, "Shared secrets of %s do not match\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void kex_keygen_initiator(void *state) {
+    kex_state *st = state;
+    st->initiator = pqb_generate_key(st->libctx, st->alg);
+}
+
+static void kex_keygen_responder(void *state) {
+    kex_state *st = state;
+    st->responder = pqb_generate_key(st->libctx, st->alg);
+}
+
+static size_t ecdh_derive(kex_state *st, EVP_PKEY *own, EVP_PKEY *peer, unsigned char *secret) {
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_from_pkey(st->libctx, own, NULL);
+    if (!ctx || EVP_PKEY_derive_init(ctx) <= 0 || EVP_PKEY_derive_set_peer(ctx, peer) <= 0) {
+        fprintf(stderr, "Failed to initialize key derivation for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    size_t len = MAX_SECRET_LEN;
+    if (EVP_PKEY_derive(ctx, secret, &len) <= 0) {
+        fprintf(stderr, "Failed to derive the shared secret for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    EVP_PKEY_CTX_free(ctx);
+    return len;
+}
+
+static void ecdh_derive_initiator(void *state) {
+    kex_state *st = state;
+    st->secret_len = ecdh_derive(st, st->initiator, st->responder, st->secret_initiator);
+}
+
+static void ecdh_derive_responder(void *state) {
+    kex_state *st = state;
+    ecdh_derive(st, st->responder, st->initiator, st->secret_responder);
+}
+
+static void ecdh_finish_iteration(void *state) {
+    kex_state *st = state;
+    kex_check(st);
+    st->responder_bytes = encoded_public_key_len(st->responder);
+    st->wire_bytes = encoded_public_key_len(st->initiator) + st->responder_bytes;
+    kex_release(st);
+}
+
+static const pqb_op ecdh_ops[] = {
+    {"keygen_initiator", "Key generation (initiator)", NULL, kex_keygen_initiator, NULL, 0},
+    {"keygen_responder", "Key generation (responder)", NULL, kex_keygen_responder, NULL, 0},
+    {"derive_initiator", "Derive (initiator)", NULL, ecdh_derive_initiator, NULL, 0},
+    {"derive_responder", "Derive (responder)", NULL, ecdh_derive_responder, ecdh_finish_iteration, 0},
+};
+
+const pqb_family pqb_ecdh_handshake_family = {
+    .name = "ecdh_handshake",
+    .ops = ecdh_ops,
+    .num_ops = sizeof(ecdh_ops) / sizeof(ecdh_ops[0]),
+    .create = kex_create,
+    .destroy = kex_destroy,
+    .handshake = 1,
+    .wire_bytes = kex_wire_bytes,
+    .responder_bytes = kex_responder_bytes,
+};
+
+// The responder encapsulates against the initiator's public key share
+static void kem_handshake_encapsulate(void *state) {
+    kex_state *st = state;
+
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_from_pkey(st->libctx, st->initiator, NULL);
+    if (!ctx || EVP_PKEY_encapsulate_init(ctx, NULL) <= 0) {
+        fprintf(stderr, "Failed to initialize encapsulation for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    if (EVP_PKEY_encapsulate(ctx, NULL, &st->ciphertext_len, NULL, &st->secret_len) <= 0 ||
+        st->secret_len > MAX_SECRET_LEN) {
+        fprintf(stderr, "Failed to determine output lengths for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    st->ciphertext = OPENSSL_malloc(st->ciphertext_len);
+    if (!st->ciphertext ||
+        EVP_PKEY_encapsulate(ctx, st->ciphertext, &st->ciphertext_len, st->secret_responder, &st->secret_len) <= 0) {
+        fprintf(stderr, "Failed to encapsulate key for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    EVP_PKEY_CTX_free(ctx);
+}
+
+static void kem_handshake_decapsulate(void *state) {
+    kex_state *st = state;
+    size_t secret_len = st->secret_len;
+
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_from_pkey(st->libctx, st->initiator, NULL);
+    if (!ctx || EVP_PKEY_decapsulate_init(ctx, NULL) <= 0) {
+        fprintf(stderr, "Failed to initialize decapsulation for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    if (EVP_PKEY_decapsulate(ctx, st->secret_initiator, &secret_len, st->ciphertext, st->ciphertext_len) <= 0) {
+        fprintf(stderr, "Failed to decapsulate key for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    EVP_PKEY_CTX_free(ctx);
+}
+
+static void kem_handshake_finish_iteration(void *state) {
+    kex_state *st = state;
+    kex_check(st);
+    st->responder_bytes = st->ciphertext_len;
+    st->wire_bytes = encoded_public_key_len(st->initiator) + st->responder_bytes;
+    kex_release(st);
+}
+
+static const pqb_op kem_handshake_ops[] = {
+    {"keygen_initiator", "Key generation (initiator)", NULL, kex_keygen_initiator, NULL, 0},
+    {"encapsulation_responder", "Encapsulation (responder)", NULL, kem_handshake_encapsulate, NULL, 0},
+    {"decapsulation_initiator", "Decapsulation (initiator)", NULL, kem_handshake_decapsulate,
+     kem_handshake_finish_iteration, 0},
+};
+
+const pqb_family pqb_kem_handshake_family = {
+    .name = "kem_handshake",
+    .ops = kem_handshake_ops,
+    .num_ops = sizeof(kem_handshake_ops) / sizeof(kem_handshake_ops[0]),
+    .create = kex_create,
+    .destroy = kex_destroy,
+    .handshake = 1,
+    .wire_bytes = kex_wire_bytes,
+    .responder_bytes = kex_responder_bytes,
+    .algorithms = PQB_ALGS_KEM,
+};
@@ -0,0 +1,174 @@
+#include "keys.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <openssl/ec.h>
+#include <openssl/objects.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+
+static int is_ec_curve(const char *name) {
+    int nid = OBJ_sn2nid(name);
+    if (nid == NID_undef) {
+        return 0;
+    }
+    EC_GROUP *group = EC_GROUP_new_by_curve_name(nid);
+    EC_GROUP_free(group);
+    return group != NULL;
+}
+
+// Key type the provider has to implement for alg
+static const char *key_type(const char *alg) {
+    if (strncmp(alg, "RSA", 3) == 0) {
+        return "RSA";
+    }
+    if (is_ec_curve(alg)) {
+        return "EC";
+    }
+    return alg;
+}
+
+int pqb_key_type_builtin(const char *alg) {
+    static const char *const ecx[] = {"X25519", "X448", "ED25519", "ED448"};
+    if (strncmp(alg, "RSA", 3) == 0 || is_ec_curve(alg)) {
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(ecx) / sizeof(ecx[0]); i++) {
+        if (strcasecmp(alg, ecx[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int pqb_key_type_available(OSSL_LIB_CTX *libctx, const char *alg) {
+    EVP_KEYMGMT *keymgmt = EVP_KEYMGMT_fetch(libctx, key_type(alg), NULL);
+    EVP_KEYMGMT_free(keymgmt);
+    return keymgmt != NULL;
+}
+
+EVP_PKEY_CTX *pqb_keygen_ctx_new(OSSL_LIB_CTX *libctx, const char *alg) {
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_from_name(libctx, key_type(alg), NULL);
+    if (!ctx) {
+        fprintf(stderr, "Failed to create EVP_PKEY_CTX for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+
+    if (EVP_PKEY_keygen_init(ctx) <= 0) {
+        fprintf(stderr, "Failed to initialize keygen for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+
+    if (strncmp(alg, "RSA", 3) == 0) {
+        int bits = 2048;
+        if (alg[3] == '-') {
+            bits = atoi(alg + 4);
+        }
+        if (EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, bits) <= 0) {
+            fprintf(stderr, "Failed to set RSA key size\n");
+            exit(EXIT_FAILURE);
+        }
+    } else if (is_ec_curve(alg)) {
+        if (EVP_PKEY_CTX_set_group_name(ctx, alg) <= 0) {
+            fprintf(stderr, "Failed to set EC curve %s\n", alg);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    return ctx;
+}
+
+EVP_PKEY *pqb_generate_key(OSSL_LIB_CTX *libctx, const char *alg) {
+    EVP_PKEY_CTX *ctx = pqb_keygen_ctx_new(libctx, alg);
+    EVP_PKEY *pkey = NULL;
+
+    if (EVP_PKEY_generate(ctx, &pkey) <= 0) {
+        fprintf(stderr, "Failed to generate key pair for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+
+    EVP_PKEY_CTX_free(ctx);
+    return pkey;
+}
+
+typedef struct {
+    OSSL_LIB_CTX *libctx;
+    char alg[256];
+    EVP_PKEY *pkey;
+} cached_key;
+
+struct pqb_key_cache {
+    pthread_mutex_t lock;
+    cached_key *keys;
+    int count;
+    int capacity;
+};
+
+pqb_key_cache *pqb_key_cache_new(void) {
+    pqb_key_cache *cache = calloc(1, sizeof(*cache));
+    if (!cache) {
+        fprintf(stderr, "Failed to allocate the key cache\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+void pqb_key_cache_free(pqb_key_cache *cache) {
+    if (!cache) {
+        return;
+    }
+    for (int k = 0; k < cache->count; k++) {
+        EVP_PKEY_free(cache->keys[k].pkey);
+    }
+    free(cache->keys);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+EVP_PKEY *pqb_key_cache_get(pqb_key_cache *cache, OSSL_LIB_CTX *libctx, const char *alg) {
+    if (!cache) {
+        return pqb_generate_key(libctx, alg);
+    }
+    // Held while generating, so that racing states wait for the one key
+    // rather than each making their own
+    pthread_mutex_lock(&cache->lock);
+    EVP_PKEY *pkey = NULL;
+    for (int k = 0; k < cache->count && !pkey; k++) {
+        if (cache->keys[k].libctx == libctx && strcmp(cache->keys[k].alg, alg) == 0) {
+            pkey = cache->keys[k].pkey;
+        }
+    }
+    if (!pkey) {
+        if (strlen(alg) >= sizeof(cache->keys[0].alg)) {
+            fprintf(stderr, "Algorithm name too long for the key cache: %s\n", alg);
+            exit(EXIT_FAILURE);
+        }
+        if (cache->count == cache->capacity) {
+            cache->capacity = cache->capacity ? cache->capacity * 2 : 16;
+            cache->keys = realloc(cache->keys, cache->capacity * sizeof(cached_key));
+            if (!cache->keys) {
+                fprintf(stderr, "Failed to allocate the key cache\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        cached_key *entry = &cache->keys[cache->count++];
+        entry->libctx = libctx;
+        snprintf(entry->alg, sizeof(entry->alg), "%s", alg);
+        entry->pkey = pkey = pqb_generate_key(libctx, alg);
+    }
+    if (!EVP_PKEY_up_ref(pkey)) {
+        fprintf(stderr, "Failed to share the key pair of %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return pkey;
+}
+
+void pqb_key_sizes(EVP_PKEY *pkey, int *priv_key_len, int *pub_key_len) {
+    *priv_key_len = i2d_PrivateKey(pkey, NULL);
+    *pub_key_len = i2d_PUBKEY(pkey, NULL);
+}
@@ -0,0 +1,38 @@
+#ifndef PQB_KEYS_H
+#define PQB_KEYS_H
+
+#include <openssl/evp.h>
+
+// Generate a key pair for any algorithm name the drivers use: "RSA-<bits>",
+// an EC curve short name such as "prime256v1", or a provider algorithm name
+// such as "dilithium3" or "kyber768"
+EVP_PKEY *pqb_generate_key(OSSL_LIB_CTX *libctx, const char *alg);
+
+// The fetched, initialised and parameterised context pqb_generate_key uses;
+// EVP_PKEY_generate can be called on it repeatedly
+EVP_PKEY_CTX *pqb_keygen_ctx_new(OSSL_LIB_CTX *libctx, const char *alg);
+
+// Whether a provider loaded into libctx implements the key type of alg
+int pqb_key_type_available(OSSL_LIB_CTX *libctx, const char *alg);
+
+// Key pairs kept for the life of a bench, one per library context and
+// algorithm, for states that need some key pair of the algorithm rather
+// than a fresh one: the signer of a sign and verify run. Safe to share
+// between threads.
+typedef struct pqb_key_cache pqb_key_cache;
+
+pqb_key_cache *pqb_key_cache_new(void);
+void pqb_key_cache_free(pqb_key_cache *cache);
+
+// A new reference to the cached key pair of alg in libctx, generated on
+// first use; with a NULL cache, a fresh key pair every time
+EVP_PKEY *pqb_key_cache_get(pqb_key_cache *cache, OSSL_LIB_CTX *libctx, const char *alg);
+
+// Whether alg is one of OpenSSL's own RSA, EC or X25519/X448/Ed25519/Ed448
+// key types rather than a provider's, e.g. a post-quantum one
+int pqb_key_type_builtin(const char *alg);
+
+// DER sizes of the private and public halves of a key pair
+void pqb_key_sizes(EVP_PKEY *pkey, int *priv_key_len, int *pub_key_len);
+
+#endif
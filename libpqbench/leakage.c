@@ -0,0 +1,160 @@
+#include "bench.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "stats.h"
+
+// Welford's running mean and variance per class, so the test needs the same
+// few doubles whether it sees a thousand samples or a billion
+typedef struct {
+    double n[2];
+    double mean[2];
+    double m2[2];
+} t_test;
+
+static void t_push(t_test *t, double x, int c) {
+    t->n[c] += 1;
+    double delta = x - t->mean[c];
+    t->mean[c] += delta / t->n[c];
+    t->m2[c] += delta * (x - t->mean[c]);
+}
+
+static double t_value(const t_test *t) {
+    if (t->n[0] < 2 || t->n[1] < 2) {
+        return 0.0;
+    }
+    double var0 = t->m2[0] / (t->n[0] - 1);
+    double var1 = t->m2[1] / (t->n[1] - 1);
+    double den = sqrt(var0 / t->n[0] + var1 / t->n[1]);
+    return den > 0 ? (t->mean[0] - t->mean[1]) / den : 0.0;
+}
+
+// The inputs of the next block, of the classes the bits of classes draw.
+// As dudect does, every input is made before any is measured, so both
+// classes reach the timed op after the same switch of input rather than
+// one after a copy and the other after drawing random bytes.
+static void make_inputs(const pqb_family *family, void *state, uint64_t classes) {
+    for (int i = 0; i < PQB_LEAKAGE_BLOCK; i++) {
+        family->make_input(state, i, (int)(classes >> i) & 1);
+    }
+}
+
+// One timed run of op on the input in slot
+static uint64_t measure(const pqb_bench *bench, const pqb_family *family, const pqb_op *op, void *state, int slot) {
+    family->use_input(state, slot);
+    if (op->prepare) {
+        op->prepare(state);
+    }
+    uint64_t start = pqb_timer_start(&bench->timer);
+    op->run(state);
+    uint64_t stop = pqb_timer_stop(&bench->timer);
+    if (op->finish) {
+        op->finish(state);
+    }
+    return pqb_timer_elapsed(&bench->timer, start, stop);
+}
+
+static void test_op(pqb_bench *bench, const pqb_family *family, const pqb_op *op, void *state, const char *alg,
+                    uint64_t measurements, uint64_t *rng) {
+    uint64_t *pilot = malloc(2 * PQB_LEAKAGE_PILOT * sizeof(uint64_t));
+    if (!pilot) {
+        fprintf(stderr, "Failed to allocate memory for the leakage pilot\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Both classes are in the pilot, so the thresholds do not favour either.
+    // dudect's thresholds: the 1 - 0.5^(10 (i + 1) / crops) quantiles.
+    uint64_t bits = 0;
+    for (int i = 0; i < PQB_LEAKAGE_PILOT; i++) {
+        if (i % PQB_LEAKAGE_BLOCK == 0) {
+            bits = pqb_splitmix64(rng);
+            make_inputs(family, state, bits);
+        }
+        pilot[i] = measure(bench, family, op, state, i % PQB_LEAKAGE_BLOCK);
+    }
+    pqb_sort_samples(pilot, pilot + PQB_LEAKAGE_PILOT, PQB_LEAKAGE_PILOT);
+    double thresholds[PQB_LEAKAGE_CROPS];
+    for (int k = 0; k < PQB_LEAKAGE_CROPS; k++) {
+        double q = 1 - pow(0.5, 10.0 * (k + 1) / PQB_LEAKAGE_CROPS);
+        thresholds[k] = pqb_quantile_sorted(pilot, PQB_LEAKAGE_PILOT, q);
+    }
+    free(pilot);
+
+    t_test all = {{0}, {0}, {0}};
+    t_test cropped[PQB_LEAKAGE_CROPS] = {{{0}, {0}, {0}}};
+    for (uint64_t m = 0; m < measurements; m++) {
+        if (m % PQB_LEAKAGE_BLOCK == 0) {
+            bits = pqb_splitmix64(rng);
+            make_inputs(family, state, bits);
+        }
+        int slot = (int)(m % PQB_LEAKAGE_BLOCK);
+        int c = (int)(bits >> slot) & 1;
+        double x = (double)measure(bench, family, op, state, slot);
+        t_push(&all, x, c);
+        for (int k = 0; k < PQB_LEAKAGE_CROPS; k++) {
+            if (x < thresholds[k]) {
+                t_push(&cropped[k], x, c);
+            }
+        }
+    }
+
+    pqb_leakage_result result;
+    result.algorithm = alg;
+    result.op = op;
+    result.input_classes = family->input_classes;
+    result.measurements = measurements;
+    result.counts[0] = (uint64_t)all.n[0];
+    result.counts[1] = (uint64_t)all.n[1];
+    result.means[0] = all.mean[0];
+    result.means[1] = all.mean[1];
+    result.t = t_value(&all);
+    result.max_t = fabs(result.t);
+    result.max_t_samples = measurements;
+    result.max_t_threshold = 0.0;
+    for (int k = 0; k < PQB_LEAKAGE_CROPS; k++) {
+        double t = fabs(t_value(&cropped[k]));
+        if (t > result.max_t) {
+            result.max_t = t;
+            result.max_t_samples = (uint64_t)(cropped[k].n[0] + cropped[k].n[1]);
+            result.max_t_threshold = thresholds[k];
+        }
+    }
+    result.max_tau = result.max_t_samples ? result.max_t / sqrt((double)result.max_t_samples) : 0.0;
+    result.leaky = result.max_t > PQB_LEAKAGE_T_THRESHOLD;
+    result.timer = &bench->timer;
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->leakage) {
+            bench->sinks[s]->leakage(bench->sinks[s], &result);
+        }
+    }
+}
+
+void pqb_bench_run_leakage(pqb_bench *bench, const pqb_family *family, const char *alg, uint64_t measurements) {
+    const pqb_family *leakage = family->leakage;
+    if (!leakage) {
+        fprintf(stderr, "The %s family has no leakage test\n", family->name);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t rng = bench->stats_options.seed;
+
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->begin) {
+            bench->sinks[s]->begin(bench->sinks[s], alg);
+        }
+    }
+    // One key and one set of contexts for the whole test, so the classes
+    // differ in their input alone
+    void *state = leakage->create(bench, alg);
+    pqb_bench_warm_up(bench, leakage, state, &bench->timer);
+    for (int o = 0; o < leakage->num_ops; o++) {
+        test_op(bench, leakage, &leakage->ops[o], state, alg, measurements, &rng);
+    }
+    leakage->destroy(state);
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->end) {
+            bench->sinks[s]->end(bench->sinks[s], alg);
+        }
+    }
+}
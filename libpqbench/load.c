@@ -0,0 +1,241 @@
+#define _GNU_SOURCE
+#include "bench.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "isolate.h"
+#include "measure.h"
+
+// The schedule of one point, shared by its workers
+typedef struct {
+    pthread_barrier_t barrier;
+    const uint64_t *offsets; // ns from start to each request's intended start
+    uint64_t num_requests;
+    atomic_uint_fast64_t next; // the request the next idle worker takes
+    uint64_t start;            // monotonic ns, set by the main thread between the barriers
+    uint64_t deadline;
+} schedule;
+
+typedef struct {
+    const pqb_bench *bench;
+    const pqb_family *family;
+    const pqb_op *op;
+    const char *alg;
+    const pqb_timer *timer;
+    schedule *sched;
+    int cpu;
+    pqb_histogram latency;
+    pqb_histogram service;
+    uint64_t finished; // monotonic ns when this worker's last request finished
+} worker;
+
+uint64_t *pqb_load_arrivals(pqb_arrival arrival, double rate, double duration, uint64_t *rng, uint64_t *count) {
+    uint64_t capacity = (uint64_t)(rate * duration * 1.25) + 16;
+    uint64_t *offsets = pqb_xcalloc(capacity, sizeof(uint64_t), "the load generator");
+    uint64_t n = 0;
+    double t = 0.0;
+    while (t < duration) {
+        if (n == capacity) {
+            capacity *= 2;
+            offsets = realloc(offsets, capacity * sizeof(uint64_t));
+            if (!offsets) {
+                fprintf(stderr, "Failed to allocate memory for the load generator\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        offsets[n++] = (uint64_t)(t * 1e9);
+        if (arrival == PQB_ARRIVAL_POISSON) {
+            // Uniform on (0, 1], so the log is finite
+            double u = ((pqb_splitmix64(rng) >> 11) + 1) * 0x1.0p-53;
+            t += -log(u) / rate;
+        } else {
+            t = n / rate;
+        }
+    }
+    *count = n;
+    return offsets;
+}
+
+void pqb_load_wait_until(uint64_t t) {
+    uint64_t now = pqb_cycles_read_monotonic();
+    if (now + PQB_LOAD_SPIN_NS < t) {
+        uint64_t wake = t - PQB_LOAD_SPIN_NS;
+        struct timespec ts = {(time_t)(wake / 1000000000ULL), (long)(wake % 1000000000ULL)};
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+        }
+    }
+    while (pqb_cycles_read_monotonic() < t) {
+    }
+}
+
+static void *worker_main(void *arg) {
+    worker *w = arg;
+    schedule *sched = w->sched;
+    const pqb_op *op = w->op;
+
+    pqb_pin_thread(w->cpu);
+    void *state = w->family->create((pqb_bench *)w->bench, w->alg);
+    pqb_bench_warm_up(w->bench, w->family, state, w->timer);
+
+    // Everyone is ready at the first barrier; the main thread stamps the
+    // start before the second
+    pthread_barrier_wait(&sched->barrier);
+    pthread_barrier_wait(&sched->barrier);
+    w->finished = sched->start;
+    for (;;) {
+        uint64_t i = atomic_fetch_add_explicit(&sched->next, 1, memory_order_relaxed);
+        if (i >= sched->num_requests || pqb_cycles_read_monotonic() >= sched->deadline) {
+            break;
+        }
+        uint64_t intended = sched->start + sched->offsets[i];
+        if (op->prepare) {
+            op->prepare(state);
+        }
+        pqb_load_wait_until(intended);
+        uint64_t begun = pqb_cycles_read_monotonic();
+        op->run(state);
+        uint64_t done = pqb_cycles_read_monotonic();
+        if (op->finish) {
+            op->finish(state);
+        }
+        // A request whose worker was busy starts late, and the wait counts
+        pqb_histogram_record(&w->latency, done - intended);
+        pqb_histogram_record(&w->service, done - begun);
+        w->finished = done;
+    }
+
+    w->family->destroy(state);
+    return NULL;
+}
+
+static void measure_point(pqb_bench *bench, const pqb_family *family, const pqb_op *op, const char *alg,
+                          const pqb_timer *timer, const int *cpus, const pqb_load_options *options, double rate,
+                          uint64_t *rng) {
+    int workers = options->workers;
+    uint64_t highest = (uint64_t)(options->duration * PQB_LOAD_DEADLINE * 1e9);
+    schedule sched;
+    sched.offsets = pqb_load_arrivals(options->arrival, rate, options->duration, rng, &sched.num_requests);
+    atomic_init(&sched.next, 0);
+    pthread_barrier_init(&sched.barrier, NULL, workers + 1);
+
+    worker *ws = pqb_xcalloc(workers, sizeof(worker), "the load generator");
+    pthread_t *tids = pqb_xcalloc(workers, sizeof(pthread_t), "the load generator");
+    for (int t = 0; t < workers; t++) {
+        worker *w = &ws[t];
+        w->bench = bench;
+        w->family = family;
+        w->op = op;
+        w->alg = alg;
+        w->timer = timer;
+        w->sched = &sched;
+        w->cpu = cpus[t];
+        pqb_histogram_init(&w->latency, highest);
+        pqb_histogram_init(&w->service, highest);
+        int err = pthread_create(&tids[t], NULL, worker_main, w);
+        if (err != 0) {
+            fprintf(stderr, "Failed to start worker thread: %s\n", strerror(err));
+            exit(EXIT_FAILURE);
+        }
+    }
+    pthread_barrier_wait(&sched.barrier);
+    sched.start = pqb_cycles_read_monotonic() + PQB_LOAD_SPIN_NS;
+    sched.deadline = sched.start + highest;
+    pthread_barrier_wait(&sched.barrier);
+    for (int t = 0; t < workers; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    pthread_barrier_destroy(&sched.barrier);
+
+    pqb_histogram latency, service;
+    pqb_histogram_init(&latency, highest);
+    pqb_histogram_init(&service, highest);
+    uint64_t finished = sched.start;
+    for (int t = 0; t < workers; t++) {
+        pqb_histogram_add(&latency, &ws[t].latency);
+        pqb_histogram_add(&service, &ws[t].service);
+        if (ws[t].finished > finished) {
+            finished = ws[t].finished;
+        }
+        pqb_histogram_free(&ws[t].latency);
+        pqb_histogram_free(&ws[t].service);
+    }
+
+    pqb_load_result result;
+    result.algorithm = alg;
+    result.op = op;
+    result.workers = workers;
+    result.cpus = cpus;
+    result.arrival = options->arrival;
+    result.offered_rate = rate;
+    result.requests = sched.num_requests;
+    result.completed = latency.total;
+    result.abandoned = sched.num_requests - latency.total;
+    result.duration = options->duration;
+    // A pool that keeps up finishes about when the arrivals end; one that
+    // does not takes longer
+    double elapsed = (finished - sched.start) * 1e-9;
+    if (elapsed < options->duration) {
+        elapsed = options->duration;
+    }
+    result.achieved_rate = elapsed > 0 ? result.completed / elapsed : 0.0;
+    result.saturated = result.abandoned > 0 || result.achieved_rate < PQB_LOAD_SATURATED * rate;
+    result.latency = &latency;
+    result.service = &service;
+    result.timer = timer;
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->load) {
+            bench->sinks[s]->load(bench->sinks[s], &result);
+        }
+    }
+
+    pqb_histogram_free(&latency);
+    pqb_histogram_free(&service);
+    free(tids);
+    free(ws);
+    free((uint64_t *)sched.offsets);
+}
+
+void pqb_bench_run_load(pqb_bench *bench, const pqb_family *family, const char *alg, const pqb_load_options *options) {
+    const pqb_family *load = family->load;
+    if (!load) {
+        fprintf(stderr, "The %s family has no load generator\n", family->name);
+        exit(EXIT_FAILURE);
+    }
+    int workers = options->workers;
+    int *cpus = pqb_xcalloc(workers, sizeof(int), "the load generator");
+    int num_cpus = pqb_allowed_cpus(cpus, workers);
+    if (num_cpus < workers) {
+        fprintf(stderr, "Only %d cpus available, workers beyond that share cpus\n", num_cpus);
+        for (int t = num_cpus; t < workers; t++) {
+            cpus[t] = cpus[t % num_cpus];
+        }
+    }
+    pqb_timer timer;
+    pqb_timer_init(&timer, PQB_TIMER_WALL);
+    uint64_t rng = bench->stats_options.seed;
+
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->begin) {
+            bench->sinks[s]->begin(bench->sinks[s], alg);
+        }
+    }
+    for (int o = 0; o < load->num_ops; o++) {
+        for (int r = 0; r < options->num_rates; r++) {
+            measure_point(bench, load, &load->ops[o], alg, &timer, cpus, options, options->rates[r], &rng);
+        }
+    }
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->end) {
+            bench->sinks[s]->end(bench->sinks[s], alg);
+        }
+    }
+
+    pqb_timer_close(&timer);
+    free(cpus);
+}
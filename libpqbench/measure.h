@@ -0,0 +1,72 @@
+#ifndef PQB_MEASURE_H
+#define PQB_MEASURE_H
+
+#include "alloc.h"
+#include "bench.h"
+
+// Building blocks of pqb_bench_run, shared with the runners that decide for
+// themselves how many passes to make
+
+// Hardware counter deltas of one op, over the runs the group counted for
+// the whole op
+typedef struct {
+    uint64_t sum[PQB_NUM_COUNTERS];
+    int runs;
+} pqb_counter_totals;
+
+// What the measured passes over one algorithm's family have produced so far
+typedef struct {
+    uint64_t **samples;      // [op][run]
+    int **cpus;              // [op][run]
+    pqb_alloc_count *allocs; // [op], summed over runs
+    pqb_counter_totals *counters; // [op]
+    pqb_memory_usage *memory; // [op]
+    int memory_profiled;     // whether memory holds a profile
+    int runs;                // passes measured
+    int capacity;            // passes the arrays have room for
+    size_t wire_bytes;
+    int warmup_runs;
+} pqb_collected;
+
+// calloc, exiting with "Failed to allocate memory for <what>" when it fails
+void *pqb_xcalloc(size_t count, size_t size, const char *what);
+
+void pqb_collected_init(pqb_collected *c, const pqb_family *family, int capacity);
+void pqb_collected_reserve(pqb_collected *c, const pqb_family *family, int capacity);
+void pqb_collected_free(pqb_collected *c, const pqb_family *family);
+
+// Measure one more pass over every op, growing the arrays when they are full
+void pqb_measure_pass(const pqb_bench *bench, const pqb_family *family, void *state, pqb_collected *c);
+
+// Run every op of the family on a thread of its own, with the state as the
+// measured passes left it, and record the most heap, resident set and stack
+// each used; usage must hold family->num_ops entries. Counts only the heap
+// allocated through OpenSSL, and only once the allocator is installed.
+void pqb_memory_profile(const pqb_family *family, void *state, pqb_memory_usage usage[]);
+
+// Profile memory into c if the bench asks for it
+void pqb_collect_memory(const pqb_bench *bench, const pqb_family *family, void *state, pqb_collected *c);
+
+// The op the handshake total of a handshake family is reported as
+extern const pqb_op pqb_handshake_op;
+
+// Summarise every op, plus the handshake total for handshake families, and
+// report them to the sinks between begin and end
+void pqb_report_collected(const pqb_bench *bench, const pqb_family *family, const char *alg,
+                          const pqb_collected *c);
+
+// The open loop schedule of load mode, shared with the key pool
+
+// Closer than this to an intended start, spin rather than sleep, since a
+// wakeup can come tens of microseconds late
+#define PQB_LOAD_SPIN_NS 50000
+
+// Intended start of every request that arrives within duration seconds at
+// rate per second, as ns from the start of the run; the caller frees it.
+// Poisson gaps are drawn from rng.
+uint64_t *pqb_load_arrivals(pqb_arrival arrival, double rate, double duration, uint64_t *rng, uint64_t *count);
+
+// Wait until monotonic time t in ns, sleeping then spinning
+void pqb_load_wait_until(uint64_t t);
+
+#endif
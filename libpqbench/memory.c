@@ -0,0 +1,168 @@
+#define _GNU_SOURCE
+#include "measure.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "alloc.h"
+
+#define PAINT 0xa5
+// Room left unpainted below the painting frame for its own locals; ops that
+// use less stack than this read as 0
+#define PAINT_MARGIN 256
+
+typedef struct {
+    const pqb_family *family;
+    void *state;
+    unsigned char *stack; // lowest address of the profiling thread's stack
+    int rss;              // whether the peak resident set can be reset
+    pqb_memory_usage *usage;
+} profile;
+
+// VmRSS and VmHWM of the process in bytes, read with plain syscalls so the
+// read itself does not allocate; 0 if unavailable
+static void read_rss(int64_t *rss, int64_t *hwm) {
+    char buf[8192];
+    *rss = 0;
+    *hwm = 0;
+    int fd = open("/proc/self/status", O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) {
+        return;
+    }
+    buf[n] = '\0';
+    const char *p = strstr(buf, "VmRSS:");
+    if (p) {
+        *rss = strtoll(p + 6, NULL, 10) * 1024;
+    }
+    p = strstr(buf, "VmHWM:");
+    if (p) {
+        *hwm = strtoll(p + 6, NULL, 10) * 1024;
+    }
+}
+
+// Set VmHWM back to the current resident set; needs Linux 4.0 or later
+static int reset_peak_rss(void) {
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    int ok = write(fd, "5", 1) == 1;
+    close(fd);
+    return ok;
+}
+
+// Paint the unused part of this thread's stack, run the op, and return how
+// far below this frame it wrote. The stack grows down, so the lowest byte
+// that lost its paint marks the deepest point.
+static __attribute__((noinline)) int64_t run_painted(const profile *p, const pqb_op *op) {
+    volatile unsigned char marker = 0;
+    // Offsets, not pointers: the frame and the mapping are different objects
+    // as far as the compiler knows, so comparing pointers into them is
+    // undefined
+    uintptr_t frame = (uintptr_t)&marker;
+    size_t painted = frame - PAINT_MARGIN - (uintptr_t)p->stack;
+    volatile unsigned char *stack = p->stack;
+    for (size_t i = 0; i < painted; i++) {
+        stack[i] = PAINT;
+    }
+    op->run(p->state);
+    size_t untouched = 0;
+    while (untouched < painted && stack[untouched] == PAINT) {
+        untouched++;
+    }
+    return untouched < painted ? (int64_t)(frame - ((uintptr_t)p->stack + untouched)) : 0;
+}
+
+static void record_max(int64_t *slot, int64_t value) {
+    if (value > *slot) {
+        *slot = value;
+    }
+}
+
+static void *profile_main(void *arg) {
+    profile *p = arg;
+    const pqb_family *family = p->family;
+    int heap = pqb_alloc_active();
+
+    // Pass 0 is not recorded: the first op to touch the error queue or the
+    // random generators allocates them for this thread
+    for (int pass = 0; pass <= PQB_MEMORY_PASSES; pass++) {
+        for (int o = 0; o < family->num_ops; o++) {
+            const pqb_op *op = &family->ops[o];
+            pqb_memory_usage *u = &p->usage[o];
+            if (op->prepare) {
+                op->prepare(p->state);
+            }
+            int64_t rss_before = 0, hwm_before, hwm_after, rss_after;
+            if (p->rss) {
+                reset_peak_rss();
+                read_rss(&rss_before, &hwm_before);
+            }
+            pqb_alloc_peak_reset();
+            int64_t stack = run_painted(p, op);
+            int64_t peak_heap = (int64_t)pqb_alloc_peak();
+            if (p->rss) {
+                read_rss(&rss_after, &hwm_after);
+            }
+            if (op->finish) {
+                op->finish(p->state);
+            }
+            if (pass == 0) {
+                continue;
+            }
+            record_max(&u->stack, stack);
+            if (heap) {
+                record_max(&u->peak_heap, peak_heap);
+            }
+            if (p->rss && hwm_after > 0) {
+                record_max(&u->peak_rss, hwm_after > rss_before ? hwm_after - rss_before : 0);
+            }
+        }
+    }
+    return NULL;
+}
+
+void pqb_memory_profile(const pqb_family *family, void *state, pqb_memory_usage usage[]) {
+    // Fields still -1 after the passes were not measured
+    for (int o = 0; o < family->num_ops; o++) {
+        usage[o].peak_heap = -1;
+        usage[o].peak_rss = -1;
+        usage[o].stack = -1;
+    }
+
+    profile p;
+    p.family = family;
+    p.state = state;
+    p.usage = usage;
+    p.rss = reset_peak_rss();
+    // Painting touches every page, so stack use adds nothing to the resident
+    // set once pass 0 is over
+    p.stack = mmap(NULL, PQB_MEMORY_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (p.stack == MAP_FAILED) {
+        fprintf(stderr, "Failed to map a stack for memory profiling\n");
+        exit(EXIT_FAILURE);
+    }
+
+    pthread_attr_t attr;
+    pthread_t tid;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, p.stack, PQB_MEMORY_STACK_SIZE);
+    int err = pthread_create(&tid, &attr, profile_main, &p);
+    if (err) {
+        fprintf(stderr, "Failed to create the memory profiling thread: %s\n", strerror(err));
+        exit(EXIT_FAILURE);
+    }
+    pthread_join(tid, NULL);
+    pthread_attr_destroy(&attr);
+    munmap(p.stack, PQB_MEMORY_STACK_SIZE);
+}
@@ -0,0 +1,19 @@
+#ifndef PQB_MEMORY_H
+#define PQB_MEMORY_H
+
+#include <stdint.h>
+
+// Memory profiling runs every op PQB_MEMORY_PASSES times, after one more pass
+// that sets up the profiling thread's own OpenSSL state, and keeps the most
+// each op used. The thread gets a stack of PQB_MEMORY_STACK_SIZE bytes.
+#define PQB_MEMORY_PASSES 3
+#define PQB_MEMORY_STACK_SIZE (8 << 20)
+
+// Footprint of one op; -1 for what could not be measured
+typedef struct {
+    int64_t peak_heap; // most bytes allocated through OpenSSL and not yet freed at once, above the level before the op
+    int64_t peak_rss;  // growth of the peak resident set of the process over the op
+    int64_t stack;     // deepest stack the op reached below its caller
+} pqb_memory_usage;
+
+#endif
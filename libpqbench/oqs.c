@@ -0,0 +1,46 @@
+#include "oqs.h"
+
+#if PQB_HAVE_LIBOQS
+#include <ctype.h>
+#include <stddef.h>
+
+// Compare two algorithm names on their alphanumeric characters only
+static int same_name(const char *a, const char *b) {
+    for (;;) {
+        while (*a && !isalnum((unsigned char)*a)) {
+            a++;
+        }
+        while (*b && !isalnum((unsigned char)*b)) {
+            b++;
+        }
+        if (!*a || !*b) {
+            return !*a && !*b;
+        }
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) {
+            return 0;
+        }
+        a++;
+        b++;
+    }
+}
+
+const char *pqb_oqs_kem_name(const char *alg) {
+    for (int i = 0; i < OQS_KEM_alg_count(); i++) {
+        const char *id = OQS_KEM_alg_identifier(i);
+        if (same_name(alg, id) && OQS_KEM_alg_is_enabled(id)) {
+            return id;
+        }
+    }
+    return NULL;
+}
+
+const char *pqb_oqs_sig_name(const char *alg) {
+    for (int i = 0; i < OQS_SIG_alg_count(); i++) {
+        const char *id = OQS_SIG_alg_identifier(i);
+        if (same_name(alg, id) && OQS_SIG_alg_is_enabled(id)) {
+            return id;
+        }
+    }
+    return NULL;
+}
+#endif
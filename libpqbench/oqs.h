@@ -0,0 +1,16 @@
+#ifndef PQB_OQS_H
+#define PQB_OQS_H
+
+#include "config.h"
+
+#if PQB_HAVE_LIBOQS
+#include <oqs/oqs.h>
+
+// liboqs method name for an oqsprovider algorithm name, e.g. "kyber768" ->
+// "Kyber768", or NULL if liboqs has no such enabled algorithm. Names are
+// compared on their letters and digits only, ignoring case.
+const char *pqb_oqs_kem_name(const char *alg);
+const char *pqb_oqs_sig_name(const char *alg);
+#endif
+
+#endif
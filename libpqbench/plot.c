@@ -0,0 +1,217 @@
+#include "sink.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "plot.h"
+
+#if PQB_HAVE_PLPLOT
+#include <math.h>
+#include <plplot/plplot.h>
+
+#define MIN_BINS 10
+#define MAX_BINS 100
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void plot_histogram(const char *algorithm, const char *op, const double *sorted, size_t n,
+                           const char *axis_label) {
+    char filename[256];
+    snprintf(filename, sizeof(filename), "%s_%s_hist.svg", algorithm, op);
+
+    // Square root rule for the bin count, over min to p99
+    int nbins = (int)sqrt((double)n);
+    nbins = nbins < MIN_BINS ? MIN_BINS : nbins > MAX_BINS ? MAX_BINS : nbins;
+    double lo = sorted[0];
+    double hi = sorted[(size_t)(0.99 * (n - 1))];
+    if (hi <= lo) {
+        hi = lo + 1.0;
+    }
+    double width = (hi - lo) / nbins;
+
+    PLFLT x[MAX_BINS], y[MAX_BINS];
+    for (int b = 0; b < nbins; b++) {
+        x[b] = lo + b * width;
+        y[b] = 0;
+    }
+    double max_count = 0;
+    for (size_t i = 0; i < n; i++) {
+        int b = (int)((sorted[i] - lo) / width);
+        b = b < 0 ? 0 : b >= nbins ? nbins - 1 : b;
+        y[b]++;
+        if (y[b] > max_count) {
+            max_count = y[b];
+        }
+    }
+
+    plsdev("svg");
+    plsfnam(filename);
+    plinit();
+    plenv(lo, hi, 0, 1.1 * max_count, 0, 0);
+    pllab(axis_label, "Samples", op);
+    plbin(nbins, x, y, PL_BIN_DEFAULT);
+    plend();
+}
+
+static void plot_cdf(const char *algorithm, const char *op, const double *sorted, size_t n,
+                     const char *axis_label) {
+    char filename[256];
+    snprintf(filename, sizeof(filename), "%s_%s_cdf.svg", algorithm, op);
+
+    PLFLT *y = malloc(n * sizeof(PLFLT));
+    if (!y) {
+        fprintf(stderr, "Failed to allocate memory for plot %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < n; i++) {
+        y[i] = (double)(i + 1) / n;
+    }
+
+    double hi = sorted[n - 1] > sorted[0] ? sorted[n - 1] : sorted[0] + 1.0;
+    plsdev("svg");
+    plsfnam(filename);
+    plinit();
+    plenv(sorted[0], hi, 0, 1, 0, 0);
+    pllab(axis_label, "Fraction of samples", op);
+    plline((PLINT)n, sorted, y);
+    plend();
+    free(y);
+}
+
+void pqb_plot_distribution(const char *algorithm, const char *op, double *values, size_t n,
+                           const char *axis_label) {
+    if (n == 0) {
+        return;
+    }
+    qsort(values, n, sizeof(double), compare_doubles);
+    plot_histogram(algorithm, op, values, n, axis_label);
+    plot_cdf(algorithm, op, values, n, axis_label);
+}
+
+// Samples of one result, copied so rendering can wait until the bench is done
+typedef struct {
+    char *algorithm;
+    char *op;
+    const char *axis_label;
+    double *values;
+    size_t n;
+} plot_job;
+
+typedef struct {
+    pqb_sink base;
+    plot_job *jobs;
+    size_t num_jobs;
+    size_t cap_jobs;
+    const char *level;   // of a CPU matrix this run is part of, or NULL
+    char *variant;       // NULL for none
+} plot_sink;
+
+static char *copy_string(const char *s) {
+    char *c = strdup(s);
+    if (!c) {
+        fprintf(stderr, "Failed to allocate memory for a plot\n");
+        exit(EXIT_FAILURE);
+    }
+    return c;
+}
+
+// Only copies; nothing is drawn while measurements are still to come
+static void plot_result(pqb_sink *sink, const pqb_result *r) {
+    plot_sink *ps = (plot_sink *)sink;
+    // Soak runs may keep a histogram instead of the samples
+    if (!r->samples) {
+        return;
+    }
+    if (ps->num_jobs == ps->cap_jobs) {
+        ps->cap_jobs = ps->cap_jobs ? ps->cap_jobs * 2 : 16;
+        ps->jobs = realloc(ps->jobs, ps->cap_jobs * sizeof(plot_job));
+        if (!ps->jobs) {
+            fprintf(stderr, "Failed to allocate memory for plots\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    plot_job *job = &ps->jobs[ps->num_jobs++];
+    double scale = pqb_timer_scale(r->timer);
+    job->algorithm = copy_string(r->algorithm);
+    char op[256];
+    snprintf(op, sizeof(op), "%s%s%s%s%s", r->op->name, ps->level ? "_" : "", ps->level ? ps->level : "",
+             ps->variant ? "_" : "", ps->variant ? ps->variant : "");
+    job->op = copy_string(op);
+    job->axis_label = pqb_timer_axis_label(r->timer);
+    job->n = r->num_samples;
+    job->values = malloc(job->n * sizeof(double));
+    if (!job->values) {
+        fprintf(stderr, "Failed to allocate memory for plot samples\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < job->n; i++) {
+        job->values[i] = r->samples[i] * scale;
+    }
+}
+
+// pqb_bench_free closes sinks after the last measurement, so this is where
+// every plot is drawn
+static void plot_close(pqb_sink *sink) {
+    plot_sink *ps = (plot_sink *)sink;
+    for (size_t j = 0; j < ps->num_jobs; j++) {
+        plot_job *job = &ps->jobs[j];
+        pqb_plot_distribution(job->algorithm, job->op, job->values, job->n, job->axis_label);
+        free(job->algorithm);
+        free(job->op);
+        free(job->values);
+    }
+    free(ps->jobs);
+    free(ps->variant);
+    free(ps);
+}
+
+pqb_sink *pqb_plot_sink_new(void) {
+    plot_sink *ps = calloc(1, sizeof(*ps));
+    if (!ps) {
+        fprintf(stderr, "Failed to allocate plot sink\n");
+        exit(EXIT_FAILURE);
+    }
+    ps->base.result = plot_result;
+    ps->base.close = plot_close;
+    ps->level = getenv(PQB_CPU_LEVEL_ENV);
+    return &ps->base;
+}
+
+void pqb_plot_sink_set_variant(pqb_sink *sink, const char *variant) {
+    plot_sink *ps = (plot_sink *)sink;
+    free(ps->variant);
+    ps->variant = variant ? copy_string(variant) : NULL;
+}
+
+#else
+
+static void plot_result(pqb_sink *sink, const pqb_result *r) {
+    (void)sink;
+    (void)r;
+}
+
+static void plot_close(pqb_sink *sink) {
+    free(sink);
+}
+
+pqb_sink *pqb_plot_sink_new(void) {
+    pqb_sink *sink = calloc(1, sizeof(*sink));
+    if (!sink) {
+        fprintf(stderr, "Failed to allocate plot sink\n");
+        exit(EXIT_FAILURE);
+    }
+    sink->result = plot_result;
+    sink->close = plot_close;
+    return sink;
+}
+
+void pqb_plot_sink_set_variant(pqb_sink *sink, const char *variant) {
+    (void)sink;
+    (void)variant;
+}
+
+#endif
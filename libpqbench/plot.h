@@ -0,0 +1,17 @@
+#ifndef PQB_PLOT_H
+#define PQB_PLOT_H
+
+#include <stddef.h>
+
+#include "config.h"
+
+#if PQB_HAVE_PLPLOT
+// Draw the distribution of one op's samples, already scaled to the unit in
+// axis_label, into <algorithm>_<op>_hist.svg and <algorithm>_<op>_cdf.svg.
+// Every sample is plotted; the histogram's last bin also counts everything
+// above p99 so that a few outliers do not flatten it. Sorts values in place.
+void pqb_plot_distribution(const char *algorithm, const char *op, double *values, size_t n,
+                           const char *axis_label);
+#endif
+
+#endif
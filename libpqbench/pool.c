@@ -0,0 +1,346 @@
+#define _GNU_SOURCE
+#include "pool.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+#include "isolate.h"
+#include "keys.h"
+#include "measure.h"
+
+typedef struct {
+    atomic_size_t seq; // pos when free for the producer at pos, pos + 1 once filled for the consumer at pos
+    EVP_PKEY *key;
+} slot;
+
+typedef struct {
+    pqb_key_pool *pool;
+    pthread_t tid;
+    int cpu; // -1 to leave unpinned
+} producer;
+
+struct pqb_key_pool {
+    OSSL_LIB_CTX *libctx;
+    char alg[128];
+    slot *slots;
+    size_t mask;
+    // Each end on a cache line of its own, so producers and consumers do
+    // not false share
+    _Alignas(64) atomic_size_t head; // next position to fill
+    _Alignas(64) atomic_size_t tail; // next position to take
+    _Alignas(64) atomic_uint_fast64_t generated;
+    atomic_int stop;
+    producer *producers;
+    int num_producers;
+};
+
+static int ring_push(pqb_key_pool *pool, EVP_PKEY *key) {
+    size_t pos = atomic_load_explicit(&pool->head, memory_order_relaxed);
+    for (;;) {
+        slot *s = &pool->slots[pos & pool->mask];
+        size_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&pool->head, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                s->key = key;
+                atomic_store_explicit(&s->seq, pos + 1, memory_order_release);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0; // full
+        } else {
+            pos = atomic_load_explicit(&pool->head, memory_order_relaxed);
+        }
+    }
+}
+
+static EVP_PKEY *ring_pop(pqb_key_pool *pool) {
+    size_t pos = atomic_load_explicit(&pool->tail, memory_order_relaxed);
+    for (;;) {
+        slot *s = &pool->slots[pos & pool->mask];
+        size_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&pool->tail, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                EVP_PKEY *key = s->key;
+                atomic_store_explicit(&s->seq, pos + pool->mask + 1, memory_order_release);
+                return key;
+            }
+        } else if (diff < 0) {
+            return NULL; // empty
+        } else {
+            pos = atomic_load_explicit(&pool->tail, memory_order_relaxed);
+        }
+    }
+}
+
+static void *producer_main(void *arg) {
+    producer *p = arg;
+    pqb_key_pool *pool = p->pool;
+    if (p->cpu >= 0) {
+        pqb_pin_thread(p->cpu);
+    }
+    // A pool generates from a context it keeps, as a service would
+    EVP_PKEY_CTX *ctx = pqb_keygen_ctx_new(pool->libctx, pool->alg);
+    EVP_PKEY *key = NULL;
+    while (!atomic_load_explicit(&pool->stop, memory_order_relaxed)) {
+        if (!key && EVP_PKEY_generate(ctx, &key) <= 0) {
+            fprintf(stderr, "Failed to generate key pair for %s\n", pool->alg);
+            exit(EXIT_FAILURE);
+        }
+        if (ring_push(pool, key)) {
+            key = NULL;
+            atomic_fetch_add_explicit(&pool->generated, 1, memory_order_relaxed);
+        } else {
+            struct timespec ts = {0, PQB_POOL_FULL_SLEEP_NS};
+            nanosleep(&ts, NULL);
+        }
+    }
+    EVP_PKEY_free(key);
+    EVP_PKEY_CTX_free(ctx);
+    return NULL;
+}
+
+pqb_key_pool *pqb_key_pool_new(OSSL_LIB_CTX *libctx, const char *alg, int capacity, int producers, const int *cpus) {
+    pqb_key_pool *pool = aligned_alloc(64, (sizeof(*pool) + 63) & ~(size_t)63);
+    size_t slots = 1;
+    while (slots < (size_t)capacity) {
+        slots <<= 1;
+    }
+    if (pool) {
+        memset(pool, 0, sizeof(*pool));
+        pool->slots = calloc(slots, sizeof(slot));
+        pool->producers = calloc(producers, sizeof(producer));
+    }
+    if (!pool || !pool->slots || !pool->producers) {
+        fprintf(stderr, "Failed to allocate a key pool for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    pool->libctx = libctx;
+    snprintf(pool->alg, sizeof(pool->alg), "%s", alg);
+    pool->mask = slots - 1;
+    for (size_t i = 0; i < slots; i++) {
+        atomic_init(&pool->slots[i].seq, i);
+    }
+    atomic_init(&pool->head, 0);
+    atomic_init(&pool->tail, 0);
+    atomic_init(&pool->generated, 0);
+    atomic_init(&pool->stop, 0);
+
+    pool->num_producers = producers;
+    for (int p = 0; p < producers; p++) {
+        producer *pr = &pool->producers[p];
+        pr->pool = pool;
+        pr->cpu = cpus ? cpus[p] : -1;
+        int err = pthread_create(&pr->tid, NULL, producer_main, pr);
+        if (err != 0) {
+            fprintf(stderr, "Failed to start key pool thread: %s\n", strerror(err));
+            exit(EXIT_FAILURE);
+        }
+    }
+    return pool;
+}
+
+EVP_PKEY *pqb_key_pool_take(pqb_key_pool *pool) {
+    return ring_pop(pool);
+}
+
+int pqb_key_pool_capacity(const pqb_key_pool *pool) {
+    return (int)(pool->mask + 1);
+}
+
+uint64_t pqb_key_pool_size(pqb_key_pool *pool) {
+    size_t tail = atomic_load_explicit(&pool->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&pool->head, memory_order_relaxed);
+    return head > tail ? head - tail : 0;
+}
+
+uint64_t pqb_key_pool_generated(pqb_key_pool *pool) {
+    return atomic_load_explicit(&pool->generated, memory_order_relaxed);
+}
+
+void pqb_key_pool_free(pqb_key_pool *pool) {
+    atomic_store_explicit(&pool->stop, 1, memory_order_relaxed);
+    for (int p = 0; p < pool->num_producers; p++) {
+        pthread_join(pool->producers[p].tid, NULL);
+    }
+    EVP_PKEY *key;
+    while ((key = ring_pop(pool))) {
+        EVP_PKEY_free(key);
+    }
+    free(pool->producers);
+    free(pool->slots);
+    free(pool);
+}
+
+// Pool mode
+
+typedef struct {
+    pqb_bench *bench;
+    const char *alg;
+    const pqb_pool_options *options;
+    const int *cpus; // [0] for the handshakes, the rest for the producers
+    int num_cpus;
+    const pqb_timer *timer;
+} pool_run;
+
+static void *pool_run_main(void *arg) {
+    pool_run *run = arg;
+    const pqb_pool_options *options = run->options;
+    pqb_bench *bench = run->bench;
+    uint64_t highest = (uint64_t)(options->duration * PQB_LOAD_DEADLINE * 1e9);
+    pqb_pin_thread(run->cpus[0]);
+
+    // On demand: every handshake generates its own key
+    EVP_PKEY_CTX *ctx = pqb_keygen_ctx_new(bench->libctx, run->alg);
+    pqb_histogram on_demand, handout;
+    pqb_histogram_init(&on_demand, highest);
+    pqb_histogram_init(&handout, highest);
+    for (int r = -1; r < bench->runs; r++) {
+        EVP_PKEY *key = NULL;
+        uint64_t begun = pqb_cycles_read_monotonic();
+        if (EVP_PKEY_generate(ctx, &key) <= 0) {
+            fprintf(stderr, "Failed to generate key pair for %s\n", run->alg);
+            exit(EXIT_FAILURE);
+        }
+        uint64_t done = pqb_cycles_read_monotonic();
+        if (r >= 0) { // the first is a warm-up
+            pqb_histogram_record(&on_demand, done - begun);
+        }
+        EVP_PKEY_free(key);
+    }
+
+    pqb_pool_result result;
+    memset(&result, 0, sizeof(result));
+    result.algorithm = run->alg;
+    result.arrival = options->arrival;
+    result.target_rate = options->rate;
+    result.keygen_rate = 1e9 / pqb_histogram_mean(&on_demand);
+    result.cores_needed = result.target_rate / result.keygen_rate;
+    result.producers_needed = (int)ceil(result.cores_needed);
+    // By default as many producers as needed, but no more than there are
+    // cpus beside the handshakes'
+    result.producers = options->producers;
+    if (result.producers == 0) {
+        int spare = run->num_cpus > 1 ? run->num_cpus - 1 : 1;
+        result.producers = result.producers_needed < spare ? result.producers_needed : spare;
+        if (result.producers < 1) {
+            result.producers = 1;
+        }
+    }
+    result.duration = options->duration;
+
+    int *cpus = calloc(result.producers, sizeof(int));
+    if (!cpus) {
+        fprintf(stderr, "Failed to allocate memory for the key pool\n");
+        exit(EXIT_FAILURE);
+    }
+    if (run->num_cpus < result.producers + 1) {
+        fprintf(stderr, "Only %d cpus available, key pool threads beyond that share cpus\n", run->num_cpus);
+    }
+    for (int p = 0; p < result.producers; p++) {
+        cpus[p] = run->cpus[(p + 1) % run->num_cpus];
+    }
+
+    // Taken from a pool that starts full, as one filled at start up would
+    pqb_key_pool *pool = pqb_key_pool_new(bench->libctx, run->alg, options->capacity, result.producers, cpus);
+    result.capacity = pqb_key_pool_capacity(pool);
+    while (pqb_key_pool_size(pool) < (uint64_t)result.capacity) {
+        struct timespec ts = {0, 1000000};
+        nanosleep(&ts, NULL);
+    }
+    uint64_t rng = bench->stats_options.seed;
+    const uint64_t *offsets = pqb_load_arrivals(options->arrival, options->rate, options->duration, &rng,
+                                                &result.requests);
+    result.lowest_fill = result.capacity;
+    uint64_t generated = pqb_key_pool_generated(pool);
+    uint64_t start = pqb_cycles_read_monotonic() + PQB_LOAD_SPIN_NS;
+    uint64_t deadline = start + highest;
+    uint64_t finished = start;
+    uint64_t handled = 0;
+    for (; handled < result.requests; handled++) {
+        uint64_t intended = start + offsets[handled];
+        if (pqb_cycles_read_monotonic() >= deadline) {
+            break;
+        }
+        pqb_load_wait_until(intended);
+        EVP_PKEY *key = pqb_key_pool_take(pool);
+        if (!key) {
+            result.misses++;
+            if (EVP_PKEY_generate(ctx, &key) <= 0) {
+                fprintf(stderr, "Failed to generate key pair for %s\n", run->alg);
+                exit(EXIT_FAILURE);
+            }
+        }
+        uint64_t done = pqb_cycles_read_monotonic();
+        // A handshake kept waiting by the one before it counts the wait
+        pqb_histogram_record(&handout, done - intended);
+        finished = done;
+        uint64_t fill = pqb_key_pool_size(pool);
+        if (fill < result.lowest_fill) {
+            result.lowest_fill = fill;
+        }
+        EVP_PKEY_free(key);
+    }
+    result.abandoned = result.requests - handled;
+    double elapsed = (finished - start) * 1e-9;
+    if (elapsed < options->duration) {
+        elapsed = options->duration;
+    }
+    result.refill_rate = (pqb_key_pool_generated(pool) - generated) / elapsed;
+    result.sustained = result.misses == 0 && result.abandoned == 0;
+    pqb_key_pool_free(pool);
+
+    result.on_demand = &on_demand;
+    result.handout = &handout;
+    result.timer = run->timer;
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->pool) {
+            bench->sinks[s]->pool(bench->sinks[s], &result);
+        }
+    }
+
+    free((uint64_t *)offsets);
+    free(cpus);
+    pqb_histogram_free(&on_demand);
+    pqb_histogram_free(&handout);
+    EVP_PKEY_CTX_free(ctx);
+    return NULL;
+}
+
+void pqb_bench_run_pool(pqb_bench *bench, const char *alg, const pqb_pool_options *options) {
+    int cpus[CPU_SETSIZE];
+    pqb_timer timer;
+    pqb_timer_init(&timer, PQB_TIMER_WALL);
+    pool_run run = {bench, alg, options, cpus, pqb_allowed_cpus(cpus, CPU_SETSIZE), &timer};
+
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->begin) {
+            bench->sinks[s]->begin(bench->sinks[s], alg);
+        }
+    }
+    // On a thread of its own, pinned like the producers, so the process's
+    // own affinity is left alone
+    pthread_t tid;
+    int err = pthread_create(&tid, NULL, pool_run_main, &run);
+    if (err != 0) {
+        fprintf(stderr, "Failed to start key pool thread: %s\n", strerror(err));
+        exit(EXIT_FAILURE);
+    }
+    pthread_join(tid, NULL);
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->end) {
+            bench->sinks[s]->end(bench->sinks[s], alg);
+        }
+    }
+    pqb_timer_close(&timer);
+}
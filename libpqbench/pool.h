@@ -0,0 +1,32 @@
+#ifndef PQB_POOL_H
+#define PQB_POOL_H
+
+#include <stdint.h>
+#include <openssl/evp.h>
+
+// Pool of pregenerated key pairs of one algorithm: background threads keep a
+// bounded ring of ready keys full and any thread takes one without waiting.
+// The ring is lock free on both sides, a sequence number per slot telling
+// producers and consumers whose turn it is (Vyukov's bounded MPMC queue).
+typedef struct pqb_key_pool pqb_key_pool;
+
+// Start producers threads generating keys for alg into a ring of at least
+// capacity keys, rounded up to a power of two. Producer p is pinned to
+// cpus[p] unless cpus is NULL. Exits on failure.
+pqb_key_pool *pqb_key_pool_new(OSSL_LIB_CTX *libctx, const char *alg, int capacity, int producers, const int *cpus);
+
+// A ready key, now the caller's to free, or NULL if the pool is empty
+EVP_PKEY *pqb_key_pool_take(pqb_key_pool *pool);
+
+int pqb_key_pool_capacity(const pqb_key_pool *pool);
+
+// Keys ready now; only a snapshot while other threads use the pool
+uint64_t pqb_key_pool_size(pqb_key_pool *pool);
+
+// Keys the producers have put into the ring so far
+uint64_t pqb_key_pool_generated(pqb_key_pool *pool);
+
+// Stop and join the producers and free every key still in the ring
+void pqb_key_pool_free(pqb_key_pool *pool);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef PQBENCH_H
+#define PQBENCH_H
+
+#include "bench.h"
+#include "cli.h"
+#include "cost.h"
+#include "cycles.h"
+#include "dds.h"
+#include "discover.h"
+#include "families.h"
+#include "input.h"
+#include "isolate.h"
+#include "keys.h"
+#include "sink.h"
+#include "stats.h"
+#include "suite.h"
+#include "timer.h"
+
+#endif
@@ -0,0 +1,287 @@
+#include "samples.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+void pqb_samples_init(pqb_samples *s, pqb_samples_mode mode, uint64_t highest) {
+    memset(s, 0, sizeof(*s));
+    s->mode = mode;
+    if (mode == PQB_SAMPLES_HISTOGRAM) {
+        pqb_histogram_init(&s->histogram, highest);
+    }
+}
+
+void pqb_samples_free(pqb_samples *s) {
+    for (size_t c = 0; c < s->num_chunks; c++) {
+        free(s->chunks[c]);
+    }
+    free(s->chunks);
+    if (s->mode == PQB_SAMPLES_HISTOGRAM) {
+        pqb_histogram_free(&s->histogram);
+    }
+    memset(s, 0, sizeof(*s));
+}
+
+void pqb_samples_grow(pqb_samples *s) {
+    if (s->num_chunks == s->chunks_capacity) {
+        s->chunks_capacity = s->chunks_capacity ? s->chunks_capacity * 2 : 16;
+        s->chunks = realloc(s->chunks, s->chunks_capacity * sizeof(uint64_t *));
+        if (!s->chunks) {
+            fprintf(stderr, "Failed to allocate memory for samples\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    long page = sysconf(_SC_PAGESIZE);
+    size_t align = page > 0 && PQB_SAMPLES_CHUNK_BYTES % page == 0 ? (size_t)page : 4096;
+    uint64_t *chunk = aligned_alloc(align, PQB_SAMPLES_CHUNK_BYTES);
+    if (!chunk) {
+        fprintf(stderr, "Failed to allocate memory for samples\n");
+        exit(EXIT_FAILURE);
+    }
+    // Fault the pages in now rather than on the first write after a timed op
+    memset(chunk, 0, PQB_SAMPLES_CHUNK_BYTES);
+    s->chunks[s->num_chunks++] = chunk;
+}
+
+// Number of values in raw chunk c
+static size_t chunk_count(const pqb_samples *s, size_t c) {
+    size_t done = c * PQB_SAMPLES_PER_CHUNK;
+    return s->count - done < PQB_SAMPLES_PER_CHUNK ? s->count - done : PQB_SAMPLES_PER_CHUNK;
+}
+
+uint64_t *pqb_samples_copy(const pqb_samples *s) {
+    if (s->mode != PQB_SAMPLES_RAW) {
+        return NULL;
+    }
+    uint64_t *out = malloc((s->count ? s->count : 1) * sizeof(uint64_t));
+    if (!out) {
+        fprintf(stderr, "Failed to allocate memory for %zu samples\n", s->count);
+        exit(EXIT_FAILURE);
+    }
+    for (size_t c = 0; c * PQB_SAMPLES_PER_CHUNK < s->count; c++) {
+        memcpy(out + c * PQB_SAMPLES_PER_CHUNK, s->chunks[c], chunk_count(s, c) * sizeof(uint64_t));
+    }
+    return out;
+}
+
+// Past one chunk the raw samples are never merged into one array, so long
+// runs stay within the memory of their chunks. Once every chunk is sorted,
+// order statistics come from binary searches over the chunks, and the mean
+// from one streaming merge over just the ranks it covers.
+
+// Samples at most v, over the sorted chunks
+static size_t ranks_at_most(const pqb_samples *s, uint64_t v) {
+    size_t total = 0;
+    for (size_t c = 0; c * PQB_SAMPLES_PER_CHUNK < s->count; c++) {
+        const uint64_t *chunk = s->chunks[c];
+        size_t lo = 0, hi = chunk_count(s, c);
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (chunk[mid] <= v) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        total += lo;
+    }
+    return total;
+}
+
+// Samples below v, where v may be any real number
+static size_t ranks_below(const pqb_samples *s, double v) {
+    if (v <= 0) {
+        return 0;
+    }
+    if (v >= (double)UINT64_MAX) {
+        return s->count;
+    }
+    uint64_t c = (uint64_t)ceil(v);
+    return c == 0 ? 0 : ranks_at_most(s, c - 1);
+}
+
+// Samples at most v, where v may be any real number
+static size_t ranks_up_to(const pqb_samples *s, double v) {
+    if (v < 0) {
+        return 0;
+    }
+    return v >= (double)UINT64_MAX ? s->count : ranks_at_most(s, (uint64_t)floor(v));
+}
+
+// The sample of rank r, as sorted[r] would be
+static uint64_t select_rank(const pqb_samples *s, size_t r) {
+    uint64_t lo = 0, hi = UINT64_MAX;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (ranks_at_most(s, mid) > r) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+// As pqb_quantile_sorted
+static double quantile(const pqb_samples *s, double q) {
+    double h = (s->count - 1) * q;
+    size_t lo = (size_t)h;
+    if (lo + 1 >= s->count) {
+        return (double)select_rank(s, s->count - 1);
+    }
+    uint64_t a = select_rank(s, lo);
+    return a + (h - lo) * ((double)select_rank(s, lo + 1) - (double)a);
+}
+
+// Twice the deviation from the median of rank k among all samples, searched
+// in whole units since twice the median, m2, is an integer
+static unsigned __int128 deviation_rank(const pqb_samples *s, unsigned __int128 m2, size_t k) {
+    unsigned __int128 lo = 0, hi = (unsigned __int128)2 * UINT64_MAX;
+    while (lo < hi) {
+        unsigned __int128 d = lo + (hi - lo) / 2;
+        // Samples x with |2x - m2| <= d
+        unsigned __int128 top = (m2 + d) / 2;
+        size_t within = top >= UINT64_MAX ? s->count : ranks_at_most(s, (uint64_t)top);
+        if (m2 > d) {
+            unsigned __int128 bottom = (m2 - d + 1) / 2;
+            within -= bottom == 0 ? 0 : ranks_at_most(s, (uint64_t)(bottom - 1));
+        }
+        if (within > k) {
+            hi = d;
+        } else {
+            lo = d + 1;
+        }
+    }
+    return lo;
+}
+
+// Restore the min-heap of chunks ordered by their next value, from slot i down
+static void sift_down(uint64_t *const *chunks, const size_t *next, size_t *heap, size_t size, size_t i) {
+    for (;;) {
+        size_t least = i, l = 2 * i + 1, r = l + 1;
+        if (l < size && chunks[heap[l]][next[heap[l]]] < chunks[heap[least]][next[heap[least]]]) {
+            least = l;
+        }
+        if (r < size && chunks[heap[r]][next[heap[r]]] < chunks[heap[least]][next[heap[least]]]) {
+            least = r;
+        }
+        if (least == i) {
+            return;
+        }
+        size_t swap = heap[i];
+        heap[i] = heap[least];
+        heap[least] = swap;
+        i = least;
+    }
+}
+
+void pqb_samples_statistics(pqb_samples *s, const pqb_stats_options *opts, pqb_stats *out) {
+    if (s->mode == PQB_SAMPLES_HISTOGRAM) {
+        pqb_histogram_statistics(&s->histogram, opts, out);
+        return;
+    }
+    if (s->count == 0) {
+        pqb_compute_statistics_sorted(NULL, 0, opts, out);
+        return;
+    }
+
+    // Each chunk sorts with one chunk of scratch
+    uint64_t *tmp = malloc(PQB_SAMPLES_CHUNK_BYTES);
+    if (!tmp) {
+        fprintf(stderr, "Failed to allocate memory for samples\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t num_chunks = (s->count + PQB_SAMPLES_PER_CHUNK - 1) / PQB_SAMPLES_PER_CHUNK;
+    for (size_t c = 0; c < num_chunks; c++) {
+        pqb_sort_samples(s->chunks[c], tmp, chunk_count(s, c));
+    }
+    free(tmp);
+    if (num_chunks == 1) {
+        pqb_compute_statistics_sorted(s->chunks[0], s->count, opts, out);
+        return;
+    }
+
+    // The same fields as pqb_compute_statistics_sorted, in the same order
+    size_t n = s->count;
+    memset(out, 0, sizeof(*out));
+    out->num_samples = n;
+    out->confidence = opts->confidence;
+    out->min = (double)select_rank(s, 0);
+    out->max = (double)select_rank(s, n - 1);
+    out->median = quantile(s, 0.5);
+    out->p90 = quantile(s, 0.90);
+    out->p99 = quantile(s, 0.99);
+    out->p999 = quantile(s, 0.999);
+    unsigned __int128 m2 = n % 2 ? (unsigned __int128)2 * select_rank(s, n / 2)
+                                 : (unsigned __int128)select_rank(s, n / 2 - 1) + select_rank(s, n / 2);
+    unsigned __int128 mad2 = deviation_rank(s, m2, n / 2);
+    out->mad = n % 2 ? (double)mad2 / 2 : ((double)deviation_rank(s, m2, n / 2 - 1) + (double)mad2) / 4;
+    size_t lo_rank, hi_rank;
+    pqb_median_ci_ranks(n, opts->confidence, &lo_rank, &hi_rank);
+    out->median_ci_low = (double)select_rank(s, lo_rank);
+    out->median_ci_high = (double)select_rank(s, hi_rank);
+
+    // The ranks that enter the mean, as filtered_range in stats.c finds them
+    size_t first = 0, last = n;
+    size_t ignore_runs = n * IGNORE_PERCENTAGE;
+    size_t effective_runs = n - 2 * ignore_runs;
+    if (opts->filter == PQB_FILTER_LEGACY && effective_runs >= 4) {
+        double q1 = select_rank(s, ignore_runs + (effective_runs / 4));
+        double q3 = select_rank(s, ignore_runs + (3 * effective_runs / 4));
+        double iqr = q3 - q1;
+        first = ranks_below(s, q1 - IQR_MULTIPLIER * iqr);
+        first = first < ignore_runs ? ignore_runs : first > n - ignore_runs ? n - ignore_runs : first;
+        last = ranks_up_to(s, q3 + IQR_MULTIPLIER * iqr);
+        last = last < first ? first : last > n - ignore_runs ? n - ignore_runs : last;
+    }
+
+    // One merge of the sorted chunks through a heap up to rank last, keeping
+    // the filtered values only when few enough to bootstrap
+    size_t count = last - first;
+    int keep = opts->bootstrap_resamples > 0 && count > 1 && count <= PQB_BOOTSTRAP_MAX_SAMPLES;
+    uint64_t *values = keep ? malloc(count * sizeof(uint64_t)) : NULL;
+    size_t *next = calloc(num_chunks, sizeof(size_t));
+    size_t *heap = calloc(num_chunks, sizeof(size_t));
+    if (!next || !heap || (keep && !values)) {
+        fprintf(stderr, "Failed to allocate memory for %zu samples\n", n);
+        exit(EXIT_FAILURE);
+    }
+    size_t size = num_chunks;
+    for (size_t c = 0; c < num_chunks; c++) {
+        heap[c] = c;
+    }
+    for (size_t i = size / 2; i-- > 0;) {
+        sift_down(s->chunks, next, heap, size, i);
+    }
+    double mean = 0.0, m2_sum = 0.0;
+    for (size_t i = 0; i < last; i++) {
+        size_t c = heap[0];
+        uint64_t v = s->chunks[c][next[c]++];
+        if (next[c] == chunk_count(s, c)) {
+            heap[0] = heap[--size];
+        }
+        sift_down(s->chunks, next, heap, size, 0);
+        if (i < first) {
+            continue;
+        }
+        // Welford, as over the sorted array
+        double x = (double)v;
+        size_t k = i - first + 1;
+        double delta = x - mean;
+        mean += delta / k;
+        m2_sum += delta * (x - mean);
+        if (values) {
+            values[i - first] = v;
+        }
+    }
+    free(heap);
+    free(next);
+    out->num_filtered = count;
+    out->mean = mean;
+    out->std_dev = count ? sqrt(m2_sum / count) : 0.0;
+    pqb_mean_ci(values, count, mean, out->std_dev, opts, &out->mean_ci_low, &out->mean_ci_high);
+    free(values);
+}
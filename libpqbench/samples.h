@@ -0,0 +1,62 @@
+#ifndef PQB_SAMPLES_H
+#define PQB_SAMPLES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "histogram.h"
+#include "stats.h"
+
+// Where the samples of one op of a long run go. Raw keeps every value
+// exactly, in page aligned chunks that are never moved once written, so
+// growing costs one chunk allocation and no copy. Histogram keeps a fixed
+// amount of memory however long the run, to 3 significant digits up to the
+// highest trackable value, tails included.
+typedef enum {
+    PQB_SAMPLES_RAW,
+    PQB_SAMPLES_HISTOGRAM
+} pqb_samples_mode;
+
+#define PQB_SAMPLES_CHUNK_BYTES (64 * 1024)
+#define PQB_SAMPLES_PER_CHUNK (PQB_SAMPLES_CHUNK_BYTES / sizeof(uint64_t))
+
+typedef struct {
+    pqb_samples_mode mode;
+    uint64_t **chunks; // raw: each PQB_SAMPLES_PER_CHUNK values
+    size_t num_chunks;
+    size_t chunks_capacity;
+    size_t count;
+    pqb_histogram histogram; // histogram mode only
+} pqb_samples;
+
+// highest is the largest value the histogram mode tells apart
+void pqb_samples_init(pqb_samples *s, pqb_samples_mode mode, uint64_t highest);
+void pqb_samples_free(pqb_samples *s);
+
+// Append one more raw chunk, touching every page of it
+void pqb_samples_grow(pqb_samples *s);
+
+static inline void pqb_samples_add(pqb_samples *s, uint64_t value) {
+    if (s->mode == PQB_SAMPLES_HISTOGRAM) {
+        pqb_histogram_record(&s->histogram, value);
+    } else {
+        size_t chunk = s->count / PQB_SAMPLES_PER_CHUNK;
+        if (chunk == s->num_chunks) {
+            pqb_samples_grow(s);
+        }
+        s->chunks[chunk][s->count % PQB_SAMPLES_PER_CHUNK] = value;
+    }
+    s->count++;
+}
+
+// Raw mode: a contiguous copy of every value in order, for the caller to
+// free; NULL in histogram mode
+uint64_t *pqb_samples_copy(const pqb_samples *s);
+
+// The same statistics in either mode, exact for raw samples. Raw samples
+// are sorted chunk by chunk in place, so their order is lost: copy them
+// first if it matters. Beyond that only the filtered values, when few
+// enough to bootstrap, are copied.
+void pqb_samples_statistics(pqb_samples *s, const pqb_stats_options *opts, pqb_stats *out);
+
+#endif
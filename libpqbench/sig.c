@@ -0,0 +1,663 @@
+#include "families.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#include "keys.h"
+#include "oqs.h"
+
+typedef struct {
+    OSSL_LIB_CTX *libctx;
+    const char *alg;
+    EVP_PKEY *pkey;
+    const unsigned char *msg;
+    size_t msg_len;
+    unsigned char *sig;
+    unsigned int sig_len;
+    // Hot mode only
+    EVP_MD *md;
+    EVP_MD_CTX *md_ctx;
+    EVP_PKEY_CTX *sign_ctx;
+    EVP_PKEY_CTX *verify_ctx;
+    size_t sig_size;
+    // Batch mode only
+    int batch_size;
+    unsigned char *sigs; // batch_size * sig_size bytes
+    size_t *sig_lens;
+    // Leakage mode only
+    const unsigned char *fixed_msg;
+    unsigned char *inputs; // PQB_LEAKAGE_BLOCK messages of msg_len bytes
+#if PQB_HAVE_LIBOQS
+    // Paths mode only; liboqs has its own key pair for the same algorithm
+    OQS_SIG *oqs;
+    uint8_t *oqs_public_key;
+    uint8_t *oqs_secret_key;
+    uint8_t *oqs_sig;
+    size_t oqs_sig_len;
+#endif
+} sig_state;
+
+#if PQB_HAVE_LIBOQS
+static const pqb_family sig_liboqs_family;
+#endif
+
+static sig_state *sig_state_new(pqb_bench *bench, const char *alg) {
+    sig_state *st = calloc(1, sizeof(*st));
+    if (!st) {
+        fprintf(stderr, "Failed to allocate signature state for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    st->libctx = bench->libctx;
+    st->alg = alg;
+    st->msg = bench->payload;
+    st->msg_len = bench->payload_len;
+    return st;
+}
+
+// A cold state has a key pair of its own, as a one-off caller would, with
+// none of the provider's caches on it warmed by other runs
+static void *sig_create(pqb_bench *bench, const char *alg) {
+    sig_state *st = sig_state_new(bench, alg);
+    st->pkey = pqb_generate_key(bench->libctx, alg);
+    return st;
+}
+
+static void sig_destroy(void *state) {
+    sig_state *st = state;
+    EVP_PKEY_free(st->pkey);
+    OPENSSL_free(st->sig);
+    free(st);
+}
+
+// Sign the payload using the private key of the algorithm
+static void sig_sign(void *state) {
+    sig_state *st = state;
+
+    EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+    EVP_SignInit(md_ctx, EVP_get_digestbyname("sha256"));
+    EVP_SignUpdate(md_ctx, st->msg, st->msg_len);
+    st->sig = OPENSSL_malloc(EVP_PKEY_size(st->pkey));
+    if (!EVP_SignFinal(md_ctx, st->sig, &st->sig_len, st->pkey)) {
+        fprintf(stderr, "Failed to sign the payload with %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+
+    EVP_MD_CTX_free(md_ctx);
+}
+
+// Verify the signature just made using the public key of the algorithm
+static void sig_verify(void *state) {
+    sig_state *st = state;
+
+    EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+    EVP_VerifyInit(md_ctx, EVP_get_digestbyname("sha256"));
+    EVP_VerifyUpdate(md_ctx, st->msg, st->msg_len);
+    int verify_result = EVP_VerifyFinal(md_ctx, st->sig, st->sig_len, st->pkey);
+
+    EVP_MD_CTX_free(md_ctx);
+
+    if (verify_result != 1) {
+        fprintf(stderr, "Failed to verify the signature for algorithm %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void sig_finish_iteration(void *state) {
+    sig_state *st = state;
+    OPENSSL_free(st->sig);
+    st->sig = NULL;
+}
+
+static const pqb_op sig_ops[] = {
+    {"signing", "Signing", NULL, sig_sign, NULL, 0},
+    {"verifying", "Verifying", NULL, sig_verify, sig_finish_iteration, 0},
+};
+
+// Hot mode does what EVP_SignFinal and EVP_VerifyFinal do internally, but
+// with the digest fetched once, one reused EVP_MD_CTX and signing and
+// verifying contexts that are initialised once for the key
+
+// Hot states time the primitive alone, so they may share the bench's key pair
+static void *sig_hot_create(pqb_bench *bench, const char *alg) {
+    sig_state *st = sig_state_new(bench, alg);
+    st->pkey = pqb_key_cache_get(bench->keys, bench->libctx, alg);
+
+    st->md = EVP_MD_fetch(st->libctx, "SHA256", NULL);
+    st->md_ctx = EVP_MD_CTX_new();
+    st->sign_ctx = EVP_PKEY_CTX_new_from_pkey(st->libctx, st->pkey, NULL);
+    st->verify_ctx = EVP_PKEY_CTX_new_from_pkey(st->libctx, st->pkey, NULL);
+    if (!st->md || !st->md_ctx || !st->sign_ctx || !st->verify_ctx) {
+        fprintf(stderr, "Failed to set up signing contexts for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    if (EVP_PKEY_sign_init(st->sign_ctx) <= 0 || EVP_PKEY_CTX_set_signature_md(st->sign_ctx, st->md) <= 0 ||
+        EVP_PKEY_verify_init(st->verify_ctx) <= 0 || EVP_PKEY_CTX_set_signature_md(st->verify_ctx, st->md) <= 0) {
+        fprintf(stderr, "Failed to initialize signing contexts for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+
+    st->sig_size = EVP_PKEY_size(st->pkey);
+    st->sig = OPENSSL_malloc(st->sig_size);
+    if (!st->sig) {
+        fprintf(stderr, "Failed to allocate signature buffer for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    return st;
+}
+
+static void sig_hot_destroy(void *state) {
+    sig_state *st = state;
+    EVP_PKEY_CTX_free(st->sign_ctx);
+    EVP_PKEY_CTX_free(st->verify_ctx);
+    EVP_MD_CTX_free(st->md_ctx);
+    EVP_MD_free(st->md);
+    sig_destroy(st);
+}
+
+static unsigned int sig_hot_digest(sig_state *st, unsigned char *digest) {
+    unsigned int digest_len = 0;
+    if (!EVP_DigestInit_ex2(st->md_ctx, st->md, NULL) || !EVP_DigestUpdate(st->md_ctx, st->msg, st->msg_len) ||
+        !EVP_DigestFinal_ex(st->md_ctx, digest, &digest_len)) {
+        fprintf(stderr, "Failed to digest the payload for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    return digest_len;
+}
+
+static void sig_hot_sign(void *state) {
+    sig_state *st = state;
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = sig_hot_digest(st, digest);
+
+    size_t sig_len = st->sig_size;
+    if (EVP_PKEY_sign(st->sign_ctx, st->sig, &sig_len, digest, digest_len) <= 0) {
+        fprintf(stderr, "Failed to sign the payload with %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    st->sig_len = sig_len;
+}
+
+static void sig_hot_verify(void *state) {
+    sig_state *st = state;
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = sig_hot_digest(st, digest);
+
+    if (EVP_PKEY_verify(st->verify_ctx, st->sig, st->sig_len, digest, digest_len) != 1) {
+        fprintf(stderr, "Failed to verify the signature for algorithm %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static const pqb_op sig_hot_ops[] = {
+    {"signing_hot", "Signing (hot)", NULL, sig_hot_sign, NULL, 0},
+    {"verifying_hot", "Verifying (hot)", NULL, sig_hot_verify, NULL, 0},
+};
+
+static const pqb_family sig_hot_family = {
+    .name = "sig_hot",
+    .ops = sig_hot_ops,
+    .num_ops = sizeof(sig_hot_ops) / sizeof(sig_hot_ops[0]),
+    .create = sig_hot_create,
+    .destroy = sig_hot_destroy,
+    .algorithms = PQB_ALGS_SIGNATURE,
+#if PQB_HAVE_LIBOQS
+    .liboqs = &sig_liboqs_family,
+#endif
+};
+
+// Leakage mode signs, as hot mode does, either the bench payload or a random
+// message of the same length with the same key. Both classes are copies in
+// one block of messages, so neither is signed from a buffer the other left
+// cold or fresh in the cache.
+
+static void *sig_leakage_create(pqb_bench *bench, const char *alg) {
+    sig_state *st = sig_hot_create(bench, alg);
+    st->fixed_msg = st->msg;
+    st->inputs = OPENSSL_malloc(PQB_LEAKAGE_BLOCK * (st->msg_len ? st->msg_len : 1));
+    if (!st->inputs) {
+        fprintf(stderr, "Failed to allocate message buffers for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    return st;
+}
+
+static void sig_leakage_destroy(void *state) {
+    sig_state *st = state;
+    OPENSSL_free(st->inputs);
+    sig_hot_destroy(st);
+}
+
+static void sig_leakage_make_input(void *state, int slot, int input_class) {
+    sig_state *st = state;
+    unsigned char *msg = st->inputs + slot * st->msg_len;
+    if (input_class == 0) {
+        memcpy(msg, st->fixed_msg, st->msg_len);
+    } else if (st->msg_len && RAND_bytes(msg, (int)st->msg_len) != 1) {
+        fprintf(stderr, "Failed to generate a random message\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void sig_leakage_use_input(void *state, int slot) {
+    sig_state *st = state;
+    st->msg = st->inputs + slot * st->msg_len;
+}
+
+static const pqb_op sig_leakage_ops[] = {
+    {"signing", "Signing", NULL, sig_hot_sign, NULL, 0},
+};
+
+static const pqb_family sig_leakage_family = {
+    .name = "sig_leakage",
+    .ops = sig_leakage_ops,
+    .num_ops = sizeof(sig_leakage_ops) / sizeof(sig_leakage_ops[0]),
+    .create = sig_leakage_create,
+    .destroy = sig_leakage_destroy,
+    .make_input = sig_leakage_make_input,
+    .use_input = sig_leakage_use_input,
+    .input_classes = {"fixed message", "random message"},
+};
+
+// Load mode signs and verifies the payload with hot mode's contexts; a
+// signature is made up front so that verifying can be the first request
+
+static void *sig_load_create(pqb_bench *bench, const char *alg) {
+    sig_state *st = sig_hot_create(bench, alg);
+    sig_hot_sign(st);
+    return st;
+}
+
+static const pqb_op sig_load_ops[] = {
+    {"signing", "Signing", NULL, sig_hot_sign, NULL, 0},
+    {"verifying", "Verifying", NULL, sig_hot_verify, NULL, 0},
+};
+
+static const pqb_family sig_load_family = {
+    .name = "sig_load",
+    .ops = sig_load_ops,
+    .num_ops = sizeof(sig_load_ops) / sizeof(sig_load_ops[0]),
+    .create = sig_load_create,
+    .destroy = sig_hot_destroy,
+};
+
+// Batch mode signs the payload batch_size times into one contiguous buffer,
+// then verifies all of them, with the contexts of hot mode
+
+static void *sig_batch_create(pqb_bench *bench, const char *alg) {
+    sig_state *st = sig_hot_create(bench, alg);
+    st->batch_size = bench->batch_size;
+    st->sigs = OPENSSL_malloc(st->batch_size * st->sig_size);
+    st->sig_lens = calloc(st->batch_size, sizeof(size_t));
+    if (!st->sigs || !st->sig_lens) {
+        fprintf(stderr, "Failed to allocate memory for a batch of %d signatures\n", st->batch_size);
+        exit(EXIT_FAILURE);
+    }
+    return st;
+}
+
+static void sig_batch_destroy(void *state) {
+    sig_state *st = state;
+    OPENSSL_free(st->sigs);
+    free(st->sig_lens);
+    sig_hot_destroy(st);
+}
+
+static void sig_batch_sign(void *state) {
+    sig_state *st = state;
+    unsigned char digest[EVP_MAX_MD_SIZE];
+
+    for (int i = 0; i < st->batch_size; i++) {
+        unsigned int digest_len = sig_hot_digest(st, digest);
+        st->sig_lens[i] = st->sig_size;
+        if (EVP_PKEY_sign(st->sign_ctx, st->sigs + i * st->sig_size, &st->sig_lens[i], digest,
+                          digest_len) <= 0) {
+            fprintf(stderr, "Failed to sign the payload with %s\n", st->alg);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void sig_batch_verify(void *state) {
+    sig_state *st = state;
+    unsigned char digest[EVP_MAX_MD_SIZE];
+
+    for (int i = 0; i < st->batch_size; i++) {
+        unsigned int digest_len = sig_hot_digest(st, digest);
+        if (EVP_PKEY_verify(st->verify_ctx, st->sigs + i * st->sig_size, st->sig_lens[i], digest,
+                            digest_len) != 1) {
+            fprintf(stderr, "Failed to verify the signature for algorithm %s\n", st->alg);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static const pqb_op sig_batch_ops[] = {
+    {"signing_batch", "Signing (batch)", NULL, sig_batch_sign, NULL, 1},
+    {"verifying_batch", "Verifying (batch)", NULL, sig_batch_verify, NULL, 1},
+};
+
+static const pqb_family sig_batch_family = {
+    .name = "sig_batch",
+    .ops = sig_batch_ops,
+    .num_ops = sizeof(sig_batch_ops) / sizeof(sig_batch_ops[0]),
+    .create = sig_batch_create,
+    .destroy = sig_batch_destroy,
+};
+
+// Paths mode signs the same payload three ways: the SHA-256 pre-hash of
+// EVP_SignFinal that the other modes use, a one-shot EVP_DigestSign with no
+// digest so the scheme hashes the message itself, and the raw OQS_SIG API.
+// Both EVP paths set up their contexts per call, so the first two differ only
+// in the extra hash.
+
+#if PQB_HAVE_LIBOQS
+// liboqs has its own key pair for the same algorithm
+static void sig_oqs_setup(sig_state *st) {
+    const char *oqs_name = pqb_oqs_sig_name(st->alg);
+    st->oqs = oqs_name ? OQS_SIG_new(oqs_name) : NULL;
+    if (!st->oqs) {
+        fprintf(stderr, "liboqs has no signature algorithm matching %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    st->oqs_public_key = OPENSSL_malloc(st->oqs->length_public_key);
+    st->oqs_secret_key = OPENSSL_malloc(st->oqs->length_secret_key);
+    st->oqs_sig = OPENSSL_malloc(st->oqs->length_signature);
+    if (!st->oqs_public_key || !st->oqs_secret_key || !st->oqs_sig) {
+        fprintf(stderr, "Failed to allocate liboqs buffers for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    if (OQS_SIG_keypair(st->oqs, st->oqs_public_key, st->oqs_secret_key) != OQS_SUCCESS) {
+        fprintf(stderr, "Failed to generate liboqs key pair for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void sig_oqs_teardown(sig_state *st) {
+    OPENSSL_free(st->oqs_public_key);
+    OPENSSL_clear_free(st->oqs_secret_key, st->oqs->length_secret_key);
+    OPENSSL_free(st->oqs_sig);
+    OQS_SIG_free(st->oqs);
+}
+#endif
+
+static void *sig_paths_create(pqb_bench *bench, const char *alg) {
+    sig_state *st = sig_create(bench, alg);
+#if PQB_HAVE_LIBOQS
+    sig_oqs_setup(st);
+#endif
+    return st;
+}
+
+static void sig_paths_destroy(void *state) {
+#if PQB_HAVE_LIBOQS
+    sig_oqs_teardown(state);
+#endif
+    sig_destroy(state);
+}
+
+static void sig_oneshot_sign(void *state) {
+    sig_state *st = state;
+
+    EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+    if (!md_ctx || EVP_DigestSignInit_ex(md_ctx, NULL, NULL, st->libctx, NULL, st->pkey, NULL) <= 0) {
+        fprintf(stderr, "Failed to initialize one-shot signing for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    size_t sig_len = EVP_PKEY_size(st->pkey);
+    st->sig = OPENSSL_malloc(sig_len);
+    if (!st->sig || EVP_DigestSign(md_ctx, st->sig, &sig_len, st->msg, st->msg_len) <= 0) {
+        fprintf(stderr, "Failed to sign the payload with %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    st->sig_len = sig_len;
+
+    EVP_MD_CTX_free(md_ctx);
+}
+
+static void sig_oneshot_verify(void *state) {
+    sig_state *st = state;
+
+    EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+    if (!md_ctx || EVP_DigestVerifyInit_ex(md_ctx, NULL, NULL, st->libctx, NULL, st->pkey, NULL) <= 0) {
+        fprintf(stderr, "Failed to initialize one-shot verification for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+    int verify_result = EVP_DigestVerify(md_ctx, st->sig, st->sig_len, st->msg, st->msg_len);
+
+    EVP_MD_CTX_free(md_ctx);
+
+    if (verify_result != 1) {
+        fprintf(stderr, "Failed to verify the signature for algorithm %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+}
+
+#if PQB_HAVE_LIBOQS
+static void sig_oqs_sign(void *state) {
+    sig_state *st = state;
+    st->oqs_sig_len = st->oqs->length_signature;
+    if (OQS_SIG_sign(st->oqs, st->oqs_sig, &st->oqs_sig_len, st->msg, st->msg_len, st->oqs_secret_key) !=
+        OQS_SUCCESS) {
+        fprintf(stderr, "Failed to sign the payload with %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void sig_oqs_verify(void *state) {
+    sig_state *st = state;
+    if (OQS_SIG_verify(st->oqs, st->msg, st->msg_len, st->oqs_sig, st->oqs_sig_len, st->oqs_public_key) !=
+        OQS_SUCCESS) {
+        fprintf(stderr, "Failed to verify the signature for algorithm %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+}
+#endif
+
+static const pqb_op sig_paths_ops[] = {
+    {"signing_prehash", "Signing (SHA-256 pre-hash)", NULL, sig_sign, NULL, 0},
+    {"verifying_prehash", "Verifying (SHA-256 pre-hash)", NULL, sig_verify, sig_finish_iteration, 0},
+    {"signing_oneshot", "Signing (one-shot)", NULL, sig_oneshot_sign, NULL, 0},
+    {"verifying_oneshot", "Verifying (one-shot)", NULL, sig_oneshot_verify, sig_finish_iteration, 0},
+#if PQB_HAVE_LIBOQS
+    {"signing_liboqs", "Signing (liboqs)", NULL, sig_oqs_sign, NULL, 0},
+    {"verifying_liboqs", "Verifying (liboqs)", NULL, sig_oqs_verify, NULL, 0},
+#endif
+};
+
+#if PQB_HAVE_LIBOQS
+// The two EVP paths alone, for algorithms liboqs does not have
+static const pqb_family sig_evp_paths_family = {
+    .name = "sig_paths",
+    .ops = sig_paths_ops,
+    .num_ops = 4,
+    .create = sig_create,
+    .destroy = sig_destroy,
+};
+
+static const pqb_family sig_paths_family;
+
+static const pqb_family *sig_paths_resolve(const char *alg) {
+    return pqb_oqs_sig_name(alg) ? &sig_paths_family : &sig_evp_paths_family;
+}
+#endif
+
+static const pqb_family sig_paths_family = {
+    .name = "sig_paths",
+    .ops = sig_paths_ops,
+    .num_ops = sizeof(sig_paths_ops) / sizeof(sig_paths_ops[0]),
+    .create = sig_paths_create,
+    .destroy = sig_paths_destroy,
+#if PQB_HAVE_LIBOQS
+    .resolve = sig_paths_resolve,
+#endif
+};
+
+#if PQB_HAVE_LIBOQS
+// The liboqs backend of a comparison signs and verifies through OQS_SIG
+// alone, with no EVP key at all
+
+static void *sig_liboqs_create(pqb_bench *bench, const char *alg) {
+    sig_state *st = sig_state_new(bench, alg);
+    sig_oqs_setup(st);
+    return st;
+}
+
+static void sig_liboqs_destroy(void *state) {
+    sig_oqs_teardown(state);
+    sig_destroy(state);
+}
+
+static const pqb_op sig_liboqs_ops[] = {
+    {"signing", "Signing (liboqs)", NULL, sig_oqs_sign, NULL, 0},
+    {"verifying", "Verifying (liboqs)", NULL, sig_oqs_verify, NULL, 0},
+};
+
+static const pqb_family sig_liboqs_family = {
+    .name = "sig_liboqs",
+    .ops = sig_liboqs_ops,
+    .num_ops = sizeof(sig_liboqs_ops) / sizeof(sig_liboqs_ops[0]),
+    .create = sig_liboqs_create,
+    .destroy = sig_liboqs_destroy,
+};
+#endif
+
+const pqb_family pqb_sig_family = {
+    .name = "sig",
+    .ops = sig_ops,
+    .num_ops = sizeof(sig_ops) / sizeof(sig_ops[0]),
+    .create = sig_create,
+    .destroy = sig_destroy,
+    .hot = &sig_hot_family,
+    .batch = &sig_batch_family,
+    .paths = &sig_paths_family,
+    .leakage = &sig_leakage_family,
+    .load = &sig_load_family,
+    .chain = &pqb_chain_family,
+    .algorithms = PQB_ALGS_SIGNATURE,
+#if PQB_HAVE_LIBOQS
+    .liboqs = &sig_liboqs_family,
+#endif
+};
+
+typedef struct {
+    OSSL_LIB_CTX *libctx;
+    const char *alg;
+    EVP_PKEY *pkey;
+} keygen_state;
+
+static void *keygen_create(pqb_bench *bench, const char *alg) {
+    keygen_state *st = calloc(1, sizeof(*st));
+    if (!st) {
+        fprintf(stderr, "Failed to allocate keygen state for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    st->libctx = bench->libctx;
+    st->alg = alg;
+    return st;
+}
+
+static void keygen_destroy(void *state) {
+    free(state);
+}
+
+static void keygen_run(void *state) {
+    keygen_state *st = state;
+    st->pkey = pqb_generate_key(st->libctx, st->alg);
+}
+
+static void keygen_finish(void *state) {
+    keygen_state *st = state;
+    EVP_PKEY_free(st->pkey);
+    st->pkey = NULL;
+}
+
+static const pqb_op keygen_ops[] = {
+    {"keygen", "Key generation", NULL, keygen_run, keygen_finish, 0},
+};
+
+// Hot mode generates every key from one context fetched and set up in create
+
+typedef struct {
+    keygen_state base;
+    EVP_PKEY_CTX *ctx;
+} keygen_hot_state;
+
+static void *keygen_hot_create(pqb_bench *bench, const char *alg) {
+    keygen_hot_state *st = calloc(1, sizeof(*st));
+    if (!st) {
+        fprintf(stderr, "Failed to allocate keygen state for %s\n", alg);
+        exit(EXIT_FAILURE);
+    }
+    st->base.libctx = bench->libctx;
+    st->base.alg = alg;
+    st->ctx = pqb_keygen_ctx_new(bench->libctx, alg);
+    return st;
+}
+
+static void keygen_hot_destroy(void *state) {
+    keygen_hot_state *st = state;
+    EVP_PKEY_CTX_free(st->ctx);
+    free(st);
+}
+
+static void keygen_hot_run(void *state) {
+    keygen_hot_state *st = state;
+    if (EVP_PKEY_generate(st->ctx, &st->base.pkey) <= 0) {
+        fprintf(stderr, "Failed to generate key pair for %s\n", st->base.alg);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static const pqb_op keygen_hot_ops[] = {
+    {"keygen_hot", "Key generation (hot)", NULL, keygen_hot_run, keygen_finish, 0},
+};
+
+#if PQB_HAVE_LIBOQS
+static void keygen_oqs_run(void *state) {
+    sig_state *st = state;
+    if (OQS_SIG_keypair(st->oqs, st->oqs_public_key, st->oqs_secret_key) != OQS_SUCCESS) {
+        fprintf(stderr, "Failed to generate liboqs key pair for %s\n", st->alg);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static const pqb_op keygen_liboqs_ops[] = {
+    {"keygen", "Key generation (liboqs)", NULL, keygen_oqs_run, NULL, 0},
+};
+
+static const pqb_family keygen_liboqs_family = {
+    .name = "keygen_liboqs",
+    .ops = keygen_liboqs_ops,
+    .num_ops = sizeof(keygen_liboqs_ops) / sizeof(keygen_liboqs_ops[0]),
+    .create = sig_liboqs_create,
+    .destroy = sig_liboqs_destroy,
+};
+#endif
+
+static const pqb_family keygen_hot_family = {
+    .name = "keygen_hot",
+    .ops = keygen_hot_ops,
+    .num_ops = sizeof(keygen_hot_ops) / sizeof(keygen_hot_ops[0]),
+    .create = keygen_hot_create,
+    .destroy = keygen_hot_destroy,
+    .algorithms = PQB_ALGS_SIGNATURE,
+#if PQB_HAVE_LIBOQS
+    .liboqs = &keygen_liboqs_family,
+#endif
+};
+
+const pqb_family pqb_keygen_family = {
+    .name = "keygen",
+    .ops = keygen_ops,
+    .num_ops = sizeof(keygen_ops) / sizeof(keygen_ops[0]),
+    .create = keygen_create,
+    .destroy = keygen_destroy,
+    .hot = &keygen_hot_family,
+    .algorithms = PQB_ALGS_SIGNATURE,
+#if PQB_HAVE_LIBOQS
+    .liboqs = &keygen_liboqs_family,
+#endif
+};
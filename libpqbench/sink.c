@@ -0,0 +1,301 @@
+#include "sink.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+typedef struct {
+    pqb_sink base;
+    FILE *out;
+} text_sink;
+
+static void text_begin(pqb_sink *sink, const char *algorithm) {
+    text_sink *ts = (text_sink *)sink;
+    fprintf(ts->out, "Algorithm: %s\n", algorithm);
+}
+
+static void text_result(pqb_sink *sink, const pqb_result *r) {
+    text_sink *ts = (text_sink *)sink;
+    double scale = pqb_timer_scale(r->timer);
+    const char *unit = pqb_timer_unit(r->timer);
+
+    const pqb_stats *st = &r->stats;
+
+    // Calculate the percentage of standard deviation with respect to the mean
+    double std_dev_percentage = (st->std_dev / st->mean) * 100;
+
+    fprintf(ts->out, "%s - Mean: %f %s, Standard deviation: %f %s, Standard deviation percentage: %f%%\n",
+            r->op->label, st->mean * scale, unit, st->std_dev * scale, unit, std_dev_percentage);
+    fprintf(ts->out,
+            "    Median: %f %s (%.0f%% CI %f - %f), p90: %f, p99: %f, p99.9: %f, Min: %f, Max: %f, MAD: %f, "
+            "Mean %.0f%% CI: %f - %f, Samples: %zu (%zu in mean), Warmup: %d\n",
+            st->median * scale, unit, st->confidence * 100, st->median_ci_low * scale, st->median_ci_high * scale,
+            st->p90 * scale, st->p99 * scale, st->p999 * scale, st->min * scale, st->max * scale, st->mad * scale,
+            st->confidence * 100, st->mean_ci_low * scale, st->mean_ci_high * scale, st->num_samples,
+            st->num_filtered, r->warmup_runs);
+    if (r->wire_bytes) {
+        fprintf(ts->out, "    Bytes on the wire: %zu\n", r->wire_bytes);
+    }
+    if (r->allocs_counted) {
+        fprintf(ts->out, "    Allocations: %f per operation, %f bytes per operation\n", r->allocs_per_op,
+                r->alloc_bytes_per_op);
+    }
+    if (r->counters_counted) {
+        const double *n = r->counters_per_op;
+        const char *sep = " ";
+        fprintf(ts->out, "    Counters per operation:");
+        for (int c = 0; c < PQB_NUM_COUNTERS; c++) {
+            if (n[c] >= 0) {
+                fprintf(ts->out, "%s%s: %.1f", sep, pqb_counter_label(c), n[c]);
+                sep = ", ";
+            }
+        }
+        if (n[PQB_COUNTER_INSTRUCTIONS] >= 0 && n[PQB_COUNTER_CYCLES] > 0) {
+            fprintf(ts->out, "%sIPC: %.3f", sep, n[PQB_COUNTER_INSTRUCTIONS] / n[PQB_COUNTER_CYCLES]);
+        }
+        fprintf(ts->out, "\n");
+    }
+    if (r->memory_measured) {
+        const pqb_memory_usage *m = &r->memory;
+        fprintf(ts->out, "    Memory:");
+        if (m->peak_heap >= 0) {
+            fprintf(ts->out, " Peak heap: %lld bytes,", (long long)m->peak_heap);
+        }
+        if (m->peak_rss >= 0) {
+            fprintf(ts->out, " Peak RSS growth: %lld bytes,", (long long)m->peak_rss);
+        }
+        fprintf(ts->out, " Stack: %lld bytes\n", (long long)m->stack);
+    }
+    if (r->ops_per_sample > 1) {
+        double per_op = scale / r->ops_per_sample;
+        fprintf(ts->out, "    Per operation (batch of %d): Mean: %f %s, Median: %f %s, Mean %.0f%% CI: %f - %f\n",
+                r->ops_per_sample, st->mean * per_op, unit, st->median * per_op, unit, st->confidence * 100,
+                st->mean_ci_low * per_op, st->mean_ci_high * per_op);
+    }
+}
+
+static void text_throughput(pqb_sink *sink, const pqb_throughput_result *r) {
+    text_sink *ts = (text_sink *)sink;
+    double scale = pqb_timer_scale(r->timer);
+    const char *unit = pqb_timer_unit(r->timer);
+
+    fprintf(ts->out, "%s - %s%sThreads: %d, Throughput: %f ops/s, Speedup: %fx, Iterations: %f /s, Median latency: %f %s, "
+            "p99 latency: %f %s\n",
+            r->op->label, r->topology ? r->topology : "", r->topology ? ", " : "", r->threads, r->ops_per_sec, r->speedup, r->iterations_per_sec, r->stats.median * scale, unit, r->stats.p99 * scale,
+            unit);
+    fprintf(ts->out, "    Per-thread median latency (%s):", unit);
+    for (int t = 0; t < r->threads; t++) {
+        fprintf(ts->out, " cpu%d %f", r->cpus[t], r->thread_stats[t].median * scale);
+    }
+    fprintf(ts->out, "\n");
+}
+
+static void text_sweep(pqb_sink *sink, const pqb_sweep_result *r) {
+    text_sink *ts = (text_sink *)sink;
+    double scale = pqb_timer_scale(r->timer);
+    const char *unit = pqb_timer_unit(r->timer);
+
+    for (int p = 0; p < r->num_points; p++) {
+        fprintf(ts->out, "%s - Payload: %zu bytes, Mean: %f %s, Median: %f %s, p99: %f %s\n", r->op->label,
+                r->sizes[p], r->stats[p].mean * scale, unit, r->stats[p].median * scale, unit,
+                r->stats[p].p99 * scale, unit);
+    }
+    fprintf(ts->out, "%s - Fixed cost: %f %s, Per KiB: %f %s, R squared: %f\n", r->op->label, r->fixed * scale, unit,
+            r->per_byte * 1024 * scale, unit, r->r_squared);
+}
+
+// A table of medians, one column per backend, each relative to the first
+// measured backend
+static void text_comparison(pqb_sink *sink, const pqb_comparison_result *r) {
+    text_sink *ts = (text_sink *)sink;
+    double scale = pqb_timer_scale(r->timer);
+    int num_ops = r->family->num_ops;
+
+    fprintf(ts->out, "Backend comparison, median %s:\n%-32s", pqb_timer_unit(r->timer), "Operation");
+    for (int b = 0; b < r->num_backends; b++) {
+        if (r->measured[b]) {
+            fprintf(ts->out, " %24s", r->backends[b].name);
+        }
+    }
+    fprintf(ts->out, "\n");
+    for (int o = 0; o < num_ops; o++) {
+        fprintf(ts->out, "%-32s", r->family->ops[o].label);
+        double reference = 0.0;
+        for (int b = 0; b < r->num_backends; b++) {
+            if (!r->measured[b]) {
+                continue;
+            }
+            double median = r->stats[b * num_ops + o].median;
+            if (reference == 0.0) {
+                reference = median;
+            }
+            char cell[64];
+            snprintf(cell, sizeof(cell), "%f (%.2fx)", median * scale, reference > 0 ? median / reference : 0.0);
+            fprintf(ts->out, " %24s", cell);
+        }
+        fprintf(ts->out, "\n");
+    }
+}
+
+static void text_leakage(pqb_sink *sink, const pqb_leakage_result *r) {
+    text_sink *ts = (text_sink *)sink;
+    double scale = pqb_timer_scale(r->timer);
+    const char *unit = pqb_timer_unit(r->timer);
+
+    fprintf(ts->out, "%s - Leakage test, %s vs %s: %s (max |t| %f, threshold %.1f)\n", r->op->label,
+            r->input_classes[0], r->input_classes[1], r->leaky ? "leakage likely" : "no leakage detected", r->max_t,
+            PQB_LEAKAGE_T_THRESHOLD);
+    fprintf(ts->out, "    Measurements: %llu (%llu / %llu), Means: %f / %f %s, t: %f, Max |t| over %llu samples",
+            (unsigned long long)r->measurements, (unsigned long long)r->counts[0],
+            (unsigned long long)r->counts[1], r->means[0] * scale, r->means[1] * scale, unit, r->t,
+            (unsigned long long)r->max_t_samples);
+    if (r->max_t_threshold > 0) {
+        fprintf(ts->out, " below %f %s", r->max_t_threshold * scale, unit);
+    }
+    fprintf(ts->out, ", Max tau: %f\n", r->max_tau);
+}
+
+static void text_handshake(pqb_sink *sink, const pqb_handshake_estimate *e) {
+    text_sink *ts = (text_sink *)sink;
+    fprintf(ts->out, "Handshake estimate, %.1f ms RTT, %.1f Mbit/s, %d certificates:\n", e->rtt_ms,
+            e->bandwidth_mbps, e->chain_certs);
+    fprintf(ts->out, "    Bytes: %zu client / %zu server, Round trips: %d\n", e->client_bytes, e->server_bytes,
+            e->round_trips);
+    fprintf(ts->out, "    CPU: %f ms client / %f ms server, Transfer: %f ms, Latency: %f ms\n", e->client_cpu_ms,
+            e->server_cpu_ms, e->transfer_ms, e->latency_ms);
+}
+
+static void text_mesh(pqb_sink *sink, const pqb_mesh_estimate *e) {
+    text_sink *ts = (text_sink *)sink;
+    fprintf(ts->out, "Discovery storm, %d participants, %.1f ms RTT, ", e->participants, e->rtt_ms);
+    if (e->bandwidth_mbps > 0) {
+        fprintf(ts->out, "%.1f Mbit/s:\n", e->bandwidth_mbps);
+    } else {
+        fprintf(ts->out, "unlimited bandwidth:\n");
+    }
+    fprintf(ts->out, "    Handshakes: %llu, Bytes: %zu request / %zu reply / %zu final, One handshake: %f ms\n",
+            (unsigned long long)e->handshakes, e->request_bytes, e->reply_bytes, e->final_bytes, e->handshake_ms);
+    fprintf(ts->out, "    Time to full mesh: %f ms, CPU per participant: %f ms (min %f, max %f), Sent per participant: %.0f bytes\n",
+            e->full_mesh_ms, e->cpu_ms_mean, e->cpu_ms_min, e->cpu_ms_max, e->sent_bytes_mean);
+}
+
+static const char *arrival_name(pqb_arrival arrival) {
+    return arrival == PQB_ARRIVAL_POISSON ? "poisson" : "fixed";
+}
+
+static void text_load(pqb_sink *sink, const pqb_load_result *r) {
+    text_sink *ts = (text_sink *)sink;
+    double scale = pqb_timer_scale(r->timer);
+    const char *unit = pqb_timer_unit(r->timer);
+    const pqb_histogram *lat = r->latency, *svc = r->service;
+
+    fprintf(ts->out, "%s - Offered: %.1f req/s (%s arrivals, %d workers), Achieved: %.1f req/s%s\n", r->op->label,
+            r->offered_rate, arrival_name(r->arrival), r->workers, r->achieved_rate, r->saturated ? ", saturated" : "");
+    fprintf(ts->out,
+            "    Latency: p50: %f %s, p90: %f, p99: %f, p99.9: %f, Max: %f, Service: p50: %f, p99: %f, "
+            "Requests: %llu (%llu abandoned)\n",
+            pqb_histogram_quantile(lat, 0.5) * scale, unit, pqb_histogram_quantile(lat, 0.9) * scale,
+            pqb_histogram_quantile(lat, 0.99) * scale, pqb_histogram_quantile(lat, 0.999) * scale,
+            pqb_histogram_quantile(lat, 1.0) * scale, pqb_histogram_quantile(svc, 0.5) * scale,
+            pqb_histogram_quantile(svc, 0.99) * scale, (unsigned long long)r->requests,
+            (unsigned long long)r->abandoned);
+}
+
+static void text_pool(pqb_sink *sink, const pqb_pool_result *r) {
+    text_sink *ts = (text_sink *)sink;
+    double scale = pqb_timer_scale(r->timer);
+    const char *unit = pqb_timer_unit(r->timer);
+    const pqb_histogram *od = r->on_demand, *ho = r->handout;
+
+    fprintf(ts->out, "Key pool - Target: %.1f handshakes/s (%s arrivals), Capacity: %d keys, Producers: %d%s\n",
+            r->target_rate, arrival_name(r->arrival), r->capacity, r->producers,
+            r->sustained ? "" : ", not sustained");
+    fprintf(ts->out, "    On demand: p50: %f %s, p99: %f, p99.9: %f, Max: %f, Rate: %.1f keys/s per thread\n",
+            pqb_histogram_quantile(od, 0.5) * scale, unit, pqb_histogram_quantile(od, 0.99) * scale,
+            pqb_histogram_quantile(od, 0.999) * scale, pqb_histogram_quantile(od, 1.0) * scale, r->keygen_rate);
+    fprintf(ts->out,
+            "    Hand-out: p50: %f %s, p99: %f, p99.9: %f, Max: %f, Misses: %llu of %llu (%llu abandoned), "
+            "Lowest fill: %llu\n",
+            pqb_histogram_quantile(ho, 0.5) * scale, unit, pqb_histogram_quantile(ho, 0.99) * scale,
+            pqb_histogram_quantile(ho, 0.999) * scale, pqb_histogram_quantile(ho, 1.0) * scale,
+            (unsigned long long)r->misses, (unsigned long long)r->requests, (unsigned long long)r->abandoned,
+            (unsigned long long)r->lowest_fill);
+    fprintf(ts->out, "    Refill needed: %.1f keys/s, %.2f cores (%d producers), Refilled: %.1f keys/s\n",
+            r->target_rate, r->cores_needed, r->producers_needed, r->refill_rate);
+}
+
+static void text_async(pqb_sink *sink, const pqb_async_result *r) {
+    text_sink *ts = (text_sink *)sink;
+    double scale = pqb_timer_scale(r->timer);
+    const char *unit = pqb_timer_unit(r->timer);
+
+    if (r->depth == 0) {
+        fprintf(ts->out, "%s - Synchronous, Throughput: %f ops/s", r->op->label, r->ops_per_sec);
+    } else {
+        fprintf(ts->out, "%s - Async depth: %d, Throughput: %f ops/s, Speedup: %fx, Pauses: %llu", r->op->label,
+                r->depth, r->ops_per_sec, r->speedup, (unsigned long long)r->pauses);
+    }
+    fprintf(ts->out, ", Median latency: %f %s, p99 latency: %f %s, Max: %f %s\n", r->stats.median * scale, unit,
+            r->stats.p99 * scale, unit, r->stats.max * scale, unit);
+}
+
+static void text_cpu_matrix(pqb_sink *sink, const pqb_cpu_matrix_result *r) {
+    text_sink *ts = (text_sink *)sink;
+    fprintf(ts->out, "CPU feature matrix - Median per level, Speedup of %s over it\n", r->levels[0].name);
+    for (int i = 0; i < r->num_rows; i++) {
+        const pqb_cpu_matrix_row *row = &r->rows[i];
+        fprintf(ts->out, "    %s %s:", row->algorithm, row->op);
+        const char *sep = " ";
+        for (int l = 0; l < r->num_levels; l++) {
+            if (!r->completed[l]) {
+                continue;
+            }
+            fprintf(ts->out, "%s%s: ", sep, r->levels[l].name);
+            sep = ", ";
+            if (isnan(row->median[l])) {
+                fprintf(ts->out, "-");
+            } else if (l == 0 || isnan(row->median[0]) || row->median[0] <= 0) {
+                fprintf(ts->out, "%f %s", row->median[l], row->unit);
+            } else {
+                fprintf(ts->out, "%f %s (%.2fx)", row->median[l], row->unit, row->median[l] / row->median[0]);
+            }
+        }
+        fprintf(ts->out, "\n");
+    }
+    fprintf(ts->out, "\n");
+    fflush(ts->out);
+}
+
+static void text_end(pqb_sink *sink, const char *algorithm) {
+    text_sink *ts = (text_sink *)sink;
+    (void)algorithm;
+    fprintf(ts->out, "\n");
+    fflush(ts->out);
+}
+
+static void text_close(pqb_sink *sink) {
+    free(sink);
+}
+
+pqb_sink *pqb_text_sink_new(FILE *out) {
+    text_sink *ts = calloc(1, sizeof(*ts));
+    if (!ts) {
+        fprintf(stderr, "Failed to allocate text sink\n");
+        exit(EXIT_FAILURE);
+    }
+    ts->base.begin = text_begin;
+    ts->base.result = text_result;
+    ts->base.throughput = text_throughput;
+    ts->base.sweep = text_sweep;
+    ts->base.comparison = text_comparison;
+    ts->base.leakage = text_leakage;
+    ts->base.handshake = text_handshake;
+    ts->base.mesh = text_mesh;
+    ts->base.load = text_load;
+    ts->base.pool = text_pool;
+    ts->base.async = text_async;
+    ts->base.cpu_matrix = text_cpu_matrix;
+    ts->base.end = text_end;
+    ts->base.close = text_close;
+    ts->out = out;
+    return &ts->base;
+}
@@ -0,0 +1,33 @@
+#ifndef PQB_SINK_H
+#define PQB_SINK_H
+
+#include <stdio.h>
+
+#include "bench.h"
+
+// Human readable summary, one block per algorithm
+pqb_sink *pqb_text_sink_new(FILE *out);
+
+// SVG histogram and CDF of every result, one pair of files per algorithm and
+// op. Samples are copied as results arrive and drawn when the sink is closed,
+// after the last measurement. Does nothing when built with PQB_HAVE_PLPLOT=0.
+// In a level's run of a CPU matrix, the op is suffixed with the level name.
+pqb_sink *pqb_plot_sink_new(void);
+
+// Suffix the op of the results that arrive from now on with variant as well,
+// <algorithm>_<op>[_<level>]_<variant>_hist.svg, so that runs of the same op
+// in one process keep files of their own; NULL for none
+void pqb_plot_sink_set_variant(pqb_sink *sink, const char *variant);
+
+// Every raw sample as one NDJSON line: algorithm, op, threads, iteration,
+// value in the raw timer unit, unit, thread, cpu and ops_per_sample.
+// path "-" writes to stdout, as for the sinks below.
+pqb_sink *pqb_ndjson_sink_new(const char *path);
+
+// Summary records of latency, throughput and sweep results as one JSON array
+pqb_sink *pqb_json_sink_new(const char *path);
+
+// The same summaries as CSV rows under one header
+pqb_sink *pqb_csv_sink_new(const char *path);
+
+#endif
@@ -0,0 +1,104 @@
+#define _GNU_SOURCE
+#include "bench.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "measure.h"
+#include "samples.h"
+
+static void report(const pqb_bench *bench, const char *alg, const pqb_op *op, pqb_samples *s,
+                   size_t wire_bytes, int warmup_runs) {
+    pqb_result result = {0};
+    result.algorithm = alg;
+    result.op = op;
+    // Sinks that want every sample get them in order only when there are
+    // any, copied before the statistics sort the chunks
+    uint64_t *all = pqb_samples_copy(s);
+    result.samples = all;
+    result.cpus = NULL;
+    result.num_samples = all ? (int)s->count : 0;
+    result.ops_per_sample = op->batched ? bench->batch_size : 1;
+    result.wire_bytes = wire_bytes;
+    result.warmup_runs = warmup_runs;
+    result.timer = &bench->timer;
+    pqb_samples_statistics(s, &bench->stats_options, &result.stats);
+    for (int k = 0; k < bench->num_sinks; k++) {
+        bench->sinks[k]->result(bench->sinks[k], &result);
+    }
+    free(all);
+}
+
+void pqb_bench_run_soak(pqb_bench *bench, const pqb_family *family, const char *alg, double seconds,
+                        pqb_samples_mode mode) {
+    const pqb_timer *timer = &bench->timer;
+    void *state = family->create(bench, alg);
+    int warmup_runs = pqb_bench_warm_up(bench, family, state, timer);
+
+    // One more for the handshake total
+    int num_series = family->num_ops + (family->handshake ? 1 : 0);
+    pqb_samples *samples = calloc(num_series, sizeof(pqb_samples));
+    if (!samples) {
+        fprintf(stderr, "Failed to allocate memory for samples\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int o = 0; o < num_series; o++) {
+        pqb_samples_init(&samples[o], mode, PQB_SOAK_HIGHEST);
+    }
+
+    // The clock is read once per pass, outside the timed ops
+    uint64_t end = pqb_cycles_read_monotonic() + (uint64_t)(seconds * 1e9);
+    size_t passes = 0;
+    while (pqb_cycles_read_monotonic() < end) {
+        // Raw samples are counted in ints by the sinks
+        if (mode == PQB_SAMPLES_RAW && passes == INT_MAX) {
+            fprintf(stderr, "%s: stopping after %d raw samples per op\n", alg, INT_MAX);
+            break;
+        }
+        uint64_t total = 0;
+        for (int o = 0; o < family->num_ops; o++) {
+            const pqb_op *op = &family->ops[o];
+            if (op->prepare) {
+                op->prepare(state);
+            }
+            uint64_t start = pqb_timer_start(timer);
+            op->run(state);
+            uint64_t stop = pqb_timer_stop(timer);
+            uint64_t elapsed = pqb_timer_elapsed(timer, start, stop);
+            pqb_samples_add(&samples[o], elapsed);
+            total += elapsed;
+            if (op->finish) {
+                op->finish(state);
+            }
+        }
+        if (family->handshake) {
+            pqb_samples_add(&samples[family->num_ops], total);
+        }
+        passes++;
+    }
+    size_t wire_bytes = family->wire_bytes ? family->wire_bytes(state) : 0;
+    family->destroy(state);
+
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->begin) {
+            bench->sinks[s]->begin(bench->sinks[s], alg);
+        }
+    }
+    for (int o = 0; o < family->num_ops; o++) {
+        report(bench, alg, &family->ops[o], &samples[o], family->handshake ? 0 : wire_bytes, warmup_runs);
+    }
+    if (family->handshake) {
+        report(bench, alg, &pqb_handshake_op, &samples[family->num_ops], wire_bytes, warmup_runs);
+    }
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->end) {
+            bench->sinks[s]->end(bench->sinks[s], alg);
+        }
+    }
+
+    for (int o = 0; o < num_series; o++) {
+        pqb_samples_free(&samples[o]);
+    }
+    free(samples);
+}
@@ -0,0 +1,364 @@
+#include "stats.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INSERTION_SORT_THRESHOLD 64
+
+void pqb_stats_default_options(pqb_stats_options *opts) {
+    opts->filter = PQB_FILTER_LEGACY;
+    opts->bootstrap_resamples = PQB_BOOTSTRAP_RESAMPLES;
+    opts->confidence = PQB_CONFIDENCE;
+    opts->seed = 0x9e3779b97f4a7c15ULL;
+}
+
+static void insertion_sort(uint64_t *v, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        uint64_t x = v[i];
+        size_t j = i;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+}
+
+void pqb_sort_samples(uint64_t *samples, uint64_t *tmp, size_t num_samples) {
+    if (num_samples < INSERTION_SORT_THRESHOLD) {
+        insertion_sort(samples, num_samples);
+        return;
+    }
+
+    // All eight byte histograms in one pass; a byte position where every
+    // sample falls into the same bucket (typically the high bytes) is skipped
+    size_t counts[8][256];
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < num_samples; i++) {
+        uint64_t x = samples[i];
+        for (int d = 0; d < 8; d++) {
+            counts[d][(x >> (8 * d)) & 0xff]++;
+        }
+    }
+
+    uint64_t *src = samples;
+    uint64_t *dst = tmp;
+    for (int d = 0; d < 8; d++) {
+        if (counts[d][(src[0] >> (8 * d)) & 0xff] == num_samples) {
+            continue;
+        }
+        size_t offset = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t c = counts[d][b];
+            counts[d][b] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < num_samples; i++) {
+            uint64_t x = src[i];
+            dst[counts[d][(x >> (8 * d)) & 0xff]++] = x;
+        }
+        uint64_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != samples) {
+        memcpy(samples, src, num_samples * sizeof(uint64_t));
+    }
+}
+
+double pqb_quantile_sorted(const uint64_t *sorted, size_t num_samples, double q) {
+    if (num_samples == 0) {
+        return 0.0;
+    }
+    double h = (num_samples - 1) * q;
+    size_t lo = (size_t)h;
+    if (lo + 1 >= num_samples) {
+        return (double)sorted[num_samples - 1];
+    }
+    return sorted[lo] + (h - lo) * ((double)sorted[lo + 1] - (double)sorted[lo]);
+}
+
+// Acklam's rational approximation, relative error below 1.2e-9
+double pqb_normal_quantile(double p) {
+    static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                               1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                               6.680131188771972e+01, -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                               -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+    static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                               3.754408661907416e+00};
+    const double p_low = 0.02425;
+
+    if (p <= 0.0) {
+        return -INFINITY;
+    }
+    if (p >= 1.0) {
+        return INFINITY;
+    }
+    if (p < p_low) {
+        double q = sqrt(-2 * log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+    if (p > 1 - p_low) {
+        double q = sqrt(-2 * log(1 - p));
+        return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+    double q = p - 0.5;
+    double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+           (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+}
+
+// First index in [lo, hi) whose value is >= bound
+static size_t lower_bound(const uint64_t *sorted, size_t lo, size_t hi, double bound) {
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if ((double)sorted[mid] < bound) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// First index in [lo, hi) whose value is > bound
+static size_t upper_bound(const uint64_t *sorted, size_t lo, size_t hi, double bound) {
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if ((double)sorted[mid] <= bound) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// The samples that enter the mean form a contiguous range of the sorted array
+static void filtered_range(const uint64_t *sorted, size_t n, pqb_filter filter, size_t *first, size_t *last) {
+    *first = 0;
+    *last = n;
+    if (filter != PQB_FILTER_LEGACY) {
+        return;
+    }
+
+    size_t ignore_runs = n * IGNORE_PERCENTAGE;
+    size_t effective_runs = n - 2 * ignore_runs;
+    if (effective_runs < 4) {
+        return;
+    }
+
+    double q1 = sorted[ignore_runs + (effective_runs / 4)];
+    double q3 = sorted[ignore_runs + (3 * effective_runs / 4)];
+    double iqr = q3 - q1;
+
+    *first = lower_bound(sorted, ignore_runs, n - ignore_runs, q1 - IQR_MULTIPLIER * iqr);
+    *last = upper_bound(sorted, *first, n - ignore_runs, q3 + IQR_MULTIPLIER * iqr);
+}
+
+// Median of |x - median| by merging the two monotone deviation sequences on
+// either side of the median, so no second sort is needed
+static double median_absolute_deviation(const uint64_t *sorted, size_t n, double median) {
+    size_t right = lower_bound(sorted, 0, n, median);
+    size_t left = right; // deviations to the left are taken from left - 1 downwards
+    size_t target = n / 2;
+    double previous = 0.0, current = 0.0;
+
+    for (size_t k = 0; k <= target; k++) {
+        double dl = left > 0 ? median - (double)sorted[left - 1] : INFINITY;
+        double dr = right < n ? (double)sorted[right] - median : INFINITY;
+        previous = current;
+        if (dl <= dr) {
+            current = dl;
+            left--;
+        } else {
+            current = dr;
+            right++;
+        }
+    }
+    return (n % 2 == 1) ? current : (previous + current) / 2;
+}
+
+uint64_t pqb_splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Percentile bootstrap confidence interval of the mean of values[0..n)
+static void bootstrap_mean_ci(const uint64_t *values, size_t n, const pqb_stats_options *opts, double *low, double *high) {
+    int resamples = opts->bootstrap_resamples;
+    double *means = malloc(resamples * sizeof(double));
+    if (!means) {
+        fprintf(stderr, "Failed to allocate memory for %d bootstrap resamples\n", resamples);
+        exit(EXIT_FAILURE);
+    }
+
+    uint64_t rng = opts->seed;
+    for (int b = 0; b < resamples; b++) {
+        double sum = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            size_t idx = (size_t)(((unsigned __int128)pqb_splitmix64(&rng) * n) >> 64);
+            sum += values[idx];
+        }
+        means[b] = sum / n;
+    }
+    qsort(means, resamples, sizeof(double), compare_doubles);
+
+    double alpha = (1.0 - opts->confidence) / 2;
+    *low = means[(int)(alpha * (resamples - 1))];
+    *high = means[(int)((1.0 - alpha) * (resamples - 1))];
+    free(means);
+}
+
+void pqb_compute_statistics(const uint64_t *samples, size_t num_samples, const pqb_stats_options *opts, pqb_stats *out) {
+    if (num_samples == 0) {
+        pqb_compute_statistics_sorted(samples, 0, opts, out);
+        return;
+    }
+    uint64_t *sorted = malloc(2 * num_samples * sizeof(uint64_t));
+    if (!sorted) {
+        fprintf(stderr, "Failed to allocate memory for %zu samples\n", num_samples);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(sorted, samples, num_samples * sizeof(uint64_t));
+    pqb_sort_samples(sorted, sorted + num_samples, num_samples);
+    pqb_compute_statistics_sorted(sorted, num_samples, opts, out);
+    free(sorted);
+}
+
+void pqb_compute_statistics_sorted(const uint64_t *sorted, size_t num_samples, const pqb_stats_options *opts,
+                                   pqb_stats *out) {
+    memset(out, 0, sizeof(*out));
+    out->num_samples = num_samples;
+    out->confidence = opts->confidence;
+    if (num_samples == 0) {
+        return;
+    }
+
+    // Order statistics straight off the sorted samples
+    out->min = (double)sorted[0];
+    out->max = (double)sorted[num_samples - 1];
+    out->median = pqb_quantile_sorted(sorted, num_samples, 0.5);
+    out->p90 = pqb_quantile_sorted(sorted, num_samples, 0.90);
+    out->p99 = pqb_quantile_sorted(sorted, num_samples, 0.99);
+    out->p999 = pqb_quantile_sorted(sorted, num_samples, 0.999);
+    out->mad = median_absolute_deviation(sorted, num_samples, out->median);
+
+    size_t lo_rank, hi_rank;
+    pqb_median_ci_ranks(num_samples, opts->confidence, &lo_rank, &hi_rank);
+    out->median_ci_low = (double)sorted[lo_rank];
+    out->median_ci_high = (double)sorted[hi_rank];
+
+    // Mean and standard deviation in a single Welford pass over the filtered range
+    size_t first, last;
+    filtered_range(sorted, num_samples, opts->filter, &first, &last);
+    double mean = 0.0, m2 = 0.0;
+    size_t count = 0;
+    for (size_t i = first; i < last; i++) {
+        double x = (double)sorted[i];
+        count++;
+        double delta = x - mean;
+        mean += delta / count;
+        m2 += delta * (x - mean);
+    }
+    out->num_filtered = count;
+    out->mean = mean;
+    out->std_dev = count ? sqrt(m2 / count) : 0.0;
+    pqb_mean_ci(sorted + first, count, mean, out->std_dev, opts, &out->mean_ci_low, &out->mean_ci_high);
+}
+
+void pqb_median_ci_ranks(size_t num_samples, double confidence, size_t *low, size_t *high) {
+    // Distribution-free, from the binomial ranks around n/2
+    double z = pqb_normal_quantile(1.0 - (1.0 - confidence) / 2);
+    double half_width = z * sqrt((double)num_samples) / 2;
+    double lo_rank = floor(num_samples / 2.0 - half_width);
+    double hi_rank = ceil(num_samples / 2.0 + half_width);
+    *low = lo_rank < 0 ? 0 : (size_t)lo_rank;
+    *high = hi_rank >= num_samples ? num_samples - 1 : (size_t)hi_rank;
+}
+
+void pqb_mean_ci(const uint64_t *values, size_t n, double mean, double std_dev, const pqb_stats_options *opts,
+                 double *low, double *high) {
+    if (opts->bootstrap_resamples > 0 && n > PQB_BOOTSTRAP_MAX_SAMPLES) {
+        double z = pqb_normal_quantile(1.0 - (1.0 - opts->confidence) / 2);
+        double margin = z * std_dev / sqrt((double)n);
+        *low = mean - margin;
+        *high = mean + margin;
+    } else if (opts->bootstrap_resamples > 0 && n > 1) {
+        bootstrap_mean_ci(values, n, opts, low, high);
+    } else {
+        *low = *high = mean;
+    }
+}
+
+// Sorted copy of samples, exiting if there is no memory for it
+static uint64_t *sorted_copy(const uint64_t *samples, size_t n) {
+    uint64_t *sorted = malloc(n * sizeof(uint64_t));
+    uint64_t *tmp = malloc(n * sizeof(uint64_t));
+    if (!sorted || !tmp) {
+        fprintf(stderr, "Failed to allocate memory for %zu samples\n", n);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(sorted, samples, n * sizeof(uint64_t));
+    pqb_sort_samples(sorted, tmp, n);
+    free(tmp);
+    return sorted;
+}
+
+void pqb_mann_whitney_test(const uint64_t *a, size_t na, const uint64_t *b, size_t nb, pqb_mann_whitney *out) {
+    memset(out, 0, sizeof(*out));
+    out->p_greater = 1.0;
+    out->p_less = 1.0;
+    if (na == 0 || nb == 0) {
+        return;
+    }
+    uint64_t *sa = sorted_copy(a, na);
+    uint64_t *sb = sorted_copy(b, nb);
+
+    // Merge the two sorted runs, giving every group of equal values the
+    // mean of the ranks it spans
+    double rank_sum = 0.0, ties = 0.0;
+    size_t i = 0, j = 0, rank = 1;
+    while (i < na || j < nb) {
+        uint64_t v = j == nb || (i < na && sa[i] <= sb[j]) ? sa[i] : sb[j];
+        size_t ca = 0, cb = 0;
+        while (i < na && sa[i] == v) {
+            i++;
+            ca++;
+        }
+        while (j < nb && sb[j] == v) {
+            j++;
+            cb++;
+        }
+        double t = (double)(ca + cb);
+        rank_sum += cb * (rank + (t - 1) / 2);
+        ties += t * t * t - t;
+        rank += ca + cb;
+    }
+    free(sa);
+    free(sb);
+
+    double n = (double)(na + nb);
+    double mean = (double)na * nb / 2;
+    double var = (double)na * nb / 12 * ((n + 1) - ties / (n * (n - 1)));
+    out->u = rank_sum - (double)nb * (nb + 1) / 2;
+    out->effect = out->u / ((double)na * nb);
+    if (var > 0) {
+        double sd = sqrt(var);
+        out->p_greater = 0.5 * erfc((out->u - mean - 0.5) / sd / M_SQRT2);
+        out->p_less = 0.5 * erfc((mean - out->u - 0.5) / sd / M_SQRT2);
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef PQB_STATS_H
+#define PQB_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define IGNORE_PERCENTAGE 0.2
+#define IQR_MULTIPLIER 1.5
+
+#define PQB_BOOTSTRAP_RESAMPLES 1000
+// Above this many filtered samples the mean CI is the normal approximation,
+// as good as the bootstrap by then and without resamples * samples draws
+#define PQB_BOOTSTRAP_MAX_SAMPLES 100000
+#define PQB_CONFIDENCE 0.95
+
+// Which samples the mean, standard deviation and mean CI are computed over.
+// Order statistics (min, max, percentiles, MAD) always use every sample.
+typedef enum {
+    PQB_FILTER_NONE,   // all samples
+    PQB_FILTER_LEGACY  // drop IGNORE_PERCENTAGE of the sorted samples at each end,
+                       // then anything outside IQR_MULTIPLIER interquartile ranges
+} pqb_filter;
+
+typedef struct {
+    pqb_filter filter;
+    int bootstrap_resamples; // resamples for the mean CI, 0 to skip it
+    double confidence;       // two-sided confidence level of both intervals
+    uint64_t seed;           // bootstrap RNG seed, fixed so reports are reproducible
+} pqb_stats_options;
+
+// All values are in raw sample units
+typedef struct {
+    size_t num_samples;
+    size_t num_filtered; // samples the mean and standard deviation were computed over
+    double mean;
+    double std_dev;
+    double min;
+    double max;
+    double median;
+    double p90;
+    double p99;
+    double p999;
+    double mad; // median absolute deviation from the median
+    double confidence; // level of the two intervals below
+    double mean_ci_low;
+    double mean_ci_high;
+    double median_ci_low;
+    double median_ci_high;
+} pqb_stats;
+
+void pqb_stats_default_options(pqb_stats_options *opts);
+
+// Summarise samples in O(n log n) time and O(n) heap memory
+void pqb_compute_statistics(const uint64_t *samples, size_t num_samples, const pqb_stats_options *opts, pqb_stats *out);
+
+// The same from samples already sorted, without copying them
+void pqb_compute_statistics_sorted(const uint64_t *sorted, size_t num_samples, const pqb_stats_options *opts,
+                                   pqb_stats *out);
+
+// Ranks of the sorted samples that bound the median's confidence interval
+void pqb_median_ci_ranks(size_t num_samples, double confidence, size_t *low, size_t *high);
+
+// Confidence interval of the mean of values[0..n), whose mean and standard
+// deviation are given: bootstrapped up to PQB_BOOTSTRAP_MAX_SAMPLES values,
+// the normal approximation above, where values is not read and may be NULL
+void pqb_mean_ci(const uint64_t *values, size_t n, double mean, double std_dev, const pqb_stats_options *opts,
+                 double *low, double *high);
+
+// Sort samples in place with an LSD radix sort; tmp must hold num_samples values
+void pqb_sort_samples(uint64_t *samples, uint64_t *tmp, size_t num_samples);
+
+// Value at quantile q (0..1) of sorted samples, linearly interpolated
+double pqb_quantile_sorted(const uint64_t *sorted, size_t num_samples, double q);
+
+// Next value of the SplitMix64 generator whose state is *state: seeded,
+// so runs repeat, and good enough for resampling and arrival times
+uint64_t pqb_splitmix64(uint64_t *state);
+
+// Inverse of the standard normal CDF
+double pqb_normal_quantile(double p);
+
+// Mann-Whitney U test of whether samples b tend to be larger or smaller
+// than samples a, by the normal approximation with tie and continuity
+// corrections; fine from about 20 samples a side
+typedef struct {
+    double u;         // U statistic of b
+    double effect;    // U / (na * nb): probability a value of b exceeds one of a, ties counting half
+    double p_greater; // one-sided p-value that b is stochastically greater than a
+    double p_less;    // and that it is stochastically less
+} pqb_mann_whitney;
+
+void pqb_mann_whitney_test(const uint64_t *a, size_t na, const uint64_t *b, size_t nb, pqb_mann_whitney *out);
+
+#endif
@@ -0,0 +1,385 @@
+#include "suite.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "families.h"
+
+static const struct {
+    const char *name;
+    const pqb_family *family;
+} families[] = {
+    {"keygen", &pqb_keygen_family},
+    {"kem", &pqb_kem_family},
+    {"sig", &pqb_sig_family},
+    {"ecdh-handshake", &pqb_ecdh_handshake_family},
+    {"kem-handshake", &pqb_kem_handshake_family},
+    {"dds-ecdh-handshake", &pqb_dds_ecdh_handshake_family},
+    {"dds-kem-handshake", &pqb_dds_kem_handshake_family},
+};
+
+// Where a bad line of the suite is, as compilers put it
+static void fail(const char *path, int line, const char *fmt, const char *arg) {
+    fprintf(stderr, "%s:%d: ", path, line);
+    fprintf(stderr, fmt, arg);
+    fputc('\n', stderr);
+    exit(EXIT_FAILURE);
+}
+
+static char *read_file(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    size_t len = 0, cap = 4096;
+    char *text = malloc(cap);
+    size_t n;
+    while (text && (n = fread(text + len, 1, cap - len - 1, f)) > 0) {
+        len += n;
+        if (cap - len - 1 == 0) {
+            cap *= 2;
+            text = realloc(text, cap);
+        }
+    }
+    if (!text || ferror(f)) {
+        fprintf(stderr, "Failed to read %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fclose(f);
+    text[len] = '\0';
+    return text;
+}
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) {
+        s++;
+    }
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) {
+        *--end = '\0';
+    }
+    return s;
+}
+
+// Split value in place into words separated by the characters in seps
+static int split(char *value, const char *seps, const char **words, int max, const char *path, int line,
+                 const char *key) {
+    int n = 0;
+    char *save = NULL;
+    for (char *w = strtok_r(value, seps, &save); w; w = strtok_r(NULL, seps, &save)) {
+        if (n == max) {
+            fail(path, line, "too many values for %s", key);
+        }
+        words[n++] = w;
+    }
+    return n;
+}
+
+static void add_arg(char **args, int *num_args, char *arg, const char *path, int line) {
+    if (*num_args == PQB_SUITE_MAX_ARGS) {
+        fail(path, line, "%s", "too many options");
+    }
+    args[(*num_args)++] = arg;
+}
+
+static int parse_flag(const char *value, const char *path, int line) {
+    if (strcmp(value, "yes") == 0) {
+        return 1;
+    }
+    if (strcmp(value, "no") != 0) {
+        fail(path, line, "expected yes or no, not %s", value);
+    }
+    return 0;
+}
+
+static pqb_timer_kind parse_timer(const char *value, const char *path, int line) {
+    if (strcmp(value, "time") == 0) {
+        return PQB_TIMER_CPU_TIME;
+    }
+    if (strcmp(value, "cycles") == 0) {
+        return PQB_TIMER_CYCLES;
+    }
+    if (strcmp(value, "wall") != 0) {
+        fail(path, line, "timer must be time, cycles or wall, not %s", value);
+    }
+    return PQB_TIMER_WALL;
+}
+
+static int parse_runs(const char *value, const char *path, int line) {
+    char *end;
+    long v = strtol(value, &end, 10);
+    if (*value == '\0' || *end != '\0' || v < 1 || v > 1 << 30) {
+        fail(path, line, "invalid run count %s", value);
+    }
+    return (int)v;
+}
+
+// The options one value of key adds: "--ndjson FILE", an options list, ...
+static void add_options(char **args, int *num_args, char *value, const char *path, int line) {
+    const char *words[PQB_SUITE_MAX_ARGS];
+    int n = split(value, " \t", words, PQB_SUITE_MAX_ARGS, path, line, "options");
+    for (int w = 0; w < n; w++) {
+        add_arg(args, num_args, (char *)words[w], path, line);
+    }
+}
+
+static void suite_key(pqb_suite *suite, char *key, char *value, const char *path, int line) {
+    if (strcmp(key, "providers") == 0) {
+        suite->num_providers = split(value, " \t,", suite->providers, PQB_MAX_PROVIDERS, path, line, key);
+    } else if (strcmp(key, "timer") == 0) {
+        suite->timer = parse_timer(value, path, line);
+    } else if (strcmp(key, "runs") == 0) {
+        suite->runs = parse_runs(value, path, line);
+    } else if (strcmp(key, "payload") == 0) {
+        suite->payload = value;
+    } else if (strcmp(key, "text") == 0) {
+        suite->text_sink = parse_flag(value, path, line);
+    } else if (strcmp(key, "plots") == 0) {
+        suite->plots = parse_flag(value, path, line);
+    } else if (strcmp(key, "ndjson") == 0 || strcmp(key, "json") == 0 || strcmp(key, "csv") == 0) {
+        char *option = key[0] == 'n' ? "--ndjson" : key[0] == 'j' ? "--json" : "--csv";
+        add_arg(suite->args, &suite->num_args, option, path, line);
+        add_arg(suite->args, &suite->num_args, value, path, line);
+    } else if (strcmp(key, "options") == 0) {
+        add_options(suite->args, &suite->num_args, value, path, line);
+    } else {
+        fail(path, line, "unknown key %s in [suite]", key);
+    }
+}
+
+static void entry_key(pqb_suite_entry *e, char *key, char *value, const char *path, int line, const char **mode,
+                      char **threads, char **batch) {
+    if (strcmp(key, "family") == 0) {
+        e->family = NULL;
+        for (size_t f = 0; f < sizeof(families) / sizeof(families[0]); f++) {
+            if (strcmp(value, families[f].name) == 0) {
+                e->family = families[f].family;
+            }
+        }
+        if (!e->family) {
+            fail(path, line, "unknown family %s", value);
+        }
+    } else if (strcmp(key, "algorithms") == 0) {
+        e->num_algs = split(value, " \t,", e->algs, PQB_SUITE_MAX_ALGS, path, line, key);
+    } else if (strcmp(key, "timer") == 0) {
+        e->timer = parse_timer(value, path, line);
+    } else if (strcmp(key, "runs") == 0) {
+        e->runs = parse_runs(value, path, line);
+    } else if (strcmp(key, "payload") == 0) {
+        e->payload = value;
+    } else if (strcmp(key, "mode") == 0) {
+        *mode = value;
+    } else if (strcmp(key, "threads") == 0) {
+        *threads = value;
+    } else if (strcmp(key, "batch") == 0) {
+        *batch = value;
+    } else if (strcmp(key, "options") == 0) {
+        add_options(e->args, &e->num_args, value, path, line);
+    } else {
+        fail(path, line, "unknown key %s", key);
+    }
+}
+
+// The mode as the options that select it, ahead of the section's own
+static void entry_mode(pqb_suite_entry *e, const char *mode, char *threads, char *batch, const char *path) {
+    char *args[PQB_SUITE_MAX_ARGS];
+    int n = 0;
+    if (strcmp(mode, "throughput") == 0) {
+        if (!threads) {
+            fail(path, e->line, "[%s]: mode = throughput needs threads", e->name);
+        }
+        args[n++] = "--threads";
+        args[n++] = threads;
+    } else if (strcmp(mode, "batch") == 0) {
+        if (!batch) {
+            fail(path, e->line, "[%s]: mode = batch needs batch", e->name);
+        }
+        args[n++] = "--batch";
+        args[n++] = batch;
+    } else if (strcmp(mode, "sweep") == 0) {
+        args[n++] = "--sweep";
+    } else if (strcmp(mode, "latency") != 0) {
+        fail(path, e->line, "mode must be latency, throughput, batch or sweep, not %s", mode);
+    }
+    if ((threads && strcmp(mode, "throughput") != 0) || (batch && strcmp(mode, "batch") != 0)) {
+        fail(path, e->line, "[%s]: threads and batch go with mode = throughput and mode = batch", e->name);
+    }
+    for (int a = 0; a < e->num_args; a++) {
+        add_arg(args, &n, e->args[a], path, e->line);
+    }
+    memcpy(e->args, args, n * sizeof(char *));
+    e->num_args = n;
+}
+
+pqb_suite *pqb_suite_load(const char *path) {
+    pqb_suite *suite = calloc(1, sizeof(*suite));
+    if (!suite) {
+        fprintf(stderr, "Failed to allocate the suite\n");
+        exit(EXIT_FAILURE);
+    }
+    suite->text = read_file(path);
+    suite->timer = PQB_TIMER_CPU_TIME;
+    suite->runs = PQB_SUITE_RUNS;
+    suite->text_sink = 1;
+    suite->plots = 1;
+
+    // Keys belong to [suite] while in_suite, to e while it is set
+    int in_suite = 0, seen_suite = 0;
+    pqb_suite_entry *e = NULL;
+    const char *mode = "latency";
+    char *threads = NULL, *batch = NULL;
+    int line = 0;
+    // Split by hand rather than with strtok_r, which would skip empty lines
+    // and so lose count of them
+    for (char *next = suite->text; next;) {
+        char *raw = next;
+        next = strchr(raw, '\n');
+        if (next) {
+            *next++ = '\0';
+        }
+        line++;
+        char *s = trim(raw);
+        if (*s == '\0' || *s == '#' || *s == ';') {
+            continue;
+        }
+        if (*s == '[') {
+            char *close = strchr(s, ']');
+            if (!close || close[1] != '\0' || close == s + 1) {
+                fail(path, line, "bad section header %s", s);
+            }
+            *close = '\0';
+            char *name = s + 1;
+            if (e) {
+                entry_mode(e, mode, threads, batch, path);
+            }
+            e = NULL;
+            in_suite = strcmp(name, "suite") == 0;
+            if (in_suite) {
+                if (seen_suite || suite->num_entries > 0) {
+                    fail(path, line, "%s", "[suite] must come once, before any run");
+                }
+                seen_suite = 1;
+                continue;
+            }
+            if (suite->num_entries == PQB_SUITE_MAX_ENTRIES) {
+                fprintf(stderr, "%s:%d: at most %d runs in a suite\n", path, line, PQB_SUITE_MAX_ENTRIES);
+                exit(EXIT_FAILURE);
+            }
+            e = &suite->entries[suite->num_entries++];
+            e->name = name;
+            e->line = line;
+            // [suite] comes first, so its defaults are known by now
+            e->timer = suite->timer;
+            e->runs = suite->runs;
+            e->payload = suite->payload;
+            snprintf(e->label, sizeof(e->label), "%s:%d", path, line);
+            mode = "latency";
+            threads = NULL;
+            batch = NULL;
+            continue;
+        }
+        char *eq = strchr(s, '=');
+        if (!eq) {
+            fail(path, line, "expected key = value, not %s", s);
+        }
+        *eq = '\0';
+        char *key = trim(s);
+        char *value = trim(eq + 1);
+        if (*value == '\0') {
+            fail(path, line, "no value for %s", key);
+        }
+        if (in_suite) {
+            suite_key(suite, key, value, path, line);
+        } else if (e) {
+            entry_key(e, key, value, path, line, &mode, &threads, &batch);
+        } else {
+            fail(path, line, "%s outside a section", key);
+        }
+    }
+    if (e) {
+        entry_mode(e, mode, threads, batch, path);
+    }
+    if (suite->num_entries == 0) {
+        fprintf(stderr, "%s: no runs\n", path);
+        exit(EXIT_FAILURE);
+    }
+    if (suite->num_providers == 0) {
+        suite->providers[suite->num_providers++] = "default";
+    }
+    for (int i = 0; i < suite->num_entries; i++) {
+        if (!suite->entries[i].family) {
+            fail(path, suite->entries[i].line, "[%s] has no family", suite->entries[i].name);
+        }
+    }
+    return suite;
+}
+
+void pqb_suite_free(pqb_suite *suite) {
+    free(suite->text);
+    free(suite);
+}
+
+// Whether the options set anything pqb_apply_options applies to the process
+static int process_wide(const pqb_options *opts) {
+    pqb_isolation iso;
+    pqb_isolation_default(&iso);
+    return opts->ndjson || opts->json || opts->csv || opts->num_backends > 0 || opts->save_baseline ||
+           opts->compare_baseline || opts->counters || opts->list || opts->num_cpu_levels > 0 ||
+           opts->isolation.cpu != iso.cpu || opts->isolation.fifo != iso.fifo ||
+           opts->isolation.lock_memory != iso.lock_memory;
+}
+
+static void parse(int n, char **args, const char *positional, pqb_options *opts) {
+    args[n] = NULL;
+    int first = pqb_parse_args(n, args, positional, opts);
+    if (first < n) {
+        fprintf(stderr, "%s: unexpected argument %s\n", args[0], args[first]);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void pqb_suite_options(const pqb_suite *suite, const pqb_suite_entry *entry, int argc, char *argv[], int first,
+                       pqb_options *opts) {
+    (void)argc;
+    // Room for the program name and the NULL getopt expects at the end
+    int max = 2 + suite->num_args + (entry ? entry->num_args : 0) + first;
+    char **args = calloc(max, sizeof(char *));
+    if (!args) {
+        fprintf(stderr, "Failed to allocate the suite's options\n");
+        exit(EXIT_FAILURE);
+    }
+    // Errors in an entry's options name the file and line of its section
+    char *prog = entry ? (char *)entry->label : argv[0];
+    int n = 0;
+    if (entry) {
+        args[n++] = prog;
+        for (int a = 0; a < entry->num_args; a++) {
+            args[n++] = entry->args[a];
+        }
+        parse(n, args, "", opts);
+        if (process_wide(opts)) {
+            fprintf(stderr, "%s: [%s]: the sinks, --backend, --cpu, --fifo, --mlock, --counters, --list, the baseline "
+                            "and the CPU matrix options belong in [suite]\n",
+                    prog, entry->name);
+            exit(EXIT_FAILURE);
+        }
+        n = 0;
+    }
+    args[n++] = prog;
+    for (int a = 0; a < suite->num_args; a++) {
+        args[n++] = suite->args[a];
+    }
+    for (int a = 0; entry && a < entry->num_args; a++) {
+        args[n++] = entry->args[a];
+    }
+    for (int a = 1; a < first; a++) {
+        args[n++] = argv[a];
+    }
+    parse(n, args, "<suite_file>", opts);
+    // A CPU matrix runs the driver again as it was started
+    opts->argv = argv;
+    free(args);
+}
@@ -0,0 +1,77 @@
+#ifndef PQB_SUITE_H
+#define PQB_SUITE_H
+
+#include "bench.h"
+#include "cli.h"
+#include "timer.h"
+
+// A suite file describes a whole evaluation for the pqbench driver, which
+// runs it in one process over one bench: the providers are loaded and the
+// fixture keys generated once, whatever the number of runs. A [suite]
+// section sets up the process, the providers, the sinks, the defaults and
+// any of the shared options that configure the bench, then every other
+// section is one run of a family over its algorithms:
+//
+//   [suite]
+//   providers = default oqsprovider
+//   payload = Time-operations/signature/pq/governance.xml
+//   json = results.json
+//
+//   [pq-signatures]
+//   family = sig
+//   algorithms = dilithium2, dilithium3, falcon512
+//   timer = cycles
+//   mode = batch
+//   batch = 16
+//   options = --contexts hot --warmup auto
+//
+// Lines starting with # or ; are comments. Lists are separated by spaces or
+// commas.
+#define PQB_SUITE_MAX_ENTRIES 64
+#define PQB_SUITE_MAX_ALGS 64
+#define PQB_SUITE_MAX_ARGS 64
+// Runs per algorithm unless the suite or the section sets a count, as most drivers use
+#define PQB_SUITE_RUNS 50
+
+// One section after [suite]
+typedef struct {
+    const char *name;
+    int line; // of the section header, for messages
+    const pqb_family *family;
+    pqb_timer_kind timer;
+    int runs;
+    const char *payload; // file the signature families sign, NULL for the suite's
+    const char *algs[PQB_SUITE_MAX_ALGS];
+    int num_algs;
+    char *args[PQB_SUITE_MAX_ARGS]; // the mode and the options, as command line arguments
+    int num_args;
+    char label[256]; // "<file>:<line>", what option errors are reported against
+} pqb_suite_entry;
+
+typedef struct {
+    char *text; // the whole file, which every string above points into
+    const char *providers[PQB_MAX_PROVIDERS];
+    int num_providers;
+    pqb_timer_kind timer; // default for the sections
+    int runs;
+    const char *payload;
+    int text_sink; // the text summary on stdout, on by default
+    int plots;     // the SVG plots, on by default
+    char *args[PQB_SUITE_MAX_ARGS]; // the sinks and the options, as command line arguments
+    int num_args;
+    pqb_suite_entry entries[PQB_SUITE_MAX_ENTRIES];
+    int num_entries;
+} pqb_suite;
+
+// Read and check a suite file, exiting with the file and line on bad input
+pqb_suite *pqb_suite_load(const char *path);
+void pqb_suite_free(pqb_suite *suite);
+
+// The options of the suite, entry NULL, or of one entry: the [suite]
+// options, then the entry's own, then the driver's command line options
+// before its positional argument first, so the command line has the last
+// word. Options that configure the whole process belong in [suite] only.
+void pqb_suite_options(const pqb_suite *suite, const pqb_suite_entry *entry, int argc, char *argv[], int first,
+                       pqb_options *opts);
+
+#endif
@@ -0,0 +1,118 @@
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_POINTS 16
+
+// Deterministic filler so synthetic payloads are the same on every run
+static unsigned char *synthetic_payload(size_t size) {
+    unsigned char *data = malloc(size);
+    if (!data) {
+        fprintf(stderr, "Failed to allocate a %zu byte payload\n", size);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t x = 0x243f6a8885a308d3ULL;
+    for (size_t i = 0; i < size; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        data[i] = (unsigned char)x;
+    }
+    return data;
+}
+
+// Least squares fit of y = a + b * x weighted by 1 / y^2, so every point
+// counts by its relative error and the small payloads, not the multi-megabyte
+// ones, pin down the fixed cost
+static void fit_line(const double *x, const double *y, int n, double *a, double *b, double *r_squared) {
+    double sw = 0.0, mx = 0.0, my = 0.0;
+    for (int i = 0; i < n; i++) {
+        double w = y[i] > 0 ? 1.0 / (y[i] * y[i]) : 1.0;
+        sw += w;
+        mx += w * x[i];
+        my += w * y[i];
+    }
+    mx /= sw;
+    my /= sw;
+
+    double sxx = 0.0, sxy = 0.0, syy = 0.0;
+    for (int i = 0; i < n; i++) {
+        double w = y[i] > 0 ? 1.0 / (y[i] * y[i]) : 1.0;
+        sxx += w * (x[i] - mx) * (x[i] - mx);
+        sxy += w * (x[i] - mx) * (y[i] - my);
+        syy += w * (y[i] - my) * (y[i] - my);
+    }
+    *b = sxx > 0 ? sxy / sxx : 0.0;
+    *a = my - *b * mx;
+    *r_squared = (sxx > 0 && syy > 0) ? (sxy * sxy) / (sxx * syy) : 1.0;
+}
+
+void pqb_bench_run_sweep(pqb_bench *bench, const pqb_family *family, const char *alg) {
+    size_t sizes[MAX_POINTS];
+    int num_points = 0;
+    for (size_t size = PQB_SWEEP_MIN; size <= PQB_SWEEP_MAX && num_points < MAX_POINTS; size *= 4) {
+        sizes[num_points++] = size;
+    }
+
+    const unsigned char *source = bench->payload;
+    size_t source_len = bench->payload_len;
+    unsigned char *synthetic = NULL;
+    if (source_len < sizes[num_points - 1]) {
+        synthetic = synthetic_payload(sizes[num_points - 1]);
+    }
+
+    int num_ops = family->num_ops;
+    pqb_stats *stats = calloc((size_t)num_ops * num_points, sizeof(pqb_stats));
+    pqb_stats *op_stats = calloc(num_points, sizeof(pqb_stats));
+    if (!stats || !op_stats) {
+        fprintf(stderr, "Failed to allocate memory for the sweep\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int p = 0; p < num_points; p++) {
+        const unsigned char *data = sizes[p] <= source_len ? source : synthetic;
+        pqb_bench_set_payload(bench, data, sizes[p]);
+        pqb_bench_measure(bench, family, alg, &stats[(size_t)p * num_ops]);
+    }
+    pqb_bench_set_payload(bench, source, source_len);
+
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->begin) {
+            bench->sinks[s]->begin(bench->sinks[s], alg);
+        }
+    }
+    for (int o = 0; o < num_ops; o++) {
+        double x[MAX_POINTS], y[MAX_POINTS];
+        for (int p = 0; p < num_points; p++) {
+            op_stats[p] = stats[(size_t)p * num_ops + o];
+            x[p] = (double)sizes[p];
+            y[p] = op_stats[p].mean;
+        }
+
+        pqb_sweep_result result;
+        result.algorithm = alg;
+        result.op = &family->ops[o];
+        result.num_points = num_points;
+        result.sizes = sizes;
+        result.stats = op_stats;
+        result.timer = &bench->timer;
+        fit_line(x, y, num_points, &result.fixed, &result.per_byte, &result.r_squared);
+
+        for (int s = 0; s < bench->num_sinks; s++) {
+            if (bench->sinks[s]->sweep) {
+                bench->sinks[s]->sweep(bench->sinks[s], &result);
+            }
+        }
+    }
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->end) {
+            bench->sinks[s]->end(bench->sinks[s], alg);
+        }
+    }
+
+    free(op_stats);
+    free(stats);
+    free(synthetic);
+}
@@ -0,0 +1,268 @@
+#define _GNU_SOURCE
+#include "bench.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "isolate.h"
+#include "measure.h"
+#include "topology.h"
+
+typedef struct {
+    const pqb_bench *bench;
+    const pqb_family *family;
+    const char *alg;
+    const pqb_timer *timer;
+    pthread_barrier_t *barrier;
+    pthread_barrier_t *phase; // between the workers alone, ahead of every op
+    int cpu;
+    uint64_t **samples; // [op][run]
+    uint64_t **starts;  // [op][run] monotonic ns each sample started at
+    uint64_t finished;  // monotonic ns when this worker's last run ended
+} worker;
+
+static void *worker_main(void *arg) {
+    worker *w = arg;
+    const pqb_family *family = w->family;
+
+    // Key generation and every context the ops allocate belong to this
+    // thread only, so the measured region shares nothing but the library.
+    // So does a copy of the payload, first touched here so that its pages
+    // come from this cpu's NUMA node.
+    pqb_pin_thread(w->cpu);
+    pqb_bench local = *w->bench;
+    local.keys = NULL;
+    unsigned char *payload = NULL;
+    if (local.payload_len > 0) {
+        payload = malloc(local.payload_len);
+        if (!payload) {
+            fprintf(stderr, "Failed to allocate memory for the throughput workers\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(payload, local.payload, local.payload_len);
+        local.payload = payload;
+    }
+    void *state = family->create(&local, w->alg);
+    pqb_bench_warm_up(w->bench, family, state, w->timer);
+
+    // Every op of every pass is a phase that all workers enter together, so
+    // the ops running at any time are all the same op
+    pthread_barrier_wait(w->barrier);
+    for (int i = 0; i < w->bench->runs; i++) {
+        for (int o = 0; o < family->num_ops; o++) {
+            const pqb_op *op = &family->ops[o];
+            if (op->prepare) {
+                op->prepare(state);
+            }
+            pthread_barrier_wait(w->phase);
+            uint64_t start = pqb_timer_start(w->timer);
+            op->run(state);
+            uint64_t stop = pqb_timer_stop(w->timer);
+            w->samples[o][i] = pqb_timer_elapsed(w->timer, start, stop);
+            w->starts[o][i] = start;
+            if (op->finish) {
+                op->finish(state);
+            }
+        }
+    }
+    w->finished = pqb_cycles_read_monotonic();
+
+    family->destroy(state);
+    free(payload);
+    return NULL;
+}
+
+// One point of the scaling curve, or of the topology sweep if topology names
+// it; base_ops_per_sec holds the one thread results per op and is filled in
+// when threads is 1
+static void measure_point(pqb_bench *bench, const pqb_family *family, const char *alg, const pqb_timer *timer,
+                          const int *cpus, int threads, const char *topology, double *base_ops_per_sec) {
+    int runs = bench->runs;
+    int num_ops = family->num_ops;
+    worker *workers = pqb_xcalloc(threads, sizeof(worker), "the throughput workers");
+    pthread_t *tids = pqb_xcalloc(threads, sizeof(pthread_t), "the throughput workers");
+    int *pinned = pqb_xcalloc(threads, sizeof(int), "the throughput workers");
+    pthread_barrier_t barrier, phase;
+
+    // The main thread joins the barrier too so it can stamp the start time
+    pthread_barrier_init(&barrier, NULL, threads + 1);
+    pthread_barrier_init(&phase, NULL, threads);
+    for (int t = 0; t < threads; t++) {
+        worker *w = &workers[t];
+        w->bench = bench;
+        w->family = family;
+        w->alg = alg;
+        w->timer = timer;
+        w->barrier = &barrier;
+        w->phase = &phase;
+        w->cpu = pinned[t] = cpus[t];
+        w->samples = pqb_xcalloc(num_ops, sizeof(uint64_t *), "the throughput workers");
+        w->starts = pqb_xcalloc(num_ops, sizeof(uint64_t *), "the throughput workers");
+        for (int o = 0; o < num_ops; o++) {
+            w->samples[o] = pqb_xcalloc(runs, sizeof(uint64_t), "the throughput workers");
+            w->starts[o] = pqb_xcalloc(runs, sizeof(uint64_t), "the throughput workers");
+        }
+        int err = pthread_create(&tids[t], NULL, worker_main, w);
+        if (err != 0) {
+            fprintf(stderr, "Failed to start worker thread: %s\n", strerror(err));
+            exit(EXIT_FAILURE);
+        }
+    }
+    pthread_barrier_wait(&barrier);
+    uint64_t started = pqb_cycles_read_monotonic();
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    pthread_barrier_destroy(&barrier);
+    pthread_barrier_destroy(&phase);
+
+    uint64_t finished = started;
+    for (int t = 0; t < threads; t++) {
+        if (workers[t].finished > finished) {
+            finished = workers[t].finished;
+        }
+    }
+
+    pqb_stats *thread_stats = pqb_xcalloc(threads, sizeof(pqb_stats), "the throughput workers");
+    uint64_t *all = pqb_xcalloc((size_t)threads * runs, sizeof(uint64_t), "the throughput workers");
+    const uint64_t **thread_samples = pqb_xcalloc(threads, sizeof(uint64_t *), "the throughput workers");
+    for (int o = 0; o < num_ops; o++) {
+        // The machine sustains every thread's ops of a phase over the phase's
+        // wall time, from the first start to the last stop, which includes
+        // any time a worker waited for a cpu
+        int ops_per_sample = family->ops[o].batched ? bench->batch_size : 1;
+        double phase_ns = 0.0;
+        for (int i = 0; i < runs; i++) {
+            uint64_t first = UINT64_MAX, last = 0;
+            for (int t = 0; t < threads; t++) {
+                uint64_t start = workers[t].starts[o][i];
+                uint64_t stop = start + workers[t].samples[o][i];
+                first = start < first ? start : first;
+                last = stop > last ? stop : last;
+            }
+            phase_ns += last - first;
+        }
+        double ops_per_sec = phase_ns > 0 ? (double)threads * runs * ops_per_sample / (phase_ns * 1e-9) : 0.0;
+        for (int t = 0; t < threads; t++) {
+            const uint64_t *s = workers[t].samples[o];
+            pqb_compute_statistics(s, runs, &bench->stats_options, &thread_stats[t]);
+            memcpy(all + (size_t)t * runs, s, runs * sizeof(uint64_t));
+            thread_samples[t] = s;
+        }
+        if (threads == 1) {
+            base_ops_per_sec[o] = ops_per_sec;
+        }
+
+        pqb_throughput_result result;
+        result.algorithm = alg;
+        result.op = &family->ops[o];
+        result.threads = threads;
+        result.topology = topology;
+        result.cpus = pinned;
+        result.wall_seconds = (finished - started) * 1e-9;
+        result.iterations_per_sec = result.wall_seconds > 0 ? (double)threads * runs / result.wall_seconds : 0.0;
+        result.ops_per_sec = ops_per_sec;
+        result.ops_per_sample = ops_per_sample;
+        result.speedup = base_ops_per_sec[o] > 0 ? ops_per_sec / base_ops_per_sec[o] : 0.0;
+        result.thread_stats = thread_stats;
+        result.thread_samples = thread_samples;
+        result.num_samples = runs;
+        result.timer = timer;
+        pqb_compute_statistics(all, (size_t)threads * runs, &bench->stats_options, &result.stats);
+
+        for (int s = 0; s < bench->num_sinks; s++) {
+            if (bench->sinks[s]->throughput) {
+                bench->sinks[s]->throughput(bench->sinks[s], &result);
+            }
+        }
+    }
+
+    free(thread_samples);
+    free(all);
+    free(thread_stats);
+    for (int t = 0; t < threads; t++) {
+        for (int o = 0; o < num_ops; o++) {
+            free(workers[t].samples[o]);
+            free(workers[t].starts[o]);
+        }
+        free(workers[t].samples);
+        free(workers[t].starts);
+    }
+    free(pinned);
+    free(tids);
+    free(workers);
+}
+
+void pqb_bench_run_throughput(pqb_bench *bench, const pqb_family *family, const char *alg, int max_threads) {
+    int *cpus = pqb_xcalloc(max_threads, sizeof(int), "the throughput workers");
+    int num_cpus = pqb_allowed_cpus(cpus, max_threads);
+    if (num_cpus < max_threads) {
+        fprintf(stderr, "Only %d cpus available, threads beyond that share cpus\n", num_cpus);
+        for (int t = num_cpus; t < max_threads; t++) {
+            cpus[t] = cpus[t % num_cpus];
+        }
+    }
+
+    pqb_timer timer;
+    pqb_timer_init(&timer, PQB_TIMER_WALL);
+    double *base_ops_per_sec = pqb_xcalloc(family->num_ops, sizeof(double), "the throughput workers");
+
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->begin) {
+            bench->sinks[s]->begin(bench->sinks[s], alg);
+        }
+    }
+    for (int threads = 1;; threads *= 2) {
+        if (threads > max_threads) {
+            threads = max_threads;
+        }
+        measure_point(bench, family, alg, &timer, cpus, threads, NULL, base_ops_per_sec);
+        if (threads == max_threads) {
+            break;
+        }
+    }
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->end) {
+            bench->sinks[s]->end(bench->sinks[s], alg);
+        }
+    }
+
+    pqb_timer_close(&timer);
+    free(base_ops_per_sec);
+    free(cpus);
+}
+
+void pqb_bench_run_topology(pqb_bench *bench, const pqb_family *family, const char *alg) {
+    pqb_topology *topo = pqb_xcalloc(1, sizeof(pqb_topology), "the throughput workers");
+    pqb_topology_config *configs =
+        pqb_xcalloc(PQB_TOPOLOGY_MAX_CONFIGS, sizeof(pqb_topology_config), "the throughput workers");
+    pqb_topology_discover(topo);
+    int num_configs = pqb_topology_configs(topo, configs);
+
+    pqb_timer timer;
+    pqb_timer_init(&timer, PQB_TIMER_WALL);
+    double *base_ops_per_sec = pqb_xcalloc(family->num_ops, sizeof(double), "the throughput workers");
+
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->begin) {
+            bench->sinks[s]->begin(bench->sinks[s], alg);
+        }
+    }
+    // The first configuration is the one core the speedups are relative to
+    for (int c = 0; c < num_configs; c++) {
+        measure_point(bench, family, alg, &timer, configs[c].cpus, configs[c].num_cpus, configs[c].name,
+                      base_ops_per_sec);
+    }
+    for (int s = 0; s < bench->num_sinks; s++) {
+        if (bench->sinks[s]->end) {
+            bench->sinks[s]->end(bench->sinks[s], alg);
+        }
+    }
+
+    pqb_timer_close(&timer);
+    free(base_ops_per_sec);
+    free(configs);
+    free(topo);
+}
@@ -0,0 +1,61 @@
+#include "timer.h"
+
+void pqb_timer_init(pqb_timer *t, pqb_timer_kind kind) {
+    t->kind = kind;
+    t->cycles.perf_fd = -1;
+    if (kind == PQB_TIMER_CYCLES) {
+        // Calibrate the cycle counter before anything is measured
+        pqb_cycles_init(&t->cycles);
+        pqb_cycles_describe(&t->cycles, stdout);
+    }
+}
+
+void pqb_timer_close(pqb_timer *t) {
+    if (t->kind == PQB_TIMER_CYCLES) {
+        pqb_cycles_close(&t->cycles);
+    }
+}
+
+const char *pqb_timer_unit(const pqb_timer *t) {
+    if (t->kind == PQB_TIMER_CYCLES) {
+        return pqb_cycles_unit(&t->cycles);
+    }
+    return "microseconds";
+}
+
+double pqb_timer_scale(const pqb_timer *t) {
+    if (t->kind == PQB_TIMER_CYCLES) {
+        return 1.0;
+    }
+    return 1e-3; // ns to microseconds
+}
+
+const char *pqb_timer_raw_unit(const pqb_timer *t) {
+    if (t->kind == PQB_TIMER_CYCLES) {
+        return pqb_cycles_unit(&t->cycles);
+    }
+    return "ns";
+}
+
+double pqb_timer_ns(const pqb_timer *t, double raw) {
+    if (t->kind == PQB_TIMER_CYCLES) {
+        return t->cycles.ticks_per_ns > 0 ? raw / t->cycles.ticks_per_ns : raw;
+    }
+    return raw;
+}
+
+const char *pqb_timer_axis_label(const pqb_timer *t) {
+    if (t->kind != PQB_TIMER_CYCLES) {
+        return "Time (microseconds)";
+    }
+    switch (t->cycles.source) {
+    case PQB_CYCLES_PERF:
+    case PQB_CYCLES_PMCCNTR:
+        return "Cycles";
+    case PQB_CYCLES_TSC:
+    case PQB_CYCLES_CNTVCT:
+        return "Ticks";
+    default:
+        return "Time (ns)";
+    }
+}
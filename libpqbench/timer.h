@@ -0,0 +1,72 @@
+#ifndef PQB_TIMER_H
+#define PQB_TIMER_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "cycles.h"
+
+// What a timed region is measured in
+typedef enum {
+    PQB_TIMER_CPU_TIME, // process CPU time in ns, what clock() reported
+    PQB_TIMER_WALL,     // CLOCK_MONOTONIC in ns
+    PQB_TIMER_CYCLES    // calibrated hardware cycle counter
+} pqb_timer_kind;
+
+typedef struct {
+    pqb_timer_kind kind;
+    pqb_cycle_counter cycles;
+} pqb_timer;
+
+void pqb_timer_init(pqb_timer *t, pqb_timer_kind kind);
+void pqb_timer_close(pqb_timer *t);
+
+// Unit results are reported in, and the factor from raw samples to that unit
+const char *pqb_timer_unit(const pqb_timer *t);
+double pqb_timer_scale(const pqb_timer *t);
+
+// Unit of the raw samples themselves: "ns", "cycles" or "ticks"
+const char *pqb_timer_raw_unit(const pqb_timer *t);
+
+// A raw sample in nanoseconds, through the calibrated rate for cycle counters
+double pqb_timer_ns(const pqb_timer *t, double raw);
+
+// Y axis label for plots of this timer's samples
+const char *pqb_timer_axis_label(const pqb_timer *t);
+
+static inline uint64_t pqb_timer_read_cputime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t pqb_timer_start(const pqb_timer *t) {
+    switch (t->kind) {
+    case PQB_TIMER_CYCLES:
+        return pqb_cycles_start(&t->cycles);
+    case PQB_TIMER_WALL:
+        return pqb_cycles_read_monotonic();
+    default:
+        return pqb_timer_read_cputime();
+    }
+}
+
+static inline uint64_t pqb_timer_stop(const pqb_timer *t) {
+    switch (t->kind) {
+    case PQB_TIMER_CYCLES:
+        return pqb_cycles_stop(&t->cycles);
+    case PQB_TIMER_WALL:
+        return pqb_cycles_read_monotonic();
+    default:
+        return pqb_timer_read_cputime();
+    }
+}
+
+static inline uint64_t pqb_timer_elapsed(const pqb_timer *t, uint64_t start, uint64_t stop) {
+    if (t->kind == PQB_TIMER_CYCLES) {
+        return pqb_cycles_elapsed(&t->cycles, start, stop);
+    }
+    return stop - start;
+}
+
+#endif
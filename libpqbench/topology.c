@@ -0,0 +1,203 @@
+#define _GNU_SOURCE
+#include "topology.h"
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "isolate.h"
+
+// An integer from a sysfs file, or fallback if it cannot be read
+static int read_int(const char *path, int fallback) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return fallback;
+    }
+    int v;
+    if (fscanf(f, "%d", &v) != 1) {
+        v = fallback;
+    }
+    fclose(f);
+    return v;
+}
+
+// Mark node on every cpu of a list such as "0-3,8-11"
+static void mark_cpulist(pqb_topology *topo, const char *list, int node) {
+    const char *p = list;
+    while (*p) {
+        char *end;
+        long lo = strtol(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        long hi = lo;
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+        }
+        for (int i = 0; i < topo->num_cpus; i++) {
+            if (topo->cpus[i].cpu >= lo && topo->cpus[i].cpu <= hi) {
+                topo->cpus[i].node = node;
+            }
+        }
+        p = *end == ',' ? end + 1 : end;
+        if (*p == '\n') {
+            break;
+        }
+    }
+}
+
+static void read_nodes(pqb_topology *topo) {
+    topo->num_nodes = 1;
+    DIR *dir = opendir("/sys/devices/system/node");
+    if (!dir) {
+        return;
+    }
+    int nodes = 0;
+    struct dirent *e;
+    while ((e = readdir(dir))) {
+        int node;
+        char rest;
+        if (sscanf(e->d_name, "node%d%c", &node, &rest) != 1) {
+            continue;
+        }
+        char path[512], list[4096];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/%s/cpulist", e->d_name);
+        FILE *f = fopen(path, "r");
+        if (!f) {
+            continue;
+        }
+        if (fgets(list, sizeof(list), f)) {
+            mark_cpulist(topo, list, node);
+            nodes++;
+        }
+        fclose(f);
+    }
+    closedir(dir);
+    if (nodes > 0) {
+        topo->num_nodes = nodes;
+    }
+}
+
+static int compare_cpus(const void *a, const void *b) {
+    const pqb_cpu_info *x = a, *y = b;
+    if (x->package != y->package) {
+        return x->package - y->package;
+    }
+    if (x->core != y->core) {
+        return x->core - y->core;
+    }
+    return x->cpu - y->cpu;
+}
+
+void pqb_topology_discover(pqb_topology *topo) {
+    int cpus[PQB_TOPOLOGY_MAX_CPUS];
+    memset(topo, 0, sizeof(*topo));
+    topo->num_cpus = pqb_allowed_cpus(cpus, PQB_TOPOLOGY_MAX_CPUS);
+    for (int i = 0; i < topo->num_cpus; i++) {
+        pqb_cpu_info *c = &topo->cpus[i];
+        char path[256];
+        c->cpu = cpus[i];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", c->cpu);
+        c->package = read_int(path, 0);
+        // Without topology files every cpu counts as a core of its own
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", c->cpu);
+        c->core = read_int(path, c->cpu);
+    }
+    read_nodes(topo);
+    qsort(topo->cpus, topo->num_cpus, sizeof(pqb_cpu_info), compare_cpus);
+
+    for (int i = 0; i < topo->num_cpus; i++) {
+        pqb_cpu_info *c = &topo->cpus[i];
+        const pqb_cpu_info *prev = i > 0 ? &topo->cpus[i - 1] : NULL;
+        if (prev && prev->package == c->package && prev->core == c->core) {
+            c->thread = prev->thread + 1;
+            topo->smt = 1;
+        } else {
+            c->thread = 0;
+            topo->num_cores++;
+            if (!prev || prev->package != c->package) {
+                topo->num_packages++;
+            }
+        }
+    }
+}
+
+void pqb_topology_report(const pqb_topology *topo, FILE *out) {
+    fprintf(out, "Topology: %d sockets, %d cores, %d threads, %d NUMA nodes%s\n", topo->num_packages, topo->num_cores,
+            topo->num_cpus, topo->num_nodes, topo->smt ? ", SMT" : "");
+}
+
+// Append the cpus of package, or of every package if it is negative, up to
+// max in all; per_core takes only the first thread of each core
+static void add_cpus(const pqb_topology *topo, pqb_topology_config *config, int package, int per_core, int max) {
+    for (int i = 0; i < topo->num_cpus && config->num_cpus < max; i++) {
+        const pqb_cpu_info *c = &topo->cpus[i];
+        if ((package < 0 || c->package == package) && (!per_core || c->thread == 0)) {
+            config->cpus[config->num_cpus++] = c->cpu;
+        }
+    }
+}
+
+static int same_cpus(const pqb_topology_config *a, const pqb_topology_config *b) {
+    return a->num_cpus == b->num_cpus && memcmp(a->cpus, b->cpus, a->num_cpus * sizeof(int)) == 0;
+}
+
+int pqb_topology_configs(const pqb_topology *topo, pqb_topology_config configs[]) {
+    int n = 0;
+    if (topo->num_cpus == 0) {
+        return 0;
+    }
+    int first = topo->cpus[0].package;
+    for (int kind = 0; kind < 7; kind++) {
+        pqb_topology_config *config = &configs[n];
+        config->num_cpus = 0;
+        switch (kind) {
+        case 0:
+            config->name = "core";
+            config->cpus[config->num_cpus++] = topo->cpus[0].cpu;
+            break;
+        case 1:
+            config->name = "smt-pair";
+            for (int i = 1; i < topo->num_cpus; i++) {
+                if (topo->cpus[i].thread == 1) {
+                    config->cpus[config->num_cpus++] = topo->cpus[i - 1].cpu;
+                    config->cpus[config->num_cpus++] = topo->cpus[i].cpu;
+                    break;
+                }
+            }
+            break;
+        case 2:
+            config->name = "two-cores";
+            add_cpus(topo, config, first, 1, 2);
+            break;
+        case 3:
+            config->name = "socket-cores";
+            add_cpus(topo, config, first, 1, PQB_TOPOLOGY_MAX_CPUS);
+            break;
+        case 4:
+            config->name = "socket-threads";
+            add_cpus(topo, config, first, 0, PQB_TOPOLOGY_MAX_CPUS);
+            break;
+        case 5:
+            config->name = "all-cores";
+            add_cpus(topo, config, -1, 1, PQB_TOPOLOGY_MAX_CPUS);
+            break;
+        default:
+            config->name = "all-threads";
+            add_cpus(topo, config, -1, 0, PQB_TOPOLOGY_MAX_CPUS);
+            break;
+        }
+        // Pairs need two cpus; the rest must differ from what came before
+        int keep = config->num_cpus > 0 && !((kind == 1 || kind == 2) && config->num_cpus < 2);
+        for (int c = 0; keep && c < n; c++) {
+            if (same_cpus(&configs[c], config)) {
+                keep = 0;
+            }
+        }
+        if (keep) {
+            n++;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,48 @@
+#ifndef PQB_TOPOLOGY_H
+#define PQB_TOPOLOGY_H
+
+#include <stdio.h>
+
+#define PQB_TOPOLOGY_MAX_CPUS 1024
+#define PQB_TOPOLOGY_MAX_CONFIGS 8
+
+typedef struct {
+    int cpu;
+    int package; // socket
+    int core;    // core id, unique within its package
+    int node;    // NUMA node, 0 without NUMA
+    int thread;  // which of its core's SMT siblings, in cpu order
+} pqb_cpu_info;
+
+// The cpus this process may run on, from /sys/devices/system/cpu and
+// /sys/devices/system/node, sorted by package, core and thread
+typedef struct {
+    pqb_cpu_info cpus[PQB_TOPOLOGY_MAX_CPUS];
+    int num_cpus;
+    int num_packages;
+    int num_cores;
+    int num_nodes;
+    int smt; // some core has more than one usable thread
+} pqb_topology;
+
+void pqb_topology_discover(pqb_topology *topo);
+
+void pqb_topology_report(const pqb_topology *topo, FILE *out);
+
+// A set of cpus to run the same op on at once, one pinned thread each
+typedef struct {
+    const char *name;
+    int cpus[PQB_TOPOLOGY_MAX_CPUS];
+    int num_cpus;
+} pqb_topology_config;
+
+// The configurations worth comparing on this machine, at most
+// PQB_TOPOLOGY_MAX_CONFIGS: one core ("core"), the two threads of one core
+// ("smt-pair") against two cores of one socket ("two-cores"), one thread per
+// core of the first socket ("socket-cores") and every thread of it
+// ("socket-threads"), then the same over every socket ("all-cores",
+// "all-threads"). Those the machine cannot tell apart from an earlier one
+// are left out. Returns how many there are.
+int pqb_topology_configs(const pqb_topology *topo, pqb_topology_config configs[]);
+
+#endif
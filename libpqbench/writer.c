@@ -0,0 +1,189 @@
+#define _GNU_SOURCE
+#include "writer.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sysinfo.h>
+
+#define BUFFER_SIZE (1 << 20)
+
+struct pqb_writer {
+    FILE *out;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    char *buffers[2];
+    int current;    // buffer records are appended to
+    size_t used;    // bytes in the current buffer
+    size_t pending; // bytes of the other buffer still to be written, 0 once done
+    int closing;
+};
+
+static void *writer_main(void *arg) {
+    pqb_writer *w = arg;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        while (w->pending == 0 && !w->closing) {
+            pthread_cond_wait(&w->cond, &w->lock);
+        }
+        if (w->pending == 0) {
+            break;
+        }
+        const char *data = w->buffers[!w->current];
+        size_t len = w->pending;
+        pthread_mutex_unlock(&w->lock);
+        if (fwrite(data, 1, len, w->out) != len) {
+            perror("Failed to write results");
+            exit(EXIT_FAILURE);
+        }
+        pthread_mutex_lock(&w->lock);
+        w->pending = 0;
+        pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    fflush(w->out);
+    return NULL;
+}
+
+// Hand the current buffer to the thread once it is done with the other one
+static void swap_buffers(pqb_writer *w) {
+    pthread_mutex_lock(&w->lock);
+    while (w->pending != 0) {
+        pthread_cond_wait(&w->cond, &w->lock);
+    }
+    w->pending = w->used;
+    w->current = !w->current;
+    w->used = 0;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+}
+
+// Let the thread run anywhere but the cpu the measurements run on. When the
+// creator is already pinned to that one cpu, any other online cpu will do.
+static void avoid_current_cpu(pthread_t thread) {
+    cpu_set_t set;
+    int cpu = sched_getcpu();
+    if (cpu < 0 || sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return;
+    }
+    if (CPU_COUNT(&set) < 2) {
+        CPU_ZERO(&set);
+        for (int c = 0; c < get_nprocs() && c < CPU_SETSIZE; c++) {
+            CPU_SET(c, &set);
+        }
+    }
+    CPU_CLR(cpu, &set);
+    if (CPU_COUNT(&set) > 0) {
+        pthread_setaffinity_np(thread, sizeof(set), &set);
+    }
+}
+
+pqb_writer *pqb_writer_open(const char *path) {
+    pqb_writer *w = calloc(1, sizeof(*w));
+    if (!w) {
+        fprintf(stderr, "Failed to allocate writer for %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    w->out = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!w->out) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    w->buffers[0] = malloc(BUFFER_SIZE);
+    w->buffers[1] = malloc(BUFFER_SIZE);
+    if (!w->buffers[0] || !w->buffers[1]) {
+        fprintf(stderr, "Failed to allocate buffers for %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->cond, NULL);
+    int err = pthread_create(&w->thread, NULL, writer_main, w);
+    if (err != 0) {
+        fprintf(stderr, "Failed to start writer thread: %s\n", strerror(err));
+        exit(EXIT_FAILURE);
+    }
+    avoid_current_cpu(w->thread);
+    return w;
+}
+
+void pqb_writer_write(pqb_writer *w, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        if (w->used == BUFFER_SIZE) {
+            swap_buffers(w);
+        }
+        size_t n = BUFFER_SIZE - w->used;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(w->buffers[w->current] + w->used, p, n);
+        w->used += n;
+        p += n;
+        len -= n;
+    }
+}
+
+void pqb_writer_printf(pqb_writer *w, const char *fmt, ...) {
+    char line[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+        fprintf(stderr, "Failed to format a result record\n");
+        exit(EXIT_FAILURE);
+    }
+    if ((size_t)n < sizeof(line)) {
+        pqb_writer_write(w, line, n);
+        return;
+    }
+
+    char *big = malloc((size_t)n + 1);
+    if (!big) {
+        fprintf(stderr, "Failed to allocate a %d byte result record\n", n);
+        exit(EXIT_FAILURE);
+    }
+    va_start(ap, fmt);
+    vsnprintf(big, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    pqb_writer_write(w, big, n);
+    free(big);
+}
+
+void pqb_writer_json_string(pqb_writer *w, const char *s) {
+    pqb_writer_write(w, "\"", 1);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            pqb_writer_printf(w, "\\%c", *s);
+        } else if ((unsigned char)*s < 0x20) {
+            pqb_writer_printf(w, "\\u%04x", *s);
+        } else {
+            pqb_writer_write(w, s, 1);
+        }
+    }
+    pqb_writer_write(w, "\"", 1);
+}
+
+void pqb_writer_close(pqb_writer *w) {
+    swap_buffers(w);
+    pthread_mutex_lock(&w->lock);
+    w->closing = 1;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    if (w->out != stdout) {
+        fclose(w->out);
+    }
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->cond);
+    free(w->buffers[0]);
+    free(w->buffers[1]);
+    free(w);
+}
@@ -0,0 +1,25 @@
+#ifndef PQB_WRITER_H
+#define PQB_WRITER_H
+
+#include <stddef.h>
+
+// Buffered output file drained by a background thread. Records are appended
+// to one in-memory buffer while the other is written out, so formatting a
+// record is a memcpy and never waits on the disk; the thread is kept off the
+// cpu that created the writer.
+typedef struct pqb_writer pqb_writer;
+
+// Open path for writing, "-" for stdout; exits on failure
+pqb_writer *pqb_writer_open(const char *path);
+
+void pqb_writer_write(pqb_writer *w, const void *data, size_t len);
+void pqb_writer_printf(pqb_writer *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// s as a quoted JSON string. Algorithm and op names are plain identifiers,
+// but quote defensively.
+void pqb_writer_json_string(pqb_writer *w, const char *s);
+
+// Write out everything still buffered, stop the thread and close the file
+void pqb_writer_close(pqb_writer *w);
+
+#endif
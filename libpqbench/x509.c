@@ -0,0 +1,57 @@
+#include "x509.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/x509v3.h>
+
+static X509_NAME *common_name(const char *cn) {
+    X509_NAME *name = X509_NAME_new();
+    if (!name || !X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_UTF8, (const unsigned char *)cn, -1, -1, 0)) {
+        fprintf(stderr, "Failed to build the certificate name %s\n", cn);
+        exit(EXIT_FAILURE);
+    }
+    return name;
+}
+
+static void add_extension(X509 *cert, int nid, const char *value) {
+    X509_EXTENSION *ext = X509V3_EXT_conf_nid(NULL, NULL, nid, value);
+    if (!ext || !X509_add_ext(cert, ext, -1)) {
+        fprintf(stderr, "Failed to add the certificate extension %s\n", value);
+        exit(EXIT_FAILURE);
+    }
+    X509_EXTENSION_free(ext);
+}
+
+X509 *pqb_x509_issue(OSSL_LIB_CTX *libctx, EVP_PKEY *subject_key, const char *subject_cn, EVP_PKEY *issuer_key,
+                     const char *issuer_cn, int ca) {
+    static long serial = 1;
+
+    X509 *cert = X509_new_ex(libctx, NULL);
+    X509_NAME *subject = common_name(subject_cn);
+    X509_NAME *issuer = common_name(issuer_cn);
+    if (!cert || !X509_set_version(cert, X509_VERSION_3) || !ASN1_INTEGER_set(X509_get_serialNumber(cert), serial++) ||
+        !X509_gmtime_adj(X509_getm_notBefore(cert), 0) ||
+        !X509_gmtime_adj(X509_getm_notAfter(cert), 365L * 24 * 60 * 60) || !X509_set_subject_name(cert, subject) ||
+        !X509_set_issuer_name(cert, issuer) || !X509_set_pubkey(cert, subject_key)) {
+        fprintf(stderr, "Failed to fill in the certificate of %s\n", subject_cn);
+        exit(EXIT_FAILURE);
+    }
+    X509_NAME_free(subject);
+    X509_NAME_free(issuer);
+    add_extension(cert, NID_basic_constraints, ca ? "critical,CA:TRUE" : "critical,CA:FALSE");
+    add_extension(cert, NID_key_usage, ca ? "critical,keyCertSign,cRLSign" : "critical,digitalSignature");
+
+    // "UNDEF" is the default of keys that must not be given one
+    char mdname[64] = "";
+    EVP_MD *md = NULL;
+    if (EVP_PKEY_get_default_digest_name(issuer_key, mdname, sizeof(mdname)) > 0 && strcmp(mdname, "UNDEF") != 0) {
+        md = EVP_MD_fetch(libctx, mdname, NULL);
+    }
+    if (X509_sign(cert, issuer_key, md) <= 0) {
+        fprintf(stderr, "Failed to sign the certificate of %s\n", subject_cn);
+        exit(EXIT_FAILURE);
+    }
+    EVP_MD_free(md);
+    return cert;
+}
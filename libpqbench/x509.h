@@ -0,0 +1,15 @@
+#ifndef PQB_X509_H
+#define PQB_X509_H
+
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+// Issue a version 3 certificate for subject_key with common name subject_cn,
+// signed by issuer_key under the name issuer_cn and valid for a year from
+// now. ca marks it as a certificate authority that may sign others. The
+// digest is the issuer key's default one, none for algorithms that sign the
+// message itself. Exits on failure.
+X509 *pqb_x509_issue(OSSL_LIB_CTX *libctx, EVP_PKEY *subject_key, const char *subject_cn, EVP_PKEY *issuer_key,
+                     const char *issuer_cn, int ca);
+
+#endif
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pqbench.h"
+
+// Runs a whole suite file in one process, see libpqbench/suite.h: the
+// providers are loaded once and the signature keys generated once, then
+// every section is measured over the same bench. Options on the command line
+// apply to every section, after the suite's own.
+
+typedef struct {
+    const char *path;
+    unsigned char *data;
+    size_t size;
+} payload;
+
+// Each file is mapped once however many sections sign it
+static void set_payload(pqb_bench *bench, payload *payloads, int *num_payloads, const char *path) {
+    if (!path) {
+        pqb_bench_set_payload(bench, NULL, 0);
+        return;
+    }
+    int p = 0;
+    while (p < *num_payloads && strcmp(payloads[p].path, path) != 0) {
+        p++;
+    }
+    if (p == *num_payloads) {
+        payloads[p].path = path;
+        payloads[p].data = pqb_map_file(path, &payloads[p].size);
+        (*num_payloads)++;
+    }
+    pqb_bench_set_payload(bench, payloads[p].data, payloads[p].size);
+}
+
+// What select_variants in cli.c would stop at, found before the first run
+static void check_variants(const pqb_suite_entry *entry, const pqb_options *opts) {
+    const pqb_family *family = entry->family;
+    const char *missing = NULL;
+    if (opts->chain > 0) {
+        missing = family->chain ? NULL : "certificate chains";
+    } else if (opts->paths) {
+        missing = family->paths ? NULL : "alternative paths";
+    } else if (opts->batch > 0) {
+        missing = family->batch ? NULL : "batch variant";
+    } else if (opts->contexts != PQB_CONTEXTS_COLD) {
+        missing = family->hot ? NULL : "hot variant";
+    }
+    if (missing) {
+        fprintf(stderr, "%s: [%s]: the %s family has no %s\n", entry->label, entry->name, family->name, missing);
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    pqb_options cli;
+    int first = pqb_parse_args(argc, argv, "<suite_file>", &cli);
+    if (argc - first != 1) {
+        pqb_usage(argv[0], "<suite_file>");
+    }
+    pqb_suite *suite = pqb_suite_load(argv[first]);
+
+    // Every section's options are checked before anything is measured
+    pqb_options opts;
+    pqb_suite_options(suite, NULL, argc, argv, first, &opts);
+    pqb_options *entry_opts = calloc(suite->num_entries, sizeof(pqb_options));
+    if (!entry_opts) {
+        fprintf(stderr, "Failed to allocate the suite's options\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int e = 0; e < suite->num_entries; e++) {
+        pqb_suite_entry *entry = &suite->entries[e];
+        pqb_suite_options(suite, entry, argc, argv, first, &entry_opts[e]);
+        if (entry->num_algs == 0 && !entry_opts[e].algorithms && !entry_opts[e].discover) {
+            fprintf(stderr, "%s: [%s] has no algorithms\n", entry->label, entry->name);
+            exit(EXIT_FAILURE);
+        }
+        check_variants(entry, &entry_opts[e]);
+    }
+
+    // Timers are set up the first time a section uses them: calibrating a
+    // cycle counter takes a while
+    pqb_timer timers[PQB_TIMER_CYCLES + 1];
+    int have_timer[PQB_TIMER_CYCLES + 1] = {0};
+    pqb_bench bench;
+    pqb_bench_init(&bench, suite->entries[0].timer, suite->entries[0].runs);
+    timers[bench.timer.kind] = bench.timer;
+    have_timer[bench.timer.kind] = 1;
+    for (int p = 0; p < suite->num_providers; p++) {
+        pqb_bench_load_provider(&bench, suite->providers[p]);
+    }
+    pqb_bench_share_keys(&bench);
+    if (suite->text_sink) {
+        pqb_bench_add_sink(&bench, pqb_text_sink_new(stdout));
+    }
+    // Sections may measure the same ops of the same algorithms, so each
+    // names its plots
+    pqb_sink *plots = NULL;
+    if (suite->plots) {
+        plots = pqb_plot_sink_new();
+        pqb_bench_add_sink(&bench, plots);
+    }
+    pqb_apply_options(&bench, &opts);
+
+    payload *payloads = calloc(suite->num_entries, sizeof(payload));
+    if (!payloads) {
+        fprintf(stderr, "Failed to allocate the suite's payloads\n");
+        exit(EXIT_FAILURE);
+    }
+    int num_payloads = 0;
+    for (int e = 0; e < suite->num_entries; e++) {
+        pqb_suite_entry *entry = &suite->entries[e];
+        if (!have_timer[entry->timer]) {
+            pqb_timer_init(&timers[entry->timer], entry->timer);
+            have_timer[entry->timer] = 1;
+        }
+        bench.timer = timers[entry->timer];
+        bench.runs = entry->runs;
+        set_payload(&bench, payloads, &num_payloads, entry->payload);
+        pqb_apply_run_options(&bench, &entry_opts[e]);
+        if (plots) {
+            pqb_plot_sink_set_variant(plots, entry->name);
+        }
+
+        printf("\n[%s] %s, %d runs\n", entry->name, entry->family->name, entry->runs);
+        fflush(stdout);
+        pqb_run_all_with_options(&bench, &entry_opts[e], entry->family, entry->algs, entry->num_algs);
+    }
+
+    // The bench closes the timer it holds, and the others are closed here
+    for (int t = 0; t <= PQB_TIMER_CYCLES; t++) {
+        if (have_timer[t] && t != (int)bench.timer.kind) {
+            pqb_timer_close(&timers[t]);
+        }
+    }
+    int status = pqb_bench_free(&bench);
+    for (int p = 0; p < num_payloads; p++) {
+        pqb_unmap_file(payloads[p].data, payloads[p].size);
+    }
+    free(payloads);
+    free(entry_opts);
+    pqb_suite_free(suite);
+
+    return status;
+}
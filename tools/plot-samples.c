@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plot.h"
+
+#if !PQB_HAVE_PLPLOT
+#error "plot-samples needs PLplot"
+#endif
+
+// Draws the histogram and CDF plots from the raw samples a driver wrote with
+// --ndjson, so the measuring run itself never has to load PLplot:
+//   plot-samples samples.ndjson
+// reads the file ("-" or no argument for stdin) and writes one pair of SVG
+// files per algorithm, op and thread count, in the raw sample unit.
+
+typedef struct {
+    char algorithm[128];
+    char op[64];
+    char unit[16];
+    int threads;
+    double *values;
+    size_t n;
+    size_t cap;
+} series;
+
+// Copy the string value of "key" out of one of our own NDJSON records
+static int string_field(const char *line, const char *key, char *out, size_t size) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":\"", key);
+    const char *p = strstr(line, pattern);
+    if (!p) {
+        return 0;
+    }
+    p += strlen(pattern);
+    size_t len = 0;
+    while (p[len] && p[len] != '"') {
+        len++;
+    }
+    if (len >= size) {
+        return 0;
+    }
+    memcpy(out, p, len);
+    out[len] = '\0';
+    return 1;
+}
+
+static int number_field(const char *line, const char *key, double *out) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p = strstr(line, pattern);
+    if (!p) {
+        return 0;
+    }
+    char *end;
+    *out = strtod(p + strlen(pattern), &end);
+    return end != p + strlen(pattern);
+}
+
+static series *find_series(series **all, size_t *num, size_t *cap, const char *algorithm, const char *op,
+                           const char *unit, int threads) {
+    for (size_t i = 0; i < *num; i++) {
+        series *s = &(*all)[i];
+        if (s->threads == threads && strcmp(s->algorithm, algorithm) == 0 && strcmp(s->op, op) == 0) {
+            return s;
+        }
+    }
+    if (*num == *cap) {
+        *cap = *cap ? *cap * 2 : 16;
+        *all = realloc(*all, *cap * sizeof(series));
+        if (!*all) {
+            fprintf(stderr, "Failed to allocate memory for %zu series\n", *cap);
+            exit(EXIT_FAILURE);
+        }
+    }
+    series *s = &(*all)[(*num)++];
+    memset(s, 0, sizeof(*s));
+    snprintf(s->algorithm, sizeof(s->algorithm), "%s", algorithm);
+    snprintf(s->op, sizeof(s->op), "%s", op);
+    snprintf(s->unit, sizeof(s->unit), "%s", unit);
+    s->threads = threads;
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [samples.ndjson]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    FILE *in = stdin;
+    if (argc == 2 && strcmp(argv[1], "-") != 0) {
+        in = fopen(argv[1], "r");
+        if (!in) {
+            perror(argv[1]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    series *all = NULL;
+    size_t num = 0, cap = 0;
+    char line[1024];
+    long lineno = 0;
+    while (fgets(line, sizeof(line), in)) {
+        lineno++;
+        char algorithm[128], op[64], unit[16];
+        double value, threads = 1;
+        if (!string_field(line, "algorithm", algorithm, sizeof(algorithm)) ||
+            !string_field(line, "op", op, sizeof(op)) || !string_field(line, "unit", unit, sizeof(unit)) ||
+            !number_field(line, "value", &value)) {
+            fprintf(stderr, "Skipping line %ld, not a sample record\n", lineno);
+            continue;
+        }
+        number_field(line, "threads", &threads);
+
+        series *s = find_series(&all, &num, &cap, algorithm, op, unit, (int)threads);
+        if (s->n == s->cap) {
+            s->cap = s->cap ? s->cap * 2 : 1024;
+            s->values = realloc(s->values, s->cap * sizeof(double));
+            if (!s->values) {
+                fprintf(stderr, "Failed to allocate memory for %zu samples\n", s->cap);
+                exit(EXIT_FAILURE);
+            }
+        }
+        s->values[s->n++] = value;
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+
+    for (size_t i = 0; i < num; i++) {
+        series *s = &all[i];
+        char op[96], axis_label[32];
+        if (s->threads > 1) {
+            snprintf(op, sizeof(op), "%s_%dthreads", s->op, s->threads);
+        } else {
+            snprintf(op, sizeof(op), "%s", s->op);
+        }
+        snprintf(axis_label, sizeof(axis_label), "Latency (%s)", s->unit);
+        pqb_plot_distribution(s->algorithm, op, s->values, s->n, axis_label);
+        printf("%s %s: %zu samples\n", s->algorithm, op, s->n);
+        free(s->values);
+    }
+    free(all);
+
+    return 0;
+}